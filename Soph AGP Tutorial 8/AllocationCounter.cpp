@@ -0,0 +1,60 @@
+#include "AllocationCounter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+static std::atomic<size_t> allocations{ 0 };
+
+//msvc's aligned blocks have to go back through _aligned_free, posix ones are plain free
+#ifdef _WIN32
+#define ALIGNED_ALLOC(size, alignment) _aligned_malloc(size, alignment)
+#define ALIGNED_FREE(p) _aligned_free(p)
+#else
+static void* AlignedAlloc(size_t size, size_t alignment) {
+	void* p = nullptr;
+	return posix_memalign(&p, std::max(alignment, sizeof(void*)), size) == 0 ? p : nullptr;
+}
+#define ALIGNED_ALLOC(size, alignment) AlignedAlloc(size, alignment)
+#define ALIGNED_FREE(p) free(p)
+#endif
+
+size_t AllocationCounter::GetCount() {
+	return allocations.load(std::memory_order_relaxed);
+}
+
+//the array and nothrow forms call one of these two, so they're the only ones that need
+//counting. std::vector, std::string, make_shared etc all go through them
+void* operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = ALIGNED_ALLOC(size ? size : 1, (size_t)alignment))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	ALIGNED_FREE(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+	ALIGNED_FREE(p);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+#include <cstddef>
+
+//counts heap allocations by replacing the global operator new, for benchmarks that want to see
+//how many a frame makes. the count is one relaxed atomic add per allocation, cheap enough to
+//leave in every build
+namespace AllocationCounter {
+	//allocations made with new on any thread since the program started
+	size_t GetCount();
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "AssetLoader.h"
+
+#include <chrono>
+#include <cfloat>
+
+#include "Renderer.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "Debug.h"
+
+AssetLoader::AssetLoader(Renderer& renderer, unsigned int threadCount)
+	: renderer(renderer), pool(threadCount, "Asset loader") {
+
+}
+
+AssetLoader::~AssetLoader() {
+	pool.DropQueued();
+}
+
+void AssetLoader::QueueUpload(std::function<void()> upload) {
+	std::lock_guard<std::mutex> lock(uploadsMutex);
+	uploads.push_back(std::move(upload));
+}
+
+std::string AssetLoader::MeshCacheKey(std::string path, const ModelLoadOptions& options) {
+	//only the options that change what ends up on the gpu, not how it was loaded
+	return ModelLoader::CanonicalPath(path)
+		+ "|" + std::to_string(options.optimise)
+		+ "|" + std::to_string((int)options.vertexLayout)
+		+ "|" + std::to_string(options.buildMeshlets)
+		+ "|" + std::to_string(options.lodCount)
+		+ "|" + std::to_string(options.occluderMaxError);
+}
+
+std::shared_ptr<Mesh> AssetLoader::LoadMesh(std::string path, ModelLoadOptions options) {
+	std::string key = MeshCacheKey(path, options);
+	if (auto cached = meshCache[key].lock()) {
+		meshCacheHits++;
+		return cached;
+	}
+	meshCacheMisses++;
+
+	auto mesh = std::make_shared<Mesh>(renderer);
+	std::weak_ptr<Mesh> target = mesh;
+	meshCache[key] = target;
+	pending++;
+
+	pool.Submit([this, path, options, target]() {
+		auto data = std::make_shared<MeshData>();
+		Mesh::Prepare(path, options, *data);
+
+		//upload only if someone still wants the mesh by then
+		QueueUpload([data, target]() {
+			if (auto mesh = target.lock())
+				mesh->Upload(*data);
+		});
+	});
+	return mesh;
+}
+
+std::shared_ptr<Texture> AssetLoader::LoadTexture(std::string path) {
+	auto texture = std::make_shared<Texture>(renderer);
+	std::weak_ptr<Texture> target = texture;
+	pending++;
+
+	pool.Submit([this, path, target]() {
+		auto data = std::make_shared<TextureData>();
+		Texture::Decode(path, *data);
+
+		QueueUpload([data, target]() {
+			if (auto texture = target.lock())
+				texture->Upload(*data);
+		});
+	});
+	return texture;
+}
+
+size_t AssetLoader::ProcessUploads(float timeBudgetMs) {
+	//take the whole queue so workers can keep adding while we upload
+	std::vector<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(uploadsMutex);
+		ready.swap(uploads);
+	}
+	if (ready.empty())
+		return 0;
+
+	auto start = std::chrono::steady_clock::now();
+	size_t done = 0;
+	while (done < ready.size()) {
+		ready[done]();
+		done++;
+		pending--;
+
+		std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= timeBudgetMs)
+			break;
+	}
+
+	//out of time, put the rest back at the front for next frame
+	if (done < ready.size()) {
+		std::lock_guard<std::mutex> lock(uploadsMutex);
+		uploads.insert(uploads.begin(), std::make_move_iterator(ready.begin() + done),
+			std::make_move_iterator(ready.end()));
+	}
+	return done;
+}
+
+MeshCacheStats AssetLoader::GetMeshCacheStats() {
+	MeshCacheStats stats;
+	stats.hits = meshCacheHits;
+	stats.misses = meshCacheMisses;
+
+	for (auto it = meshCache.begin(); it != meshCache.end();) {
+		auto mesh = it->second.lock();
+		if (!mesh) {
+			it = meshCache.erase(it);
+			continue;
+		}
+		stats.liveMeshes++;
+		stats.residentBytes += mesh->GetGpuBytes();
+		++it;
+	}
+	return stats;
+}
+
+void AssetLoader::WaitAll() {
+	while (pending > 0) {
+		pool.WaitIdle();
+		ProcessUploads(FLT_MAX);
+	}
+}
\ No newline at end of file
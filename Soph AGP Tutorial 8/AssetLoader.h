@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <unordered_map>
+
+#include "ThreadPool.h"
+#include "ModelLoader.h"
+
+class Renderer;
+class Mesh;
+class Texture;
+
+struct MeshCacheStats
+{
+	size_t hits = 0; //LoadMesh calls answered with a mesh already in memory
+	size_t misses = 0; //LoadMesh calls that had to load from disk
+	size_t liveMeshes = 0; //meshes somebody still holds
+	size_t residentBytes = 0; //gpu buffer memory used by those meshes
+};
+
+//loads meshes and textures in the background. parsing and decoding happen on the pool,
+//the finished data is queued and only the gpu upload runs on the render thread
+class AssetLoader
+{
+private:
+	Renderer& renderer;
+
+	std::mutex uploadsMutex;
+	std::vector<std::function<void()>> uploads; //ready to run on the render thread
+	std::atomic<size_t> pending{ 0 }; //requested but not uploaded yet
+
+	//meshes by path and options. weak so a mesh (and its buffers) is freed once the last
+	//GameObject lets go of it, the entry just expires and gets reloaded if asked for again.
+	//only touched from the thread calling LoadMesh, the workers never see it
+	std::unordered_map<std::string, std::weak_ptr<Mesh>> meshCache;
+	size_t meshCacheHits = 0;
+	size_t meshCacheMisses = 0;
+
+	//last so it's destroyed first, its jobs queue uploads into the members above
+	ThreadPool pool;
+
+	static std::string MeshCacheKey(std::string path, const ModelLoadOptions& options);
+
+	void QueueUpload(std::function<void()> upload);
+
+public:
+	AssetLoader(Renderer& renderer, unsigned int threadCount = 0);
+	//loads not started yet are dropped, only the ones already running are waited for
+	~AssetLoader();
+
+	//both return straight away with an empty asset, check IsResident() before using it.
+	//loading the same mesh twice with the same options gives back the same shared mesh
+	std::shared_ptr<Mesh> LoadMesh(std::string path, ModelLoadOptions options = {});
+	std::shared_ptr<Texture> LoadTexture(std::string path);
+
+	//uploads finished loads until timeBudgetMs runs out (always at least one), so a burst
+	//of loads finishing together doesn't hitch a frame. returns how many were uploaded
+	size_t ProcessUploads(float timeBudgetMs = 2.0f);
+
+	size_t GetPendingCount() { return pending; }
+	//also drops cache entries for meshes nobody holds anymore
+	MeshCacheStats GetMeshCacheStats();
+	//blocks until everything requested is loaded and uploaded, for loading screens
+	void WaitAll();
+};
\ No newline at end of file
@@ -0,0 +1,695 @@
+#include "Benchmarks.h"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <thread>
+#include <algorithm>
+
+#include "Renderer.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "GameObject.h"
+#include "SoftwareRasteriser.h"
+#include "ThreadPool.h"
+#include "ModelLoader.h"
+#include "AllocationCounter.h"
+#include "Frustum.h"
+#include "Profiler.h"
+
+namespace Benchmarks {
+	//the name and where its own arguments start
+	static const char* SplitName(const char* args, std::string& name) {
+		while (*args == ' ')
+			args++;
+		const char* end = args;
+		while (*end && *end != ' ')
+			end++;
+		name.assign(args, end);
+		return end;
+	}
+
+	//objects a scene benchmark added, taken back out of the renderer when it's done
+	class Scene
+	{
+	private:
+		Renderer& renderer;
+		std::vector<std::unique_ptr<GameObject>> objects;
+	public:
+		Scene(Renderer& renderer) : renderer(renderer) {}
+		~Scene() {
+			for (auto& obj : objects) {
+				renderer.RemoveGameObject(obj.get());
+			}
+		}
+
+		GameObject* Add(const char* name, std::shared_ptr<Mesh> mesh, DirectX::FXMVECTOR position) {
+			objects.push_back(std::make_unique<GameObject>(name, mesh));
+			objects.back()->transform.SetPosition(position);
+			renderer.RegisterGameObject(objects.back().get());
+			return objects.back().get();
+		}
+
+		//along the camera's forward, right and up from where it is now
+		DirectX::XMVECTOR InFront(float along, float across, float height) {
+			Transform& camera = renderer.camera.transform;
+			DirectX::XMVECTOR position = DirectX::XMVectorAdd(camera.GetPosition(), DirectX::XMVectorScale(camera.GetForward(), along));
+			position = DirectX::XMVectorAdd(position, DirectX::XMVectorScale(camera.GetRight(), across));
+			return DirectX::XMVectorAdd(position, DirectX::XMVectorScale(camera.GetUp(), height));
+		}
+
+		//width x height objects facing the camera, centred on its view, in layers spacing apart
+		//starting distance ahead
+		void AddGrid(std::shared_ptr<Mesh> mesh, int width, int height, int layers, float distance, float spacing) {
+			for (int layer = 0; layer < layers; layer++) {
+				for (int y = 0; y < height; y++) {
+					for (int x = 0; x < width; x++) {
+						Add("Benchmark", mesh, InFront(distance + layer * spacing, (x - width / 2) * spacing, (y - height / 2) * spacing));
+					}
+				}
+			}
+		}
+	};
+
+	//loads a model for a scene benchmark and waits for it, null if it didn't load
+	static std::shared_ptr<Mesh> LoadNow(Renderer& renderer, const std::string& path) {
+		std::string model = ModelOrSphere(path);
+		std::shared_ptr<Mesh> mesh = renderer.GetAssets().LoadMesh(model);
+		renderer.GetAssets().WaitAll();
+		if (!mesh->IsResident()) {
+			std::cout << "Failed to load " << model << std::endl;
+			return nullptr;
+		}
+		return mesh;
+	}
+
+	//the scene benchmarks, with whatever renderer they were given
+	static int RunScene(const std::string& name, const char* args, Renderer& renderer) {
+		if (!renderer.GetDevice() && WantsGpu(name.c_str()))
+			std::cout << "No gpu, gpu times will be 0" << std::endl;
+		if (name == "recording")
+			return Recording(renderer);
+		if (name == "prepass")
+			return DepthPrepass(renderer);
+		if (name == "occlusion")
+			return Occlusion(renderer);
+		return Software(renderer, args);
+	}
+
+	//a sphere obj with about this many faces in the temp directory, written the first time it's
+	//asked for. empty if it couldn't be
+	static std::string SphereWithFaces(int faces) {
+		int rings = std::max((int)sqrtf(faces / 4.0f), 2);
+		int segments = std::max(faces / (2 * rings), 3);
+		std::error_code error;
+		std::string path = (std::filesystem::temp_directory_path(error) / ("agp_sphere_" + std::to_string(faces) + ".obj")).string();
+		if (!std::ifstream{ path }) {
+			std::cout << "Writing " << path << std::endl;
+			if (!WriteSphereObj(path, rings, segments))
+				return "";
+		}
+		return path;
+	}
+
+	//just the parse and vertex dedup, no cache, optimising or anything the Mesh does after
+	static ModelLoadOptions ParseOnly(ModelLoadMode mode, unsigned int threads) {
+		ModelLoadOptions options;
+		options.mode = mode;
+		options.threadCount = threads;
+		options.useCache = false;
+		options.optimise = false;
+		return options;
+	}
+
+	//fastest of repeats loads, so one slow start from a cold file doesn't skew it
+	static float TimeLoad(const std::string& path, const ModelLoadOptions& options, int repeats, std::unique_ptr<ModelLoader>& loaded) {
+		float best = 0;
+		for (int i = 0; i < repeats; i++) {
+			loaded.reset();
+			auto start = std::chrono::steady_clock::now();
+			loaded = std::make_unique<ModelLoader>(path, options);
+			float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			best = i == 0 ? ms : std::min(best, ms);
+		}
+		return best;
+	}
+
+	//how long the latest zone with this name took, 0 if the profiler doesn't have one
+	static float LastZoneMs(const char* name) {
+		std::vector<Profiler::Event> events;
+		Profiler::Collect(events);
+		const Profiler::Event* last = nullptr;
+		for (const Profiler::Event& event : events) {
+			if (strcmp(event.name, name) == 0 && (!last || event.endNs > last->endNs))
+				last = &event;
+		}
+		return last ? (last->endNs - last->startNs) / 1e6f : 0;
+	}
+
+	//a load and the text parsing part of it, which is the loader's zone less the vertex dedup
+	//inside it. both modes dedup the same faces the same way, only the parsing differs
+	struct ParseTiming
+	{
+		float loadMs = 0;
+		float parseMs = 0;
+	};
+
+	//fastest of repeats loads on one thread, like TimeLoad, with the parse of that same load
+	static ParseTiming TimeParse(const std::string& path, ModelLoadMode mode, int repeats, std::unique_ptr<ModelLoader>& loaded) {
+		bool stream = mode == ModelLoadMode::STREAM;
+		const char* loadZone = stream ? "ModelLoader::LoadModelData" : "ModelLoader::LoadModelDataMapped";
+		const char* dedupZone = stream ? "ModelLoader::DedupFaces" : "ModelLoader::MergeChunks";
+		ParseTiming best;
+		for (int i = 0; i < repeats; i++) {
+			ParseTiming timing;
+			timing.loadMs = TimeLoad(path, ParseOnly(mode, 1), 1, loaded);
+			timing.parseMs = LastZoneMs(loadZone) - LastZoneMs(dedupZone);
+			if (i == 0 || timing.loadMs < best.loadMs)
+				best = timing;
+		}
+		return best;
+	}
+
+	//whether two loads gave exactly the same vertices and indices
+	static bool SameOutput(ModelLoader& a, ModelLoader& b) {
+		return a.GetVertexCount() == b.GetVertexCount() && a.GetIndexCount() == b.GetIndexCount()
+			&& memcmp(a.GetVertexData(), b.GetVertexData(), a.GetVertexBufferSize()) == 0
+			&& memcmp(a.GetIndexData(), b.GetIndexData(), a.GetIndexBufferSize()) == 0;
+	}
+
+	int Run(const char* args, Renderer* renderer) {
+		std::string name;
+		const char* rest = SplitName(args, name);
+		if (name == "frame")
+			return Frame(rest);
+		if (name == "load")
+			return Load(rest);
+		if (name == "parse")
+			return Parse(rest);
+		if (name == "threads")
+			return Threads(rest);
+		if (name == "cull")
+			return Cull(rest);
+
+		if (name != "recording" && name != "prepass" && name != "occlusion" && name != "software") {
+			std::cout << "Unknown benchmark \"" << name << "\", expected frame, load, parse, threads, cull, recording, prepass, occlusion or software" << std::endl;
+			return 1;
+		}
+		if (renderer)
+			return RunScene(name, rest, *renderer);
+
+		//from where the game starts, looking down +z
+		Renderer headless{ 800, 600, RenderBackend::NULL_DEVICE };
+		headless.camera.transform.SetPosition({ 0, 0, -5 });
+		int result = RunScene(name, rest, headless);
+		headless.Clean();
+		return result;
+	}
+
+	bool WriteSphereObj(const std::string& path, int rings, int segments) {
+		rings = std::max(rings, 2);
+		segments = std::max(segments, 3);
+		std::ofstream obj{ path, std::ios::trunc };
+		const float pi = 3.14159265f;
+		for (int r = 0; r <= rings; r++) {
+			float theta = pi * r / rings;
+			for (int s = 0; s <= segments; s++) {
+				float phi = 2 * pi * s / segments;
+				float x = sinf(theta) * cosf(phi), y = cosf(theta), z = sinf(theta) * sinf(phi);
+				obj << "v " << x << " " << y << " " << z << "\n";
+				obj << "vt " << (float)s / segments << " " << (float)r / rings << "\n";
+				obj << "vn " << x << " " << y << " " << z << "\n";
+			}
+		}
+		//obj indices start at 1, and every vertex has its own uv and normal
+		auto corner = [&](int r, int s) {
+			std::string i = std::to_string(r * (segments + 1) + s + 1);
+			return i + "/" + i + "/" + i;
+		};
+		for (int r = 0; r < rings; r++) {
+			for (int s = 0; s < segments; s++) {
+				obj << "f " << corner(r, s) << " " << corner(r + 1, s) << " " << corner(r + 1, s + 1) << "\n";
+				obj << "f " << corner(r, s) << " " << corner(r + 1, s + 1) << " " << corner(r, s + 1) << "\n";
+			}
+		}
+		return (bool)obj;
+	}
+
+	std::string ModelOrSphere(const std::string& path) {
+		if (std::ifstream{ path })
+			return path;
+		std::error_code error;
+		std::string sphere = (std::filesystem::temp_directory_path(error) / "agp_sphere.obj").string();
+		if (!std::ifstream{ sphere } && !WriteSphereObj(sphere, 32, 64))
+			return path; //loading it fails and says so
+		std::cout << path << " not found, using " << sphere << std::endl;
+		return sphere;
+	}
+
+	bool WantsGpu(const char* args) {
+		std::string name;
+		SplitName(args, name);
+		return name == "recording" || name == "prepass" || name == "occlusion";
+	}
+
+	int Frame(const char* args) {
+		int objectCount = 10000;
+		int frames = 100;
+		char backendName[16] = "null";
+		sscanf(args, "%d %d %15s", &objectCount, &frames, backendName);
+		objectCount = std::max(objectCount, 1);
+		frames = std::max(frames, 1);
+		bool recording = strcmp(backendName, "record") == 0;
+
+		Renderer renderer{ 800, 600, recording ? RenderBackend::RECORDING : RenderBackend::NULL_DEVICE };
+		AssetLoader& assets = renderer.GetAssets();
+		std::string model = ModelOrSphere("Assets/Models/fish.obj");
+		std::shared_ptr<Mesh> mesh = assets.LoadMesh(model);
+		std::shared_ptr<Texture> texture = assets.LoadTexture("Assets/Textures/fish_texture.png");
+		renderer.texture = texture.get();
+		assets.WaitAll();
+		if (!mesh->IsResident()) {
+			std::cout << "Failed to load " << model << std::endl;
+			renderer.Clean();
+			return 1;
+		}
+
+		//wider than the view, so the frustum has something to cull. one draw per object rather than
+		//one instanced draw for the lot, like a scene of different meshes would need
+		renderer.camera.transform.SetPosition({ 0, 0, -5 });
+		renderer.instancingMinObjects = UINT_MAX;
+		int side = (int)ceilf(sqrtf((float)objectCount));
+		std::vector<std::unique_ptr<GameObject>> scene;
+		for (int i = 0; i < objectCount; i++) {
+			scene.push_back(std::make_unique<GameObject>("Benchmark", mesh));
+			scene.back()->transform.SetPosition({ (i % side - side / 2) * 1.5f, (i / side - side / 2) * 1.5f, 60, 1 });
+			renderer.RegisterGameObject(scene.back().get());
+		}
+
+		//the first frame sizes every scratch list, what's left after that is the steady state
+		renderer.RenderFrame();
+		size_t allocationsBefore = AllocationCounter::GetCount();
+		size_t streamCommands = 0;
+		size_t streamBytes = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			renderer.RenderFrame();
+			streamCommands += renderer.GetRecordedFrame().GetCommandCount();
+			streamBytes += renderer.GetRecordedFrame().GetByteSize();
+		}
+		double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		size_t allocations = AllocationCounter::GetCount() - allocationsBefore;
+
+		const FrameStats& stats = renderer.GetFrameStats();
+		std::cout << (recording ? "record" : "null") << ", " << objectCount << " objects, " << frames << " frames" << std::endl;
+		std::cout << "frame ms: " << ns / frames / 1e6 << std::endl;
+		std::cout << "ns per object: " << ns / frames / objectCount << std::endl;
+		std::cout << "allocations per frame: " << (double)allocations / frames << std::endl;
+		std::cout << "objects drawn: " << stats.objectsDrawn << ", culled: " << stats.objectsCulled
+			<< ", draw calls: " << stats.drawCalls << ", state changes: " << stats.stateChanges << std::endl;
+		std::cout << "one pass state changes, registration order: " << stats.stateChangesUnsorted
+			<< ", sorted: " << stats.stateChangesSorted << std::endl;
+		std::cout << "state object binds: " << stats.stateBinds << ", skipped as redundant: " << stats.stateBindsSkipped << std::endl;
+		if (recording) {
+			std::cout << "stream commands per frame: " << streamCommands / frames
+				<< ", bytes per frame: " << streamBytes / frames << std::endl;
+		}
+
+		for (auto& obj : scene) {
+			renderer.RemoveGameObject(obj.get());
+		}
+		renderer.Clean();
+		return 0;
+	}
+
+	int Load(const char* args) {
+		int maxFaces = 1000000;
+		sscanf(args, "%d", &maxFaces);
+
+		std::cout << "faces, vertices, indices, load ms, ns per face, vs smallest" << std::endl;
+		float firstNs = 0;
+		for (int faces : { 10000, 100000, 1000000 }) {
+			if (faces > maxFaces)
+				break;
+			std::string path = SphereWithFaces(faces);
+			if (path.empty()) {
+				std::cout << "Failed to write a " << faces << " face sphere" << std::endl;
+				return 1;
+			}
+			std::unique_ptr<ModelLoader> model;
+			float ms = TimeLoad(path, ParseOnly(ModelLoadMode::MAPPED, 1), faces < 1000000 ? 5 : 2, model);
+			if (model->GetIndexCount() == 0) {
+				std::cout << "Failed to load " << path << std::endl;
+				return 1;
+			}
+			//the sphere's face count is only about what was asked for
+			size_t loadedFaces = model->GetIndexCount() / 3;
+			float ns = ms * 1e6f / loadedFaces;
+			if (firstNs == 0)
+				firstNs = ns;
+			std::cout << loadedFaces << ", " << model->GetVertexCount() << ", " << model->GetIndexCount() << ", "
+				<< ms << ", " << ns << ", " << ns / firstNs << std::endl;
+		}
+		std::cout << "a linear loader keeps ns per face flat as faces grow" << std::endl;
+		return 0;
+	}
+
+	int Parse(const char* args) {
+		const float target = 10.0f; //times faster the mapped parse is meant to be
+		int faces = 1000000;
+		sscanf(args, "%d", &faces);
+		std::string path = SphereWithFaces(std::max(faces, 1));
+		std::error_code error;
+		float mb = (float)std::filesystem::file_size(path, error) / (1024 * 1024);
+		if (path.empty() || error) {
+			std::cout << "Failed to write a " << faces << " face sphere" << std::endl;
+			return 1;
+		}
+
+		std::unique_ptr<ModelLoader> stream, mapped;
+		ParseTiming streamMs = TimeParse(path, ModelLoadMode::STREAM, 3, stream);
+		ParseTiming mappedMs = TimeParse(path, ModelLoadMode::MAPPED, 3, mapped);
+		if (stream->GetIndexCount() == 0 || mapped->GetIndexCount() == 0) {
+			std::cout << "Failed to load " << path << std::endl;
+			return 1;
+		}
+
+		std::cout << path << ", " << mb << " MB" << std::endl;
+		std::cout << "mode, load ms, load MB/s, parse ms, parse MB/s" << std::endl;
+		std::cout << "stream, " << streamMs.loadMs << ", " << mb * 1000 / streamMs.loadMs
+			<< ", " << streamMs.parseMs << ", " << mb * 1000 / streamMs.parseMs << std::endl;
+		std::cout << "mapped, " << mappedMs.loadMs << ", " << mb * 1000 / mappedMs.loadMs
+			<< ", " << mappedMs.parseMs << ", " << mb * 1000 / mappedMs.parseMs << std::endl;
+		float speedup = streamMs.parseMs / mappedMs.parseMs;
+		std::cout << "mapped loads " << streamMs.loadMs / mappedMs.loadMs << "x faster, parses " << speedup
+			<< "x faster against a " << target << "x target (" << (speedup >= target ? "met" : "MISSED") << ")" << std::endl;
+		std::cout << "output " << (SameOutput(*stream, *mapped) ? "identical" : "DIFFERENT") << std::endl;
+		return SameOutput(*stream, *mapped) ? 0 : 1;
+	}
+
+	int Threads(const char* args) {
+		int faces = 1000000;
+		unsigned int maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		sscanf(args, "%d %u", &faces, &maxThreads);
+		maxThreads = std::max(maxThreads, 1u);
+		std::string path = SphereWithFaces(std::max(faces, 1));
+		std::error_code error;
+		float mb = (float)std::filesystem::file_size(path, error) / (1024 * 1024);
+		if (path.empty() || error) {
+			std::cout << "Failed to write a " << faces << " face sphere" << std::endl;
+			return 1;
+		}
+
+		//doubling up to the most asked for, then that itself if it isn't a power of two
+		std::vector<unsigned int> threadCounts;
+		for (unsigned int threads = 1; threads < maxThreads; threads *= 2) {
+			threadCounts.push_back(threads);
+		}
+		threadCounts.push_back(maxThreads);
+
+		std::cout << path << ", " << mb << " MB" << std::endl;
+		std::cout << "threads, load ms, MB/s, speedup, same as 1 thread" << std::endl;
+		std::unique_ptr<ModelLoader> serial;
+		float serialMs = 0;
+		bool allSame = true;
+		for (unsigned int threads : threadCounts) {
+			std::unique_ptr<ModelLoader> model;
+			float ms = TimeLoad(path, ParseOnly(ModelLoadMode::MAPPED, threads), 3, model);
+			if (model->GetIndexCount() == 0) {
+				std::cout << "Failed to load " << path << std::endl;
+				return 1;
+			}
+			if (!serial) {
+				serial = std::move(model);
+				serialMs = ms;
+			}
+			bool same = !model || SameOutput(*serial, *model);
+			allSame = allSame && same;
+			std::cout << threads << ", " << ms << ", " << mb * 1000 / ms << ", " << serialMs / ms << ", " << (same ? "yes" : "NO") << std::endl;
+		}
+		return allSame ? 0 : 1;
+	}
+
+	int Cull(const char* args) {
+		const int runs = 20;
+		int objects = 100000;
+		sscanf(args, "%d", &objects);
+		objects = std::max(objects, 1);
+
+		//the game's camera at the origin looking down +z, with objects anywhere in a box 240 units
+		//across around it. a few percent of them end up in view
+		Frustum frustum{ DirectX::XMMatrixLookToLH(DirectX::XMVectorZero(), DirectX::XMVectorSet(0, 0, 1, 0), DirectX::XMVectorSet(0, 1, 0, 0))
+			* DirectX::XMMatrixPerspectiveFovLH(DirectX::XMConvertToRadians(60), 4.0f / 3.0f, 0.1f, 100.0f) };
+		SphereList spheres;
+		unsigned int seed = 1234;
+		auto next = [&]() {
+			seed = seed * 1664525u + 1013904223u;
+			return (seed >> 8) / 16777216.0f;
+		};
+		for (int i = 0; i < objects; i++) {
+			spheres.Add({ next() * 240 - 120, next() * 240 - 120, next() * 240 - 120 }, 0.1f + next() * 4);
+		}
+
+		std::vector<uint8_t> simdVisible, scalarVisible(spheres.Size());
+		size_t simdCount = 0, scalarCount = 0;
+		float simdMs = 0, scalarMs = 0;
+		for (int run = 0; run < runs; run++) {
+			auto start = std::chrono::steady_clock::now();
+			simdCount = frustum.CullSpheres(spheres, simdVisible);
+			float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			simdMs = run == 0 ? ms : std::min(simdMs, ms);
+
+			start = std::chrono::steady_clock::now();
+			scalarCount = 0;
+			for (size_t i = 0; i < spheres.Size(); i++) {
+				scalarVisible[i] = frustum.IntersectsSphere({ spheres.x[i], spheres.y[i], spheres.z[i] }, spheres.radius[i]) ? 1 : 0;
+				scalarCount += scalarVisible[i];
+			}
+			ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			scalarMs = run == 0 ? ms : std::min(scalarMs, ms);
+		}
+
+		bool same = simdCount == scalarCount && simdVisible == scalarVisible;
+		std::cout << objects << " objects, " << simdCount << " visible" << std::endl;
+		std::cout << "path, ms, ns per object" << std::endl;
+		std::cout << "scalar, " << scalarMs << ", " << scalarMs * 1e6f / objects << std::endl;
+		std::cout << "simd, " << simdMs << ", " << simdMs * 1e6f / objects << std::endl;
+		std::cout << "simd is " << scalarMs / simdMs << "x faster, results " << (same ? "identical" : "DIFFERENT") << std::endl;
+		return same ? 0 : 1;
+	}
+
+	int Recording(Renderer& renderer) {
+		const int gridSize = 48; //objects along each side
+		const int framesPerRun = 60;
+
+		std::shared_ptr<Mesh> mesh = LoadNow(renderer, "Assets/Models/sphere.obj");
+		if (!mesh)
+			return 1;
+		Scene scene{ renderer };
+		scene.AddGrid(mesh, gridSize, gridSize, 1, 60.0f, 1.5f);
+
+		//one draw per object, otherwise they'd all become a single instanced draw
+		unsigned int oldInstancing = renderer.instancingMinObjects;
+		size_t oldChunkSize = renderer.drawChunkSize;
+		unsigned int oldThreads = renderer.recordThreads;
+		renderer.instancingMinObjects = UINT_MAX;
+
+		unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+		std::cout << "chunk size, threads, command lists, draws, state binds, skipped binds, submit ms" << std::endl;
+		for (size_t chunkSize : { 0, 64, 128, 256, 512, 1024 }) {
+			for (unsigned int threads = 1; threads <= cores; threads *= 2) {
+				renderer.drawChunkSize = chunkSize;
+				renderer.recordThreads = threads;
+
+				float submitMs = 0;
+				for (int frame = 0; frame < framesPerRun; frame++) {
+					renderer.RenderFrame();
+					submitMs += renderer.GetFrameStats().submitMs;
+				}
+				const FrameStats& stats = renderer.GetFrameStats();
+				std::cout << chunkSize << ", " << threads << ", " << stats.commandLists << ", "
+					<< stats.drawCalls << ", " << stats.stateBinds << ", " << stats.stateBindsSkipped << ", " << submitMs / framesPerRun << std::endl;
+
+				if (chunkSize == 0)
+					break; //everything's on the immediate context, threads make no difference
+			}
+		}
+
+		renderer.instancingMinObjects = oldInstancing;
+		renderer.drawChunkSize = oldChunkSize;
+		renderer.recordThreads = oldThreads;
+		return 0;
+	}
+
+	int DepthPrepass(Renderer& renderer) {
+		const int warmupFrames = 8; //gpu timings come back a few frames late
+		const int framesPerRun = 60;
+
+		std::shared_ptr<Mesh> mesh = LoadNow(renderer, "Assets/Models/sphere.obj");
+		if (!mesh)
+			return 1;
+		Scene scene{ renderer };
+		scene.AddGrid(mesh, 12, 12, 16, 12.0f, 1.2f);
+
+		bool oldPrepass = renderer.depthPrepass;
+		GpuProfiler& gpu = renderer.GetGpuProfiler();
+		std::cout << "pre-pass, depth prepass ms, shading ms, gpu frame ms, pre-pass draws" << std::endl;
+		float shadingWithout = 0, shadingWith = 0, prepassWith = 0;
+		for (bool prepass : { false, true }) {
+			renderer.depthPrepass = prepass;
+			float prepassMs = 0, shadingMs = 0, frameMs = 0;
+			for (int frame = 0; frame < warmupFrames + framesPerRun; frame++) {
+				renderer.RenderFrame();
+				if (frame < warmupFrames)
+					continue;
+				prepassMs += prepass ? gpu.GetMs("Depth prepass") : 0;
+				shadingMs += gpu.GetMs("Shading");
+				frameMs += gpu.GetMs("Frame");
+			}
+			prepassMs /= framesPerRun;
+			shadingMs /= framesPerRun;
+			frameMs /= framesPerRun;
+			std::cout << (prepass ? "on" : "off") << ", " << prepassMs << ", " << shadingMs << ", " << frameMs
+				<< ", " << renderer.GetFrameStats().depthPrepassDraws << std::endl;
+			(prepass ? shadingWith : shadingWithout) = shadingMs;
+			if (prepass)
+				prepassWith = prepassMs;
+		}
+		std::cout << "pre-pass cost " << prepassWith << "ms, shading saved " << shadingWithout - shadingWith << "ms" << std::endl;
+
+		//the equal test only passes if both passes' vertex shaders put every vertex at exactly the
+		//same depth, which is what precise is there for. any pixel the two frames don't agree on
+		//is one the shading pass lost to z-fighting
+		std::vector<uint32_t> frames[2];
+		for (bool prepass : { false, true }) {
+			renderer.depthPrepass = prepass;
+			renderer.readBackNextFrame = true;
+			renderer.RenderFrame();
+			frames[prepass] = renderer.GetReadBackFrame();
+		}
+		renderer.depthPrepass = oldPrepass;
+		if (frames[0].empty() || frames[0].size() != frames[1].size()) {
+			std::cout << "no frames read back to compare" << std::endl;
+			return 0;
+		}
+		size_t differing = 0;
+		for (size_t i = 0; i < frames[0].size(); i++) {
+			differing += frames[0][i] != frames[1][i];
+		}
+		std::cout << "pixels differing with the pre-pass " << differing << " of " << frames[0].size() << std::endl;
+		return differing == 0 ? 0 : 1;
+	}
+
+	int Occlusion(Renderer& renderer) {
+		const int occluderCount = 8;
+		const float occluderScale = 4.0f;
+		const int warmupFrames = 8;
+		const int framesPerRun = 120;
+		const float strafeDistance = 20.0f; //along the camera's right, centred on where it started
+
+		std::shared_ptr<Mesh> occluderMesh = LoadNow(renderer, "Assets/Models/sphere.obj");
+		std::shared_ptr<Mesh> mesh = LoadNow(renderer, "Assets/Models/fish.obj");
+		if (!occluderMesh || !mesh)
+			return 1;
+		Scene scene{ renderer };
+		for (int i = 0; i < occluderCount; i++) {
+			GameObject* occluder = scene.Add("Occluder", occluderMesh, scene.InFront(10.0f, (i - occluderCount / 2) * occluderScale * 1.7f, 0));
+			occluder->transform.SetScale(DirectX::XMVectorReplicate(occluderScale));
+			occluder->occluder = true;
+		}
+		scene.AddGrid(mesh, 40, 10, 4, 20.0f, 1.5f);
+
+		Transform& cameraTransform = renderer.camera.transform;
+		DirectX::XMVECTOR cameraStart = cameraTransform.GetPosition();
+		DirectX::XMVECTOR strafe = DirectX::XMVectorScale(cameraTransform.GetRight(), strafeDistance);
+		bool oldOcclusion = renderer.occlusionCulling;
+		GpuProfiler& gpu = renderer.GetGpuProfiler();
+		std::cout << "occlusion, objects tested, occluded %, occlusion cull ms, submit ms, gpu frame ms" << std::endl;
+		for (bool occlusion : { false, true }) {
+			renderer.occlusionCulling = occlusion;
+			size_t tested = 0, occluded = 0;
+			float occlusionMs = 0, submitMs = 0, frameMs = 0;
+			for (int frame = 0; frame < warmupFrames + framesPerRun; frame++) {
+				float t = (float)std::max(frame - warmupFrames, 0) / framesPerRun;
+				cameraTransform.SetPosition(DirectX::XMVectorAdd(cameraStart, DirectX::XMVectorScale(strafe, t - 0.5f)));
+				renderer.RenderFrame();
+				if (frame < warmupFrames)
+					continue;
+				const FrameStats& stats = renderer.GetFrameStats();
+				tested += stats.objectsTested - (stats.objectsCulled - stats.occlusion.objectsOccluded); //in the frustum
+				occluded += stats.occlusion.objectsOccluded;
+				occlusionMs += stats.occlusionMs;
+				submitMs += stats.submitMs;
+				frameMs += gpu.GetMs("Frame");
+			}
+			std::cout << (occlusion ? "on" : "off") << ", " << tested / framesPerRun << ", "
+				<< (tested ? 100.0f * occluded / tested : 0.0f) << ", " << occlusionMs / framesPerRun << ", "
+				<< submitMs / framesPerRun << ", " << frameMs / framesPerRun << std::endl;
+		}
+
+		renderer.occlusionCulling = oldOcclusion;
+		cameraTransform.SetPosition(cameraStart);
+		return 0;
+	}
+
+	int Software(Renderer& renderer, const char* args) {
+		const int warmupFrames = 2;
+		const int frames = 10;
+		int width = 800;
+		int height = 600;
+		sscanf(args, "%d %d", &width, &height);
+
+		//its own renderer on the software backend, seeing what the given one sees. the frame
+		//goes through RenderFrame like any other, culling, lods, materials and sorting included
+		Renderer software{ width, height, RenderBackend::SOFTWARE };
+		software.camera = renderer.camera;
+		int result = 1;
+		{
+			//the game's opening scene, a fish and a tinted sphere either side of where the camera starts
+			std::shared_ptr<Mesh> fish = LoadNow(software, "Assets/Models/fish.obj");
+			std::shared_ptr<Mesh> sphere = LoadNow(software, "Assets/Models/sphere.obj");
+			if (fish && sphere) {
+				std::shared_ptr<Material> fishMaterial = std::make_shared<Material>();
+				fishMaterial->texture = software.GetAssets().LoadTexture("Assets/Textures/fish_texture.png");
+				std::shared_ptr<Material> sphereMaterial = std::make_shared<Material>();
+				sphereMaterial->colour = { 1, 0.6f, 0.6f, 1 };
+				software.GetAssets().WaitAll();
+
+				Scene scene{ software };
+				scene.Add("Fish", fish, DirectX::XMVectorSet(-3, 0, 0, 1))->material = fishMaterial;
+				scene.Add("Sphere", sphere, DirectX::XMVectorSet(3, 0, 0, 1))->material = sphereMaterial;
+
+				//the first frames upload what loaded, fastest of the rest
+				float bestFrameMs = 0, bestSoftwareMs = 0;
+				for (int frame = 0; frame < warmupFrames + frames; frame++) {
+					auto start = std::chrono::steady_clock::now();
+					software.RenderFrame();
+					float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+					if (frame < warmupFrames)
+						continue;
+					if (frame == warmupFrames || ms < bestFrameMs) {
+						bestFrameMs = ms;
+						bestSoftwareMs = software.GetFrameStats().softwareMs;
+					}
+				}
+
+				SoftwareRasteriser& rasteriser = software.GetSoftwareRasteriser();
+				const SoftwareRasteriserStats& stats = rasteriser.GetStats();
+				std::cout << "Software frame " << bestFrameMs << "ms, " << bestSoftwareMs << "ms of it rasterising, "
+					<< stats.trianglesRasterised << " of " << stats.trianglesSubmitted << " triangles rasterised, "
+					<< stats.pixelsShaded << " pixels shaded" << std::endl;
+				std::cout << (rasteriser.WriteTga("software.tga") ? "Wrote software.tga" : "Failed to write software.tga") << std::endl;
+				result = 0;
+			}
+		}
+		software.Clean();
+		return result;
+	}
+}
\ No newline at end of file
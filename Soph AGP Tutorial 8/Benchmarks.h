@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+
+class Renderer;
+
+//the command line benchmarks, shared by the game's -benchmark and the agp_benchmark tool. each
+//prints csv-ish lines to stdout and returns a process exit code
+namespace Benchmarks {
+	//args is the benchmark's name followed by its own arguments, "frame 10000 100 record". renderer
+	//is what benchmarks timing the gpu draw with, null gives them a headless 800x600 one instead
+	int Run(const char* args, Renderer* renderer = nullptr);
+
+	//whether the named benchmark measures anything on the gpu, so is worth giving a window
+	bool WantsGpu(const char* args);
+
+	//frame <objects> <frames> [null|record]. times RenderFrame's cpu side, culling through to
+	//submission, over a grid of fish with no window or gpu, and prints ns per object and heap
+	//allocations per frame. record also captures every bind and draw and prints how big that was
+	int Frame(const char* args);
+
+	//load [max faces]. loads generated spheres of 10k, 100k and 1M faces on one thread with no
+	//cache or optimising, so what's timed is the parse and vertex dedup, and prints ns per face
+	//for each. if the loader's linear that stays flat
+	int Load(const char* args);
+	//parse [faces]. the same generated sphere, 1M faces unless asked otherwise, through the
+	//getline and stringstream loader and the memory mapped one, both on one thread. prints MB/s
+	//for each, whole load and just the parse without the dedup both do, with the parse speedup
+	//against the 10x target. fails if they don't give byte for byte the same output
+	int Parse(const char* args);
+	//threads [faces] [max threads]. the mapped loader on the generated sphere at 1, 2, 4... threads
+	//up to every core. prints MB/s and speedup over one thread, and fails if any thread count
+	//gives different output to one
+	int Threads(const char* args);
+	//cull [objects]. 100k random bounding spheres around the game's camera, unless asked for some
+	//other number, through Frustum::CullSpheres four at a time and through IntersectsSphere one at
+	//a time. prints the best of several runs for each and the speedup, and fails if they disagree
+	int Cull(const char* args);
+
+	//the rest draw from wherever the renderer's camera is, into a scene they add and take away
+	//again. recording, prepass and occlusion want a real device for their gpu times, headless
+	//they still give the cpu side
+
+	//recording. a 48x48 grid of spheres rendered at every draw chunk size and recording thread
+	//count, printing how long submission took so we can see how it scales
+	int Recording(Renderer& renderer);
+	//prepass. 16 layers of spheres one behind another so most pixels are covered many times
+	//over, with and without the depth pre-pass. prints the pre-pass's gpu time next to what it
+	//saved in shading, then fails if a frame with it differs from one without by even a pixel
+	int DepthPrepass(Renderer& renderer);
+	//occlusion. a row of big spheres with a grid of fish behind, the camera strafing past on the
+	//same path with occlusion culling off and on
+	int Occlusion(Renderer& renderer);
+	//software [width height]. the game's opening scene rendered by a SOFTWARE backend renderer
+	//from renderer's camera, written to software.tga to compare against the window
+	int Software(Renderer& renderer, const char* args);
+
+	//a radius 1 uv sphere as an obj with positions, uvs and normals, 2 * rings * segments faces.
+	//for when a benchmark or test wants a model of a known size rather than one off disk
+	bool WriteSphereObj(const std::string& path, int rings, int segments);
+	//path if it can be opened, otherwise a sphere written to the temp folder to stand in for it.
+	//Assets/Models isn't checked in, so fresh checkouts only have the stand in
+	std::string ModelOrSphere(const std::string& path);
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "CommandStream.h"
+
+#include <cstring>
+
+//values each op is followed by, in the order a to e
+static const int valueCounts[(int)StreamOp::COUNT] = { 1, 1, 1, 1, 0, 2, 1, 3, 5 };
+
+void CommandStream::WriteOp(StreamOp op) {
+	bytes.push_back((uint8_t)op);
+	commandCount++;
+}
+
+void CommandStream::WriteValue(uint32_t value) {
+	//seven bits a byte, low first, top bit set while more follow. ids, offsets and counts are
+	//mostly small, so most values take one or two bytes instead of four
+	while (value >= 0x80) {
+		bytes.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	bytes.push_back((uint8_t)value);
+}
+
+void CommandStream::BeginPass(bool depthOnly) {
+	WriteOp(StreamOp::BEGIN_PASS);
+	WriteValue(depthOnly);
+}
+
+void CommandStream::SetLayer(bool transparent) {
+	WriteOp(StreamOp::SET_LAYER);
+	WriteValue(transparent);
+}
+
+void CommandStream::SetShader(bool instanced) {
+	WriteOp(StreamOp::SET_SHADER);
+	WriteValue(instanced);
+}
+
+void CommandStream::SetTexture(uint32_t texture) {
+	WriteOp(StreamOp::SET_TEXTURE);
+	WriteValue(texture);
+}
+
+void CommandStream::SetMaterial(DirectX::XMFLOAT4 colour) {
+	WriteOp(StreamOp::SET_MATERIAL);
+	size_t at = bytes.size();
+	bytes.resize(at + sizeof(colour));
+	memcpy(bytes.data() + at, &colour, sizeof(colour));
+}
+
+void CommandStream::SetGeometry(uint32_t arena, bool instanced) {
+	WriteOp(StreamOp::SET_GEOMETRY);
+	WriteValue(arena);
+	WriteValue(instanced);
+}
+
+void CommandStream::SetObject(uint32_t constants) {
+	WriteOp(StreamOp::SET_OBJECT);
+	WriteValue(constants);
+}
+
+void CommandStream::Draw(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex) {
+	WriteOp(StreamOp::DRAW);
+	WriteValue(indexCount);
+	WriteValue(firstIndex);
+	WriteValue((uint32_t)baseVertex);
+}
+
+void CommandStream::DrawInstanced(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex, uint32_t instanceCount, uint32_t firstInstance) {
+	WriteOp(StreamOp::DRAW_INSTANCED);
+	WriteValue(indexCount);
+	WriteValue(firstIndex);
+	WriteValue((uint32_t)baseVertex);
+	WriteValue(instanceCount);
+	WriteValue(firstInstance);
+}
+
+void CommandStream::Append(const CommandStream& other) {
+	bytes.insert(bytes.end(), other.bytes.begin(), other.bytes.end());
+	commandCount += other.commandCount;
+}
+
+void CommandStream::Clear() {
+	bytes.clear();
+	commandCount = 0;
+}
+
+bool CommandStream::SetBytes(const uint8_t* data, size_t size) {
+	bytes.assign(data, data + size);
+	commandCount = 0;
+	size_t offset = 0;
+	Command command;
+	while (Read(offset, command)) {
+		commandCount++;
+	}
+	if (offset != bytes.size()) {
+		Clear();
+		return false;
+	}
+	return true;
+}
+
+bool CommandStream::Read(size_t& offset, Command& command) const {
+	if (offset >= bytes.size() || bytes[offset] >= (uint8_t)StreamOp::COUNT)
+		return false;
+
+	size_t at = offset;
+	command = Command();
+	command.op = (StreamOp)bytes[at++];
+	if (command.op == StreamOp::SET_MATERIAL) {
+		if (bytes.size() - at < sizeof(command.colour))
+			return false;
+		memcpy(&command.colour, bytes.data() + at, sizeof(command.colour));
+		offset = at + sizeof(command.colour);
+		return true;
+	}
+
+	uint32_t* values[5] = { &command.a, &command.b, &command.c, &command.d, &command.e };
+	for (int i = 0; i < valueCounts[(int)command.op]; i++) {
+		uint32_t value = 0;
+		for (int shift = 0;; shift += 7) {
+			if (at >= bytes.size() || shift > 28)
+				return false;
+			uint8_t byte = bytes[at++];
+			value |= (uint32_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				break;
+		}
+		*values[i] = value;
+	}
+	offset = at;
+	return true;
+}
\ No newline at end of file
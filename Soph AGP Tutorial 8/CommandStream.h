@@ -0,0 +1,68 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <DirectXMath.h>
+
+//what a recorded command does. everything the renderer binds or draws while submitting a frame
+enum class StreamOp : uint8_t
+{
+	BEGIN_PASS, //targets, viewport, per frame buffers. a = 1 for the depth pre-pass
+	SET_LAYER, //blend and depth state, a = 1 transparent
+	SET_SHADER, //vertex shader, a = 1 instanced
+	SET_TEXTURE, //a = texture id, 0 for none
+	SET_MATERIAL, //colour
+	SET_GEOMETRY, //a = geometry pool arena, b = 1 instanced
+	SET_OBJECT, //a = which of the frame's per object constant blocks
+	DRAW, //a = index count, b = first index, c = base vertex
+	DRAW_INSTANCED, //a = index count, b = first index, c = base vertex, d = instance count, e = first instance
+	COUNT
+};
+
+//a frame's binds and draws written one after another, each an op byte followed by only the
+//values that op uses, so a few thousand draws come to tens of kilobytes. no d3d in here,
+//it's what the recording backend keeps instead of calling the device
+class CommandStream
+{
+public:
+	//one command read back out, fields the op doesn't use are 0
+	struct Command
+	{
+		StreamOp op = StreamOp::COUNT;
+		uint32_t a = 0, b = 0, c = 0, d = 0, e = 0;
+		DirectX::XMFLOAT4 colour{ 0, 0, 0, 0 }; //SET_MATERIAL only
+	};
+
+private:
+	std::vector<uint8_t> bytes;
+	size_t commandCount = 0;
+
+	void WriteOp(StreamOp op);
+	void WriteValue(uint32_t value);
+
+public:
+	void BeginPass(bool depthOnly);
+	void SetLayer(bool transparent);
+	void SetShader(bool instanced);
+	void SetTexture(uint32_t texture);
+	void SetMaterial(DirectX::XMFLOAT4 colour);
+	void SetGeometry(uint32_t arena, bool instanced);
+	void SetObject(uint32_t constants);
+	void Draw(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex);
+	void DrawInstanced(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex, uint32_t instanceCount, uint32_t firstInstance);
+
+	//adds everything other recorded after what's here, for stitching chunks back into frame order
+	void Append(const CommandStream& other);
+	//keeps the memory for the next frame
+	void Clear();
+	//replaces what's here with bytes from another stream's GetBytes, a saved capture say. false,
+	//leaving it empty, if they don't read back as whole commands
+	bool SetBytes(const uint8_t* data, size_t size);
+
+	//reads the command at offset and moves offset past it. false at the end, or if what's there
+	//isn't a whole command
+	bool Read(size_t& offset, Command& command) const;
+
+	size_t GetCommandCount() const { return commandCount; }
+	size_t GetByteSize() const { return bytes.size(); }
+	const uint8_t* GetBytes() const { return bytes.data(); }
+};
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include "ConstantBufferRing.h"
+
+#ifndef HEADLESS_ONLY
+#include <d3d11_1.h>
+#endif
+#include <algorithm>
+#include <cstdint>
+
+#include "Debug.h"
+
+ConstantBufferRing::~ConstantBufferRing() {
+	Release();
+}
+
+#ifndef HEADLESS_ONLY
+
+bool ConstantBufferRing::Init(ID3D11Device* device, ID3D11DeviceContext* devCon, unsigned int capacity) {
+	dev = device;
+
+	//offsets into constant buffers are an 11.1 feature, and optional even then
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	if (FAILED(dev->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options)))
+		|| !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer) {
+		LOG("Constant buffer offsetting not supported, using one constant buffer per draw");
+		return false;
+	}
+	if (FAILED(devCon->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&devCon1))) {
+		LOG("No ID3D11DeviceContext1, using one constant buffer per draw");
+		return false;
+	}
+
+	return CreateBuffer(capacity);
+}
+
+bool ConstantBufferRing::CreateBuffer(unsigned int capacity) {
+	if (buffer) buffer->Release();
+	buffer = nullptr;
+
+	D3D11_BUFFER_DESC cbd = { 0 };
+	cbd.Usage = D3D11_USAGE_DYNAMIC;
+	cbd.ByteWidth = RingAllocator::Align(capacity);
+	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	cbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	if (FAILED(dev->CreateBuffer(&cbd, NULL, &buffer))) {
+		LOG("Failed to create constant buffer ring");
+		return false;
+	}
+	ring.Reset(cbd.ByteWidth);
+	return true;
+}
+
+void* ConstantBufferRing::Begin(unsigned int blockCount, unsigned int blockSize) {
+	blockStride = RingAllocator::Align(blockSize);
+	if (blockCount == 0 || !buffer)
+		return nullptr;
+
+	unsigned int size = blockCount * blockStride;
+	if (!ring.Allocate(size, span)) {
+		//more objects than ever before, grow and start over in the new buffer
+		if (!CreateBuffer(std::max(size, ring.GetCapacity() * 2)) || !ring.Allocate(size, span))
+			return nullptr;
+	}
+
+	//no overwrite promises the driver we won't touch anything the gpu may still be reading,
+	//which holds until the ring wraps and discard hands us a fresh copy
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(devCon1->Map(buffer, 0, span.discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped))) {
+		LOG("Failed to map constant buffer ring");
+		return nullptr;
+	}
+	return (uint8_t*)mapped.pData + span.offset;
+}
+
+void ConstantBufferRing::End() {
+	devCon1->Unmap(buffer, 0);
+}
+
+void ConstantBufferRing::BindVS(ID3D11DeviceContext1* context, unsigned int slot, unsigned int block) {
+	//offsets and sizes are counted in 16 byte constants
+	UINT firstConstant = (span.offset + block * blockStride) / 16;
+	UINT constantCount = blockStride / 16;
+	context->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &constantCount);
+}
+
+void ConstantBufferRing::Release() {
+	if (buffer) buffer->Release();
+	if (devCon1) devCon1->Release();
+	buffer = nullptr;
+	devCon1 = nullptr;
+}
+
+#else
+
+//offsets need 11.1, so without d3d11 at all it's never supported and the renderer falls back
+//to a constant buffer per draw, which headless only counts
+
+bool ConstantBufferRing::Init(ID3D11Device*, ID3D11DeviceContext*, unsigned int) {
+	return false;
+}
+
+bool ConstantBufferRing::CreateBuffer(unsigned int) {
+	return false;
+}
+
+void* ConstantBufferRing::Begin(unsigned int, unsigned int blockSize) {
+	blockStride = RingAllocator::Align(blockSize);
+	return nullptr;
+}
+
+void ConstantBufferRing::End() {}
+void ConstantBufferRing::BindVS(ID3D11DeviceContext1*, unsigned int, unsigned int) {}
+void ConstantBufferRing::Release() {}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "RingAllocator.h"
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11DeviceContext1;
+struct ID3D11Buffer;
+
+//one big dynamic constant buffer the whole frame's per object constants are written into with a
+//single map, each draw then binds its own 256 byte block by offset. needs d3d 11.1 constant
+//buffer offsetting, Init returns false without it and the caller keeps its old path
+class ConstantBufferRing
+{
+private:
+	ID3D11Device* dev = nullptr;
+	ID3D11DeviceContext1* devCon1 = nullptr;
+	ID3D11Buffer* buffer = nullptr;
+	RingAllocator ring;
+
+	RingAllocator::Span span; //this frame's blocks
+	unsigned int blockStride = 0;
+
+	bool CreateBuffer(unsigned int capacity);
+
+public:
+	ConstantBufferRing() = default;
+	~ConstantBufferRing();
+
+	bool Init(ID3D11Device* dev, ID3D11DeviceContext* devCon, unsigned int capacity = 1 << 20);
+	bool IsSupported() { return buffer != nullptr; }
+
+	//maps room for blockCount blocks of blockSize bytes, each starting 256 bytes apart.
+	//returns where to write block 0, or null if it failed. call End before drawing
+	void* Begin(unsigned int blockCount, unsigned int blockSize);
+	void End();
+	unsigned int GetBlockStride() { return blockStride; }
+
+	//binds one block from the last Begin to a vertex shader constant buffer slot. any 11.1
+	//context works, deferred ones included, as long as it's executed after End
+	void BindVS(ID3D11DeviceContext1* context, unsigned int slot, unsigned int block);
+
+	unsigned int GetWrapCount() { return ring.GetWrapCount(); }
+	void Release();
+
+	ConstantBufferRing(const ConstantBufferRing&) = delete;
+	ConstantBufferRing& operator=(const ConstantBufferRing&) = delete;
+};
\ No newline at end of file
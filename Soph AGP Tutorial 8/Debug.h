@@ -2,10 +2,17 @@
 #include <string>
 
 #if _DEBUG
+#ifdef _WIN32
+#include <windows.h>
+#define LOG_WRITE(text) OutputDebugStringA(text)
+#else
+#include <cstdio>
+#define LOG_WRITE(text) fputs(text, stderr)
+#endif
 #define LOGLINE(msg) \
-	OutputDebugStringA(std::string(msg) + "\n".c_str())
+	LOG_WRITE((std::string(msg) + "\n").c_str())
 #define LOG(msg) \
-	OutputDebugStringA((std::string(__FILE__) + "(" + std::to_string(__LINE__) \
+	LOG_WRITE((std::string(__FILE__) + "(" + std::to_string(__LINE__) \
 		 + "): " + std::string(msg) + "\n").c_str())
 #else
 #define LOGLINE(msg)
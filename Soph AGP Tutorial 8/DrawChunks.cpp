@@ -0,0 +1,52 @@
+#include "DrawChunks.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace DrawChunks {
+
+	void Partition(size_t commandCount, size_t chunkSize, std::vector<Chunk>& chunks) {
+		chunks.clear();
+		if (commandCount == 0)
+			return;
+		if (chunkSize == 0 || chunkSize >= commandCount) {
+			chunks.push_back(Chunk{ 0, commandCount });
+			return;
+		}
+
+		for (size_t first = 0; first < commandCount; first += chunkSize) {
+			chunks.push_back(Chunk{ first, std::min(chunkSize, commandCount - first) });
+		}
+
+		if (chunks.size() > 1 && chunks.back().count < chunkSize / 4) {
+			size_t leftover = chunks.back().count;
+			chunks.pop_back();
+			chunks.back().count += leftover;
+		}
+	}
+
+	void Record(ThreadPool& pool, size_t chunkCount, unsigned int maxThreads, const std::function<void(size_t)>& record) {
+		if (chunkCount == 0)
+			return;
+
+		//threads take the next chunk as they finish one, rather than a fixed share each, so a
+		//slow chunk doesn't hold up ones that could go elsewhere
+		std::atomic<size_t> next{ 0 };
+		auto work = [&]() {
+			for (size_t chunk = next++; chunk < chunkCount; chunk = next++) {
+				record(chunk);
+			}
+		};
+
+		size_t helpers = std::min(pool.GetThreadCount(), chunkCount - 1);
+		if (maxThreads > 0)
+			helpers = std::min(helpers, (size_t)maxThreads - 1);
+		for (size_t i = 0; i < helpers; i++) {
+			pool.Submit(work);
+		}
+
+		work();
+		pool.WaitIdle(); //work and next live on this stack, helpers must be done with them
+	}
+}
\ No newline at end of file
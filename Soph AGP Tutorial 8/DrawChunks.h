@@ -0,0 +1,27 @@
+#pragma once
+#include <vector>
+#include <functional>
+
+class ThreadPool;
+
+//splits a frame's sorted draw commands so several threads can record them at once. each chunk
+//goes into its own deferred context, and the command lists are executed in chunk order
+//afterwards, so the gpu still sees every draw in the order it was sorted into
+namespace DrawChunks {
+	struct Chunk
+	{
+		size_t first; //first command in the chunk
+		size_t count;
+	};
+
+	//chunkSize commands per chunk, 0 keeps everything in one. a short last chunk is folded into
+	//the one before it when it's under a quarter of chunkSize, a command list that small costs
+	//more to execute than it saved recording
+	void Partition(size_t commandCount, size_t chunkSize, std::vector<Chunk>& chunks);
+
+	//calls record once for every chunk index, on up to maxThreads threads including the calling
+	//one (0 uses the whole pool). which thread gets which chunk isn't fixed, so record should
+	//only write to things owned by its chunk. returns once every chunk is done. the pool has to
+	//be one nothing else submits to, this waits for it to go idle
+	void Record(ThreadPool& pool, size_t chunkCount, unsigned int maxThreads, const std::function<void(size_t)>& record);
+}
\ No newline at end of file
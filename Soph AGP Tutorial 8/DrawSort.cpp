@@ -0,0 +1,59 @@
+#include "DrawSort.h"
+
+#include <algorithm>
+
+namespace DrawSort {
+
+	uint64_t MakeKey(bool transparent, unsigned int arena, unsigned int material, unsigned int mesh,
+		unsigned int lod, float depth) {
+
+		uint64_t depthBits = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * 0xFFFFFF);
+		uint64_t state = ((uint64_t)(arena & 0xF) << 34) | ((uint64_t)(material & 0x3FFF) << 20)
+			| ((uint64_t)(mesh & 0xFFFF) << 4) | (lod & 0xF);
+
+		if (transparent) {
+			//farthest first, so depth is flipped and goes above the state
+			return (1ull << 62) | ((0xFFFFFF - depthBits) << 38) | state;
+		}
+		return (state << 24) | depthBits;
+	}
+
+	void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values,
+		std::vector<uint64_t>& keyScratch, std::vector<uint32_t>& valueScratch) {
+
+		size_t count = keys.size();
+		keyScratch.resize(count);
+		valueScratch.resize(count);
+
+		//count every byte's digits in one go rather than a pass per byte
+		size_t histograms[8][256] = {};
+		for (uint64_t key : keys) {
+			for (int b = 0; b < 8; b++)
+				histograms[b][(key >> (b * 8)) & 0xFF]++;
+		}
+
+		//least significant byte first, each pass is stable so earlier bytes stay sorted within later ones
+		for (int b = 0; b < 8; b++) {
+			size_t* histogram = histograms[b];
+			//every key has the same digit here, this pass wouldn't move anything. common for the
+			//high bytes when there are only a few meshes and materials
+			if (histogram[(keys.empty() ? 0 : (keys[0] >> (b * 8)) & 0xFF)] == count)
+				continue;
+
+			size_t offset = 0;
+			for (int d = 0; d < 256; d++) {
+				size_t digits = histogram[d];
+				histogram[d] = offset;
+				offset += digits;
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				size_t to = histogram[(keys[i] >> (b * 8)) & 0xFF]++;
+				keyScratch[to] = keys[i];
+				valueScratch[to] = values[i];
+			}
+			keys.swap(keyScratch);
+			values.swap(valueScratch);
+		}
+	}
+}
\ No newline at end of file
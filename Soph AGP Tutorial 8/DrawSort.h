@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+//64 bit keys that put a frame's draws in a cheap order to submit them in, and a radix sort for them.
+//from the top bit down:
+//  opaque       layer 2 | arena 4 | material 14 | mesh 16 | lod 4 | depth 24, front to back
+//  transparent  layer 2 | far to near depth 24 | arena 4 | material 14 | mesh 16 | lod 4
+//arena is the mesh's geometry pool arena, which decides the input layout and buffers, and
+//material covers the texture and the per material constants
+//so opaque draws group by state and only use depth to break ties, while transparent ones
+//must stay in depth order for blending and only group when depths tie
+namespace DrawSort {
+	//depth is 0 at the camera and 1 at the far plane, ids wrap at their field size
+	uint64_t MakeKey(bool transparent, unsigned int arena, unsigned int material, unsigned int mesh,
+		unsigned int lod, float depth);
+
+	//sorts keys smallest first, carrying values along. the scratch vectors are only
+	//there so repeated calls don't reallocate
+	void RadixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values,
+		std::vector<uint64_t>& keyScratch, std::vector<uint32_t>& valueScratch);
+}
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "FrameCapture.h"
+
+#include <fstream>
+#include <cstring>
+#include <unordered_map>
+
+#include "MappedFile.h"
+#include "Debug.h"
+
+using namespace DirectX;
+
+//laid out as [header][geometry][textures][frames]. geometry is each GeometryHeader followed by
+//its vertices and indices, textures each TextureHeader then rgba pixels, and frames each
+//FrameHeader then its FrameGeometry, texture indices, object constants, instances and stream
+struct CaptureHeader
+{
+	char magic[4];
+	uint32_t version;
+	int32_t width;
+	int32_t height;
+	uint32_t geometryCount;
+	uint32_t textureCount;
+	uint32_t frameCount;
+};
+
+struct GeometryHeader
+{
+	uint32_t layout;
+	uint32_t vertexStride;
+	uint32_t shortIndices;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+};
+
+struct TextureHeader
+{
+	uint32_t id;
+	uint32_t width;
+	uint32_t height;
+};
+
+struct FrameHeader
+{
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMFLOAT4 cameraPosition;
+	XMFLOAT4 clearColour;
+	float time;
+	uint32_t geometryCount;
+	uint32_t textureCount;
+	uint32_t objectCount;
+	uint32_t instanceCount;
+	uint32_t streamSize;
+};
+
+struct FrameGeometry
+{
+	uint32_t geometry; //into the file's geometry
+	uint32_t arena;
+	uint32_t vertexOffset;
+	uint32_t indexOffset;
+};
+
+//bump whenever the layout or anything it records changes
+const uint32_t captureVersion = 2;
+const char captureMagic[4] = { 'A', 'G', 'P', 'C' };
+
+static size_t IndexBytes(const GeometryData& data) {
+	return (size_t)data.indexCount * (data.shortIndices ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
+//every index has to name one of the geometry's own vertices, replays read vertices through them
+static bool IndicesInRange(const GeometryData& data) {
+	for (uint32_t i = 0; i < data.indexCount; i++) {
+		uint32_t index;
+		if (data.shortIndices) {
+			uint16_t shortIndex;
+			memcpy(&shortIndex, &data.indices[i * sizeof(uint16_t)], sizeof(shortIndex));
+			index = shortIndex;
+		}
+		else {
+			memcpy(&index, &data.indices[i * sizeof(uint32_t)], sizeof(index));
+		}
+		if (index >= data.vertexCount)
+			return false;
+	}
+	return true;
+}
+
+bool FrameCapture::Save(const std::string& path) const {
+	//number every distinct mesh and texture, frames share them by pointer
+	std::vector<const GeometryData*> geometry;
+	std::vector<const CapturedTexture*> textures;
+	std::unordered_map<const GeometryData*, uint32_t> geometryIndices;
+	std::unordered_map<const TextureData*, uint32_t> textureIndices;
+	for (const CapturedFrame& frame : frames) {
+		for (const CapturedGeometry& captured : frame.geometry) {
+			if (geometryIndices.emplace(captured.data.get(), (uint32_t)geometry.size()).second)
+				geometry.push_back(captured.data.get());
+		}
+		for (const CapturedTexture& captured : frame.textures) {
+			if (textureIndices.emplace(captured.data.get(), (uint32_t)textures.size()).second)
+				textures.push_back(&captured);
+		}
+	}
+
+	std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+	if (!file) {
+		LOG("Failed to write capture " + path);
+		return false;
+	}
+	auto write = [&](const void* data, size_t size) { file.write((const char*)data, size); };
+
+	CaptureHeader header = {};
+	memcpy(header.magic, captureMagic, sizeof(header.magic));
+	header.version = captureVersion;
+	header.width = width;
+	header.height = height;
+	header.geometryCount = (uint32_t)geometry.size();
+	header.textureCount = (uint32_t)textures.size();
+	header.frameCount = (uint32_t)frames.size();
+	write(&header, sizeof(header));
+
+	for (const GeometryData* data : geometry) {
+		GeometryHeader geometryHeader = { (uint32_t)data->layout, data->vertexStride, data->shortIndices, data->vertexCount, data->indexCount };
+		write(&geometryHeader, sizeof(geometryHeader));
+		write(data->vertices.data(), (size_t)data->vertexCount * data->vertexStride);
+		write(data->indices.data(), IndexBytes(*data));
+	}
+	for (const CapturedTexture* texture : textures) {
+		TextureHeader textureHeader = { texture->id, texture->data->width, texture->data->height };
+		write(&textureHeader, sizeof(textureHeader));
+		write(texture->data->pixels.data(), (size_t)textureHeader.width * textureHeader.height * 4);
+	}
+
+	for (const CapturedFrame& frame : frames) {
+		FrameHeader frameHeader = { frame.view, frame.projection, frame.cameraPosition, frame.clearColour, frame.time,
+			(uint32_t)frame.geometry.size(), (uint32_t)frame.textures.size(), (uint32_t)frame.objectConstants.size(),
+			(uint32_t)frame.instances.size(), (uint32_t)frame.stream.GetByteSize() };
+		write(&frameHeader, sizeof(frameHeader));
+		for (const CapturedGeometry& captured : frame.geometry) {
+			FrameGeometry entry = { geometryIndices[captured.data.get()], captured.arena, captured.vertexOffset, captured.indexOffset };
+			write(&entry, sizeof(entry));
+		}
+		for (const CapturedTexture& captured : frame.textures) {
+			uint32_t index = textureIndices[captured.data.get()];
+			write(&index, sizeof(index));
+		}
+		write(frame.objectConstants.data(), frame.objectConstants.size() * sizeof(CBuffer_PerObject));
+		write(frame.instances.data(), frame.instances.size() * sizeof(CBuffer_PerObject));
+		write(frame.stream.GetBytes(), frame.stream.GetByteSize());
+	}
+
+	if (!file) {
+		LOG("Failed to write capture " + path);
+		return false;
+	}
+	return true;
+}
+
+bool FrameCapture::Load(const std::string& path) {
+	frames.clear();
+	MappedFile file{ path };
+	if (!file.IsOpen()) {
+		LOG("Failed to open capture " + path);
+		return false;
+	}
+
+	const uint8_t* at = (const uint8_t*)file.GetData();
+	const uint8_t* end = at + file.GetSize();
+	//every read is checked against what's left, a cut short file fails rather than overruns
+	auto read = [&](void* out, size_t size) {
+		if (size > (size_t)(end - at))
+			return false;
+		memcpy(out, at, size);
+		at += size;
+		return true;
+	};
+	//sized from the file, so checked before resizing or a corrupt count could ask for anything
+	auto readVector = [&](auto& out, size_t count) {
+		if (count > (size_t)(end - at) / sizeof(out[0]))
+			return false;
+		out.resize(count);
+		return read(out.data(), count * sizeof(out[0]));
+	};
+	auto truncated = [&]() {
+		LOG("Capture " + path + " is truncated or corrupt");
+		frames.clear();
+		return false;
+	};
+
+	CaptureHeader header;
+	if (!read(&header, sizeof(header)) || memcmp(header.magic, captureMagic, sizeof(header.magic)) != 0
+		|| header.version != captureVersion) {
+		LOG(path + " isn't a capture from this version");
+		return false;
+	}
+	width = header.width;
+	height = header.height;
+
+	std::vector<std::shared_ptr<const GeometryData>> geometry;
+	for (uint32_t i = 0; i < header.geometryCount; i++) {
+		GeometryHeader geometryHeader;
+		if (!read(&geometryHeader, sizeof(geometryHeader)) || geometryHeader.layout > (uint32_t)VertexLayout::QUANTISED)
+			return truncated();
+		auto data = std::make_shared<GeometryData>();
+		data->layout = (VertexLayout)geometryHeader.layout;
+		data->vertexStride = geometryHeader.vertexStride;
+		data->shortIndices = geometryHeader.shortIndices != 0;
+		data->vertexCount = geometryHeader.vertexCount;
+		data->indexCount = geometryHeader.indexCount;
+		if (data->vertexStride != VertexFormats::GetStride(data->layout)
+			|| !readVector(data->vertices, (size_t)data->vertexCount * data->vertexStride)
+			|| !readVector(data->indices, IndexBytes(*data)) || !IndicesInRange(*data))
+			return truncated();
+		geometry.push_back(std::move(data));
+	}
+
+	std::vector<CapturedTexture> textures;
+	for (uint32_t i = 0; i < header.textureCount; i++) {
+		TextureHeader textureHeader;
+		if (!read(&textureHeader, sizeof(textureHeader)))
+			return truncated();
+		auto data = std::make_shared<TextureData>();
+		data->width = textureHeader.width;
+		data->height = textureHeader.height;
+		if (!readVector(data->pixels, (size_t)data->width * data->height * 4))
+			return truncated();
+		textures.push_back(CapturedTexture{ textureHeader.id, std::move(data) });
+	}
+
+	for (uint32_t i = 0; i < header.frameCount; i++) {
+		FrameHeader frameHeader;
+		if (!read(&frameHeader, sizeof(frameHeader)))
+			return truncated();
+		CapturedFrame& frame = frames.emplace_back();
+		frame.view = frameHeader.view;
+		frame.projection = frameHeader.projection;
+		frame.cameraPosition = frameHeader.cameraPosition;
+		frame.clearColour = frameHeader.clearColour;
+		frame.time = frameHeader.time;
+
+		for (uint32_t g = 0; g < frameHeader.geometryCount; g++) {
+			FrameGeometry entry;
+			if (!read(&entry, sizeof(entry)) || entry.geometry >= geometry.size())
+				return truncated();
+			frame.geometry.push_back(CapturedGeometry{ entry.arena, entry.vertexOffset, entry.indexOffset, geometry[entry.geometry] });
+		}
+		for (uint32_t t = 0; t < frameHeader.textureCount; t++) {
+			uint32_t index;
+			if (!read(&index, sizeof(index)) || index >= textures.size())
+				return truncated();
+			frame.textures.push_back(textures[index]);
+		}
+		std::vector<uint8_t> stream;
+		if (!readVector(frame.objectConstants, frameHeader.objectCount) || !readVector(frame.instances, frameHeader.instanceCount)
+			|| !readVector(stream, frameHeader.streamSize) || !frame.stream.SetBytes(stream.data(), stream.size()))
+			return truncated();
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <DirectXMath.h>
+
+#include "VertexFormats.h"
+#include "Texture.h"
+#include "CommandStream.h"
+
+//the vertex shader's per object constants, and what the instance buffer holds per instance.
+//world is affine, so only three rows go up
+struct CBuffer_PerObject
+{
+	DirectX::XMFLOAT3X4 world;
+	//inverse transpose of world's 3x3 stored the same way, for normals under any scale or shear.
+	//the matrix never reads the w column, so m[0][3] says how NORMAL is stored: 1 for octahedral
+	//(COMPACT and QUANTISED), 0 for the plain float3 of FULL
+	DirectX::XMFLOAT3X4 normalWorld;
+};
+
+//a mesh's vertices and indices as they went into the geometry pool. the pool only keeps these
+//when the renderer's keepCaptureData is on, shared so captures hold on to them after a free
+struct GeometryData
+{
+	VertexLayout layout = VertexLayout::FULL;
+	uint32_t vertexStride = 0;
+	bool shortIndices = false;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	std::vector<uint8_t> vertices; //interleaved in the layout's format
+	std::vector<uint8_t> indices; //16 or 32 bit, relative to the mesh's first vertex
+};
+
+//where some geometry sat in the pool when a frame drew it, the stream's draws index the arena
+//directly so replays put it back in the same place
+struct CapturedGeometry
+{
+	uint32_t arena = 0;
+	uint32_t vertexOffset = 0;
+	uint32_t indexOffset = 0;
+	std::shared_ptr<const GeometryData> data;
+};
+
+struct CapturedTexture
+{
+	uint32_t id = 0; //Texture::GetId, what SET_TEXTURE names
+	std::shared_ptr<const TextureData> data; //top mip
+};
+
+//everything one RenderFrame sent to the device apart from the resources themselves
+struct CapturedFrame
+{
+	DirectX::XMFLOAT4X4 view;
+	DirectX::XMFLOAT4X4 projection;
+	DirectX::XMFLOAT4 cameraPosition;
+	DirectX::XMFLOAT4 clearColour;
+	float time = 0; //the per frame buffer's, seconds since the renderer started
+	std::vector<CapturedGeometry> geometry; //what the visible objects were drawn from
+	std::vector<CapturedTexture> textures;
+	std::vector<CBuffer_PerObject> objectConstants; //SET_OBJECT's a indexes these
+	std::vector<CBuffer_PerObject> instances; //DRAW_INSTANCED's first instance indexes these
+	CommandStream stream;
+};
+
+//a few frames of renderer activity with the meshes and textures they used, saved to a file
+//that FrameReplay plays back anywhere, no d3d or window needed. geometry and textures shared
+//between frames are only written once
+struct FrameCapture
+{
+	int width = 0;
+	int height = 0;
+	std::vector<CapturedFrame> frames;
+
+	bool Save(const std::string& path) const;
+	//false if the file is missing, from another version or cut short
+	bool Load(const std::string& path);
+};
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "FrameReplay.h"
+
+#include <chrono>
+
+#include "SoftwareRasteriser.h"
+#include "Profiler.h"
+
+using namespace DirectX;
+
+FrameReplay::FrameReplay(const FrameCapture& capture)
+	: capture(capture) {
+}
+
+const FrameReplay::Unpacked& FrameReplay::Unpack(const std::shared_ptr<const GeometryData>& source) {
+	auto found = unpacked.find(source.get());
+	if (found != unpacked.end() && !found->second.source.expired())
+		return found->second;
+
+	const GeometryData& data = *source;
+	Unpacked& out = unpacked[source.get()];
+	out.source = source;
+	out.vertices.resize(data.vertexCount);
+	VertexFormats::Unpack(data.vertices.data(), data.vertexCount, data.layout, out.vertices.data());
+	out.indices.resize(data.indexCount);
+	for (uint32_t i = 0; i < data.indexCount; i++) {
+		out.indices[i] = data.shortIndices ? ((const uint16_t*)data.indices.data())[i] : ((const uint32_t*)data.indices.data())[i];
+	}
+	return out;
+}
+
+ReplayFrameStats FrameReplay::Replay(size_t frameIndex, ReplayTarget target, SoftwareRasteriser* rasteriser, ThreadPool* pool,
+	std::vector<ReplayDraw>& draws) {
+	PROFILE_ZONE("FrameReplay::Replay");
+	using Clock = std::chrono::steady_clock;
+	auto frameStart = Clock::now();
+	ReplayFrameStats stats;
+	const CapturedFrame& frame = capture.frames[frameIndex];
+	bool software = target == ReplayTarget::SOFTWARE && rasteriser && pool;
+
+	//draws name their geometry by the arena bound and their base vertex, which no two
+	//allocations in an arena share. unpacked up front so it isn't timed as part of a draw
+	auto locationKey = [](uint32_t arena, uint32_t vertexOffset) { return ((uint64_t)arena << 32) | vertexOffset; };
+	located.clear();
+	for (auto it = unpacked.begin(); it != unpacked.end();)
+		it = it->second.source.expired() ? unpacked.erase(it) : std::next(it);
+	for (const CapturedGeometry& geometry : frame.geometry) {
+		located[locationKey(geometry.arena, geometry.vertexOffset)] = &geometry;
+		if (software)
+			Unpack(geometry.data);
+	}
+
+	if (software)
+		rasteriser->Begin(XMLoadFloat4x4(&frame.view) * XMLoadFloat4x4(&frame.projection), frame.clearColour);
+	size_t firstDraw = draws.size();
+	rasterised.clear();
+
+	//what the stream has bound so far
+	bool depthOnly = false;
+	bool transparent = false;
+	uint32_t texture = 0;
+	const TextureData* textureData = nullptr; //null draws untextured, like the renderer's white placeholder
+	XMFLOAT4 colour = { 1, 1, 1, 1 };
+	uint32_t arena = UINT32_MAX;
+	uint32_t object = 0;
+
+	size_t offset = 0;
+	CommandStream::Command command;
+	for (size_t index = 0; frame.stream.Read(offset, command); index++) {
+		stats.commands++;
+		switch (command.op) {
+		case StreamOp::BEGIN_PASS:
+			depthOnly = command.a != 0;
+			arena = UINT32_MAX;
+			continue;
+		case StreamOp::SET_LAYER:
+			transparent = command.a != 0;
+			continue;
+		case StreamOp::SET_TEXTURE:
+			texture = command.a;
+			textureData = nullptr;
+			for (const CapturedTexture& captured : frame.textures) {
+				if (captured.id == texture)
+					textureData = captured.data.get();
+			}
+			continue;
+		case StreamOp::SET_MATERIAL:
+			colour = command.colour;
+			continue;
+		case StreamOp::SET_GEOMETRY:
+			arena = command.a;
+			continue;
+		case StreamOp::SET_OBJECT:
+			object = command.a;
+			continue;
+		case StreamOp::DRAW:
+		case StreamOp::DRAW_INSTANCED:
+			break;
+		default:
+			continue; //shaders follow from the pass and instancing, nothing to do
+		}
+
+		ReplayDraw& draw = draws.emplace_back();
+		rasterised.emplace_back(0, 0);
+		draw.frame = frameIndex;
+		draw.command = index;
+		draw.instanced = command.op == StreamOp::DRAW_INSTANCED;
+		draw.depthOnly = depthOnly;
+		draw.transparent = transparent;
+		draw.texture = texture;
+		draw.indexCount = command.a;
+		draw.instanceCount = draw.instanced ? command.d : 1;
+		stats.draws++;
+
+		//the index range has to fall inside what was captured at that spot
+		const CapturedGeometry* geometry = nullptr;
+		auto found = located.find(locationKey(arena, command.c));
+		if (found != located.end() && command.b >= found->second->indexOffset
+			&& (uint64_t)command.b - found->second->indexOffset + command.a <= found->second->data->indexCount)
+			geometry = found->second;
+		bool constantsCaptured = draw.instanced ? (uint64_t)command.e + command.d <= frame.instances.size()
+			: object < frame.objectConstants.size();
+		draw.skipped = !geometry || !constantsCaptured || (software && depthOnly);
+		if (draw.skipped) {
+			stats.skippedDraws++;
+			continue;
+		}
+
+		auto drawStart = Clock::now();
+		if (software) {
+			const Unpacked& mesh = Unpack(geometry->data);
+			size_t trianglesBefore = rasteriser->GetStats().trianglesRasterised;
+			rasterised.back() = { rasteriser->GetStats().draws, draw.instanceCount };
+			const unsigned int* indices = mesh.indices.data() + (command.b - geometry->indexOffset);
+			for (uint32_t i = 0; i < draw.instanceCount; i++) {
+				XMMATRIX world = draw.instanced ? XMLoadFloat3x4(&frame.instances[command.e + i].world)
+					: XMLoadFloat3x4(&frame.objectConstants[object].world);
+				rasteriser->Draw(mesh.vertices.data(), mesh.vertices.size(), indices, draw.indexCount,
+					world, textureData, colour, transparent);
+			}
+			draw.triangles = rasteriser->GetStats().trianglesRasterised - trianglesBefore;
+		}
+		draw.ms = std::chrono::duration<float, std::milli>(Clock::now() - drawStart).count();
+		stats.drawMs += draw.ms;
+
+		if (software && finishEachDraw) {
+			auto shadeStart = Clock::now();
+			rasteriser->Finish(*pool, 0);
+			draw.shadeMs = std::chrono::duration<float, std::milli>(Clock::now() - shadeStart).count();
+			stats.finishMs += draw.shadeMs;
+		}
+	}
+
+	if (software) {
+		if (!finishEachDraw) {
+			auto finishStart = Clock::now();
+			rasteriser->Finish(*pool, 0);
+			stats.finishMs = std::chrono::duration<float, std::milli>(Clock::now() - finishStart).count();
+		}
+		//an instanced draw went to the rasteriser once per instance
+		for (size_t i = 0; i < rasterised.size(); i++) {
+			for (size_t d = 0; d < rasterised[i].second; d++) {
+				draws[firstDraw + i].pixels += rasteriser->GetDrawPixels(rasterised[i].first + d);
+			}
+		}
+	}
+	stats.totalMs = std::chrono::duration<float, std::milli>(Clock::now() - frameStart).count();
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
+
+#include "FrameCapture.h"
+#include "ModelLoader.h"
+
+class SoftwareRasteriser;
+class ThreadPool;
+
+//what a capture is played back onto
+enum class ReplayTarget
+{
+	NULL_DEVICE, //commands are read and matched to their geometry but nothing is drawn
+	SOFTWARE //drawn with a SoftwareRasteriser
+};
+
+//one draw command as it was replayed
+struct ReplayDraw
+{
+	size_t frame = 0;
+	size_t command = 0; //position in the frame's stream
+	bool instanced = false;
+	bool depthOnly = false; //in the pre-pass
+	bool transparent = false;
+	//its geometry or constants weren't captured, or it's a pre-pass draw on the software
+	//target, whose depth less test would reject the shading after it
+	bool skipped = false;
+	uint32_t texture = 0;
+	uint32_t indexCount = 0;
+	uint32_t instanceCount = 1;
+	size_t triangles = 0; //rasterised after clipping and culling, software target only
+	size_t pixels = 0; //written after the depth test, software target only
+	//transforming, clipping and binning on the software target
+	float ms = 0;
+	//shading its pixels, only with FrameReplay::finishEachDraw. otherwise the whole frame is
+	//shaded at once into ReplayFrameStats::finishMs and pixels is what to go by
+	float shadeMs = 0;
+};
+
+struct ReplayFrameStats
+{
+	size_t commands = 0;
+	size_t draws = 0;
+	size_t skippedDraws = 0;
+	float drawMs = 0; //every ReplayDraw's ms
+	float finishMs = 0; //shading the tiles, software target only. every ReplayDraw's shadeMs with finishEachDraw
+	float totalMs = 0;
+};
+
+//plays captured frames back without the renderer, a device or a window, so a frame that spiked
+//somewhere else can be timed and bisected on any machine. the stream's binds are tracked and
+//each draw is handed to the target with the state they left
+class FrameReplay
+{
+private:
+	//geometry unpacked to what the software rasteriser takes, once for every frame sharing it.
+	//a capture holds on to its geometry, but a renderer drawing live frees meshes and can reuse
+	//their addresses, so entries whose source has gone are dropped
+	struct Unpacked
+	{
+		std::weak_ptr<const GeometryData> source;
+		std::vector<VertexPosUVNorm> vertices;
+		std::vector<unsigned int> indices;
+	};
+
+	const FrameCapture& capture;
+	std::unordered_map<const GeometryData*, Unpacked> unpacked;
+	std::unordered_map<uint64_t, const CapturedGeometry*> located; //this frame's by arena and base vertex
+	std::vector<std::pair<size_t, size_t>> rasterised; //each draw's first rasteriser draw and how many
+
+	const Unpacked& Unpack(const std::shared_ptr<const GeometryData>& source);
+
+public:
+	//the capture has to outlive the replay
+	FrameReplay(const FrameCapture& capture);
+
+	//shade after every draw instead of once at the end of the frame, so each ReplayDraw gets its
+	//own shading time. slower overall, each Finish has to go through every tile
+	bool finishEachDraw = false;
+
+	//replays one frame onto target, adding a ReplayDraw for every draw command. the software
+	//target needs rasteriser and pool, and draws at whatever size the rasteriser is. the pool
+	//follows SoftwareRasteriser::Finish's rules
+	ReplayFrameStats Replay(size_t frame, ReplayTarget target, SoftwareRasteriser* rasteriser, ThreadPool* pool,
+		std::vector<ReplayDraw>& draws);
+};
\ No newline at end of file
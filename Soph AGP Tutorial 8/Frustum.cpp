@@ -0,0 +1,78 @@
+#include "Frustum.h"
+
+using namespace DirectX;
+
+Frustum::Frustum(FXMMATRIX viewProjection) {
+	//Gribb & Hartmann. clip = v * M, so each plane is a sum of the matrix's columns,
+	//transposing turns those columns into rows we can add up
+	XMMATRIX m = XMMatrixTranspose(viewProjection);
+
+	XMVECTOR p[6];
+	p[0] = XMVectorAdd(m.r[3], m.r[0]);		//left,   -w <= x
+	p[1] = XMVectorSubtract(m.r[3], m.r[0]);	//right,   x <= w
+	p[2] = XMVectorAdd(m.r[3], m.r[1]);		//bottom, -w <= y
+	p[3] = XMVectorSubtract(m.r[3], m.r[1]);	//top,     y <= w
+	p[4] = m.r[2];								//near,    0 <= z (d3d clip space)
+	p[5] = XMVectorSubtract(m.r[3], m.r[2]);	//far,     z <= w
+
+	//normalised so plane distances are real distances we can compare radii to
+	for (int i = 0; i < 6; i++) {
+		XMStoreFloat4(&planes[i], XMPlaneNormalize(p[i]));
+	}
+}
+
+bool Frustum::IntersectsSphere(XMFLOAT3 centre, float radius) const {
+	for (int i = 0; i < 6; i++) {
+		const XMFLOAT4& p = planes[i];
+		float distance = p.x * centre.x + p.y * centre.y + p.z * centre.z + p.w;
+		if (distance < -radius)
+			return false;
+	}
+	return true;
+}
+
+size_t Frustum::CullSpheres(const SphereList& spheres, std::vector<uint8_t>& visible) const {
+	size_t count = spheres.Size();
+	visible.resize(count);
+
+	//each plane's components splatted across a register, so one multiply-add chain
+	//gives four spheres' distances to that plane
+	XMVECTOR px[6], py[6], pz[6], pw[6];
+	for (int i = 0; i < 6; i++) {
+		XMVECTOR p = XMLoadFloat4(&planes[i]);
+		px[i] = XMVectorSplatX(p);
+		py[i] = XMVectorSplatY(p);
+		pz[i] = XMVectorSplatZ(p);
+		pw[i] = XMVectorSplatW(p);
+	}
+
+	size_t visibleCount = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&spheres.x[i]));
+		XMVECTOR y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&spheres.y[i]));
+		XMVECTOR z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&spheres.z[i]));
+		XMVECTOR negRadius = XMVectorNegate(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&spheres.radius[i])));
+
+		//a lane stays set while its sphere is inside or touching every plane
+		XMVECTOR inside = XMVectorTrueInt();
+		for (int p = 0; p < 6; p++) {
+			XMVECTOR distance = XMVectorMultiplyAdd(x, px[p], XMVectorMultiplyAdd(y, py[p], XMVectorMultiplyAdd(z, pz[p], pw[p])));
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(distance, negRadius));
+		}
+
+		uint32_t lanes[4];
+		XMStoreInt4(lanes, inside);
+		for (int lane = 0; lane < 4; lane++) {
+			visible[i + lane] = lanes[lane] ? 1 : 0;
+			visibleCount += visible[i + lane];
+		}
+	}
+
+	//the last few that don't fill a register
+	for (; i < count; i++) {
+		visible[i] = IntersectsSphere(XMFLOAT3(spheres.x[i], spheres.y[i], spheres.z[i]), spheres.radius[i]) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
\ No newline at end of file
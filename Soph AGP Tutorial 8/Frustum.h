@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <DirectXMath.h>
+
+//bounding spheres stored one component per array, so four of them load straight into
+//simd registers side by side
+struct SphereList
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+
+	void Clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+	void Add(DirectX::XMFLOAT3 centre, float r) {
+		x.push_back(centre.x);
+		y.push_back(centre.y);
+		z.push_back(centre.z);
+		radius.push_back(r);
+	}
+	size_t Size() const { return x.size(); }
+};
+
+//six planes pulled out of a view projection matrix. built from a full
+//world * view * projection the planes end up in that object's local space
+class Frustum
+{
+private:
+	//left, right, bottom, top, near, far. normals point inwards
+	DirectX::XMFLOAT4 planes[6];
+
+public:
+	Frustum() = default;
+	Frustum(DirectX::FXMMATRIX viewProjection);
+
+	//false only when the sphere is fully outside one of the planes
+	bool IntersectsSphere(DirectX::XMFLOAT3 centre, float radius) const;
+	//same test for a whole list, four spheres per step. visible[i] ends up 1 or 0,
+	//returns how many were visible
+	size_t CullSpheres(const SphereList& spheres, std::vector<uint8_t>& visible) const;
+
+	DirectX::XMFLOAT4 GetPlane(int i) const { return planes[i]; }
+};
\ No newline at end of file
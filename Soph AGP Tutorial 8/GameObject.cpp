@@ -1,6 +1,6 @@
 #include "GameObject.h"
 
-GameObject::GameObject(std::string objectName, Mesh* objectMesh)
-	: name(objectName), mesh(objectMesh) {
+GameObject::GameObject(std::string objectName, std::shared_ptr<Mesh> objectMesh)
+	: name(objectName), mesh(std::move(objectMesh)) {
 
 }
\ No newline at end of file
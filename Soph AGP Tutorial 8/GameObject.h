@@ -1,10 +1,12 @@
 #pragma once
 
 #include <string>
+#include <memory>
 
 #include "Transform.h"
 
 class Mesh;
+struct Material;
 
 class GameObject
 {
@@ -12,9 +14,15 @@ private:
 	std::string name = "GameObject";
 public:
 	Transform transform;
-	Mesh* mesh;
+	std::shared_ptr<Mesh> mesh; //shared with every other object using the same model
+	std::shared_ptr<Material> material; //null draws plain white with the renderer's texture
+	bool transparent = false; //drawn after everything opaque, farthest first
+	//drawn into the occlusion buffer to hide what's behind it. for big solid things like walls and
+	//terrain, small or thin objects cost more to rasterise than they save
+	bool occluder = false;
+	unsigned int lod = 0; //level of detail picked last frame, the renderer keeps it up to date
 
 	std::string GetName() { return name; }
-	GameObject(std::string objectName, Mesh* objectMesh);
+	GameObject(std::string objectName, std::shared_ptr<Mesh> objectMesh);
 };
 
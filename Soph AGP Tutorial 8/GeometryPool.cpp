@@ -0,0 +1,316 @@
+#include "GeometryPool.h"
+
+#ifndef HEADLESS_ONLY
+#include <d3d11.h>
+#endif
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+#include "Renderer.h"
+#include "Debug.h"
+
+GeometryPool::GeometryPool(Renderer& renderer, unsigned int initialVertices, unsigned int initialIndices)
+	: renderer(renderer), initialVertices(initialVertices), initialIndices(initialIndices) {
+
+}
+
+GeometryPool::~GeometryPool() {
+	Release();
+}
+
+int GeometryPool::FindArena(VertexLayout layout, unsigned int vertexStride, bool shortIndices) {
+	for (size_t i = 0; i < arenas.size(); i++) {
+		if (arenas[i].layout == layout && arenas[i].vertexStride == vertexStride && arenas[i].shortIndices == shortIndices)
+			return (int)i;
+	}
+
+	Arena arena;
+	arena.layout = layout;
+	arena.vertexStride = vertexStride;
+	arena.positionStride = (unsigned int)VertexFormats::GetPositionSize(layout);
+	arena.attributeStride = vertexStride - arena.positionStride;
+	arena.shortIndices = shortIndices;
+	arenas.push_back(std::move(arena));
+	return (int)arenas.size() - 1;
+}
+
+#ifdef HEADLESS_ONLY
+bool GeometryPool::CreateBuffers(const Arena&, unsigned int, unsigned int, ID3D11Buffer**, ID3D11Buffer**, ID3D11Buffer**) {
+	return true;
+}
+#else
+bool GeometryPool::CreateBuffers(const Arena& arena, unsigned int vertexCapacity, unsigned int indexCapacity,
+	ID3D11Buffer** pBuffer, ID3D11Buffer** vBuffer, ID3D11Buffer** iBuffer) {
+	ID3D11Device* dev = renderer.GetDevice();
+	if (!dev)
+		return true; //headless renderers only keep track of the ranges, the buffers stay null
+
+	//default usage rather than immutable, meshes are copied in and moved around after creation
+	D3D11_BUFFER_DESC pbd = { 0 };
+	pbd.Usage = D3D11_USAGE_DEFAULT;
+	pbd.ByteWidth = vertexCapacity * arena.positionStride;
+	pbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	if (FAILED(dev->CreateBuffer(&pbd, NULL, pBuffer))) {
+		LOG("Failed to create pooled position buffer");
+		return false;
+	}
+
+	D3D11_BUFFER_DESC vbd = { 0 };
+	vbd.Usage = D3D11_USAGE_DEFAULT;
+	vbd.ByteWidth = vertexCapacity * arena.attributeStride;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	if (FAILED(dev->CreateBuffer(&vbd, NULL, vBuffer))) {
+		LOG("Failed to create pooled vertex buffer");
+		(*pBuffer)->Release();
+		*pBuffer = nullptr;
+		return false;
+	}
+
+	D3D11_BUFFER_DESC ibd = { 0 };
+	ibd.Usage = D3D11_USAGE_DEFAULT;
+	ibd.ByteWidth = indexCapacity * (arena.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int));
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	if (FAILED(dev->CreateBuffer(&ibd, NULL, iBuffer))) {
+		LOG("Failed to create pooled index buffer");
+		(*pBuffer)->Release();
+		(*vBuffer)->Release();
+		*pBuffer = nullptr;
+		*vBuffer = nullptr;
+		return false;
+	}
+	return true;
+}
+#endif
+
+bool GeometryPool::Rebuild(int arenaIndex, unsigned int vertexCapacity, unsigned int indexCapacity) {
+	Arena& arena = arenas[arenaIndex];
+
+	//copy into fresh buffers rather than shuffling in place, a buffer can't copy onto itself.
+	//made first so a failure leaves the arena exactly as it was
+	ID3D11Buffer* pBuffer = nullptr;
+	ID3D11Buffer* vBuffer = nullptr;
+	ID3D11Buffer* iBuffer = nullptr;
+	if (!CreateBuffers(arena, vertexCapacity, indexCapacity, &pBuffer, &vBuffer, &iBuffer))
+		return false;
+
+	//old offsets, the copies below need to know where each mesh came from
+	std::vector<std::pair<Handle, Allocation>> live;
+	for (Handle h = 0; h < allocations.size(); h++) {
+		if (allocations[h].arena == arenaIndex)
+			live.emplace_back(h, allocations[h]);
+	}
+
+	arena.vertices.Grow(vertexCapacity);
+	arena.indices.Grow(indexCapacity);
+	std::unordered_map<unsigned int, unsigned int> vertexMoves, indexMoves;
+	for (auto& move : arena.vertices.Compact())
+		vertexMoves[move.from] = move.to;
+	for (auto& move : arena.indices.Compact())
+		indexMoves[move.from] = move.to;
+
+#ifndef HEADLESS_ONLY
+	ID3D11DeviceContext* devCon = renderer.GetDeviceCon();
+#endif
+	for (auto& entry : live) {
+		Allocation& moved = allocations[entry.first];
+		const Allocation& old = entry.second;
+		auto v = vertexMoves.find(old.vertexOffset);
+		if (v != vertexMoves.end())
+			moved.vertexOffset = v->second;
+		auto i = indexMoves.find(old.indexOffset);
+		if (i != indexMoves.end())
+			moved.indexOffset = i->second;
+
+#ifndef HEADLESS_ONLY
+		if (arena.pBuffer) {
+			D3D11_BOX box = { old.vertexOffset * arena.positionStride, 0, 0,
+				(old.vertexOffset + old.vertexCount) * arena.positionStride, 1, 1 };
+			devCon->CopySubresourceRegion(pBuffer, 0, moved.vertexOffset * arena.positionStride, 0, 0, arena.pBuffer, 0, &box);
+		}
+		if (arena.vBuffer) {
+			D3D11_BOX box = { old.vertexOffset * arena.attributeStride, 0, 0,
+				(old.vertexOffset + old.vertexCount) * arena.attributeStride, 1, 1 };
+			devCon->CopySubresourceRegion(vBuffer, 0, moved.vertexOffset * arena.attributeStride, 0, 0, arena.vBuffer, 0, &box);
+		}
+		if (arena.iBuffer) {
+			unsigned int indexSize = arena.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
+			D3D11_BOX box = { old.indexOffset * indexSize, 0, 0, (old.indexOffset + old.indexCount) * indexSize, 1, 1 };
+			devCon->CopySubresourceRegion(iBuffer, 0, moved.indexOffset * indexSize, 0, 0, arena.iBuffer, 0, &box);
+		}
+#endif
+	}
+
+	Release(arena);
+	arena.pBuffer = pBuffer;
+	arena.vBuffer = vBuffer;
+	arena.iBuffer = iBuffer;
+	return true;
+}
+
+GeometryPool::Handle GeometryPool::Allocate(VertexLayout layout, unsigned int vertexStride, const void* vertexData,
+	unsigned int vertexCount, bool shortIndices, const void* indexData, unsigned int indexCount) {
+	if (vertexCount == 0 || indexCount == 0)
+		return invalidHandle;
+
+	int arenaIndex = FindArena(layout, vertexStride, shortIndices);
+	Arena& arena = arenas[arenaIndex];
+
+	unsigned int vertexOffset = arena.vertices.Allocate(vertexCount);
+	unsigned int indexOffset = arena.indices.Allocate(indexCount);
+	if (vertexOffset == RangeAllocator::invalid || indexOffset == RangeAllocator::invalid) {
+		if (vertexOffset != RangeAllocator::invalid) arena.vertices.Free(vertexOffset);
+		if (indexOffset != RangeAllocator::invalid) arena.indices.Free(indexOffset);
+
+		//enough space in total just means it's fragmented, packing fixes that without growing
+		auto newCapacity = [](RangeAllocator& ranges, unsigned int wanted, unsigned int initial) {
+			unsigned int capacity = ranges.GetCapacity();
+			if (capacity - ranges.GetUsed() >= wanted)
+				return capacity;
+			return std::max(std::max(capacity * 2, ranges.GetUsed() + wanted), initial);
+		};
+		unsigned int vertexCapacity = newCapacity(arena.vertices, vertexCount, initialVertices);
+		unsigned int indexCapacity = newCapacity(arena.indices, indexCount, initialIndices);
+		if (arena.vBuffer && vertexCapacity == arena.vertices.GetCapacity() && indexCapacity == arena.indices.GetCapacity())
+			defragmentCount++;
+		else if (arena.vBuffer)
+			growCount++;
+
+		if (!Rebuild(arenaIndex, vertexCapacity, indexCapacity))
+			return invalidHandle;
+
+		//everything free is one range at the end now, big enough by construction
+		vertexOffset = arena.vertices.Allocate(vertexCount);
+		indexOffset = arena.indices.Allocate(indexCount);
+	}
+
+	//positions of every vertex first, then the rest of every vertex, each uploaded to its own stream
+	unsigned int positionStride = arena.positionStride;
+	unsigned int attributeStride = arena.attributeStride;
+	splitScratch.resize((size_t)vertexCount * vertexStride);
+	uint8_t* positions = splitScratch.data();
+	uint8_t* attributes = positions + (size_t)vertexCount * positionStride;
+	const uint8_t* source = (const uint8_t*)vertexData;
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		memcpy(positions + (size_t)v * positionStride, source + (size_t)v * vertexStride, positionStride);
+		memcpy(attributes + (size_t)v * attributeStride, source + (size_t)v * vertexStride + positionStride, attributeStride);
+	}
+
+#ifndef HEADLESS_ONLY
+	ID3D11DeviceContext* devCon = renderer.GetDeviceCon();
+	if (devCon) {
+		unsigned int indexSize = shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
+		D3D11_BOX positionBox = { vertexOffset * positionStride, 0, 0, (vertexOffset + vertexCount) * positionStride, 1, 1 };
+		devCon->UpdateSubresource(arena.pBuffer, 0, &positionBox, positions, 0, 0);
+		D3D11_BOX vertexBox = { vertexOffset * attributeStride, 0, 0, (vertexOffset + vertexCount) * attributeStride, 1, 1 };
+		devCon->UpdateSubresource(arena.vBuffer, 0, &vertexBox, attributes, 0, 0);
+		D3D11_BOX indexBox = { indexOffset * indexSize, 0, 0, (indexOffset + indexCount) * indexSize, 1, 1 };
+		devCon->UpdateSubresource(arena.iBuffer, 0, &indexBox, indexData, 0, 0);
+	}
+#endif
+
+	Handle handle;
+	if (!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (Handle)allocations.size();
+		allocations.emplace_back();
+	}
+	allocations[handle] = Allocation{ arenaIndex, vertexOffset, vertexCount, indexOffset, indexCount, nullptr };
+
+	//the interleaved original, one copy that doesn't move when the arena is repacked
+	if (renderer.keepCaptureData) {
+		auto kept = std::make_shared<GeometryData>();
+		kept->layout = layout;
+		kept->vertexStride = vertexStride;
+		kept->shortIndices = shortIndices;
+		kept->vertexCount = vertexCount;
+		kept->indexCount = indexCount;
+		kept->vertices.assign(source, source + (size_t)vertexCount * vertexStride);
+		const uint8_t* indexBytes = (const uint8_t*)indexData;
+		kept->indices.assign(indexBytes, indexBytes + (size_t)indexCount * (shortIndices ? sizeof(uint16_t) : sizeof(unsigned int)));
+		allocations[handle].kept = std::move(kept);
+	}
+	return handle;
+}
+
+void GeometryPool::Free(Handle handle) {
+	if (handle == invalidHandle || handle >= allocations.size() || allocations[handle].arena < 0)
+		return;
+
+	Allocation& allocation = allocations[handle];
+	Arena& arena = arenas[allocation.arena];
+	arena.vertices.Free(allocation.vertexOffset);
+	arena.indices.Free(allocation.indexOffset);
+	allocation = Allocation();
+	freeHandles.push_back(handle);
+}
+
+void GeometryPool::Bind([[maybe_unused]] ID3D11DeviceContext* context, Bindings& bindings, Handle handle, bool instanced) {
+	int arenaIndex = allocations[handle].arena;
+	if (arenaIndex == bindings.arena && instanced == bindings.instanced)
+		return;
+
+	//depth only passes leave slot 2 alone, their input layout never reads it
+#ifndef HEADLESS_ONLY
+	if (context) {
+		const Arena& arena = arenas[arenaIndex];
+		context->IASetInputLayout(renderer.GetInputLayout(arena.layout, instanced, bindings.positionsOnly));
+		UINT offset = 0;
+		context->IASetVertexBuffers(0, 1, &arena.pBuffer, &arena.positionStride, &offset);
+		if (!bindings.positionsOnly)
+			context->IASetVertexBuffers(2, 1, &arena.vBuffer, &arena.attributeStride, &offset);
+		context->IASetIndexBuffer(arena.iBuffer, arena.shortIndices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+	}
+#endif
+
+	bindings.arena = arenaIndex;
+	bindings.instanced = instanced;
+	bindings.bindCount++;
+}
+
+void GeometryPool::Defragment() {
+	for (size_t i = 0; i < arenas.size(); i++) {
+		Arena& arena = arenas[i];
+		if (!arena.pBuffer || (arena.vertices.GetFreeRangeCount() <= 1 && arena.indices.GetFreeRangeCount() <= 1))
+			continue; //already packed
+		if (Rebuild((int)i, arena.vertices.GetCapacity(), arena.indices.GetCapacity()))
+			defragmentCount++;
+	}
+}
+
+GeometryPoolStats GeometryPool::GetStats() {
+	GeometryPoolStats stats;
+	stats.arenas = arenas.size();
+	stats.allocations = allocations.size() - freeHandles.size();
+	for (Arena& arena : arenas) {
+		size_t indexSize = arena.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
+		stats.vertexBytesCapacity += (size_t)arena.vertices.GetCapacity() * arena.vertexStride;
+		stats.vertexBytesUsed += (size_t)arena.vertices.GetUsed() * arena.vertexStride;
+		stats.indexBytesCapacity += arena.indices.GetCapacity() * indexSize;
+		stats.indexBytesUsed += arena.indices.GetUsed() * indexSize;
+		stats.freeRanges += arena.vertices.GetFreeRangeCount() + arena.indices.GetFreeRangeCount();
+	}
+	stats.grows = growCount;
+	stats.defragments = defragmentCount;
+	return stats;
+}
+
+void GeometryPool::Release(Arena& arena) {
+#ifndef HEADLESS_ONLY
+	if (arena.pBuffer) arena.pBuffer->Release();
+	if (arena.vBuffer) arena.vBuffer->Release();
+	if (arena.iBuffer) arena.iBuffer->Release();
+#endif
+	arena.pBuffer = nullptr;
+	arena.vBuffer = nullptr;
+	arena.iBuffer = nullptr;
+}
+
+void GeometryPool::Release() {
+	for (Arena& arena : arenas) {
+		Release(arena);
+	}
+}
\ No newline at end of file
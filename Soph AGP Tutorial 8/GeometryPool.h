@@ -0,0 +1,130 @@
+#pragma once
+#include <vector>
+#include <memory>
+
+#include "RangeAllocator.h"
+#include "VertexFormats.h"
+
+struct ID3D11Buffer;
+struct ID3D11DeviceContext;
+
+class Renderer;
+struct GeometryData;
+
+struct GeometryPoolStats
+{
+	size_t arenas = 0;
+	size_t allocations = 0;
+	size_t vertexBytesCapacity = 0;
+	size_t vertexBytesUsed = 0;
+	size_t indexBytesCapacity = 0;
+	size_t indexBytesUsed = 0;
+	size_t freeRanges = 0; //across every arena, 1 per buffer means no fragmentation
+	size_t grows = 0;
+	size_t defragments = 0;
+};
+
+//every static mesh lives in a few big vertex and index buffers instead of its own pair.
+//meshes with the same vertex layout and index size share an arena, so drawing them one
+//after another needs no buffer changes at all. positions are kept in a buffer of their own,
+//slot 0, apart from uvs and normals in slot 2, so depth only passes read just the positions
+class GeometryPool
+{
+public:
+	typedef unsigned int Handle;
+	static const Handle invalidHandle = UINT_MAX;
+
+	//what one device context has bound from the pool. each context draws are recorded into
+	//keeps its own, so contexts on different threads never share one
+	struct Bindings
+	{
+		int arena = -1;
+		bool instanced = false;
+		//binds only the position stream, with the depth only input layouts. fixed for a pass,
+		//start a fresh Bindings to change it
+		bool positionsOnly = false;
+		size_t bindCount = 0;
+	};
+
+private:
+	struct Arena
+	{
+		VertexLayout layout = VertexLayout::FULL;
+		unsigned int vertexStride = 0; //whole vertex, split between the two streams below
+		unsigned int positionStride = 0;
+		unsigned int attributeStride = 0;
+		bool shortIndices = false;
+		ID3D11Buffer* pBuffer = nullptr; //positions
+		ID3D11Buffer* vBuffer = nullptr; //everything else
+		ID3D11Buffer* iBuffer = nullptr;
+		RangeAllocator vertices; //counted in vertices
+		RangeAllocator indices; //counted in indices
+	};
+
+	struct Allocation
+	{
+		int arena = -1; //-1 when the handle is free
+		unsigned int vertexOffset = 0;
+		unsigned int vertexCount = 0;
+		unsigned int indexOffset = 0;
+		unsigned int indexCount = 0;
+		std::shared_ptr<const GeometryData> kept; //only with the renderer's keepCaptureData on
+	};
+
+	Renderer& renderer;
+	unsigned int initialVertices;
+	unsigned int initialIndices;
+
+	std::vector<Arena> arenas;
+	std::vector<Allocation> allocations; //indexed by handle
+	std::vector<Handle> freeHandles;
+
+	size_t growCount = 0;
+	size_t defragmentCount = 0;
+	std::vector<uint8_t> splitScratch; //a mesh's interleaved vertices pulled apart into the two streams
+
+	int FindArena(VertexLayout layout, unsigned int vertexStride, bool shortIndices);
+	bool CreateBuffers(const Arena& arena, unsigned int vertexCapacity, unsigned int indexCapacity,
+		ID3D11Buffer** pBuffer, ID3D11Buffer** vBuffer, ID3D11Buffer** iBuffer);
+	//moves everything in the arena into new buffers of the given size, packed to the front
+	bool Rebuild(int arenaIndex, unsigned int vertexCapacity, unsigned int indexCapacity);
+	void Release(Arena& arena); //its buffers, the ranges in it are left alone
+
+public:
+	//starting size of each arena, they double whenever they run out
+	GeometryPool(Renderer& renderer, unsigned int initialVertices = 1 << 16, unsigned int initialIndices = 1 << 18);
+	~GeometryPool();
+
+	//copies the mesh into the pool, indices are relative to the mesh's first vertex. vertexData is
+	//interleaved in the layout's format, the pool splits it. returns invalidHandle if the gpu
+	//buffers couldn't be made
+	Handle Allocate(VertexLayout layout, unsigned int vertexStride, const void* vertexData, unsigned int vertexCount,
+		bool shortIndices, const void* indexData, unsigned int indexCount);
+	void Free(Handle handle);
+
+	//sets the input layout, vertex and index buffers for the handle's arena on the context, unless
+	//bindings says they already are. instanced picks the input layout that also reads the instance
+	//buffer in slot 1. only reads the pool, so contexts on different threads can bind at once.
+	//bindings must be reset whenever the pool grows or defragments, the old buffers may still be bound.
+	//a null context only updates bindings, for renderers without a device
+	void Bind(ID3D11DeviceContext* context, Bindings& bindings, Handle handle, bool instanced = false);
+
+	//pass as DrawIndexed's BaseVertexLocation and add to its StartIndexLocation
+	unsigned int GetBaseVertex(Handle handle) { return allocations[handle].vertexOffset; }
+	unsigned int GetFirstIndex(Handle handle) { return allocations[handle].indexOffset; }
+	//what was uploaded, null unless the renderer was keeping capture data at the time
+	std::shared_ptr<const GeometryData> GetKeptData(Handle handle) { return allocations[handle].kept; }
+	//meshes in the same arena draw one after another without rebinding anything
+	int GetArena(Handle handle) { return allocations[handle].arena; }
+
+	//packs every arena so its free space is one range at the end. Allocate does this by
+	//itself when a mesh doesn't fit, calling it after unloading a lot saves a later stall
+	void Defragment();
+	GeometryPoolStats GetStats();
+
+	//releases the gpu buffers, handles stay valid to Free but can't be drawn
+	void Release();
+
+	GeometryPool(const GeometryPool&) = delete;
+	GeometryPool& operator=(const GeometryPool&) = delete;
+};
\ No newline at end of file
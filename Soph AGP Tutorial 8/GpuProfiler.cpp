@@ -0,0 +1,187 @@
+#include "GpuProfiler.h"
+#include "Profiler.h"
+#include "Debug.h"
+
+#ifndef HEADLESS_ONLY
+#include <d3d11.h>
+#endif
+
+GpuProfiler::~GpuProfiler() {
+	Release();
+}
+
+float GpuProfiler::GetMs(const std::string& name) {
+	auto found = lastMs.find(name);
+	return found != lastMs.end() ? found->second : 0.0f;
+}
+
+#ifndef HEADLESS_ONLY
+
+ID3D11Query* GpuProfiler::CreateQuery(bool disjoint) {
+	D3D11_QUERY_DESC desc = {};
+	desc.Query = disjoint ? D3D11_QUERY_TIMESTAMP_DISJOINT : D3D11_QUERY_TIMESTAMP;
+	ID3D11Query* query = nullptr;
+	if (FAILED(dev->CreateQuery(&desc, &query))) {
+		LOG("Failed to create gpu timing query");
+		return nullptr;
+	}
+	return query;
+}
+
+bool GpuProfiler::Init(ID3D11Device* inDev, ID3D11DeviceContext* inDevCon) {
+	dev = inDev;
+	devCon = inDevCon;
+	for (Frame& frame : frames) {
+		frame.disjoint = CreateQuery(true);
+		frame.start = CreateQuery(false);
+		frame.end = CreateQuery(false);
+		if (!frame.disjoint || !frame.start || !frame.end) {
+			Release();
+			return false;
+		}
+	}
+	return true;
+}
+
+void GpuProfiler::Release() {
+	for (Frame& frame : frames) {
+		if (frame.disjoint) frame.disjoint->Release();
+		if (frame.start) frame.start->Release();
+		if (frame.end) frame.end->Release();
+		for (Zone& zone : frame.zones) {
+			if (zone.begin) zone.begin->Release();
+			if (zone.end) zone.end->Release();
+		}
+		frame = Frame();
+	}
+	dev = nullptr;
+	devCon = nullptr;
+}
+
+void GpuProfiler::BeginFrame() {
+	if (!dev)
+		return;
+
+	Collect();
+	Frame& frame = frames[current];
+	if (frame.pending) {
+		//the gpu is more than framesInFlight behind, skip timing this frame rather than wait
+		return;
+	}
+
+	frame.zoneCount = 0;
+	frame.cpuStartNs = Profiler::Now();
+	devCon->Begin(frame.disjoint);
+	devCon->End(frame.start);
+	openZones.clear();
+	inFrame = true;
+}
+
+void GpuProfiler::EndFrame() {
+	if (!inFrame)
+		return;
+
+	while (!openZones.empty()) {
+		End(); //zones left open are closed here rather than lost
+	}
+	Frame& frame = frames[current];
+	devCon->End(frame.end);
+	devCon->End(frame.disjoint);
+	frame.pending = true;
+	inFrame = false;
+	current = (current + 1) % framesInFlight;
+}
+
+void GpuProfiler::Begin(const char* name) {
+	if (!inFrame)
+		return;
+
+	Frame& frame = frames[current];
+	if (frame.zoneCount == frame.zones.size()) {
+		Zone zone;
+		zone.begin = CreateQuery(false);
+		zone.end = CreateQuery(false);
+		if (!zone.begin || !zone.end) {
+			if (zone.begin) zone.begin->Release();
+			if (zone.end) zone.end->Release();
+			openZones.push_back(SIZE_MAX); //still needs its End matching up
+			return;
+		}
+		frame.zones.push_back(zone);
+	}
+
+	Zone& zone = frame.zones[frame.zoneCount];
+	zone.name = name;
+	zone.depth = (uint32_t)openZones.size();
+	devCon->End(zone.begin); //timestamps only have an End
+	openZones.push_back(frame.zoneCount++);
+}
+
+void GpuProfiler::End() {
+	if (!inFrame || openZones.empty())
+		return;
+
+	size_t index = openZones.back();
+	openZones.pop_back();
+	if (index != SIZE_MAX)
+		devCon->End(frames[current].zones[index].end);
+}
+
+void GpuProfiler::Collect() {
+	//current is the next frame to record, so the one submitted longest ago. walking on from it
+	//reads frames in the order they were submitted
+	for (int i = 0; i < framesInFlight; i++) {
+		Frame& frame = frames[(current + i) % framesInFlight];
+		if (!frame.pending)
+			continue;
+
+		D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+		if (devCon->GetData(frame.disjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			return; //not done yet, and nothing after it will be either
+		frame.pending = false;
+		if (disjoint.Disjoint || disjoint.Frequency == 0)
+			continue; //the clock changed speed part way, these timings mean nothing
+
+		UINT64 start = 0, frameEnd = 0;
+		if (devCon->GetData(frame.start, &start, sizeof(start), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+			|| devCon->GetData(frame.end, &frameEnd, sizeof(frameEnd), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+			continue;
+
+		double nsPerTick = 1e9 / (double)disjoint.Frequency;
+		Profiler::RecordGpu("Frame", frame.cpuStartNs, frame.cpuStartNs + (uint64_t)((frameEnd - start) * nsPerTick), 0);
+		lastMs["Frame"] = (float)((frameEnd - start) * nsPerTick / 1e6);
+		for (size_t z = 0; z < frame.zoneCount; z++) {
+			Zone& zone = frame.zones[z];
+			UINT64 begin = 0, end = 0;
+			if (devCon->GetData(zone.begin, &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK
+				|| devCon->GetData(zone.end, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK)
+				continue;
+
+			uint64_t startNs = frame.cpuStartNs + (uint64_t)((begin - start) * nsPerTick);
+			uint64_t endNs = frame.cpuStartNs + (uint64_t)((end - start) * nsPerTick);
+			Profiler::RecordGpu(zone.name, startNs, endNs, zone.depth + 1);
+			lastMs[zone.name] = (float)((end - begin) * nsPerTick / 1e6);
+		}
+	}
+}
+
+#else
+
+//no device to time, Init always fails so every zone is skipped the same as a failed one
+
+ID3D11Query* GpuProfiler::CreateQuery(bool) {
+	return nullptr;
+}
+
+bool GpuProfiler::Init(ID3D11Device*, ID3D11DeviceContext*) {
+	return false;
+}
+
+void GpuProfiler::Release() {}
+void GpuProfiler::BeginFrame() {}
+void GpuProfiler::EndFrame() {}
+void GpuProfiler::Begin(const char*) {}
+void GpuProfiler::End() {}
+void GpuProfiler::Collect() {}
+
+#endif
\ No newline at end of file
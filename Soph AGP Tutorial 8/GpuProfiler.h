@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11Query;
+
+//times parts of a frame on the gpu with timestamp queries inside a disjoint query. results are
+//read back a few frames later without ever waiting on the gpu, and go to the profiler's GPU
+//track as well as GetMs. the track is lined up with the cpu time the frame was submitted at,
+//the gpu runs a little after that, so durations are exact but start times are approximate
+class GpuProfiler
+{
+private:
+	static const int framesInFlight = 4; //frames of queries kept before the oldest must be read
+
+	struct Zone
+	{
+		const char* name = nullptr;
+		uint32_t depth = 0;
+		ID3D11Query* begin = nullptr;
+		ID3D11Query* end = nullptr;
+	};
+
+	struct Frame
+	{
+		ID3D11Query* disjoint = nullptr;
+		ID3D11Query* start = nullptr;
+		ID3D11Query* end = nullptr;
+		uint64_t cpuStartNs = 0;
+		std::vector<Zone> zones; //only the first zoneCount are this frame's, the rest are spare queries
+		size_t zoneCount = 0;
+		bool pending = false;
+	};
+
+	ID3D11Device* dev = nullptr;
+	ID3D11DeviceContext* devCon = nullptr;
+	Frame frames[framesInFlight];
+	int current = 0;
+	bool inFrame = false;
+	std::vector<size_t> openZones; //indices into the current frame's zones
+	std::unordered_map<std::string, float> lastMs;
+
+	ID3D11Query* CreateQuery(bool disjoint);
+	//reads back every finished frame, oldest first. stops at the first one the gpu hasn't done
+	void Collect();
+
+public:
+	GpuProfiler() = default;
+	~GpuProfiler();
+
+	bool Init(ID3D11Device* dev, ID3D11DeviceContext* devCon);
+	void Release();
+
+	//everything between these is one frame, zones must be inside one
+	void BeginFrame();
+	void EndFrame();
+	void Begin(const char* name); //name must outlive the profiler, string literals
+	void End();
+
+	//milliseconds the last read back frame spent in a zone, "Frame" for the whole thing. 0 if
+	//it hasn't come back yet
+	float GetMs(const std::string& name);
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	//times the rest of the scope on the gpu
+	class Scope
+	{
+	private:
+		GpuProfiler& profiler;
+	public:
+		Scope(GpuProfiler& profiler, const char* name) : profiler(profiler) { profiler.Begin(name); }
+		~Scope() { profiler.End(); }
+	};
+};
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Debug.h"
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(std::string path) {
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		LOG("Failed to open " + path + " for mapping");
+		return;
+	}
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		return; //empty files can't be mapped, IsOpen() stays false
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL) {
+		LOG("Failed to create file mapping for " + path);
+		return;
+	}
+	mappingHandle = mapping;
+
+	data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr) {
+		LOG("Failed to map view of " + path);
+		return;
+	}
+	size = (size_t)fileSize.QuadPart;
+}
+
+MappedFile::~MappedFile() {
+	if (data) UnmapViewOfFile(data);
+	if (mappingHandle) CloseHandle(mappingHandle);
+	if (fileHandle) CloseHandle(fileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(std::string path) {
+	fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (fileDescriptor < 0) {
+		LOG("Failed to open " + path + " for mapping");
+		return;
+	}
+
+	struct stat fileStat;
+	if (fstat(fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0) {
+		return; //empty files can't be mapped, IsOpen() stays false
+	}
+
+	void* view = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (view == MAP_FAILED) {
+		LOG("Failed to map " + path);
+		return;
+	}
+	madvise(view, (size_t)fileStat.st_size, MADV_SEQUENTIAL);
+
+	data = (const char*)view;
+	size = (size_t)fileStat.st_size;
+}
+
+MappedFile::~MappedFile() {
+	if (data) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+}
+
+#endif
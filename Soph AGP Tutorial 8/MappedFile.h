@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+
+//read only view of a whole file mapped into our address space
+//the OS pages the file in as we touch it, so there is no copy into a buffer of our own
+class MappedFile
+{
+private:
+	const char* data = nullptr;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#else
+	int fileDescriptor = -1;
+#endif
+
+public:
+	bool IsOpen() { return data != nullptr; }
+	const char* GetData() { return data; }
+	size_t GetSize() { return size; }
+
+	MappedFile(std::string path);
+	~MappedFile();
+
+	//owns OS handles so it can't be copied
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+};
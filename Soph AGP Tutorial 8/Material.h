@@ -0,0 +1,24 @@
+#pragma once
+#include <memory>
+#include <DirectXMath.h>
+
+class Texture;
+
+//how a surface looks. objects sharing a material get drawn next to each other, and its
+//constants only go to the gpu when a different material is bound
+struct Material
+{
+	std::shared_ptr<Texture> texture; //null draws with the renderer's texture
+	DirectX::XMFLOAT4 colour{ 1, 1, 1, 1 }; //multiplied with the texture, alpha blends transparent objects
+
+	Material() : sortId(NextSortId()) {}
+	unsigned int GetSortId() const { return sortId; }
+
+private:
+	unsigned int sortId; //0 is left for objects without a material
+
+	static unsigned int NextSortId() {
+		static unsigned int next = 1;
+		return next++;
+	}
+};
\ No newline at end of file
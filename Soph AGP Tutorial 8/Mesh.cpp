@@ -1,67 +1,211 @@
 #include "Mesh.h"
 
+#ifndef HEADLESS_ONLY
 #include <d3d11.h>
+#endif
+#include <vector>
+#include <cfloat>
+#include <climits>
+#include <algorithm>
 
 #include "Renderer.h"
-#include "ModelLoader.h"
+#include "MeshSimplifier.h"
+#include "Profiler.h"
 #include "Debug.h"
 
-Mesh::Mesh(Renderer& renderer, std::string objPath)
-	: dev(renderer.GetDevice()), devCon(renderer.GetDeviceCon()) {
-	
-	ModelLoader ml{ objPath };
-
-	//create the vertex buffer
-	D3D11_BUFFER_DESC vbd = { 0 };
-	vbd.Usage = D3D11_USAGE_DYNAMIC; //dynamic allows cpu write and gpu read
-	vbd.ByteWidth = (unsigned int) ml.GetVertexBufferSize(); //size of buffer - size of vertex * num of vertices
-	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER; //use as vertex buffer
-	vbd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE; //allow CPU to write in buffer
-	//create vertex buffer using the buffer data
-	dev->CreateBuffer(&vbd, NULL, &vBuffer);
-	if (vBuffer == 0) {
-		LOG("Failed to create vertex buffer,,, apparently this wont fail");
-		return;
+static unsigned int nextSortId = 0;
+
+Mesh::Mesh(Renderer& renderer)
+	: dev(renderer.GetDevice()), renderer(renderer), sortId(nextSortId++) {
+	DirectX::XMStoreFloat4x4(&dequantise, DirectX::XMMatrixIdentity());
+}
+
+Mesh::~Mesh() {
+	renderer.GetGeometry().Free(geometry);
+}
+
+Mesh::Mesh(Renderer& renderer, std::string objPath, ModelLoadOptions options)
+	: Mesh(renderer) {
+	MeshData data;
+	Prepare(objPath, options, data);
+	Upload(data);
+}
+
+void Mesh::Prepare(std::string objPath, ModelLoadOptions options, MeshData& data) {
+	PROFILE_ZONE("Mesh::Prepare");
+	data.loader = std::make_unique<ModelLoader>(objPath, options);
+	ModelLoader& ml = *data.loader;
+
+	data.vertexLayout = options.vertexLayout;
+	data.vertexStride = (unsigned int)VertexFormats::GetStride(data.vertexLayout);
+	DirectX::XMStoreFloat4x4(&data.dequantise, DirectX::XMMatrixIdentity());
+
+	//full vertices go straight from the loader (maybe a mapped .meshbin), others get packed first
+	data.vertexBytes = ml.GetVertexData();
+	data.vertexByteSize = ml.GetVertexBufferSize();
+	if (data.vertexLayout != VertexLayout::FULL) {
+		data.packedVertices = VertexFormats::Pack(ml.GetVertexData(), ml.GetVertexCount(),
+			data.vertexLayout, ml.GetBoundsMin(), ml.GetBoundsMax(), data.dequantise);
+		data.vertexBytes = data.packedVertices.data();
+		data.vertexByteSize = data.packedVertices.size();
+	}
+
+#if _DEBUG
+	if (data.vertexLayout != VertexLayout::FULL) {
+		VertexFormats::PackError error = VertexFormats::MeasureError(ml.GetVertexData(), ml.GetVertexCount(),
+			data.vertexLayout, data.packedVertices, data.dequantise);
+		LOG(objPath + " packed vertices " + std::to_string(ml.GetVertexBufferSize()) + " -> "
+			+ std::to_string(data.packedVertices.size()) + " bytes, max error pos " + std::to_string(error.position)
+			+ " uv " + std::to_string(error.uv) + " normal " + std::to_string(error.normalDegrees) + " degrees");
 	}
+#endif
+
+	//lod 0 is the loaded mesh, each level after roughly halves the triangles of the one before
+	std::vector<std::vector<unsigned int>> lodIndices(1);
+	lodIndices[0].assign(ml.GetIndexData(), ml.GetIndexData() + ml.GetIndexCount());
+	std::vector<float> lodErrors(1, 0.0f);
+	for (unsigned int i = 0; i < options.lodCount; i++) {
+		const std::vector<unsigned int>& previous = lodIndices.back();
+		std::vector<unsigned int> simplified;
+		float error = MeshSimplifier::Simplify(ml.GetVertexData(), ml.GetVertexCount(),
+			previous.data(), previous.size(), (previous.size() / 6) * 3, FLT_MAX, simplified);
 
-	//copy the vertices into the buffer
-	D3D11_MAPPED_SUBRESOURCE ms;
-	devCon->Map(vBuffer, NULL, D3D11_MAP_WRITE_DISCARD, NULL, &ms); //map the buffer
-	memcpy(ms.pData, ml.GetVertexData(), ml.GetVertexBufferSize()); //copy the data into the buffer
-	devCon->Unmap(vBuffer, NULL);
+		//seams and borders can stop it getting anywhere, not worth a level for a few triangles
+		if (simplified.empty() || simplified.size() > previous.size() * 9 / 10)
+			break;
 
+		MeshOptimiser::OptimiseVertexCache(simplified.data(), simplified.size(), ml.GetVertexCount());
+		//each level is simplified from the last, so their errors stack up
+		lodErrors.push_back(lodErrors.back() + error);
+		lodIndices.push_back(std::move(simplified));
 
-	//create the index buffer
-	D3D11_BUFFER_DESC ibd = { 0 };
-	ibd.Usage = D3D11_USAGE_DEFAULT;
-	ibd.ByteWidth = (int)ml.GetIndexBufferSize();
-	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		LOG(objPath + " lod " + std::to_string(lodIndices.size() - 1) + ": "
+			+ std::to_string(lodIndices.back().size() / 3) + " triangles, error " + std::to_string(lodErrors.back()));
+	}
+
+	//every level goes into the one index buffer, split into meshlets so each one is a contiguous range
+	std::vector<unsigned int>& indices = data.indices;
+	for (size_t i = 0; i < lodIndices.size(); i++) {
+		MeshLod lod;
+		lod.firstIndex = (unsigned int)indices.size();
+		lod.indexCount = (unsigned int)lodIndices[i].size();
+		lod.error = lodErrors[i];
 
-	//define the resource data
-	D3D11_SUBRESOURCE_DATA initData = { 0 };
-	initData.pSysMem = ml.GetIndexData();
+		if (options.buildMeshlets) {
+			std::vector<unsigned int> meshletIndices;
+			Meshlets::Build(ml.GetVertexData(), ml.GetVertexCount(), lodIndices[i].data(), lodIndices[i].size(),
+				meshletIndices, lod.meshlets);
+			lodIndices[i].swap(meshletIndices);
+			for (Meshlet& meshlet : lod.meshlets) {
+				meshlet.firstIndex += lod.firstIndex;
+			}
+		}
+
+		indices.insert(indices.end(), lodIndices[i].begin(), lodIndices[i].end());
+		data.lods.push_back(std::move(lod));
+	}
 
-	//get the number of indices on the model
-	indexCount = (int)ml.GetIndexCount();
+	//bounding sphere around the loader's box, used to work out how big we are on screen
+	DirectX::XMFLOAT3 boundsMin = ml.GetBoundsMin(), boundsMax = ml.GetBoundsMax();
+	data.boundsCentre = { (boundsMin.x + boundsMax.x) * 0.5f, (boundsMin.y + boundsMax.y) * 0.5f, (boundsMin.z + boundsMax.z) * 0.5f };
+	DirectX::XMVECTOR extent = DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&boundsMax), DirectX::XMLoadFloat3(&boundsMin));
+	data.boundsRadius = DirectX::XMVectorGetX(DirectX::XMVector3Length(extent)) * 0.5f;
 
-	//create the index buffer with the device
-	if (FAILED(dev->CreateBuffer(&ibd, &initData, &iBuffer))) {
-		LOG("Failed to create index buffer");
+	//the occluder is the coarsest level that hasn't moved far, with only the vertices it uses.
+	//simplification only ever moves the surface a little either way, which a hidden object sat
+	//right behind it could slip through, so the allowed error is kept small
+	size_t occluderLod = 0;
+	for (size_t i = 1; i < lodIndices.size(); i++) {
+		if (lodErrors[i] <= options.occluderMaxError * data.boundsRadius)
+			occluderLod = i;
+	}
+	std::vector<unsigned int> remap(ml.GetVertexCount(), UINT_MAX);
+	for (unsigned int index : lodIndices[occluderLod]) {
+		if (remap[index] == UINT_MAX) {
+			remap[index] = (unsigned int)data.occluder.vertices.size();
+			data.occluder.vertices.push_back(ml.GetVertexData()[index].pos);
+		}
+		data.occluder.indices.push_back(remap[index]);
+	}
+
+	//use 16 bit indices when the mesh is small enough, halves the index buffer
+	data.shortIndices = VertexFormats::NarrowIndices(indices.data(), indices.size(),
+		ml.GetVertexCount(), data.shortIndexData);
+}
+
+void Mesh::Upload(MeshData& data) {
+	PROFILE_ZONE("Mesh::Upload");
+	vertexLayout = data.vertexLayout;
+	dequantise = data.dequantise;
+
+	//meshes don't get buffers of their own, they're copied into the pool shared with everything
+	//else of the same format so drawing them back to back needs no rebinding
+	unsigned int vertexCount = (unsigned int)(data.vertexByteSize / data.vertexStride);
+	unsigned int indexCount = data.shortIndices ? (unsigned int)data.shortIndexData.size() : (unsigned int)data.indices.size();
+	const void* indexData = data.shortIndices ? (const void*)data.shortIndexData.data() : (const void*)data.indices.data();
+	geometry = renderer.GetGeometry().Allocate(vertexLayout, data.vertexStride, data.vertexBytes, vertexCount,
+		data.shortIndices, indexData, indexCount);
+	if (geometry == GeometryPool::invalidHandle) {
+		LOG("Failed to add mesh to the geometry pool");
 		return;
 	}
+
+	gpuBytes = data.vertexByteSize + (size_t)indexCount * (data.shortIndices ? sizeof(uint16_t) : sizeof(unsigned int));
+	lods = std::move(data.lods);
+	boundsCentre = data.boundsCentre;
+	boundsRadius = data.boundsRadius;
+	occluder = std::move(data.occluder);
+}
+
+void Mesh::Render(ID3D11DeviceContext* context, GeometryPool::Bindings& bindings, unsigned int lod) {
+	DrawRange all{ lods[lod].firstIndex, lods[lod].indexCount };
+	Render(context, bindings, &all, 1);
+}
+
+unsigned int Mesh::SelectLod(float pixelsPerUnit, unsigned int currentLod, float maxErrorPixels, float hysteresis) {
+	//coarsest level whose error stays under the limit on screen. lod 0 always passes
+	auto pixelError = [&](unsigned int lod) { return lods[lod].error * pixelsPerUnit; };
+	unsigned int wanted = 0;
+	for (unsigned int i = 1; i < lods.size(); i++) {
+		if (pixelError(i) <= maxErrorPixels)
+			wanted = i;
+	}
+
+	currentLod = std::min(currentLod, (unsigned int)lods.size() - 1);
+	//go coarser only once that level is comfortably under the limit, and finer only once
+	//the current level is clearly over it, so sitting near a boundary doesn't flicker
+	if (wanted > currentLod) {
+		while (wanted > currentLod && pixelError(wanted) > maxErrorPixels * (1.0f - hysteresis))
+			wanted--;
+		return wanted;
+	}
+	if (wanted < currentLod && pixelError(currentLod) <= maxErrorPixels * (1.0f + hysteresis))
+		return currentLod;
+	return wanted;
 }
 
-void Mesh::Render() {
-	//select which primitive we are using
-	devCon->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+void Mesh::Render(ID3D11DeviceContext* context, GeometryPool::Bindings& bindings,
+	[[maybe_unused]] const DrawRange* ranges, [[maybe_unused]] size_t rangeCount) {
+	//buffers and input layout only change when the last mesh drawn was in a different arena,
+	//the renderer sets the primitive topology once per frame
+	GeometryPool& pool = renderer.GetGeometry();
+	pool.Bind(context, bindings, geometry);
 
-	//select which vertex buffer to use
-	UINT stride = sizeof(VertexPosUVNorm);
-	UINT offset = 0;
-	devCon->IASetVertexBuffers(0, 1, &vBuffer, &stride, &offset);
-	
-	//select index buffer
-	devCon->IASetIndexBuffer(iBuffer, DXGI_FORMAT_R32_UINT, 0);
+#ifndef HEADLESS_ONLY
+	unsigned int firstIndex = pool.GetFirstIndex(geometry);
+	int baseVertex = (int)pool.GetBaseVertex(geometry);
+	for (size_t i = 0; i < rangeCount; i++) {
+		context->DrawIndexed(ranges[i].indexCount, firstIndex + ranges[i].firstIndex, baseVertex);
+	}
+#endif
+}
 
-	devCon->DrawIndexed(indexCount, 0, 0);
+void Mesh::RenderInstanced(ID3D11DeviceContext* context, GeometryPool::Bindings& bindings,
+	[[maybe_unused]] unsigned int lod, [[maybe_unused]] unsigned int instanceCount, [[maybe_unused]] unsigned int firstInstance) {
+	GeometryPool& pool = renderer.GetGeometry();
+	pool.Bind(context, bindings, geometry, true);
+#ifndef HEADLESS_ONLY
+	context->DrawIndexedInstanced(lods[lod].indexCount, instanceCount,
+		pool.GetFirstIndex(geometry) + lods[lod].firstIndex, (int)pool.GetBaseVertex(geometry), firstInstance);
+#endif
 }
\ No newline at end of file
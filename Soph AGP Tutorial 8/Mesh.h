@@ -1,24 +1,110 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <memory>
+#include <DirectXMath.h>
+
+#include "ModelLoader.h"
+#include "VertexFormats.h"
+#include "Meshlet.h"
+#include "GeometryPool.h"
+#include "OcclusionBuffer.h"
 
 struct ID3D11Device;
 struct ID3D11DeviceContext;
-struct ID3D11Buffer;
 
 class Renderer;
 
+//one level of detail, a range of the mesh's index buffer
+struct MeshLod
+{
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+	float error = 0; //how far the surface may have moved from lod 0, object space units
+	std::vector<Meshlet> meshlets; //empty when built without them
+};
+
+//everything a Mesh needs before it touches the gpu. Mesh::Prepare fills it in without
+//using d3d at all, so it can run on a loading thread and be uploaded later
+struct MeshData
+{
+	std::unique_ptr<ModelLoader> loader; //kept alive so full vertices can stay in the loader's memory
+	const void* vertexBytes = nullptr;
+	size_t vertexByteSize = 0;
+	std::vector<uint8_t> packedVertices;
+	unsigned int vertexStride = 0;
+	VertexLayout vertexLayout = VertexLayout::FULL;
+	DirectX::XMFLOAT4X4 dequantise;
+
+	std::vector<unsigned int> indices;
+	std::vector<uint16_t> shortIndexData;
+	bool shortIndices = false;
+
+	std::vector<MeshLod> lods;
+	DirectX::XMFLOAT3 boundsCentre{ 0, 0, 0 };
+	float boundsRadius = 0;
+	OccluderMesh occluder;
+};
+
 class Mesh
 {
 private:
 	ID3D11Device* dev;
-	ID3D11DeviceContext* devCon;
-	ID3D11Buffer* vBuffer = NULL; //vertex buffer
-	ID3D11Buffer* iBuffer = NULL; //index buffer
+	Renderer& renderer;
+	//where our vertices and indices live in the renderer's shared buffers
+	GeometryPool::Handle geometry = GeometryPool::invalidHandle;
 
-	unsigned int indexCount = 0;
+	VertexLayout vertexLayout = VertexLayout::FULL;
+	//takes stored positions back to object space, identity unless positions are quantised
+	DirectX::XMFLOAT4X4 dequantise;
+
+	std::vector<MeshLod> lods; //finest first, empty until uploaded
+	DirectX::XMFLOAT3 boundsCentre{ 0, 0, 0 };
+	float boundsRadius = 0;
+	OccluderMesh occluder; //a coarse level's triangles, for occlusion culling
+	size_t gpuBytes = 0; //space taken in the geometry pool
+	unsigned int sortId; //small number for draw sort keys, unique per mesh
 
 public:
-	Mesh(Renderer& renderer, std::string objPath);
-	void Render();
-};
+	//loads and uploads straight away, blocking until it's done
+	Mesh(Renderer& renderer, std::string objPath, ModelLoadOptions options = {});
+	//empty mesh for the AssetLoader to Upload into later
+	Mesh(Renderer& renderer);
+	~Mesh();
+
+	//owns its space in the pool, share it through a shared_ptr instead of copying
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	//cpu side of loading, safe to call from any thread
+	static void Prepare(std::string objPath, ModelLoadOptions options, MeshData& data);
+	//copies into the renderer's geometry pool, render thread only
+	void Upload(MeshData& data);
+	bool IsResident() { return !lods.empty(); }
 
+	//these draw on the given context, immediate or deferred, binding the geometry pool's buffers
+	//through bindings when the context doesn't have them yet
+	void Render(ID3D11DeviceContext* context, GeometryPool::Bindings& bindings, unsigned int lod = 0);
+	//draws parts of the index buffer, usually what survived meshlet culling
+	void Render(ID3D11DeviceContext* context, GeometryPool::Bindings& bindings, const DrawRange* ranges, size_t rangeCount);
+	//draws a whole level once per instance, reading world matrices from the bound instance buffer
+	void RenderInstanced(ID3D11DeviceContext* context, GeometryPool::Bindings& bindings,
+		unsigned int lod, unsigned int instanceCount, unsigned int firstInstance);
+
+	size_t GetLodCount() { return lods.size(); }
+	const MeshLod& GetLod(unsigned int lod) { return lods[lod]; }
+
+	//picks a level from how many pixels one object space unit covers at the mesh's distance,
+	//with hysteresis around maxErrorPixels so it doesn't flip between levels every frame
+	unsigned int SelectLod(float pixelsPerUnit, unsigned int currentLod, float maxErrorPixels, float hysteresis);
+
+	DirectX::XMFLOAT3 GetBoundsCentre() { return boundsCentre; }
+	float GetBoundsRadius() { return boundsRadius; }
+	const OccluderMesh& GetOccluder() { return occluder; }
+	size_t GetGpuBytes() { return gpuBytes; }
+	unsigned int GetSortId() { return sortId; }
+	GeometryPool::Handle GetGeometry() { return geometry; }
+	VertexLayout GetVertexLayout() { return vertexLayout; }
+
+	DirectX::XMMATRIX GetDequantiseMatrix() { return DirectX::XMLoadFloat4x4(&dequantise); }
+};
@@ -0,0 +1,195 @@
+#include "MeshOptimiser.h"
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "ModelLoader.h"
+
+namespace MeshOptimiser {
+
+	//scoring values from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+	const int maxCacheSize = 32;
+	const float cacheDecayPower = 1.5f;
+	const float lastTriScore = 0.75f;
+	const float valenceBoostScale = 2.0f;
+	const float valenceBoostPower = 0.5f;
+
+	static float VertexScore(int cachePosition, unsigned int remainingTris) {
+		if (remainingTris == 0)
+			return -1.0f; //nothing left to draw with this vertex
+
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				//used by the last triangle, fixed score so we don't just strip along
+				score = lastTriScore;
+			}
+			else {
+				float scaler = 1.0f / (maxCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, cacheDecayPower);
+			}
+		}
+
+		//boost vertices with few triangles left so we finish them off instead of leaving holes
+		score += valenceBoostScale * powf((float)remainingTris, -valenceBoostPower);
+		return score;
+	}
+
+	VertexCacheStats AnalyseVertexCache(const unsigned int* indices, size_t indexCount,
+		size_t vertexCount, unsigned int cacheSize) {
+
+		VertexCacheStats stats;
+		if (indexCount < 3 || vertexCount == 0)
+			return stats;
+
+		//a vertex is in the fifo if it was pushed within the last cacheSize misses
+		std::vector<size_t> pushedAt(vertexCount, 0);
+		size_t time = (size_t)cacheSize + 1;
+		size_t misses = 0;
+		for (size_t i = 0; i < indexCount; i++) {
+			unsigned int v = indices[i];
+			if (time - pushedAt[v] > cacheSize) {
+				pushedAt[v] = time++;
+				misses++;
+			}
+		}
+
+		stats.acmr = (float)misses / (float)(indexCount / 3);
+		stats.atvr = (float)misses / (float)vertexCount;
+		return stats;
+	}
+
+	void OptimiseVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount) {
+		size_t triCount = indexCount / 3;
+		if (triCount == 0 || vertexCount == 0)
+			return;
+
+		//triangles using each vertex, packed into one array with per vertex offsets
+		std::vector<unsigned int> remaining(vertexCount, 0);
+		for (size_t i = 0; i < triCount * 3; i++)
+			remaining[indices[i]]++;
+
+		std::vector<size_t> adjacencyStart(vertexCount + 1, 0);
+		for (size_t v = 0; v < vertexCount; v++)
+			adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+
+		std::vector<unsigned int> adjacency(triCount * 3);
+		std::vector<size_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t t = 0; t < triCount; t++) {
+			for (int c = 0; c < 3; c++)
+				adjacency[fill[indices[t * 3 + c]]++] = (unsigned int)t;
+		}
+
+		std::vector<int> cachePosition(vertexCount, -1);
+		std::vector<float> vertexScore(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++)
+			vertexScore[v] = VertexScore(-1, remaining[v]);
+
+		std::vector<float> triScore(triCount);
+		std::vector<bool> emitted(triCount, false);
+		size_t bestTri = 0;
+		for (size_t t = 0; t < triCount; t++) {
+			triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+			if (triScore[t] > triScore[bestTri])
+				bestTri = t;
+		}
+
+		std::vector<unsigned int> output;
+		output.reserve(triCount * 3);
+
+		std::vector<unsigned int> cache, newCache;
+		cache.reserve(maxCacheSize + 3);
+		newCache.reserve(maxCacheSize + 3);
+
+		size_t scanFrom = 0; //every triangle before this has been emitted
+		for (size_t emittedCount = 0; emittedCount < triCount; emittedCount++) {
+			if (bestTri == SIZE_MAX) {
+				//nothing in the cache touches a remaining triangle, take the next one in order
+				while (emitted[scanFrom])
+					scanFrom++;
+				bestTri = scanFrom;
+			}
+
+			const unsigned int* tri = &indices[bestTri * 3];
+			output.push_back(tri[0]);
+			output.push_back(tri[1]);
+			output.push_back(tri[2]);
+			emitted[bestTri] = true;
+
+			//take this triangle out of its vertices' remaining lists
+			for (int c = 0; c < 3; c++) {
+				unsigned int v = tri[c];
+				size_t begin = adjacencyStart[v];
+				size_t end = begin + remaining[v];
+				for (size_t i = begin; i < end; i++) {
+					if (adjacency[i] == bestTri) {
+						adjacency[i] = adjacency[end - 1];
+						break;
+					}
+				}
+				remaining[v]--;
+			}
+
+			//this triangle's vertices go to the front, everything else shuffles back
+			newCache.clear();
+			newCache.push_back(tri[0]);
+			newCache.push_back(tri[1]);
+			newCache.push_back(tri[2]);
+			for (unsigned int v : cache) {
+				if (v != tri[0] && v != tri[1] && v != tri[2])
+					newCache.push_back(v);
+			}
+
+			//rescore everything whose cache position changed, and the triangles they touch
+			bestTri = SIZE_MAX;
+			float bestScore = -1.0f;
+			for (size_t i = 0; i < newCache.size(); i++) {
+				unsigned int v = newCache[i];
+				cachePosition[v] = (i < maxCacheSize) ? (int)i : -1;
+				vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+			}
+			for (size_t i = 0; i < newCache.size(); i++) {
+				unsigned int v = newCache[i];
+				size_t begin = adjacencyStart[v];
+				for (size_t j = begin; j < begin + remaining[v]; j++) {
+					unsigned int t = adjacency[j];
+					const unsigned int* other = &indices[t * 3];
+					triScore[t] = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+					if (triScore[t] > bestScore) {
+						bestScore = triScore[t];
+						bestTri = t;
+					}
+				}
+			}
+
+			if (newCache.size() > maxCacheSize)
+				newCache.resize(maxCacheSize);
+			cache.swap(newCache);
+		}
+
+		std::copy(output.begin(), output.end(), indices);
+	}
+
+	size_t OptimiseVertexFetch(VertexPosUVNorm* vertices, size_t vertexCount,
+		unsigned int* indices, size_t indexCount) {
+
+		const unsigned int unused = ~0u;
+		std::vector<unsigned int> remap(vertexCount, unused);
+		std::vector<VertexPosUVNorm> reordered;
+		reordered.reserve(vertexCount);
+
+		for (size_t i = 0; i < indexCount; i++) {
+			unsigned int& index = indices[i];
+			if (remap[index] == unused) {
+				remap[index] = (unsigned int)reordered.size();
+				reordered.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+
+		std::copy(reordered.begin(), reordered.end(), vertices);
+		return reordered.size();
+	}
+}
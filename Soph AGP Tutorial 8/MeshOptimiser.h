@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+
+struct VertexPosUVNorm;
+
+//post load passes that reorder mesh data for the gpu without changing what gets drawn
+namespace MeshOptimiser {
+	struct VertexCacheStats
+	{
+		float acmr = 0; //average cache miss ratio, vertex shader runs per triangle (0.5 - 3)
+		float atvr = 0; //average transformed vertex ratio, vertex shader runs per vertex (1 is ideal)
+	};
+
+	//simulates a fifo post transform cache of cacheSize entries over the index buffer
+	VertexCacheStats AnalyseVertexCache(const unsigned int* indices, size_t indexCount,
+		size_t vertexCount, unsigned int cacheSize = 16);
+
+	//reorders triangles so recently used vertices get reused (Tom Forsyth's linear speed algorithm)
+	void OptimiseVertexCache(unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+	//reorders vertices into first use order so vertex fetch walks memory forwards,
+	//indices are remapped to match. returns the new vertex count, unused vertices are dropped
+	size_t OptimiseVertexFetch(VertexPosUVNorm* vertices, size_t vertexCount,
+		unsigned int* indices, size_t indexCount);
+}
@@ -0,0 +1,292 @@
+#include "MeshSimplifier.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include "ModelLoader.h"
+
+using namespace DirectX;
+
+namespace MeshSimplifier {
+
+	//sum of squared distances to a set of planes (Garland & Heckbert), weighted by triangle area
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+		double weight = 0;
+
+		void AddPlane(double a, double b, double c, double d, double w) {
+			a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+			b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+			c2 += w * c * c; cd += w * c * d;
+			d2 += w * d * d;
+			weight += w;
+		}
+
+		void Add(const Quadric& q) {
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+			weight += q.weight;
+		}
+
+		double Evaluate(const XMFLOAT3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			return a2 * x * x + b2 * y * y + c2 * z * z
+				+ 2 * (ab * x * y + ac * x * z + bc * y * z)
+				+ 2 * (ad * x + bd * y + cd * z) + d2;
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		float cost; //weighted mean squared distance
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const XMFLOAT3& p) const {
+			uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			size_t h = bits[0] * 0x9E3779B1u;
+			h ^= bits[1] * 0x85EBCA77u + (h << 6) + (h >> 2);
+			h ^= bits[2] * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+			return h;
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const {
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	};
+
+	//vertices that share a position (split by uv or normal) all map to the first of them
+	static std::vector<unsigned int> BuildPositionRemap(const VertexPosUVNorm* vertices, size_t vertexCount) {
+		std::vector<unsigned int> remap(vertexCount);
+		std::unordered_map<XMFLOAT3, unsigned int, PositionHash, PositionEqual> firstWithPosition;
+		firstWithPosition.reserve(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) {
+			auto inserted = firstWithPosition.emplace(vertices[v].pos, (unsigned int)v);
+			remap[v] = inserted.first->second;
+		}
+		return remap;
+	}
+
+	static XMVECTOR TriangleNormal(XMVECTOR a, XMVECTOR b, XMVECTOR c) {
+		return XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+	}
+
+	//true if moving 'from' onto 'to' would turn any of from's remaining triangles over
+	static bool FlipsTriangle(const VertexPosUVNorm* vertices, const std::vector<unsigned int>& indices,
+		const std::vector<unsigned int>& adjacencyStart, const std::vector<unsigned int>& adjacency,
+		unsigned int from, unsigned int to) {
+
+		XMVECTOR target = XMLoadFloat3(&vertices[to].pos);
+		for (unsigned int a = adjacencyStart[from]; a < adjacencyStart[from + 1]; a++) {
+			const unsigned int* tri = &indices[adjacency[a] * 3];
+			if (tri[0] == to || tri[1] == to || tri[2] == to)
+				continue; //shares the edge, this one disappears
+
+			XMVECTOR p[3], moved[3];
+			for (int c = 0; c < 3; c++) {
+				p[c] = XMLoadFloat3(&vertices[tri[c]].pos);
+				moved[c] = (tri[c] == from) ? target : p[c];
+			}
+
+			XMVECTOR before = TriangleNormal(p[0], p[1], p[2]);
+			XMVECTOR after = TriangleNormal(moved[0], moved[1], moved[2]);
+			if (XMVectorGetX(XMVector3Dot(before, after)) <= 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	float Simplify(const VertexPosUVNorm* vertices, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float maxError,
+		std::vector<unsigned int>& outIndices) {
+
+		outIndices.assign(indices, indices + (indexCount / 3) * 3);
+		if (outIndices.size() <= targetIndexCount || vertexCount == 0)
+			return 0.0f;
+
+		std::vector<unsigned int> remap = BuildPositionRemap(vertices, vertexCount);
+
+		//locked vertices never move. seams are vertices with more than one uv/normal at the
+		//same position, borders are edges with no triangle on the other side
+		std::vector<uint8_t> locked(vertexCount, 0);
+		for (size_t v = 0; v < vertexCount; v++) {
+			if (remap[v] != v) {
+				locked[v] = 1;
+				locked[remap[v]] = 1;
+			}
+		}
+
+		std::unordered_map<uint64_t, unsigned int> edges;
+		edges.reserve(outIndices.size());
+		for (size_t i = 0; i < outIndices.size(); i += 3) {
+			for (int c = 0; c < 3; c++) {
+				uint64_t a = remap[outIndices[i + c]], b = remap[outIndices[i + (c + 1) % 3]];
+				edges[(a << 32) | b]++;
+			}
+		}
+		for (size_t i = 0; i < outIndices.size(); i += 3) {
+			for (int c = 0; c < 3; c++) {
+				uint64_t a = remap[outIndices[i + c]], b = remap[outIndices[i + (c + 1) % 3]];
+				auto opposite = edges.find((b << 32) | a);
+				if (opposite == edges.end() || opposite->second != 1 || edges[(a << 32) | b] != 1) {
+					locked[outIndices[i + c]] = 1;
+					locked[outIndices[i + (c + 1) % 3]] = 1;
+				}
+			}
+		}
+
+		//quadrics are per position so every side of a seam agrees
+		std::vector<Quadric> quadrics(vertexCount);
+		for (size_t i = 0; i < outIndices.size(); i += 3) {
+			XMVECTOR a = XMLoadFloat3(&vertices[outIndices[i + 0]].pos);
+			XMVECTOR b = XMLoadFloat3(&vertices[outIndices[i + 1]].pos);
+			XMVECTOR c = XMLoadFloat3(&vertices[outIndices[i + 2]].pos);
+			XMVECTOR n = TriangleNormal(a, b, c);
+			float length = XMVectorGetX(XMVector3Length(n));
+			if (length <= 0.0f)
+				continue;
+
+			n = XMVectorScale(n, 1.0f / length);
+			XMFLOAT3 normal;
+			XMStoreFloat3(&normal, n);
+			double d = -XMVectorGetX(XMVector3Dot(n, a));
+			double area = length * 0.5;
+			for (int k = 0; k < 3; k++) {
+				quadrics[remap[outIndices[i + k]]].AddPlane(normal.x, normal.y, normal.z, d, area);
+			}
+		}
+
+		float maxCost = maxError * maxError;
+		float error = 0.0f;
+		std::vector<Collapse> collapses;
+		std::vector<unsigned int> collapseTo(vertexCount);
+		std::vector<uint8_t> touched(vertexCount);
+		std::vector<unsigned int> adjacencyStart(vertexCount + 1);
+		std::vector<unsigned int> adjacency;
+
+		//each pass does a batch of independent collapses, cheapest first, then rebuilds
+		while (outIndices.size() > targetIndexCount) {
+			size_t triangleCount = outIndices.size() / 3;
+
+			//triangles using each vertex, rebuilt per pass as collapses change them
+			std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+			for (unsigned int index : outIndices) {
+				adjacencyStart[index + 1]++;
+			}
+			for (size_t v = 0; v < vertexCount; v++) {
+				adjacencyStart[v + 1] += adjacencyStart[v];
+			}
+			adjacency.resize(outIndices.size());
+			std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for (size_t i = 0; i < outIndices.size(); i++) {
+				adjacency[fill[outIndices[i]]++] = (unsigned int)(i / 3);
+			}
+
+			//every edge in both directions, as long as the vertex moving isn't locked
+			collapses.clear();
+			for (size_t i = 0; i < outIndices.size(); i += 3) {
+				for (int c = 0; c < 3; c++) {
+					unsigned int a = outIndices[i + c], b = outIndices[i + (c + 1) % 3];
+					for (int direction = 0; direction < 2; direction++) {
+						unsigned int from = direction ? b : a;
+						unsigned int to = direction ? a : b;
+						if (locked[from])
+							continue;
+
+						const Quadric& qFrom = quadrics[remap[from]];
+						const Quadric& qTo = quadrics[remap[to]];
+						double weight = qFrom.weight + qTo.weight;
+						double cost = (qFrom.Evaluate(vertices[to].pos) + qTo.Evaluate(vertices[to].pos));
+						cost = (weight > 0) ? std::max(0.0, cost / weight) : 0.0;
+						collapses.push_back({ from, to, (float)cost });
+					}
+				}
+			}
+			if (collapses.empty())
+				break;
+
+			std::sort(collapses.begin(), collapses.end(),
+				[](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+			for (size_t v = 0; v < vertexCount; v++) {
+				collapseTo[v] = (unsigned int)v;
+			}
+			std::fill(touched.begin(), touched.end(), 0);
+
+			//roughly how many triangles this pass removes, so we stop close to the target
+			size_t removed = 0;
+			size_t performed = 0;
+			float passError = 0.0f;
+			for (const Collapse& collapse : collapses) {
+				if (collapse.cost > maxCost)
+					break;
+				if (touched[remap[collapse.from]] || touched[remap[collapse.to]])
+					continue;
+				if (FlipsTriangle(vertices, outIndices, adjacencyStart, adjacency, collapse.from, collapse.to))
+					continue;
+
+				collapseTo[collapse.from] = collapse.to;
+				performed++;
+				passError = std::max(passError, collapse.cost);
+
+				//the flip test assumed from's neighbours stay put, so none of them move this pass
+				for (unsigned int a = adjacencyStart[collapse.from]; a < adjacencyStart[collapse.from + 1]; a++) {
+					const unsigned int* tri = &outIndices[adjacency[a] * 3];
+					bool sharesEdge = false;
+					for (int c = 0; c < 3; c++) {
+						touched[remap[tri[c]]] = 1;
+						sharesEdge |= (tri[c] == collapse.to);
+					}
+					removed += sharesEdge ? 1 : 0;
+				}
+
+				if (triangleCount - removed <= targetIndexCount / 3)
+					break;
+			}
+
+			if (performed == 0)
+				break;
+
+			//apply the collapses, dropping triangles that lost their area
+			size_t write = 0;
+			for (size_t i = 0; i < outIndices.size(); i += 3) {
+				unsigned int a = collapseTo[outIndices[i + 0]];
+				unsigned int b = collapseTo[outIndices[i + 1]];
+				unsigned int c = collapseTo[outIndices[i + 2]];
+				if (remap[a] == remap[b] || remap[b] == remap[c] || remap[a] == remap[c])
+					continue;
+
+				outIndices[write++] = a;
+				outIndices[write++] = b;
+				outIndices[write++] = c;
+			}
+			outIndices.resize(write);
+
+			//the surviving vertex now stands in for both, so it carries both sets of planes
+			for (size_t v = 0; v < vertexCount; v++) {
+				if (collapseTo[v] != v) {
+					quadrics[remap[collapseTo[v]]].Add(quadrics[remap[v]]);
+				}
+			}
+			error = std::max(error, passError);
+		}
+
+		return sqrtf(error);
+	}
+}
\ No newline at end of file
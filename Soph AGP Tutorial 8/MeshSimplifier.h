@@ -0,0 +1,16 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+struct VertexPosUVNorm;
+
+//builds lower detail index buffers for level of detail, the vertex buffer is shared by every level
+namespace MeshSimplifier {
+	//collapses edges (lowest quadric error first) until the index count reaches targetIndexCount
+	//or the next collapse would move the surface more than maxError. vertices only ever collapse
+	//onto a neighbour, so nothing needs adding to the vertex buffer. uv/normal seams and open
+	//borders are locked in place. returns the error in object space units
+	float Simplify(const VertexPosUVNorm* vertices, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount, size_t targetIndexCount, float maxError,
+		std::vector<unsigned int>& outIndices);
+}
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "Meshlet.h"
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+
+#include "ModelLoader.h"
+#include "Frustum.h"
+
+using namespace DirectX;
+
+void MeshletCullStats::Add(const MeshletCullStats& other) {
+	meshletsTested += other.meshletsTested;
+	frustumCulled += other.frustumCulled;
+	backfaceCulled += other.backfaceCulled;
+	trianglesTested += other.trianglesTested;
+	trianglesCulled += other.trianglesCulled;
+	drawRanges += other.drawRanges;
+}
+
+namespace Meshlets {
+
+	//bounding sphere and normal cone for the triangles in outIndices[firstIndex..]
+	static void CalculateBounds(const VertexPosUVNorm* vertices, const unsigned int* indices, Meshlet& meshlet) {
+		unsigned int indexCount = meshlet.triangleCount * 3;
+
+		XMVECTOR vMin = XMLoadFloat3(&vertices[indices[0]].pos);
+		XMVECTOR vMax = vMin;
+		for (unsigned int i = 1; i < indexCount; i++) {
+			XMVECTOR p = XMLoadFloat3(&vertices[indices[i]].pos);
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		//sphere around the box centre, a little loose but cheap and never misses a vertex
+		XMVECTOR centre = XMVectorScale(XMVectorAdd(vMin, vMax), 0.5f);
+		float radiusSq = 0.0f;
+		for (unsigned int i = 0; i < indexCount; i++) {
+			XMVECTOR p = XMLoadFloat3(&vertices[indices[i]].pos);
+			radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(p, centre))));
+		}
+		XMStoreFloat3(&meshlet.centre, centre);
+		meshlet.radius = sqrtf(radiusSq);
+
+		//cone axis is the average face normal. d3d treats clockwise as front facing in our
+		//left handed space, which makes (b - a) x (c - a) point out of the front face
+		XMVECTOR normals[maxTriangles];
+		unsigned int normalCount = 0;
+		XMVECTOR axis = XMVectorZero();
+		for (unsigned int t = 0; t < meshlet.triangleCount; t++) {
+			XMVECTOR a = XMLoadFloat3(&vertices[indices[t * 3 + 0]].pos);
+			XMVECTOR b = XMLoadFloat3(&vertices[indices[t * 3 + 1]].pos);
+			XMVECTOR c = XMLoadFloat3(&vertices[indices[t * 3 + 2]].pos);
+			XMVECTOR n = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+			float length = XMVectorGetX(XMVector3Length(n));
+			if (length <= 0.0f)
+				continue; //degenerate, can't face anywhere
+
+			n = XMVectorScale(n, 1.0f / length);
+			normals[normalCount++] = n;
+			axis = XMVectorAdd(axis, n);
+		}
+
+		meshlet.coneAxis = { 0, 0, 0 };
+		meshlet.coneCutoff = 1.0f;
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if (normalCount == 0 || axisLength <= 0.0f)
+			return;
+
+		axis = XMVectorScale(axis, 1.0f / axisLength);
+		float minDot = 1.0f;
+		for (unsigned int i = 0; i < normalCount; i++) {
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(normals[i], axis)));
+		}
+
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+		//close to or over a hemisphere of normals, it'd almost never cull so don't bother
+		if (minDot <= 0.1f)
+			return;
+		meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+
+	void Build(const VertexPosUVNorm* vertices, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount,
+		std::vector<unsigned int>& outIndices, std::vector<Meshlet>& outMeshlets) {
+
+		outIndices.clear();
+		outMeshlets.clear();
+		size_t triangleCount = indexCount / 3;
+		if (triangleCount == 0 || vertexCount == 0)
+			return;
+
+		outIndices.reserve(triangleCount * 3);
+
+		//triangles using each vertex, flattened with an offset table
+		std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+		for (size_t i = 0; i < triangleCount * 3; i++) {
+			adjacencyOffsets[indices[i] + 1]++;
+		}
+		for (size_t v = 0; v < vertexCount; v++) {
+			adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+		}
+		std::vector<unsigned int> adjacency(triangleCount * 3);
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < triangleCount * 3; i++) {
+			adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+		}
+
+		//triangles left per vertex, finishing nearly done vertices first leaves fewer
+		//stragglers that would need a meshlet of their own later
+		std::vector<unsigned int> liveTriangles(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) {
+			liveTriangles[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+		}
+
+		std::vector<uint8_t> emitted(triangleCount, 0);
+		//which meshlet last used each vertex, so membership checks don't need clearing
+		const unsigned int noMeshlet = 0xffffffff;
+		std::vector<unsigned int> vertexMeshlet(vertexCount, noMeshlet);
+
+		std::vector<unsigned int> meshletVertices;
+		meshletVertices.reserve(maxVertices);
+		Meshlet current;
+		size_t seed = 0;
+		size_t emittedCount = 0;
+
+		auto finishMeshlet = [&]() {
+			current.vertexCount = (unsigned int)meshletVertices.size();
+			CalculateBounds(vertices, outIndices.data() + current.firstIndex, current);
+			outMeshlets.push_back(current);
+
+			current = Meshlet();
+			current.firstIndex = (unsigned int)outIndices.size();
+			meshletVertices.clear();
+		};
+
+		while (emittedCount < triangleCount) {
+			unsigned int meshletId = (unsigned int)outMeshlets.size();
+
+			//best neighbour is the one adding the fewest new vertices
+			size_t best = triangleCount;
+			unsigned int bestNew = 4;
+			unsigned int bestLive = 0xffffffff;
+			for (unsigned int v : meshletVertices) {
+				for (unsigned int a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++) {
+					unsigned int t = adjacency[a];
+					if (emitted[t])
+						continue;
+
+					unsigned int newVertices = 0;
+					unsigned int live = 0;
+					for (int c = 0; c < 3; c++) {
+						unsigned int corner = indices[t * 3 + c];
+						if (vertexMeshlet[corner] != meshletId)
+							newVertices++;
+						live += liveTriangles[corner];
+					}
+
+					if (newVertices < bestNew || (newVertices == bestNew && live < bestLive)) {
+						best = t;
+						bestNew = newVertices;
+						bestLive = live;
+					}
+				}
+			}
+
+			//nothing connected left, start from the next triangle in index order
+			//which after the vertex cache pass is usually close by anyway
+			if (best == triangleCount) {
+				if (!meshletVertices.empty()) {
+					finishMeshlet();
+					continue;
+				}
+				while (emitted[seed]) {
+					seed++;
+				}
+				best = seed;
+				bestNew = 3;
+			}
+
+			if (meshletVertices.size() + bestNew > maxVertices || current.triangleCount + 1 > maxTriangles) {
+				finishMeshlet();
+				continue;
+			}
+
+			for (int c = 0; c < 3; c++) {
+				unsigned int corner = indices[best * 3 + c];
+				if (vertexMeshlet[corner] != meshletId) {
+					vertexMeshlet[corner] = meshletId;
+					meshletVertices.push_back(corner);
+				}
+				liveTriangles[corner]--;
+				outIndices.push_back(corner);
+			}
+			emitted[best] = 1;
+			emittedCount++;
+			current.triangleCount++;
+		}
+
+		if (current.triangleCount > 0) {
+			finishMeshlet();
+		}
+	}
+
+	void Cull(const std::vector<Meshlet>& meshlets, const Frustum& frustum,
+		XMFLOAT3 cameraPosition, std::vector<DrawRange>& outRanges, MeshletCullStats& stats,
+		bool coneCulling) {
+
+		outRanges.clear();
+		for (const Meshlet& m : meshlets) {
+			stats.meshletsTested++;
+			stats.trianglesTested += m.triangleCount;
+
+			if (!frustum.IntersectsSphere(m.centre, m.radius)) {
+				stats.frustumCulled++;
+				stats.trianglesCulled += m.triangleCount;
+				continue;
+			}
+
+			//backface cone test against the bounding sphere, culls when the camera is
+			//behind every triangle's plane (from Arseny Kapoulkine's meshoptimizer)
+			if (coneCulling) {
+				float dx = m.centre.x - cameraPosition.x;
+				float dy = m.centre.y - cameraPosition.y;
+				float dz = m.centre.z - cameraPosition.z;
+				float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+				float alongAxis = dx * m.coneAxis.x + dy * m.coneAxis.y + dz * m.coneAxis.z;
+				if (alongAxis >= m.coneCutoff * distance + m.radius) {
+					stats.backfaceCulled++;
+					stats.trianglesCulled += m.triangleCount;
+					continue;
+				}
+			}
+
+			//meshlets sit back to back in the index buffer, so neighbours join up
+			if (!outRanges.empty() && outRanges.back().firstIndex + outRanges.back().indexCount == m.firstIndex) {
+				outRanges.back().indexCount += m.triangleCount * 3;
+			}
+			else {
+				outRanges.push_back({ m.firstIndex, m.triangleCount * 3 });
+			}
+		}
+		stats.drawRanges += outRanges.size();
+	}
+}
\ No newline at end of file
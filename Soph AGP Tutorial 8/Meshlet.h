@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <DirectXMath.h>
+
+struct VertexPosUVNorm;
+class Frustum;
+
+//a small cluster of a mesh's triangles, stored as one contiguous run of the
+//mesh's index buffer so it can be drawn (or skipped) on its own
+struct Meshlet
+{
+	unsigned int firstIndex = 0;
+	unsigned int triangleCount = 0;
+	unsigned int vertexCount = 0; //unique vertices used
+
+	//bounding sphere, object space
+	DirectX::XMFLOAT3 centre{ 0, 0, 0 };
+	float radius = 0;
+
+	//every triangle normal is within the cone around coneAxis. coneCutoff is the
+	//sine of the cone's half angle, 1 means the normals spread too far to ever cull
+	DirectX::XMFLOAT3 coneAxis{ 0, 0, 0 };
+	float coneCutoff = 1;
+};
+
+//part of the index buffer to draw, adjacent visible meshlets get merged into one
+struct DrawRange
+{
+	unsigned int firstIndex = 0;
+	unsigned int indexCount = 0;
+};
+
+struct MeshletCullStats
+{
+	size_t meshletsTested = 0;
+	size_t frustumCulled = 0;
+	size_t backfaceCulled = 0;
+	size_t trianglesTested = 0;
+	size_t trianglesCulled = 0;
+	size_t drawRanges = 0;
+
+	void Add(const MeshletCullStats& other);
+};
+
+namespace Meshlets {
+	const unsigned int maxVertices = 64;
+	const unsigned int maxTriangles = 124;
+
+	//groups triangles into meshlets, growing each one through its neighbours so they
+	//stay spatially tight. outIndices is the index buffer reordered so every meshlet
+	//is a contiguous range, the triangles themselves don't change
+	void Build(const VertexPosUVNorm* vertices, size_t vertexCount,
+		const unsigned int* indices, size_t indexCount,
+		std::vector<unsigned int>& outIndices, std::vector<Meshlet>& outMeshlets);
+
+	//rejects meshlets outside the frustum or facing away from the camera and writes the
+	//rest as compacted draw ranges. frustum and cameraPosition are in the mesh's object space.
+	//the cone test only holds while object space keeps its angles and handedness, pass
+	//coneCulling false for non-uniform or negative scale and only the frustum test runs
+	void Cull(const std::vector<Meshlet>& meshlets, const Frustum& frustum,
+		DirectX::XMFLOAT3 cameraPosition, std::vector<DrawRange>& outRanges, MeshletCullStats& stats,
+		bool coneCulling = true);
+}
\ No newline at end of file
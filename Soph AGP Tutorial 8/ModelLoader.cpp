@@ -2,8 +2,153 @@
 
 #include <fstream>
 #include <sstream>
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
 
-#include <windows.h> // For OutputDebugStringA
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "Debug.h"
+
+//cooked mesh blob written next to the OBJ, laid out as
+//[header][source path][pad to 16][vertices][indices]
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+	//key: the blob is only used if all of these still match the OBJ
+	uint64_t sourceSize;
+	int64_t sourceTime;
+	uint64_t sourceHash;
+	uint32_t pathLength;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t flags; //meshCacheFlags the data was cooked with
+	DirectX::XMFLOAT3 boundsMin;
+	DirectX::XMFLOAT3 boundsMax;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+};
+
+//bump whenever the blob layout or the data we cook into it changes
+const uint32_t meshCacheVersion = 1;
+const char meshCacheMagic[4] = { 'M', 'B', 'I', 'N' };
+
+//load options that change the cooked data, a blob only matches the same set
+enum meshCacheFlags : uint32_t
+{
+	MESH_CACHE_OPTIMISED = 1 << 0,
+};
+
+//FNV-1a, only needs to tell "same file" from "edited file"
+static uint64_t HashBytes(const char* data, size_t size)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= (unsigned char)data[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static std::string CachePath(std::string path)
+{
+	return path + ".meshbin";
+}
+
+//once a touched source has hashed the same, the blob takes its new time so later loads don't
+//hash it again. only the time is written, in place
+static bool UpdateSourceTime(std::string cachePath, int64_t sourceTime)
+{
+	std::fstream file{ cachePath, std::ios::binary | std::ios::in | std::ios::out };
+	file.seekp(offsetof(MeshCacheHeader, sourceTime));
+	file.write((const char*)&sourceTime, sizeof(sourceTime));
+	file.close();
+	if (!file)
+	{
+		LOG("Failed to update the source time in mesh cache " + cachePath);
+		return false;
+	}
+	return true;
+}
+
+std::string ModelLoader::CanonicalPath(std::string path)
+{
+	std::error_code ec;
+	std::filesystem::path canonical = std::filesystem::weakly_canonical(path, ec);
+	return ec ? path : canonical.generic_string();
+}
+
+static int64_t SourceTime(std::string path)
+{
+	std::error_code ec;
+	auto time = std::filesystem::last_write_time(path, ec);
+	return ec ? 0 : (int64_t)time.time_since_epoch().count();
+}
+
+//files smaller than this per thread aren't worth splitting
+const size_t minChunkSize = 1 << 20;
+
+//helpers for the mapped parser, these work straight on the file bytes
+//and never allocate. from_chars is locale independent unlike stringstream
+static const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+		p++;
+	return p;
+}
+
+static const char* ParseFloat(const char* p, const char* end, float& out)
+{
+	p = SkipSpaces(p, end);
+	if (p < end && *p == '+') //from_chars doesn't accept a leading plus
+		p++;
+	auto result = std::from_chars(p, end, out);
+	if (result.ec != std::errc())
+	{
+		out = 0.0f; //same as a failed stream extraction
+		return p;
+	}
+	return result.ptr;
+}
+
+//reads one face index. negative indices count back from the last element read,
+//those are stored relative to the chunk start and flagged so the merge can offset them
+static bool ParseIndex(const char*& p, const char* end, size_t localCount,
+	unsigned int& out, bool& relative)
+{
+	int value = 0;
+	auto result = std::from_chars(p, end, value);
+	if (result.ec != std::errc() || value == 0)
+		return false;
+	p = result.ptr;
+
+	relative = value < 0;
+	out = relative ? (unsigned int)(localCount + value) : (unsigned int)value;
+	return true;
+}
+
+//the same for the streamed parser, which always knows how many elements came before.
+//reaching back past the first wraps to 0 or past the end, which InRange rejects
+static unsigned int ResolveIndex(int value, size_t count)
+{
+	return value < 0 ? (unsigned int)((int64_t)count + value + 1) : (unsigned int)value;
+}
+
+static bool ExpectChar(const char*& p, const char* end, char c)
+{
+	if (p >= end || *p != c)
+		return false;
+	p++;
+	return true;
+}
 
 DirectX::XMFLOAT3 ModelLoader::ParseFloat3(std::string verts)
 {
@@ -61,29 +206,33 @@ void ModelLoader::ParseFace(std::string face)
 	if (format == FaceFormat::UNKNOWN)
 		format = DetectFaceFormat(face);
 
-	FaceIndices p1, p2, p3;
+	//signed, negative indices count back from the last element read so far
+	int v[3] = { 0 }, vt[3] = { 0 }, vn[3] = { 0 };
 	int replaced = 0;
 	switch (format)
 	{
 	case ModelLoader::FaceFormat::UNKNOWN:
 		break;
 	case ModelLoader::FaceFormat::V:
+		replaced = sscanf(face.c_str(), "%d %d %d", &v[0], &v[1], &v[2]);
+		if (replaced != 3)
+			return;
 		break;
 	case ModelLoader::FaceFormat::V_VT:
-		replaced = sscanf_s(face.c_str(), "%u/%u %u/%u %u/%u",
-			&p1.v, &p1.vt, &p2.v, &p2.vt, &p3.v, &p3.vt);
+		replaced = sscanf(face.c_str(), "%d/%d %d/%d %d/%d",
+			&v[0], &vt[0], &v[1], &vt[1], &v[2], &vt[2]);
 		if (replaced != 6)
 			return;
 		break;
 	case ModelLoader::FaceFormat::V_VN:
-		replaced = sscanf_s(face.c_str(), "%u//%u %u//%u %u//%u",
-			&p1.v, &p1.vn, &p2.v, &p2.vn, &p3.v, &p3.vn);
+		replaced = sscanf(face.c_str(), "%d//%d %d//%d %d//%d",
+			&v[0], &vn[0], &v[1], &vn[1], &v[2], &vn[2]);
 		if (replaced != 6)
 			return;
 		break;
 	case ModelLoader::FaceFormat::V_VT_VN:
-		replaced = sscanf_s(face.c_str(), "%u/%u/%u %u/%u/%u %u/%u/%u",
-				&p1.v, &p1.vt, &p1.vn, &p2.v, &p2.vt, &p2.vn, &p3.v, &p3.vt, &p3.vn);
+		replaced = sscanf(face.c_str(), "%d/%d/%d %d/%d/%d %d/%d/%d",
+				&v[0], &vt[0], &vn[0], &v[1], &vt[1], &vn[1], &v[2], &vt[2], &vn[2]);
 		if (replaced != 9)
 			return;
 		break;
@@ -93,37 +242,115 @@ void ModelLoader::ParseFace(std::string face)
 		return;
 	}
 
-	auto p1it = std::find(face_points.begin(), face_points.end(), p1);
-	if (p1it == face_points.end())
+	for (int i = 0; i < 3; i++)
 	{
-		face_points.push_back(p1);
-		out_indices.push_back((unsigned int)face_points.size() - 1);
-	}
-	else
-	{
-		out_indices.push_back((unsigned int)std::distance(face_points.begin(), p1it));
+		read_faces.emplace_back(ResolveIndex(v[i], read_vertices.size()),
+			ResolveIndex(vt[i], read_uv.size()), ResolveIndex(vn[i], read_normals.size()));
 	}
+}
+
+void ModelLoader::ParseFace(const char* begin, const char* end, ParsedChunk& chunk)
+{
+	if (chunk.format == FaceFormat::UNKNOWN)
+		chunk.format = DetectFaceFormat(std::string(begin, end));
 
-	auto p2it = std::find(face_points.begin(), face_points.end(), p2);
-	if (p2it == face_points.end())
+	if (chunk.format == FaceFormat::FORMAT_ERROR)
+		return;
+
+	//same layouts as the sscanf patterns above, only the first three corners are used
+	FaceIndices points[3];
+	bool relative[9] = { false };
+	const char* p = begin;
+	for (int i = 0; i < 3; i++)
 	{
-		face_points.push_back(p2);
-		out_indices.push_back((unsigned int)face_points.size() - 1);
+		FaceIndices& point = points[i];
+		bool* rel = &relative[i * 3];
+
+		p = SkipSpaces(p, end);
+		if (!ParseIndex(p, end, chunk.vertices.size(), point.v, rel[0]))
+			return;
+
+		switch (chunk.format)
+		{
+		case ModelLoader::FaceFormat::V_VT:
+			if (!ExpectChar(p, end, '/') || !ParseIndex(p, end, chunk.uv.size(), point.vt, rel[1]))
+				return;
+			break;
+		case ModelLoader::FaceFormat::V_VN:
+			if (!ExpectChar(p, end, '/') || !ExpectChar(p, end, '/')
+				|| !ParseIndex(p, end, chunk.normals.size(), point.vn, rel[2]))
+				return;
+			break;
+		case ModelLoader::FaceFormat::V_VT_VN:
+			if (!ExpectChar(p, end, '/') || !ParseIndex(p, end, chunk.uv.size(), point.vt, rel[1])
+				|| !ExpectChar(p, end, '/') || !ParseIndex(p, end, chunk.normals.size(), point.vn, rel[2]))
+				return;
+			break;
+		default:
+			break;
+		}
 	}
-	else
+
+	size_t firstEntry = chunk.faces.size() * 3;
+	for (int i = 0; i < 9; i++)
 	{
-		out_indices.push_back((unsigned int)std::distance(face_points.begin(), p2it));
+		if (relative[i])
+			chunk.relativeIndices.push_back(firstEntry + i);
 	}
 
-	auto p3it = std::find(face_points.begin(), face_points.end(), p3);
-	if (p3it == face_points.end())
+	chunk.faces.push_back(points[0]);
+	chunk.faces.push_back(points[1]);
+	chunk.faces.push_back(points[2]);
+}
+
+bool ModelLoader::InRange(const FaceIndices& point, size_t vertices, size_t uvs, size_t normals) const
+{
+	//relative indices that reached back too far wrap to 0 or past the end, both land here
+	if (point.v == 0 || point.v > vertices)
+		return false;
+	if ((format == FaceFormat::V_VT || format == FaceFormat::V_VT_VN) && (point.vt == 0 || point.vt > uvs))
+		return false;
+	if ((format == FaceFormat::V_VN || format == FaceFormat::V_VT_VN) && (point.vn == 0 || point.vn > normals))
+		return false;
+	return true;
+}
+
+unsigned int ModelLoader::AddFacePoint(const FaceIndices& point)
+{
+	// keep the table at most half full so probe chains stay short
+	if ((face_points.size() + 1) * 2 > face_lookup.size())
+		GrowFaceLookup();
+
+	size_t mask = face_lookup.size() - 1;
+	size_t slot = point.Hash() & mask;
+	while (face_lookup[slot] != 0)
 	{
-		face_points.push_back(p3);
-		out_indices.push_back((unsigned int)face_points.size() - 1);
+		unsigned int index = face_lookup[slot] - 1;
+		if (face_points[index] == point)
+			return index;
+		slot = (slot + 1) & mask;
 	}
-	else
+
+	//first time we've seen this combination, indices stay in first-seen order
+	face_points.push_back(point);
+	unsigned int index = (unsigned int)face_points.size() - 1;
+	face_lookup[slot] = index + 1;
+	return index;
+}
+
+void ModelLoader::GrowFaceLookup()
+{
+	size_t newSize = face_lookup.empty() ? 1024 : face_lookup.size() * 2;
+	face_lookup.assign(newSize, 0);
+
+	//reinsert everything we already have, no duplicates so no compares needed
+	size_t mask = newSize - 1;
+	for (size_t i = 0; i < face_points.size(); i++)
 	{
-		out_indices.push_back((unsigned int)std::distance(face_points.begin(), p3it));
+		size_t slot = face_points[i].Hash() & mask;
+		while (face_lookup[slot] != 0)
+			slot = (slot + 1) & mask;
+		face_lookup[slot] = (unsigned int)i + 1;
 	}
 }
 
@@ -143,13 +370,42 @@ std::vector<std::string> ModelLoader::Split(std::string s, std::string delimiter
 	return res;
 }
 
-ModelLoader::ModelLoader(std::string path)
+ModelLoader::ModelLoader(std::string path, ModelLoadOptions options)
 {
-	LoadModelData(path);
+	PROFILE_ZONE("ModelLoader");
+	uint32_t cacheFlags = 0;
+	if (options.optimise)
+		cacheFlags |= MESH_CACHE_OPTIMISED;
+
+	if (options.useCache && LoadCache(path, cacheFlags))
+		return;
+
+	if (options.mode == ModelLoadMode::MAPPED)
+		LoadModelDataMapped(path, options.threadCount);
+	else
+		LoadModelData(path);
+
+	if (!BuildVertices(path))
+		return;
+
+	if (options.optimise)
+		Optimise(path);
+
+	vertexData = out_verts.data();
+	vertexCount = out_verts.size();
+	indexData = out_indices.data();
+	indexCount = out_indices.size();
+	CalculateBounds();
+
+	if (options.useCache)
+		WriteCache(path, cacheFlags);
 }
 
+ModelLoader::~ModelLoader() = default;
+
 void ModelLoader::LoadModelData(std::string path)
 {
+	PROFILE_ZONE("ModelLoader::LoadModelData");
 	using namespace std;
 	using namespace DirectX;
 
@@ -189,17 +445,197 @@ void ModelLoader::LoadModelData(std::string path)
 
 	file.close();
 
-	if (format == FaceFormat::FORMAT_ERROR)
+	//faces can point at elements further down the file, so only check once it's all read.
+	//dedup is a step of its own after that, the same as the mapped parser's merge
+	PROFILE_ZONE("ModelLoader::DedupFaces");
+	out_indices.reserve(read_faces.size());
+	for (auto& point : read_faces)
 	{
-		std::string errorStr = "Unable to load " + path + ". Invalid face format";
-		OutputDebugStringA((std::string(__FILE__) + "(" + std::to_string(__LINE__)
-			+ "): " + std::string(errorStr) + "\n").c_str());
+		if (!InRange(point, read_vertices.size(), read_uv.size(), read_normals.size()))
+		{
+			format = FaceFormat::FORMAT_ERROR;
+			return;
+		}
+		out_indices.push_back(AddFacePoint(point));
+	}
+	read_faces = std::vector<FaceIndices>{};
+}
+
+void ModelLoader::LoadModelDataMapped(std::string path, unsigned int threadCount)
+{
+	PROFILE_ZONE("ModelLoader::LoadModelDataMapped");
+	MappedFile file{ path };
+	if (!file.IsOpen())
 		return;
+
+	const char* data = file.GetData();
+	size_t size = file.GetSize();
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	size_t chunkCount = std::min((size_t)threadCount, std::max((size_t)1, size / minChunkSize));
+
+	//split the file into roughly even chunks, pushing each split forward to the next line
+	std::vector<const char*> bounds{ data };
+	for (size_t i = 1; i < chunkCount; i++)
+	{
+		const char* split = std::max(data + size * i / chunkCount, bounds.back());
+		const char* lineEnd = (const char*)memchr(split, '\n', data + size - split);
+		bounds.push_back(lineEnd ? lineEnd + 1 : data + size);
+	}
+	bounds.push_back(data + size);
+
+	std::vector<ParsedChunk> chunks(chunkCount);
+	if (chunkCount == 1)
+	{
+		ParseChunk(bounds[0], bounds[1], FaceFormat::UNKNOWN, chunks[0]);
+	}
+	else
+	{
+		std::vector<std::thread> workers;
+		for (size_t i = 0; i < chunkCount; i++)
+			workers.emplace_back(ParseChunk, bounds[i], bounds[i + 1], FaceFormat::UNKNOWN, std::ref(chunks[i]));
+		for (auto& worker : workers)
+			worker.join();
+	}
+
+	//a serial parse takes its face format from the first face in the file, any chunk
+	//that guessed differently from its own first face gets parsed again with that format
+	for (auto& chunk : chunks)
+	{
+		if (chunk.format != FaceFormat::UNKNOWN)
+		{
+			format = chunk.format;
+			break;
+		}
+	}
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		if (chunks[i].format != FaceFormat::UNKNOWN && chunks[i].format != format)
+		{
+			chunks[i] = ParsedChunk{};
+			ParseChunk(bounds[i], bounds[i + 1], format, chunks[i]);
+		}
+	}
+
+	MergeChunks(chunks);
+}
+
+void ModelLoader::ParseChunk(const char* begin, const char* end, FaceFormat faceFormat, ParsedChunk& chunk)
+{
+	PROFILE_ZONE("ModelLoader::ParseChunk");
+	chunk.format = faceFormat;
+
+	const char* p = begin;
+	while (p < end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (lineEnd == nullptr)
+			lineEnd = end;
+
+		//first word of the line decides what we're reading
+		p = SkipSpaces(p, lineEnd);
+		const char* token = p;
+		while (p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r')
+			p++;
+		size_t tokenLength = p - token;
+
+		if (tokenLength == 1 && token[0] == 'v')
+		{
+			DirectX::XMFLOAT3 out;
+			p = ParseFloat(p, lineEnd, out.x);
+			p = ParseFloat(p, lineEnd, out.y);
+			p = ParseFloat(p, lineEnd, out.z);
+			chunk.vertices.push_back(out);
+		}
+		else if (tokenLength == 2 && token[0] == 'v' && token[1] == 't')
+		{
+			DirectX::XMFLOAT2 out;
+			p = ParseFloat(p, lineEnd, out.x);
+			p = ParseFloat(p, lineEnd, out.y);
+			chunk.uv.push_back(out);
+		}
+		else if (tokenLength == 2 && token[0] == 'v' && token[1] == 'n')
+		{
+			DirectX::XMFLOAT3 out;
+			p = ParseFloat(p, lineEnd, out.x);
+			p = ParseFloat(p, lineEnd, out.y);
+			p = ParseFloat(p, lineEnd, out.z);
+			chunk.normals.push_back(out);
+		}
+		else if (tokenLength == 1 && token[0] == 'f')
+		{
+			ParseFace(p, lineEnd, chunk);
+		}
+
+		p = (lineEnd < end) ? lineEnd + 1 : end;
+	}
+}
+
+void ModelLoader::MergeChunks(std::vector<ParsedChunk>& chunks)
+{
+	PROFILE_ZONE("ModelLoader::MergeChunks");
+	size_t vertexTotal = 0, uvTotal = 0, normalTotal = 0, faceTotal = 0;
+	for (auto& chunk : chunks)
+	{
+		vertexTotal += chunk.vertices.size();
+		uvTotal += chunk.uv.size();
+		normalTotal += chunk.normals.size();
+		faceTotal += chunk.faces.size();
+	}
+	read_vertices.reserve(vertexTotal);
+	read_uv.reserve(uvTotal);
+	read_normals.reserve(normalTotal);
+	out_indices.reserve(faceTotal);
+
+	//chunks are appended in file order so face order, and with it the
+	//first-seen vertex order, matches a serial parse exactly
+	for (auto& chunk : chunks)
+	{
+		for (size_t entry : chunk.relativeIndices)
+		{
+			FaceIndices& point = chunk.faces[entry / 3];
+			switch (entry % 3)
+			{
+			case 0: point.v += (unsigned int)read_vertices.size() + 1; break;
+			case 1: point.vt += (unsigned int)read_uv.size() + 1; break;
+			case 2: point.vn += (unsigned int)read_normals.size() + 1; break;
+			}
+		}
+
+		read_vertices.insert(read_vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+		read_uv.insert(read_uv.end(), chunk.uv.begin(), chunk.uv.end());
+		read_normals.insert(read_normals.end(), chunk.normals.begin(), chunk.normals.end());
+
+		for (auto& point : chunk.faces)
+		{
+			//checked against the whole file, a point past the end of a list or before its
+			//start once relative ones are offset fails the load like a bad face format
+			if (!InRange(point, vertexTotal, uvTotal, normalTotal))
+			{
+				format = FaceFormat::FORMAT_ERROR;
+				return;
+			}
+			out_indices.push_back(AddFacePoint(point));
+		}
+
+		chunk = ParsedChunk{}; //free each chunk as soon as it's merged
+	}
+}
+
+bool ModelLoader::BuildVertices([[maybe_unused]] std::string path)
+{
+	PROFILE_ZONE("ModelLoader::BuildVertices");
+	if (format == FaceFormat::FORMAT_ERROR)
+	{
+		LOG("Unable to load " + path + ". Invalid face format or index");
+		return false;
 	}
 
+	out_verts.reserve(face_points.size());
 	for (auto p : face_points)
 	{
-		VertexPosUVNorm v;
+		VertexPosUVNorm v{};
 		v.pos = read_vertices[p.v - 1];
 		if(format == FaceFormat::V_VT || format == FaceFormat::V_VT_VN)
 			v.uv = read_uv[p.vt - 1];
@@ -208,4 +644,170 @@ void ModelLoader::LoadModelData(std::string path)
 		out_verts.push_back(v);
 	}
 
+	return true;
+}
+
+void ModelLoader::CalculateBounds()
+{
+	if (vertexCount == 0)
+		return;
+
+	boundsMin = boundsMax = vertexData[0].pos;
+	for (size_t i = 1; i < vertexCount; i++)
+	{
+		const DirectX::XMFLOAT3& pos = vertexData[i].pos;
+		boundsMin = { std::min(boundsMin.x, pos.x), std::min(boundsMin.y, pos.y), std::min(boundsMin.z, pos.z) };
+		boundsMax = { std::max(boundsMax.x, pos.x), std::max(boundsMax.y, pos.y), std::max(boundsMax.z, pos.z) };
+	}
+}
+
+void ModelLoader::Optimise([[maybe_unused]] std::string path)
+{
+	PROFILE_ZONE("ModelLoader::Optimise");
+	cacheStatsBefore = MeshOptimiser::AnalyseVertexCache(out_indices.data(), out_indices.size(), out_verts.size());
+
+	MeshOptimiser::OptimiseVertexCache(out_indices.data(), out_indices.size(), out_verts.size());
+	size_t usedVertices = MeshOptimiser::OptimiseVertexFetch(out_verts.data(), out_verts.size(),
+		out_indices.data(), out_indices.size());
+	out_verts.resize(usedVertices);
+
+	cacheStatsAfter = MeshOptimiser::AnalyseVertexCache(out_indices.data(), out_indices.size(), out_verts.size());
+
+	LOG(path + " vertex cache ACMR " + std::to_string(cacheStatsBefore.acmr) + " -> " + std::to_string(cacheStatsAfter.acmr)
+		+ ", ATVR " + std::to_string(cacheStatsBefore.atvr) + " -> " + std::to_string(cacheStatsAfter.atvr));
+}
+
+bool ModelLoader::LoadCache(std::string path, uint32_t flags)
+{
+	PROFILE_ZONE("ModelLoader::LoadCache");
+	std::error_code ec;
+	if (!std::filesystem::exists(CachePath(path), ec))
+		return false;
+
+	auto blob = std::make_unique<MappedFile>(CachePath(path));
+	if (!blob->IsOpen() || blob->GetSize() < sizeof(MeshCacheHeader))
+		return false;
+
+	MeshCacheHeader header;
+	memcpy(&header, blob->GetData(), sizeof(header));
+	if (memcmp(header.magic, meshCacheMagic, sizeof(header.magic)) != 0 || header.version != meshCacheVersion
+		|| header.flags != flags)
+		return false;
+
+	std::string sourcePath = CanonicalPath(path);
+	if (header.pathLength != sourcePath.size()
+		|| sizeof(header) + header.pathLength > blob->GetSize()
+		|| memcmp(blob->GetData() + sizeof(header), sourcePath.data(), sourcePath.size()) != 0)
+		return false;
+
+	uint64_t sourceSize = std::filesystem::file_size(path, ec);
+	if (ec || sourceSize != header.sourceSize)
+		return false;
+
+	//a touched but otherwise identical file still hits, we just have to hash it to know
+	int64_t sourceTime = SourceTime(path);
+	bool touched = sourceTime != header.sourceTime;
+	if (touched)
+	{
+		MappedFile source{ path };
+		if (!source.IsOpen() || HashBytes(source.GetData(), source.GetSize()) != header.sourceHash)
+			return false;
+	}
+
+	//vertices then indices, both after the path, aligned and inside the file. compared as sizes
+	//left rather than offset + bytes so garbage offsets can't wrap around and pass
+	uint64_t size = blob->GetSize();
+	uint64_t vertexBytes = (uint64_t)header.vertexCount * sizeof(VertexPosUVNorm);
+	uint64_t indexBytes = (uint64_t)header.indexCount * sizeof(unsigned int);
+	if (header.vertexOffset < sizeof(header) + header.pathLength || header.vertexOffset % alignof(VertexPosUVNorm) != 0
+		|| header.vertexOffset > size || vertexBytes > size - header.vertexOffset
+		|| header.indexOffset < header.vertexOffset + vertexBytes || header.indexOffset % alignof(unsigned int) != 0
+		|| header.indexOffset > size || indexBytes > size - header.indexOffset)
+	{
+		LOG("Mesh cache " + CachePath(path) + " is truncated or corrupt, reparsing");
+		return false;
+	}
+
+	//the mapping only shares reading on windows, so let go of it to write the new time and load
+	//again from the top, which now skips the hash. if the write failed the load just reparses
+	if (touched)
+	{
+		blob.reset();
+		return UpdateSourceTime(CachePath(path), sourceTime) && LoadCache(path, flags);
+	}
+
+	vertexData = (const VertexPosUVNorm*)(blob->GetData() + header.vertexOffset);
+	vertexCount = header.vertexCount;
+	indexData = (const unsigned int*)(blob->GetData() + header.indexOffset);
+	indexCount = header.indexCount;
+	boundsMin = header.boundsMin;
+	boundsMax = header.boundsMax;
+	cacheFile = std::move(blob);
+	return true;
+}
+
+void ModelLoader::WriteCache(std::string path, uint32_t flags)
+{
+	PROFILE_ZONE("ModelLoader::WriteCache");
+	if (vertexCount == 0 || indexCount == 0)
+		return;
+
+	std::string sourcePath = CanonicalPath(path);
+
+	MeshCacheHeader header = {};
+	memcpy(header.magic, meshCacheMagic, sizeof(header.magic));
+	header.version = meshCacheVersion;
+	header.flags = flags;
+	header.sourceTime = SourceTime(path);
+	{
+		MappedFile source{ path };
+		header.sourceSize = source.GetSize();
+		header.sourceHash = HashBytes(source.GetData(), source.GetSize());
+	}
+	header.pathLength = (uint32_t)sourcePath.size();
+	header.vertexCount = (uint32_t)vertexCount;
+	header.indexCount = (uint32_t)indexCount;
+	header.boundsMin = boundsMin;
+	header.boundsMax = boundsMax;
+	header.vertexOffset = (sizeof(header) + sourcePath.size() + 15) & ~(uint64_t)15;
+	header.indexOffset = header.vertexOffset + GetVertexBufferSize();
+
+	//write to a temp file then swap it in so a crash never leaves a half written blob. the
+	//name is unique per write, two loads cooking the same OBJ at once each rename a whole
+	//blob of their own and the last one wins
+	static std::atomic<uint32_t> tempCounter{ 0 };
+	std::string tempPath = CachePath(path) + "."
+		+ std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + "."
+		+ std::to_string(tempCounter++) + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		if (!file)
+		{
+			LOG("Failed to write mesh cache " + tempPath);
+			return;
+		}
+
+		const char padding[16] = {};
+		file.write((const char*)&header, sizeof(header));
+		file.write(sourcePath.data(), sourcePath.size());
+		file.write(padding, header.vertexOffset - sizeof(header) - sourcePath.size());
+		file.write((const char*)vertexData, GetVertexBufferSize());
+		file.write((const char*)indexData, GetIndexBufferSize());
+		if (!file)
+		{
+			LOG("Failed to write mesh cache " + tempPath);
+			file.close();
+			std::error_code ec;
+			std::filesystem::remove(tempPath, ec);
+			return;
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, CachePath(path), ec);
+	if (ec)
+	{
+		LOG("Failed to replace mesh cache " + CachePath(path));
+		std::filesystem::remove(tempPath, ec);
+	}
 }
\ No newline at end of file
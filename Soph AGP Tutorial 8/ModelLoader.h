@@ -1,8 +1,15 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <memory>
+#include <cstdint>
 #include <DirectXMath.h>
 
+#include "MeshOptimiser.h"
+#include "VertexFormats.h"
+
+class MappedFile;
+
 struct VertexPosUVNorm
 {
 	DirectX::XMFLOAT3 pos;
@@ -10,6 +17,32 @@ struct VertexPosUVNorm
 	DirectX::XMFLOAT3 norm;
 };
 
+enum class ModelLoadMode
+{
+	STREAM, //getline + stringstream per line, kept for comparison
+	MAPPED  //memory mapped file parsed in a single pass
+};
+
+struct ModelLoadOptions
+{
+	ModelLoadMode mode = ModelLoadMode::MAPPED;
+	//threads used by the mapped parser, 0 uses every core. small files always parse on one
+	unsigned int threadCount = 0;
+	//read/write a cooked <path>.meshbin next to the OBJ so unchanged models skip parsing
+	bool useCache = true;
+	//reorder triangles for the post transform cache and vertices for fetch locality
+	bool optimise = true;
+	//gpu vertex format the Mesh packs into, doesn't change what the loader outputs
+	VertexLayout vertexLayout = VertexLayout::FULL;
+	//split the Mesh into meshlets so the renderer can cull parts of it
+	bool buildMeshlets = true;
+	//simplified levels of detail the Mesh builds after the full one, each about half the last
+	unsigned int lodCount = 3;
+	//the Mesh keeps its coarsest level within this fraction of its bounding radius on the cpu,
+	//for objects drawn into the renderer's occlusion buffer
+	float occluderMaxError = 0.01f;
+};
+
 class ModelLoader
 {
 public:
@@ -18,14 +51,29 @@ public:
 		UNKNOWN, V, V_VT, V_VN, V_VT_VN, FORMAT_ERROR
 	};
 
-	ModelLoader(std::string path);
-	VertexPosUVNorm* GetVertexData() { return out_verts.data(); }
-	size_t GetVertexCount() { return out_verts.size(); }
-	size_t GetVertexBufferSize() { return out_verts.size() * sizeof(VertexPosUVNorm); }
+	ModelLoader(std::string path, ModelLoadOptions options = {});
+	~ModelLoader();
+
+	//these point either at our parsed vectors or straight into a mapped cache file
+	const VertexPosUVNorm* GetVertexData() { return vertexData; }
+	size_t GetVertexCount() { return vertexCount; }
+	size_t GetVertexBufferSize() { return vertexCount * sizeof(VertexPosUVNorm); }
+
+	const unsigned int* GetIndexData() { return indexData; }
+	size_t GetIndexCount() { return indexCount; }
+	size_t GetIndexBufferSize() { return indexCount * sizeof(unsigned int); }
+
+	DirectX::XMFLOAT3 GetBoundsMin() { return boundsMin; }
+	DirectX::XMFLOAT3 GetBoundsMax() { return boundsMax; }
+
+	bool IsFromCache() { return cacheFile != nullptr; }
 
-	unsigned int* GetIndexData() { return out_indices.data(); }
-	size_t GetIndexCount() { return out_indices.size(); }
-	size_t GetIndexBufferSize() { return out_indices.size() * sizeof(unsigned int); }
+	//absolute path with separators normalised, the same file always gives the same string
+	static std::string CanonicalPath(std::string path);
+
+	//filled in when this load ran the optimise pass, zero when it came from the cache
+	MeshOptimiser::VertexCacheStats GetCacheStatsBefore() { return cacheStatsBefore; }
+	MeshOptimiser::VertexCacheStats GetCacheStatsAfter() { return cacheStatsAfter; }
 
 private:
 	struct FaceIndices
@@ -43,22 +91,74 @@ private:
 		{
 			return (v == other.v) && (vt == other.vt) && (vn == other.vn);
 		}
+
+		size_t Hash() const
+		{
+			// mix the three indices so neighbouring faces spread across the table
+			size_t h = v * 0x9E3779B1u;
+			h ^= vt * 0x85EBCA77u + (h << 6) + (h >> 2);
+			h ^= vn * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+			return h;
+		}
 	};
 
-	FaceFormat format;
+	//output of parsing one slice of the file, merged in file order afterwards
+	struct ParsedChunk
+	{
+		std::vector<DirectX::XMFLOAT3> vertices;
+		std::vector<DirectX::XMFLOAT2> uv;
+		std::vector<DirectX::XMFLOAT3> normals;
+		std::vector<FaceIndices> faces; //three corners per triangle
+		//entries (corner * 3 + v/vt/vn) holding negative OBJ indices, stored
+		//relative to the chunk start until the merge knows where the chunk lands
+		std::vector<size_t> relativeIndices;
+		FaceFormat format = FaceFormat::UNKNOWN;
+	};
+
+	FaceFormat format = FaceFormat::UNKNOWN;
 
 	std::vector<DirectX::XMFLOAT3> read_vertices;
 	std::vector<DirectX::XMFLOAT2> read_uv;
 	std::vector<DirectX::XMFLOAT3> read_normals;
+	std::vector<FaceIndices> read_faces; //the streamed parser's corners, three per triangle
 	std::vector<FaceIndices> face_points;
+	// open addressing table of face_points indices + 1, 0 marks an empty slot
+	std::vector<unsigned int> face_lookup;
 
 	std::vector<VertexPosUVNorm> out_verts;
 	std::vector<unsigned int> out_indices;
 
+	std::unique_ptr<MappedFile> cacheFile;
+	const VertexPosUVNorm* vertexData = nullptr;
+	size_t vertexCount = 0;
+	const unsigned int* indexData = nullptr;
+	size_t indexCount = 0;
+	DirectX::XMFLOAT3 boundsMin{ 0, 0, 0 };
+	DirectX::XMFLOAT3 boundsMax{ 0, 0, 0 };
+
+	MeshOptimiser::VertexCacheStats cacheStatsBefore;
+	MeshOptimiser::VertexCacheStats cacheStatsAfter;
+
 	void LoadModelData(std::string path);
+	void LoadModelDataMapped(std::string path, unsigned int threadCount);
+	void MergeChunks(std::vector<ParsedChunk>& chunks);
+	bool BuildVertices(std::string path);
+	void CalculateBounds();
+	void Optimise(std::string path);
+
+	bool LoadCache(std::string path, uint32_t flags);
+	void WriteCache(std::string path, uint32_t flags);
+
+	//static so worker threads can run them without touching the loader
+	static void ParseChunk(const char* begin, const char* end, FaceFormat faceFormat, ParsedChunk& chunk);
+	static void ParseFace(const char* begin, const char* end, ParsedChunk& chunk);
+	static FaceFormat DetectFaceFormat(std::string face);
 
-	FaceFormat DetectFaceFormat(std::string face);
 	void ParseFace(std::string face);
+	//every index the format uses points at an element that was read
+	bool InRange(const FaceIndices& point, size_t vertices, size_t uvs, size_t normals) const;
+	unsigned int AddFacePoint(const FaceIndices& point);
+	void GrowFaceLookup();
 	DirectX::XMFLOAT3 ParseFloat3(std::string verts);
 	DirectX::XMFLOAT2 ParseFloat2(std::string verts);
 
@@ -0,0 +1,287 @@
+#include "OcclusionBuffer.h"
+#include "DrawChunks.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+OcclusionBuffer::OcclusionBuffer(int width, int height) {
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	Resize(width, height);
+}
+
+void OcclusionBuffer::Resize(int newWidth, int newHeight) {
+	newWidth = std::max((newWidth + 3) & ~3, 4);
+	newHeight = std::max(newHeight, 1);
+	if (newWidth == width && newHeight == height)
+		return;
+
+	width = newWidth;
+	height = newHeight;
+	levels.clear();
+	levelWidths.clear();
+	levelHeights.clear();
+	int levelWidth = width, levelHeight = height;
+	while (true) {
+		levels.emplace_back((size_t)levelWidth * levelHeight, 1.0f);
+		levelWidths.push_back(levelWidth);
+		levelHeights.push_back(levelHeight);
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+	bins.resize((height + tileRows - 1) / tileRows);
+}
+
+void OcclusionBuffer::Begin(FXMMATRIX inViewProjection) {
+	XMStoreFloat4x4(&viewProjection, inViewProjection);
+	std::fill(levels[0].begin(), levels[0].end(), 1.0f);
+	triangles.clear();
+	for (auto& bin : bins) {
+		bin.clear();
+	}
+	stats = OcclusionStats();
+}
+
+void OcclusionBuffer::AddOccluder(const OccluderMesh& mesh, FXMMATRIX world) {
+	XMMATRIX toClip = world * XMLoadFloat4x4(&viewProjection);
+	clipScratch.resize(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); i++) {
+		XMStoreFloat4(&clipScratch[i], XMVector3Transform(XMLoadFloat3(&mesh.vertices[i]), toClip));
+	}
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+		AddTriangle(clipScratch[mesh.indices[i]], clipScratch[mesh.indices[i + 1]], clipScratch[mesh.indices[i + 2]]);
+	}
+	stats.occluders++;
+}
+
+void OcclusionBuffer::AddTriangle(const XMFLOAT4& v0, const XMFLOAT4& v1, const XMFLOAT4& v2) {
+	//all three outside the same plane, none of it can be on screen
+	auto allOutside = [&](auto outside) { return outside(v0) && outside(v1) && outside(v2); };
+	if (allOutside([](const XMFLOAT4& v) { return v.x < -v.w; }) || allOutside([](const XMFLOAT4& v) { return v.x > v.w; })
+		|| allOutside([](const XMFLOAT4& v) { return v.y < -v.w; }) || allOutside([](const XMFLOAT4& v) { return v.y > v.w; })
+		|| allOutside([](const XMFLOAT4& v) { return v.z < 0; }) || allOutside([](const XMFLOAT4& v) { return v.z > v.w; }))
+		return;
+
+	if (v0.z >= 0 && v1.z >= 0 && v2.z >= 0) {
+		XMFLOAT4 clip[3] = { v0, v1, v2 };
+		SetupTriangle(clip);
+		return;
+	}
+
+	//crosses the near plane, so cut it off there before dividing by w. what's left is a
+	//triangle or a quad, wound the same way as the original
+	const XMFLOAT4* corners[3] = { &v0, &v1, &v2 };
+	XMFLOAT4 polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++) {
+		const XMFLOAT4& a = *corners[i];
+		const XMFLOAT4& b = *corners[(i + 1) % 3];
+		if (a.z >= 0)
+			polygon[count++] = a;
+		if ((a.z >= 0) != (b.z >= 0)) {
+			float t = a.z / (a.z - b.z);
+			XMStoreFloat4(&polygon[count++], XMVectorLerp(XMLoadFloat4(&a), XMLoadFloat4(&b), t));
+		}
+	}
+	for (int i = 1; i + 1 < count; i++) {
+		XMFLOAT4 clip[3] = { polygon[0], polygon[i], polygon[i + 1] };
+		SetupTriangle(clip);
+	}
+}
+
+void OcclusionBuffer::SetupTriangle(const XMFLOAT4* clip) {
+	//pixels with y pointing down, pixel i's centre at i + 0.5
+	float x[3], y[3], z[3];
+	for (int i = 0; i < 3; i++) {
+		float invW = 1.0f / clip[i].w;
+		x[i] = (clip[i].x * invW * 0.5f + 0.5f) * width;
+		y[i] = (0.5f - clip[i].y * invW * 0.5f) * height;
+		z[i] = clip[i].z * invW;
+	}
+
+	//d3d's default rasteriser state culls counter clockwise triangles, which come out negative
+	//here. the gpu never draws them, so they can't hide anything either
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0))
+		return;
+
+	Triangle triangle;
+	float minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+	float minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+	triangle.minX = (int)std::max(std::ceil(minX - 0.5f), 0.0f);
+	triangle.maxX = (int)std::min(std::floor(maxX - 0.5f), (float)(width - 1));
+	triangle.minY = (int)std::max(std::ceil(minY - 0.5f), 0.0f);
+	triangle.maxY = (int)std::min(std::floor(maxY - 0.5f), (float)(height - 1));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return; //too small to cover any pixel centre
+
+	//edge i runs from corner i to the next, positive on the inside
+	for (int i = 0; i < 3; i++) {
+		int next = (i + 1) % 3;
+		triangle.edgeA[i] = y[i] - y[next];
+		triangle.edgeB[i] = x[next] - x[i];
+		triangle.edgeC[i] = -(triangle.edgeA[i] * x[i] + triangle.edgeB[i] * y[i]);
+	}
+
+	//z / w is linear across the screen. sampled at the pixel centre it would be nearer than the
+	//triangle really is over half the pixel, so it's pushed back to the pixel's farthest corner
+	float dx1 = x[1] - x[0], dy1 = y[1] - y[0], dz1 = z[1] - z[0];
+	float dx2 = x[2] - x[0], dy2 = y[2] - y[0], dz2 = z[2] - z[0];
+	triangle.depthA = (dz1 * dy2 - dz2 * dy1) / area;
+	triangle.depthB = (dx1 * dz2 - dx2 * dz1) / area;
+	triangle.depthC = z[0] - triangle.depthA * x[0] - triangle.depthB * y[0]
+		+ 0.5f * (std::fabs(triangle.depthA) + std::fabs(triangle.depthB));
+
+	uint32_t index = (uint32_t)triangles.size();
+	triangles.push_back(triangle);
+	for (int tile = triangle.minY / tileRows; tile <= triangle.maxY / tileRows; tile++) {
+		bins[tile].push_back(index);
+	}
+	stats.trianglesRasterised++;
+}
+
+void OcclusionBuffer::RasteriseTile(int tile) {
+	float* depth = levels[0].data();
+	int firstRow = tile * tileRows;
+	int lastRow = std::min(firstRow + tileRows, height) - 1;
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR pixelOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+
+	for (uint32_t index : bins[tile]) {
+		const Triangle& triangle = triangles[index];
+		int startX = triangle.minX & ~3; //rows are a multiple of 4 wide, so blocks never run off the end
+		XMVECTOR blockX = XMVectorAdd(XMVectorReplicate((float)startX), pixelOffsets);
+
+		//every edge and the depth change by a constant from one block of four pixels to the next
+		XMVECTOR edgeA[3], edgeStep[3];
+		for (int e = 0; e < 3; e++) {
+			edgeA[e] = XMVectorReplicate(triangle.edgeA[e]);
+			edgeStep[e] = XMVectorReplicate(triangle.edgeA[e] * 4);
+		}
+		XMVECTOR depthA = XMVectorReplicate(triangle.depthA);
+		XMVECTOR depthStep = XMVectorReplicate(triangle.depthA * 4);
+
+		int endY = std::min(triangle.maxY, lastRow);
+		for (int y = std::max(triangle.minY, firstRow); y <= endY; y++) {
+			float centreY = y + 0.5f;
+			XMVECTOR edges[3];
+			for (int e = 0; e < 3; e++) {
+				edges[e] = XMVectorMultiplyAdd(edgeA[e], blockX, XMVectorReplicate(triangle.edgeB[e] * centreY + triangle.edgeC[e]));
+			}
+			XMVECTOR z = XMVectorMultiplyAdd(depthA, blockX, XMVectorReplicate(triangle.depthB * centreY + triangle.depthC));
+
+			float* row = depth + (size_t)y * width;
+			for (int x = startX; x <= triangle.maxX; x += 4) {
+				XMVECTOR inside = XMVectorAndInt(XMVectorAndInt(XMVectorGreaterOrEqual(edges[0], zero),
+					XMVectorGreaterOrEqual(edges[1], zero)), XMVectorGreaterOrEqual(edges[2], zero));
+				XMFLOAT4* pixels = reinterpret_cast<XMFLOAT4*>(row + x);
+				XMVECTOR old = XMLoadFloat4(pixels);
+				XMStoreFloat4(pixels, XMVectorSelect(old, XMVectorMin(old, z), inside));
+
+				for (int e = 0; e < 3; e++) {
+					edges[e] = XMVectorAdd(edges[e], edgeStep[e]);
+				}
+				z = XMVectorAdd(z, depthStep);
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::BuildPyramid() {
+	for (size_t level = 1; level < levels.size(); level++) {
+		const float* below = levels[level - 1].data();
+		int belowWidth = levelWidths[level - 1], belowHeight = levelHeights[level - 1];
+		float* out = levels[level].data();
+		int levelWidth = levelWidths[level], levelHeight = levelHeights[level];
+
+		//odd sizes repeat their last row or column, so every texel below is under one above
+		for (int y = 0; y < levelHeight; y++) {
+			const float* row0 = below + (size_t)(2 * y) * belowWidth;
+			const float* row1 = below + (size_t)std::min(2 * y + 1, belowHeight - 1) * belowWidth;
+			for (int x = 0; x < levelWidth; x++) {
+				int x0 = 2 * x, x1 = std::min(2 * x + 1, belowWidth - 1);
+				out[(size_t)y * levelWidth + x] = std::max(std::max(row0[x0], row0[x1]), std::max(row1[x0], row1[x1]));
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::Rasterise(ThreadPool& pool, unsigned int maxThreads) {
+	//tiles own separate rows of the buffer, so threads never write the same pixel
+	if (!triangles.empty())
+		DrawChunks::Record(pool, bins.size(), maxThreads, [this](size_t tile) { RasteriseTile((int)tile); });
+	BuildPyramid();
+}
+
+bool OcclusionBuffer::IsVisible(XMFLOAT3 boundsMin, XMFLOAT3 boundsMax) {
+	stats.objectsTested++;
+
+	//the box's corners give its rectangle on screen, and the nearest of them its nearest depth
+	XMMATRIX toClip = XMLoadFloat4x4(&viewProjection);
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, nearest = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++) {
+		XMVECTOR position = XMVectorSet((corner & 1) ? boundsMax.x : boundsMin.x, (corner & 2) ? boundsMax.y : boundsMin.y,
+			(corner & 4) ? boundsMax.z : boundsMin.z, 1);
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector4Transform(position, toClip));
+		if (clip.z < 0)
+			return true; //in front of the near plane, the camera might be inside it
+
+		float invW = 1.0f / clip.w;
+		float x = (clip.x * invW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * invW * 0.5f) * height;
+		minX = std::min(minX, x);
+		maxX = std::max(maxX, x);
+		minY = std::min(minY, y);
+		maxY = std::max(maxY, y);
+		nearest = std::min(nearest, clip.z * invW);
+	}
+
+	//every pixel the rectangle touches, not just the ones whose centres it covers
+	int x0 = (int)std::max(std::floor(minX), 0.0f);
+	int x1 = (int)std::min(std::floor(maxX), (float)(width - 1));
+	int y0 = (int)std::max(std::floor(minY), 0.0f);
+	int y1 = (int)std::min(std::floor(maxY), (float)(height - 1));
+	if (x0 > x1 || y0 > y1)
+		return true; //off screen, that's for the frustum to decide
+
+	//the level where the rectangle is a texel or two across, so only up to 3x3 texels get read
+	int size = std::max(x1 - x0, y1 - y0);
+	size_t level = 0;
+	while (level + 1 < levels.size() && (size >> level) > 1)
+		level++;
+
+	const float* depth = levels[level].data();
+	int levelWidth = levelWidths[level];
+	float farthest = 0;
+	for (int y = y0 >> level; y <= (y1 >> level); y++) {
+		for (int x = x0 >> level; x <= (x1 >> level); x++) {
+			farthest = std::max(farthest, depth[(size_t)y * levelWidth + x]);
+		}
+	}
+
+	bool visible = nearest <= farthest;
+	if (!visible)
+		stats.objectsOccluded++;
+	return visible;
+}
+
+size_t OcclusionBuffer::CullSpheres(const SphereList& spheres, std::vector<uint8_t>& visible) {
+	size_t occluded = 0;
+	for (size_t i = 0; i < spheres.Size(); i++) {
+		if (!visible[i])
+			continue;
+		float r = spheres.radius[i];
+		XMFLOAT3 boundsMin{ spheres.x[i] - r, spheres.y[i] - r, spheres.z[i] - r };
+		XMFLOAT3 boundsMax{ spheres.x[i] + r, spheres.y[i] + r, spheres.z[i] + r };
+		if (!IsVisible(boundsMin, boundsMax)) {
+			visible[i] = 0;
+			occluded++;
+		}
+	}
+	return occluded;
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <DirectXMath.h>
+
+#include "Frustum.h"
+
+class ThreadPool;
+
+//triangles a mesh occludes with, a coarse lod kept on the cpu in object space
+struct OccluderMesh
+{
+	std::vector<DirectX::XMFLOAT3> vertices;
+	std::vector<uint32_t> indices;
+};
+
+struct OcclusionStats
+{
+	size_t occluders = 0;
+	size_t trianglesRasterised = 0; //what was left after near clipping, backface and off screen rejection
+	size_t objectsTested = 0;
+	size_t objectsOccluded = 0;
+};
+
+//software hierarchical z. a few big occluders are rasterised on the cpu into a small depth
+//buffer, which is then reduced into a pyramid where each texel holds the farthest depth under
+//it. anything whose nearest point is behind every occluder depth under its screen rectangle
+//can't be seen. depth is d3d's, 0 at the near plane and 1 at the far one. no d3d in here
+class OcclusionBuffer
+{
+public:
+	//rows of pixels a thread rasterises at a time, triangles are binned by which of these they touch
+	static const int tileRows = 16;
+
+private:
+	//a triangle after clipping and projection, as edge functions and a depth plane in pixels
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3]; //inside where every a * x + b * y + c >= 0
+		float depthA, depthB, depthC; //depth = a * x + b * y + c, pushed back to the farthest point in the pixel
+		int minX, maxX, minY, maxY; //pixels whose centres might be inside, clamped to the buffer
+	};
+
+	int width = 0; //always a multiple of 4, rows are rasterised four pixels at a time
+	int height = 0;
+	//levels[0] is the rasterised depth, each level after has half the size and the max of 2x2 below
+	std::vector<std::vector<float>> levels;
+	std::vector<int> levelWidths;
+	std::vector<int> levelHeights;
+
+	DirectX::XMFLOAT4X4 viewProjection;
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<uint32_t>> bins; //triangles touching each tile, in the order they were added
+	std::vector<DirectX::XMFLOAT4> clipScratch; //an occluder's vertices in clip space
+	OcclusionStats stats;
+
+	void AddTriangle(const DirectX::XMFLOAT4& v0, const DirectX::XMFLOAT4& v1, const DirectX::XMFLOAT4& v2);
+	void SetupTriangle(const DirectX::XMFLOAT4* clip);
+	void RasteriseTile(int tile);
+	void BuildPyramid();
+
+public:
+	OcclusionBuffer(int width = 256, int height = 128);
+
+	//width is rounded up to a multiple of 4. does nothing when the size hasn't changed
+	void Resize(int width, int height);
+
+	//clears to the far plane and forgets last frame's occluders
+	void Begin(DirectX::FXMMATRIX viewProjection);
+	//clips and projects the occluder's triangles, nothing is drawn until Rasterise
+	void AddOccluder(const OccluderMesh& mesh, DirectX::FXMMATRIX world);
+	//draws every added triangle a tile of rows at a time, on up to maxThreads threads counting
+	//the calling one (0 uses the whole pool), then builds the pyramid. same rules for the pool
+	//as DrawChunks::Record, nothing else may be submitting to it
+	void Rasterise(ThreadPool& pool, unsigned int maxThreads);
+
+	//false when the world space box is entirely behind what was rasterised. boxes crossing the
+	//near plane always count as visible
+	bool IsVisible(DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax);
+	//tests the boxes around every sphere still marked visible and clears the ones that are
+	//hidden, returns how many that was
+	size_t CullSpheres(const SphereList& spheres, std::vector<uint8_t>& visible);
+
+	const OcclusionStats& GetStats() { return stats; }
+	int GetWidth() { return width; }
+	int GetHeight() { return height; }
+	size_t GetLevelCount() { return levels.size(); }
+	int GetLevelWidth(size_t level) { return levelWidths[level]; }
+	int GetLevelHeight(size_t level) { return levelHeights[level]; }
+	const float* GetDepth(size_t level = 0) { return levels[level].data(); }
+};
\ No newline at end of file
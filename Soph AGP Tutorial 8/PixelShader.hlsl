@@ -1,8 +1,13 @@
 Texture2D texture0;
 sampler sampler0;
 
+cbuffer PerMaterialCB : register(b1)
+{
+    float4 materialColour;
+};
+
 float4 main(float4 position : SV_Position, float2 uv : TEXCOORD, float4 colour : COLOUR) : SV_TARGET
 {
     float4 sampled = texture0.Sample(sampler0, uv);
-    return colour * sampled;
+    return colour * materialColour * sampled;
 }
\ No newline at end of file
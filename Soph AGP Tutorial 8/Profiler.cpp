@@ -0,0 +1,200 @@
+#include "Profiler.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+namespace Profiler {
+
+	static const uint64_t ringCapacity = 1 << 15; //power of two, 1MB of events per thread
+
+	//one thread's ring. only its owner writes events, publishing each by bumping written
+	//afterwards, so readers know which slots are complete without any locks
+	struct ThreadBuffer
+	{
+		Event events[ringCapacity];
+		std::atomic<uint64_t> written{ 0 };
+		uint32_t thread = 0;
+		uint32_t depth = 0; //zones open right now, owner only
+		std::atomic<bool> inUse{ false };
+	};
+
+	static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	static std::atomic<bool> enabled{ true };
+
+	//every ring ever made. a thread takes one the first time it records and hands it back when it
+	//exits, so short lived threads like the model parsers don't keep making new ones
+	static std::mutex registryMutex;
+	static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	static std::vector<std::pair<uint32_t, std::string>> threadNames;
+	static uint32_t nextThread = 1;
+
+	static ThreadBuffer* AcquireBuffer() {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		ThreadBuffer* buffer = nullptr;
+		for (auto& existing : buffers) {
+			bool expected = false;
+			if (existing->inUse.compare_exchange_strong(expected, true)) {
+				buffer = existing.get();
+				break;
+			}
+		}
+		if (!buffer) {
+			buffers.push_back(std::make_unique<ThreadBuffer>());
+			buffer = buffers.back().get();
+			buffer->inUse = true;
+		}
+		//a new id even for a reused ring, its old events keep the id of the thread that made them
+		buffer->thread = nextThread++;
+		buffer->depth = 0;
+		return buffer;
+	}
+
+	struct LocalBuffer
+	{
+		ThreadBuffer* buffer = nullptr;
+		~LocalBuffer() {
+			if (buffer)
+				buffer->inUse = false;
+		}
+	};
+	static thread_local LocalBuffer local;
+
+	static ThreadBuffer& GetLocalBuffer() {
+		if (!local.buffer)
+			local.buffer = AcquireBuffer();
+		return *local.buffer;
+	}
+
+	static ThreadBuffer& GetGpuBuffer() {
+		static ThreadBuffer* gpu = []() {
+			ThreadBuffer* buffer = AcquireBuffer(); //never handed back
+			buffer->thread = gpuThread;
+			return buffer;
+		}();
+		return *gpu;
+	}
+
+	static void Write(ThreadBuffer& buffer, const Event& event) {
+		uint64_t index = buffer.written.load(std::memory_order_relaxed);
+		buffer.events[index & (ringCapacity - 1)] = event;
+		buffer.written.store(index + 1, std::memory_order_release);
+	}
+
+	uint64_t Now() {
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	void SetThreadName(const std::string& name) {
+		uint32_t thread = GetLocalBuffer().thread;
+		std::lock_guard<std::mutex> lock(registryMutex);
+		threadNames.emplace_back(thread, name);
+	}
+
+	void SetEnabled(bool enable) {
+		enabled = enable;
+	}
+
+	bool IsEnabled() {
+		return enabled;
+	}
+
+	void RecordGpu(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth) {
+		if (!enabled)
+			return;
+		Write(GetGpuBuffer(), Event{ name, startNs, endNs, gpuThread, depth });
+	}
+
+	void Collect(std::vector<Event>& events) {
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (auto& buffer : buffers) {
+			uint64_t end = buffer->written.load(std::memory_order_acquire);
+			uint64_t begin = end > ringCapacity ? end - ringCapacity : 0;
+			size_t copied = events.size();
+			for (uint64_t i = begin; i < end; i++) {
+				events.push_back(buffer->events[i & (ringCapacity - 1)]);
+			}
+
+			//the owner may have lapped the start of what we copied while we were copying it. slot
+			//i is being rewritten once event i + capacity has started, so anything up to one past
+			//the last published event minus capacity can't be trusted
+			uint64_t after = buffer->written.load(std::memory_order_acquire);
+			uint64_t safeBegin = after + 1 > ringCapacity ? after + 1 - ringCapacity : 0;
+			if (safeBegin > begin) {
+				size_t drop = (size_t)std::min(safeBegin - begin, end - begin);
+				events.erase(events.begin() + copied, events.begin() + copied + drop);
+			}
+		}
+	}
+
+	static std::string Escape(const std::string& text) {
+		std::string escaped;
+		for (char c : text) {
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			if ((unsigned char)c >= 0x20)
+				escaped += c;
+		}
+		return escaped;
+	}
+
+	bool ExportChromeTrace(const std::string& path) {
+		std::vector<Event> events;
+		Collect(events);
+
+		std::ofstream file{ path, std::ios::out | std::ios::trunc };
+		if (!file)
+			return false;
+
+		//complete events ("X") with microsecond times, plus a name for each thread's track
+		file << "{\"traceEvents\":[\n";
+		bool first = true;
+		auto separator = [&]() {
+			if (!first)
+				file << ",\n";
+			first = false;
+		};
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			for (auto& thread : threadNames) {
+				separator();
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.first
+					<< ",\"args\":{\"name\":\"" << Escape(thread.second) << "\"}}";
+			}
+		}
+		separator();
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << gpuThread << ",\"args\":{\"name\":\"GPU\"}}";
+
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		for (const Event& event : events) {
+			separator();
+			file << "{\"name\":\"" << Escape(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+				<< ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << (event.endNs - event.startNs) / 1000.0
+				<< ",\"args\":{\"depth\":" << event.depth << "}}";
+		}
+		file << "\n]}\n";
+		return (bool)file;
+	}
+
+	Zone::Zone(const char* name)
+		: name(name), startNs(0), depth(0), open(enabled) {
+		if (!open)
+			return;
+		ThreadBuffer& buffer = GetLocalBuffer();
+		depth = buffer.depth++;
+		startNs = Now();
+	}
+
+	void Zone::End() {
+		if (!open)
+			return;
+		open = false;
+		ThreadBuffer& buffer = GetLocalBuffer();
+		Write(buffer, Event{ name, startNs, Now(), buffer.thread, depth });
+		buffer.depth = depth;
+	}
+}
\ No newline at end of file
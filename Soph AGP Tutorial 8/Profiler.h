@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//cpu side of the frame profiler. PROFILE_ZONE("name") times from that line to the end of the
+//scope. every thread writes its finished zones into a ring buffer of its own without taking
+//any locks, the oldest get overwritten once it's full so the rings hold roughly the last few
+//frames. no d3d in here, the gpu timings are fed in by GpuProfiler
+namespace Profiler {
+	struct Event
+	{
+		const char* name; //not copied, has to live as long as the profiler (string literals)
+		uint64_t startNs; //since the profiler started
+		uint64_t endNs;
+		uint32_t thread;
+		uint32_t depth; //zones it was nested inside of on its thread
+	};
+
+	//thread id events recorded through RecordGpu get
+	const uint32_t gpuThread = 0xFFFF;
+
+	uint64_t Now(); //nanoseconds since the profiler started
+	//name shown for the calling thread's track in the trace
+	void SetThreadName(const std::string& name);
+	//zones opened while disabled record nothing, on by default
+	void SetEnabled(bool enabled);
+	bool IsEnabled();
+
+	//adds a timing measured somewhere else, like a gpu timestamp pair converted to cpu time.
+	//only call from one thread at a time, they all share the gpu track's ring
+	void RecordGpu(const char* name, uint64_t startNs, uint64_t endNs, uint32_t depth);
+
+	//copies out what every ring holds right now. fine while other threads keep recording,
+	//events overwritten during the copy are left out rather than returned half written
+	void Collect(std::vector<Event>& events);
+	//writes what Collect returns as chrome trace json, for chrome://tracing or ui.perfetto.dev
+	bool ExportChromeTrace(const std::string& path);
+
+	class Zone
+	{
+	private:
+		const char* name;
+		uint64_t startNs;
+		uint32_t depth;
+		bool open;
+
+	public:
+		Zone(const char* name);
+		~Zone() { End(); }
+		//closes the zone before the end of the scope, does nothing the second time
+		void End();
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+	};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profileZone, __COUNTER__)(name)
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "RangeAllocator.h"
+
+#include <iterator>
+
+#include "Debug.h"
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+	: capacity(capacity) {
+	if (capacity > 0)
+		freeRanges[0] = capacity;
+}
+
+void RangeAllocator::AddFree(unsigned int offset, unsigned int size) {
+	auto next = freeRanges.lower_bound(offset);
+
+	//join onto the range before if it ends where we start
+	if (next != freeRanges.begin()) {
+		auto prev = std::prev(next);
+		if (prev->first + prev->second == offset) {
+			offset = prev->first;
+			size += prev->second;
+			freeRanges.erase(prev);
+		}
+	}
+	//and swallow the range after if it starts where we end
+	if (next != freeRanges.end() && offset + size == next->first) {
+		size += next->second;
+		freeRanges.erase(next);
+	}
+	freeRanges[offset] = size;
+}
+
+unsigned int RangeAllocator::Allocate(unsigned int size) {
+	if (size == 0)
+		return invalid;
+
+	//smallest range that fits, so big ranges stay big for big meshes
+	auto best = freeRanges.end();
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+		if (it->second >= size && (best == freeRanges.end() || it->second < best->second)) {
+			best = it;
+			if (it->second == size)
+				break;
+		}
+	}
+	if (best == freeRanges.end())
+		return invalid;
+
+	unsigned int offset = best->first;
+	unsigned int remaining = best->second - size;
+	freeRanges.erase(best);
+	if (remaining > 0)
+		freeRanges[offset + size] = remaining;
+
+	usedRanges[offset] = size;
+	used += size;
+	return offset;
+}
+
+void RangeAllocator::Free(unsigned int offset) {
+	auto it = usedRanges.find(offset);
+	if (it == usedRanges.end()) {
+		LOG("RangeAllocator::Free called with an offset that isn't allocated");
+		return;
+	}
+	unsigned int size = it->second;
+	usedRanges.erase(it);
+	used -= size;
+	AddFree(offset, size);
+}
+
+void RangeAllocator::Grow(unsigned int newCapacity) {
+	if (newCapacity <= capacity)
+		return;
+	unsigned int oldCapacity = capacity;
+	capacity = newCapacity;
+	AddFree(oldCapacity, newCapacity - oldCapacity);
+}
+
+std::vector<RangeAllocator::Move> RangeAllocator::Compact() {
+	std::vector<Move> moves;
+	std::map<unsigned int, unsigned int> packed;
+
+	//usedRanges is sorted by offset, so each range only ever moves down
+	unsigned int cursor = 0;
+	for (auto& range : usedRanges) {
+		if (range.first != cursor)
+			moves.push_back(Move{ range.first, cursor, range.second });
+		packed[cursor] = range.second;
+		cursor += range.second;
+	}
+
+	usedRanges.swap(packed);
+	freeRanges.clear();
+	if (cursor < capacity)
+		freeRanges[cursor] = capacity - cursor;
+	return moves;
+}
+
+unsigned int RangeAllocator::GetLargestFree() {
+	unsigned int largest = 0;
+	for (auto& range : freeRanges) {
+		if (range.second > largest)
+			largest = range.second;
+	}
+	return largest;
+}
\ No newline at end of file
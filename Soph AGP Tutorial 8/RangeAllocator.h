@@ -0,0 +1,48 @@
+#pragma once
+#include <map>
+#include <vector>
+#include <climits>
+#include <cstddef>
+
+//hands out ranges of a fixed size space (vertices, indices, bytes, whatever the caller counts in).
+//best fit from a free list, neighbouring free ranges are merged back together on Free
+class RangeAllocator
+{
+private:
+	std::map<unsigned int, unsigned int> freeRanges; //offset to size
+	std::map<unsigned int, unsigned int> usedRanges;
+	unsigned int capacity = 0;
+	unsigned int used = 0;
+
+	void AddFree(unsigned int offset, unsigned int size);
+
+public:
+	static const unsigned int invalid = UINT_MAX;
+
+	//where Compact moved a range to
+	struct Move
+	{
+		unsigned int from;
+		unsigned int to;
+		unsigned int size;
+	};
+
+	RangeAllocator(unsigned int capacity = 0);
+
+	//offset of the new range, or invalid when no free range is big enough
+	unsigned int Allocate(unsigned int size);
+	//offset must be one Allocate returned
+	void Free(unsigned int offset);
+	//adds space to the end, never shrinks
+	void Grow(unsigned int newCapacity);
+
+	//slides every range down to the start so all the free space is one range at the end.
+	//moves come back lowest offset first, which is a safe order to copy the data in even in place
+	std::vector<Move> Compact();
+
+	unsigned int GetCapacity() { return capacity; }
+	unsigned int GetUsed() { return used; }
+	unsigned int GetLargestFree();
+	size_t GetFreeRangeCount() { return freeRanges.size(); }
+	size_t GetAllocationCount() { return usedRanges.size(); }
+};
\ No newline at end of file
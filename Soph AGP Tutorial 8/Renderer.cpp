@@ -1,35 +1,47 @@
 #include "Renderer.h"
-#include "Window.h"
 #include "Mesh.h"
 #include "GameObject.h"
-#include "ShaderLoading.h"
 #include "ModelLoader.h"
+#include "Frustum.h"
+#include "DrawSort.h"
+#include "Material.h"
+#include "Profiler.h"
 #include "Debug.h"
 
-#include <d3d11.h>
+#include <algorithm>
+#include <cstring>
+#include <cfloat>
+#include <chrono>
 
 #include"DirectXMath.h"
 using namespace DirectX;
 
-struct CBuffer_PerObject
-{
-	XMMATRIX WVP;
-};
+//everything here is the same with or without a device, what actually talks to d3d11 is in
+//RendererD3D11.cpp
 
-Renderer::Renderer(Window& inWindow)
-	: window(inWindow) {
+//world and the normal matrix for it. the inverse transpose is right under non-uniform scale,
+//shear and mirroring alike, where scaling each axis by its own factor only covers the first
+static void StoreObjectConstants(CBuffer_PerObject& constants, FXMMATRIX world, VertexLayout layout) {
+	XMStoreFloat3x4(&constants.world, world);
+	XMStoreFloat3x4(&constants.normalWorld, XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+	constants.normalWorld.m[0][3] = layout == VertexLayout::FULL ? 0.0f : 1.0f;
+}
 
-	if (InitD3D() != S_OK) {
-		LOG("Failed to initialise D3D renderer");
-		return;
-	}
+Renderer::Renderer(int width, int height, RenderBackend inBackend)
+	: backend(inBackend), headlessWidth(width), headlessHeight(height), geometry(*this), assets(*this), recordPool(0, "Draw recording") {
 
-	if (InitPipeline() != S_OK) {
-		LOG("Failed to initialise pipeline");
-		return;
+	if (backend == RenderBackend::D3D11) {
+		LOG("D3D11 needs a window, using the null device instead");
+		backend = RenderBackend::NULL_DEVICE;
 	}
-
-	InitGraphics();
+	//the rasteriser draws from cpu copies, made as meshes and textures upload
+	if (backend == RenderBackend::SOFTWARE)
+		keepCaptureData = true;
+
+	//no shaders, buffers or states to make. the placeholder never becomes resident, so textures
+	//are recorded as whatever the material asked for
+	placeholderTexture = new Texture(*this);
+	InitSubmitContext(immediate, nullptr);
 }
 
 void Renderer::RegisterGameObject(GameObject* e) {
@@ -45,183 +57,680 @@ void Renderer::RemoveGameObject(GameObject* e) {
 	//note: will affect index based iterating
 }
 
-long Renderer::InitD3D(){
-	//create a struct to hold info about the swap chain
-	DXGI_SWAP_CHAIN_DESC scd = {};
-	//fil the swap chain description struct
-	scd.BufferCount = 1;								//one back buffer
-	scd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; //32 bit colour
-	scd.BufferDesc.Width = window.GetWidth();				//set the back buffer width
-	scd.BufferDesc.Height = window.GetHeight();				//set the back buffer height
-	scd.BufferDesc.RefreshRate.Numerator = 60;			//60FPS
-	scd.BufferDesc.RefreshRate.Denominator = 1;			//60/1 = 60FPS
-	scd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;	//intended swapchain use
-	scd.OutputWindow = window.GetHandle();
-	scd.SampleDesc.Count = 1;							//number of samples for AA
-	scd.Windowed = TRUE;								//windowed/full screen mode
-	scd.Flags = DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH; //allow full screen switching
-
-	HRESULT hr;
-	//create a swap chain, device and device context from the scd
-	hr = D3D11CreateDeviceAndSwapChain(NULL,	//default graphics adapter
-		D3D_DRIVER_TYPE_HARDWARE,				//use hardware acceleration, can also use software or WARP renderers
-		NULL,									//used for software driver types
-		D3D11_CREATE_DEVICE_DEBUG,				//flags can be OR'd together, we are enabling debug here
-		NULL,									//direct3d feature levels. NULL will use d2d11.0 or older
-		NULL,									//size of array passed to this ^^^
-		D3D11_SDK_VERSION,						//always set to D3D11_SDK_VERSION
-		&scd,									//pointer to swap chain description
-		&swapChain,
-		&dev,
-		NULL,									//out param - will be set to chosen feature level
-		&devCon);								//pointer to immediate device context
-
-	if (FAILED(hr)) {
-		LOG("Failed to create a renderer");
-		return hr; //abort
-	}
-
-	ID3D11Texture2D* backBufferTexture = nullptr; //get the address of the back buffer
-	hr = swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&backBufferTexture);
-	if (FAILED(hr)) {
-		LOG("Failed to get back buffer texture");
-		return hr; //abort
-	}
-
-	hr = dev->CreateRenderTargetView(backBufferTexture, NULL, &backBuffer);
-	backBufferTexture->Release();
-	if (FAILED(hr)) {
-		LOG("Failed to create back buffer view");
-		return hr; //abort
-	}
-
-	hr = InitDepthBuffer();
-	if (FAILED(hr)) {
-		LOG("Failed to create depth buffer");
-		return hr; //abort
-	}
-
-	//set the back buffer as the current render target
-	devCon->OMSetRenderTargets(1, &backBuffer, depthBuffer);
-
-	//define and set the viewport
-	D3D11_VIEWPORT viewport = {};
-	viewport.TopLeftX = 0;
-	viewport.TopLeftY = 0;
-	viewport.Width = float(window.GetWidth());
-	viewport.Height = float(window.GetHeight());
-	viewport.MinDepth = 0;
-	viewport.MaxDepth = 1;
-	devCon->RSSetViewports(1, &viewport);
-
-
-	return S_OK;
-}
-
-long Renderer::InitDepthBuffer() {
-	HRESULT hr;
-
-	//get swap chain settings and assign to scd
-	DXGI_SWAP_CHAIN_DESC scd = {};
-	swapChain->GetDesc(&scd);
-
-	//z buffer texture description
-	D3D11_TEXTURE2D_DESC tex2dDesc = { 0 };
-	tex2dDesc.Width = window.GetWidth();
-	tex2dDesc.Height = window.GetHeight();
-	tex2dDesc.ArraySize = 1;
-	tex2dDesc.MipLevels = 1;
-	tex2dDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
-	tex2dDesc.SampleDesc.Count = scd.SampleDesc.Count; //same sample count as swap chin
-	tex2dDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-	tex2dDesc.Usage = D3D11_USAGE_DEFAULT;
-
-	//z buffer texture
-	ID3D11Texture2D* zBufferTexture;
-	hr = dev->CreateTexture2D(&tex2dDesc, NULL, &zBufferTexture);
-	if (FAILED(hr)) {
-		LOG("Failed to create z buffer texture");
-		return E_FAIL;
-	}
-
-	//create the depth buffer view
-	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
-	ZeroMemory(&dsvDesc, sizeof(D3D11_DEPTH_STENCIL_VIEW_DESC)); //< fill the struct with zeros
-	dsvDesc.Format = tex2dDesc.Format;
-	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	hr = dev->CreateDepthStencilView(zBufferTexture, &dsvDesc, &depthBuffer);
-	if (FAILED(hr)) {
-		LOG("Failed to create depth stencil view");
-		return E_FAIL;
-	}
-	zBufferTexture->Release(); //release zbuffer pointer - we still have depthbuffer, we are only releasing a pointer here
-
-	return S_OK;
-}
-
-long Renderer::InitPipeline() {
-	ShaderLoading::LoadVertexShader("Compiled Shaders/VertexShader.cso", dev, &pVS, &pIL);
-	ShaderLoading::LoadPixelShader("Compiled Shaders/PixelShader.cso", dev, &pPS);
-
-	//set shader objects as active shaders in the pipeline
-	devCon->VSSetShader(pVS, 0, 0);
-	devCon->PSSetShader(pPS, 0, 0);
+void Renderer::MarkInput() {
+	inputTime = (int64_t)Profiler::Now();
+}
 
-	devCon->IASetInputLayout(pIL);
+void Renderer::MeasureLatency() {
+	frameStats.inputToPresentMs = (float)(((int64_t)Profiler::Now() - inputTime) / 1e6);
+	MeasureDisplayLatency();
+	frameStats.inputToDisplayMs = inputToDisplayMs;
+	inputTime = 0;
+}
+
+ID3D11InputLayout* Renderer::GetInputLayout(VertexLayout layout, bool instanced, bool positionsOnly) {
+	return inputLayouts[positionsOnly][instanced][(int)layout];
+}
 
-	return S_OK;
+void Renderer::BindFrameState(SubmitContext& submit, bool instancesReady, bool depthOnly) {
+	if (submit.context)
+		SetContextFrameState(submit, instancesReady, depthOnly);
+	submit.stream.Clear();
+	if (Records(submit))
+		submit.stream.BeginPass(depthOnly);
+
+	submit.geometry = GeometryPool::Bindings();
+	submit.geometry.positionsOnly = depthOnly;
+	submit.depthOnly = depthOnly;
+	submit.boundTexture = nullptr;
+	submit.boundShader = -1;
+	submit.boundLayer = -1;
+	submit.materialBound = false;
+	submit.states.bindCount = 0;
+	submit.states.skipCount = 0;
+	submit.stats = FrameStats();
 }
 
-void Renderer::InitGraphics() {
-	//create the constant buffer
-	D3D11_BUFFER_DESC cbd = { 0 };
-	cbd.Usage = D3D11_USAGE_DEFAULT;
-	cbd.ByteWidth = sizeof(CBuffer_PerObject);
-	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	if (FAILED(dev->CreateBuffer(&cbd, NULL, &cBuffer_PerObject))) {
-		LOG("Failed to create constant buffer");
+void Renderer::BindTexture(SubmitContext& submit, Texture* wanted) {
+	//plain white until the real texture has loaded. headless textures never load, so they're
+	//kept as they are and recorded as what would have been drawn with
+	if (!wanted || (dev && !wanted->IsResident()))
+		wanted = placeholderTexture;
+	if (wanted == submit.boundTexture)
 		return;
+
+	if (submit.context)
+		SetContextTexture(submit, wanted);
+	//every texture asks for the same sampler, so after the first this is almost always skipped
+	StateCache::SetPSSampler(submit.context, submit.states, 0, wanted->GetSampler());
+	if (Records(submit))
+		submit.stream.SetTexture(wanted->GetId());
+	submit.boundTexture = wanted;
+	submit.stats.stateChanges++;
+}
+
+void Renderer::BindMaterial(SubmitContext& submit, Material* material, Texture* materialTexture) {
+	BindTexture(submit, materialTexture);
+
+	//objects without a material share the default, and materials that happen to have the
+	//same colour don't need another upload either
+	XMFLOAT4 colour = material ? material->colour : XMFLOAT4(1, 1, 1, 1);
+	if (submit.materialBound && memcmp(&colour, &submit.boundColour, sizeof(XMFLOAT4)) == 0)
+		return;
+
+	//fine from a deferred context too, the update plays back in order with its draws
+	CBuffer_PerMaterial perMaterial;
+	perMaterial.colour = colour;
+	if (submit.context)
+		SetContextMaterial(submit, perMaterial);
+	if (Records(submit))
+		submit.stream.SetMaterial(colour);
+	submit.boundColour = colour;
+	submit.materialBound = true;
+	submit.stats.stateChanges++;
+}
+
+void Renderer::BindShader(SubmitContext& submit, bool instanced) {
+	if (submit.boundShader == (int)instanced)
+		return;
+
+	//both read the per frame buffer, the plain one also gets a per object block each draw
+	if (submit.context)
+		SetContextShader(submit, instanced);
+	if (Records(submit))
+		submit.stream.SetShader(instanced);
+	submit.boundShader = (int)instanced;
+	submit.stats.stateChanges++;
+}
+
+void Renderer::BindLayer(SubmitContext& submit, bool transparent) {
+	if (submit.boundLayer == (int)transparent)
+		return;
+
+	//the pre-pass itself writes depth as normal, it's the opaque shading after it that tests equal
+	ID3D11DepthStencilState* opaqueDepth = (depthPrepassed && !submit.depthOnly) ? depthEqual : nullptr;
+	//each pass starts its layer over, but what it left on the context is still there
+	StateCache::SetBlend(submit.context, submit.states, transparent ? alphaBlend : nullptr);
+	StateCache::SetDepthStencil(submit.context, submit.states, transparent ? depthReadOnly : opaqueDepth);
+	if (Records(submit))
+		submit.stream.SetLayer(transparent);
+	submit.boundLayer = (int)transparent;
+	submit.stats.stateChanges++;
+}
+
+void Renderer::DrawMesh(SubmitContext& submit, Mesh* mesh, const DrawRange* ranges, size_t rangeCount) {
+	if (submit.context) {
+		mesh->Render(submit.context, submit.geometry, ranges, rangeCount);
+		return;
+	}
+
+	//the pool still tracks what would be bound, so geometry binds count the same as on a gpu
+	GeometryPool::Handle handle = mesh->GetGeometry();
+	size_t binds = submit.geometry.bindCount;
+	geometry.Bind(nullptr, submit.geometry, handle);
+	if (!IsRecording())
+		return;
+	if (submit.geometry.bindCount != binds)
+		submit.stream.SetGeometry(geometry.GetArena(handle), false);
+	unsigned int firstIndex = geometry.GetFirstIndex(handle);
+	int baseVertex = (int)geometry.GetBaseVertex(handle);
+	for (size_t i = 0; i < rangeCount; i++) {
+		submit.stream.Draw(ranges[i].indexCount, firstIndex + ranges[i].firstIndex, baseVertex);
+	}
+}
+
+void Renderer::DrawMeshInstanced(SubmitContext& submit, Mesh* mesh, unsigned int lod, unsigned int instanceCount, unsigned int firstInstance) {
+	if (submit.context) {
+		mesh->RenderInstanced(submit.context, submit.geometry, lod, instanceCount, firstInstance);
+		return;
+	}
+
+	GeometryPool::Handle handle = mesh->GetGeometry();
+	size_t binds = submit.geometry.bindCount;
+	geometry.Bind(nullptr, submit.geometry, handle, true);
+	if (!IsRecording())
+		return;
+	if (submit.geometry.bindCount != binds)
+		submit.stream.SetGeometry(geometry.GetArena(handle), true);
+	const MeshLod& range = mesh->GetLod(lod);
+	submit.stream.DrawInstanced(range.indexCount, geometry.GetFirstIndex(handle) + range.firstIndex,
+		(int)geometry.GetBaseVertex(handle), instanceCount, firstInstance);
+}
+
+void Renderer::SubmitCommands(SubmitContext& submit, size_t first, size_t count, bool instancesReady, bool useRing) {
+	FrameStats& stats = submit.stats;
+	for (size_t i = first; i < first + count; i++) {
+		const DrawCommand& command = drawCommands[i];
+		const DrawItem& item = drawItems[command.item];
+		Mesh* mesh = item.mesh;
+		const MeshLod& lod = mesh->GetLod(item.lod);
+
+		//transparent objects are blended over what's behind them, they can't be in the pre-pass
+		if (submit.depthOnly && item.transparent)
+			continue;
+
+		if (command.instanceCount > 0) {
+			if (!instancesReady)
+				continue;
+			BindLayer(submit, item.transparent);
+			BindShader(submit, true);
+			if (submit.depthOnly) {
+				DrawMeshInstanced(submit, mesh, item.lod, command.instanceCount, command.firstInstance);
+				stats.depthPrepassDraws++;
+				continue;
+			}
+			BindMaterial(submit, item.material, item.texture);
+			DrawMeshInstanced(submit, mesh, item.lod, command.instanceCount, command.firstInstance);
+
+			stats.trianglesFullDetail += (size_t)mesh->GetLod(0).indexCount / 3 * command.instanceCount;
+			stats.trianglesAfterLod += (size_t)lod.indexCount / 3 * command.instanceCount;
+			stats.objectsDrawn += command.instanceCount;
+			stats.drawCalls++;
+			stats.instancedDraws++;
+			continue;
+		}
+
+		if (command.rangeCount == 0)
+			continue; //every meshlet culled
+
+		BindLayer(submit, item.transparent);
+		BindShader(submit, false);
+		if (!submit.depthOnly)
+			BindMaterial(submit, item.material, item.texture);
+
+		if (useRing && submit.context1) {
+			constantRing.BindVS(submit.context1, 2, command.constants);
+		}
+		else {
+			if (submit.context)
+				SetContextObject(submit, command.constants);
+			if (submit.depthOnly)
+				stats.depthPrepassConstantUpdates++;
+			else
+				stats.constantBufferUpdates++;
+		}
+		if (IsRecording())
+			submit.stream.SetObject(command.constants);
+
+		DrawMesh(submit, mesh, &commandRanges[command.firstRange], command.rangeCount);
+		if (submit.depthOnly) {
+			stats.depthPrepassDraws += command.rangeCount;
+			continue;
+		}
+		stats.trianglesFullDetail += mesh->GetLod(0).indexCount / 3;
+		stats.trianglesAfterLod += lod.indexCount / 3;
+		stats.objectsDrawn++;
+		stats.drawCalls += command.rangeCount;
 	}
+
+	stats.geometryBinds = submit.geometry.bindCount;
+	stats.stateChanges += stats.geometryBinds;
+	stats.stateBinds = submit.states.bindCount;
+	stats.stateBindsSkipped = submit.states.skipCount;
+}
+
+size_t Renderer::CountStateChanges(const std::vector<uint32_t>& order) {
+	countSubmit.countOnly = true;
+	BindFrameState(countSubmit, false);
+	for (uint32_t index : order) {
+		const DrawItem& item = drawItems[index];
+		BindLayer(countSubmit, item.transparent);
+		BindShader(countSubmit, false);
+		BindMaterial(countSubmit, item.material, item.texture);
+		geometry.Bind(nullptr, countSubmit.geometry, item.mesh->GetGeometry());
+	}
+	return countSubmit.stats.stateChanges + countSubmit.geometry.bindCount;
+}
+
+void Renderer::AddSubmitStats(const FrameStats& stats) {
+	frameStats.trianglesFullDetail += stats.trianglesFullDetail;
+	frameStats.trianglesAfterLod += stats.trianglesAfterLod;
+	frameStats.objectsDrawn += stats.objectsDrawn;
+	frameStats.drawCalls += stats.drawCalls;
+	frameStats.instancedDraws += stats.instancedDraws;
+	frameStats.geometryBinds += stats.geometryBinds;
+	frameStats.constantBufferUpdates += stats.constantBufferUpdates;
+	frameStats.stateChanges += stats.stateChanges;
+	frameStats.stateBinds += stats.stateBinds;
+	frameStats.stateBindsSkipped += stats.stateBindsSkipped;
+	frameStats.depthPrepassDraws += stats.depthPrepassDraws;
+	frameStats.depthPrepassConstantUpdates += stats.depthPrepassConstantUpdates;
 }
 
 void Renderer::RenderFrame() {
+	//minimised, there's nothing to draw into
+	if (GetWidth() <= 0 || GetHeight() <= 0)
+		return;
+
+	PROFILE_ZONE("RenderFrame");
+	//a failed resize leaves nothing to draw into, so the frame is skipped and the next one tries
+	//again. checked by the buffers too, the window may be back at the size they were last made at
+	bool targetsMissing = !backBuffer || !depthBuffer;
+	if (swapChain && (targetsMissing || GetWidth() != backBufferWidth || GetHeight() != backBufferHeight) && !Resize())
+		return;
+	WaitForFrame();
+	if (inputTime == 0)
+		MarkInput(); //nobody marked when input was read, measure from here instead
+
+	gpuProfiler.BeginFrame();
+
 	//clear back buffer with desired colour
-	FLOAT bg[4] = { 0.0f, 0.4f, 0.3f, 1.0f };
-	devCon->ClearRenderTargetView(backBuffer, bg);
-	devCon->ClearDepthStencilView(depthBuffer, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	float bg[4] = { 0.0f, 0.4f, 0.3f, 1.0f };
+	if (devCon)
+		ClearTargets(bg);
 
 	//create the transform data stuff
-	CBuffer_PerObject cBufferData;
-	cBufferData.WVP = DirectX::XMMatrixIdentity();
 	DirectX::XMMATRIX view = camera.GetViewMatrix();
-	DirectX::XMMATRIX projection = camera.GetProjectionMatrix(window.GetWidth(), window.GetHeight());
+	DirectX::XMMATRIX projection = camera.GetProjectionMatrix(GetWidth(), GetHeight());
+	XMMATRIX viewProjection = view * projection;
 	
-	auto t = texture->GetTexture();
-	devCon->PSSetShaderResources(0, 1, &t);
-	auto s = texture->GetSampler();
-	devCon->PSSetSamplers(0, 1, &s);
-
+	//anything that finished loading since last frame goes to the gpu now
+	Profiler::Zone uploadZone("Uploads");
+	gpuProfiler.Begin("Uploads");
+	assets.ProcessUploads(uploadBudgetMs);
+	gpuProfiler.End();
+	uploadZone.End();
+
+	frameStats = FrameStats();
+	frameStats.stateObjects = states.GetCount();
+	recordedFrame.Clear();
+
+	CBuffer_PerFrame perFrame;
+	perFrame.view = view;
+	perFrame.projection = projection;
+	perFrame.viewProjection = viewProjection;
+	XMStoreFloat4(&perFrame.cameraPosition, camera.transform.GetPosition());
+	perFrame.time = std::chrono::duration<float>(std::chrono::steady_clock::now() - startTime).count();
+	if (devCon)
+		UpdatePerFrame(perFrame);
+
+	XMVECTOR cameraPosition = camera.transform.GetPosition();
+
+	//pixels covered by one unit one unit away from the camera, along the screen's height
+	float pixelsPerUnitAtOne = GetHeight() / (2.0f * tanf(XMConvertToRadians(camera.fov) * 0.5f));
+
+	//mesh bounds are made once at load, here they're moved into world space and laid out
+	//for the frustum to test four at a time
+	Profiler::Zone cullZone("Frustum cull");
+	cullSpheres.Clear();
+	cullObjects.clear();
 	for (auto obj : gameObjects) {
-		XMMATRIX world = obj->transform.GetWorldMatrix();
-		cBufferData.WVP = world * view * projection;
-		devCon->UpdateSubresource(cBuffer_PerObject, NULL, NULL, &cBufferData, NULL, NULL);
-		devCon->VSSetConstantBuffers(0, 1, &cBuffer_PerObject);
-	
-		obj->mesh->Render();
+		Mesh* mesh = obj->mesh.get();
+		if (!mesh->IsResident())
+			continue; //still loading, or failed to
+
+		//mirrored objects have negative scale on an axis, it's the size that matters
+		XMVECTOR scale = XMVectorAbs(obj->transform.GetScale());
+		float maxScale = std::max(XMVectorGetX(scale), std::max(XMVectorGetY(scale), XMVectorGetZ(scale)));
+		XMFLOAT3 centre = mesh->GetBoundsCentre();
+		XMStoreFloat3(&centre, XMVector3TransformCoord(XMLoadFloat3(&centre), obj->transform.GetWorldMatrix()));
+		cullSpheres.Add(centre, mesh->GetBoundsRadius() * maxScale);
+		cullObjects.push_back(obj);
+	}
+
+	Frustum viewFrustum{ viewProjection };
+	size_t visibleObjects = viewFrustum.CullSpheres(cullSpheres, cullVisible);
+	frameStats.objectsTested = cullObjects.size();
+	frameStats.objectsCulled = cullObjects.size() - visibleObjects;
+	cullZone.End();
+
+	//big opaque objects are drawn into a small cpu depth buffer, and whatever the frustum kept
+	//is tested against it. the occluders always pass their own test, so they still get drawn
+	if (occlusionCulling) {
+		Profiler::Zone occlusionZone("Occlusion cull");
+		auto occlusionStart = std::chrono::steady_clock::now();
+		occlusion.Resize(occlusionWidth, std::max(1, occlusionWidth * GetHeight() / GetWidth()));
+		occlusion.Begin(viewProjection);
+		bool anyOccluders = false;
+		for (size_t i = 0; i < cullObjects.size(); i++) {
+			GameObject* obj = cullObjects[i];
+			if (!cullVisible[i] || !obj->occluder || obj->transparent || obj->mesh->GetOccluder().indices.empty())
+				continue;
+			occlusion.AddOccluder(obj->mesh->GetOccluder(), obj->transform.GetWorldMatrix());
+			anyOccluders = true;
+		}
+		if (anyOccluders) {
+			occlusion.Rasterise(recordPool, recordThreads);
+			frameStats.objectsCulled += occlusion.CullSpheres(cullSpheres, cullVisible);
+			frameStats.occlusion = occlusion.GetStats();
+		}
+		frameStats.occlusionMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - occlusionStart).count();
+	}
+
+	//pick lods and give every visible object a sort key
+	Profiler::Zone sortZone("Lod, sort and batch");
+	drawItems.clear();
+	sortKeys.clear();
+	sortOrder.clear();
+	XMVECTOR cameraForward = camera.transform.GetForward();
+	for (size_t i = 0; i < cullObjects.size(); i++) {
+		if (!cullVisible[i])
+			continue;
+		GameObject* obj = cullObjects[i];
+		Mesh* mesh = obj->mesh.get();
+
+		//size on screen from the nearest point of the bounding sphere, lod errors are object
+		//space so they get scaled by the same amount as the radius
+		float radius = cullSpheres.radius[i];
+		float maxScale = radius / std::max(mesh->GetBoundsRadius(), FLT_MIN);
+		XMVECTOR centre = XMVectorSet(cullSpheres.x[i], cullSpheres.y[i], cullSpheres.z[i], 1);
+		float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(centre, cameraPosition))) - radius;
+		distance = std::max(distance, camera.nearClippingPlane);
+		obj->lod = mesh->SelectLod(pixelsPerUnitAtOne * maxScale / distance, obj->lod, lodErrorPixels, lodHysteresis);
+
+		Material* material = obj->material.get();
+		Texture* objectTexture = (material && material->texture) ? material->texture.get() : texture;
+		DrawItem item{ obj, mesh, material, objectTexture, obj->lod, obj->transparent };
+		float depth = XMVectorGetX(XMVector3Dot(XMVectorSubtract(centre, cameraPosition), cameraForward)) / camera.farClippingPlane;
+		sortKeys.push_back(DrawSort::MakeKey(item.transparent, geometry.GetArena(mesh->GetGeometry()),
+			material ? material->GetSortId() : 0, mesh->GetSortId(), item.lod, depth));
+		sortOrder.push_back((uint32_t)drawItems.size());
+		drawItems.push_back(item);
+	}
+
+	//sortOrder is still registration order here
+	frameStats.stateChangesUnsorted = CountStateChanges(sortOrder);
+	DrawSort::RadixSort(sortKeys, sortOrder, sortKeysScratch, sortOrderScratch);
+	frameStats.stateChangesSorted = CountStateChanges(sortOrder);
+
+	//runs of the same mesh, material and lod are next to each other now. big runs become one
+	//instanced command, the rest stay single so they keep per object meshlet culling
+	auto sameBatch = [](const DrawItem& a, const DrawItem& b) {
+		return a.mesh == b.mesh && a.material == b.material && a.texture == b.texture
+			&& a.lod == b.lod && a.transparent == b.transparent;
+	};
+	drawCommands.clear();
+	instanceData.clear();
+	for (size_t first = 0; first < sortOrder.size();) {
+		size_t end = first + 1;
+		while (end < sortOrder.size() && sameBatch(drawItems[sortOrder[first]], drawItems[sortOrder[end]]))
+			end++;
+
+		if (end - first >= instancingMinObjects) {
+			drawCommands.push_back(DrawCommand{ sortOrder[first], (unsigned int)instanceData.size(), (unsigned int)(end - first), 0, 0, 0 });
+			for (size_t i = first; i < end; i++) {
+				const DrawItem& item = drawItems[sortOrder[i]];
+				StoreObjectConstants(instanceData.emplace_back(), item.mesh->GetDequantiseMatrix() * item.object->transform.GetWorldMatrix(),
+					item.mesh->GetVertexLayout());
+			}
+		}
+		else {
+			for (size_t i = first; i < end; i++)
+				drawCommands.push_back(DrawCommand{ sortOrder[i], 0, 0, 0, 0, 0 });
+		}
+		first = end;
+	}
+
+	sortZone.End();
+
+	//every instanced command's world matrices go up in a single map
+	Profiler::Zone constantsZone("Meshlet cull and constants");
+	bool instancesReady = !instanceData.empty() && UpdateInstanceBuffer();
+
+	//meshlet culling and matrices for every single draw first, so all their constants can be
+	//written in one go before anything is drawn
+	commandRanges.clear();
+	objectConstants.clear();
+	for (DrawCommand& command : drawCommands) {
+		if (command.instanceCount > 0)
+			continue;
+		const DrawItem& item = drawItems[command.item];
+		const MeshLod& lod = item.mesh->GetLod(item.lod);
+		XMMATRIX world = item.object->transform.GetWorldMatrix();
+
+		//whole level unless culling finds parts we can skip
+		drawRanges.assign(1, DrawRange{ lod.firstIndex, lod.indexCount });
+		if (meshletCulling && !lod.meshlets.empty()) {
+			//meshlet bounds are object space, so bring the frustum and camera into it
+			//rather than moving every meshlet out to world space
+			Frustum frustum{ world * viewProjection };
+			XMFLOAT3 localCamera;
+			XMStoreFloat3(&localCamera, XMVector3TransformCoord(cameraPosition, XMMatrixInverse(nullptr, world)));
+
+			//normals don't stay perpendicular under non-uniform scale and flip under negative
+			//scale, the cones built from them would cull faces that can be seen
+			XMFLOAT3 scale;
+			XMStoreFloat3(&scale, item.object->transform.GetScale());
+			float smallest = std::min(scale.x, std::min(scale.y, scale.z));
+			float largest = std::max(scale.x, std::max(scale.y, scale.z));
+			bool coneCulling = smallest > 0.0f && largest - smallest <= largest * 1e-4f;
+
+			Meshlets::Cull(lod.meshlets, frustum, localCamera, drawRanges, frameStats.meshlets, coneCulling);
+		}
+		command.firstRange = (uint32_t)commandRanges.size();
+		command.rangeCount = (uint32_t)drawRanges.size();
+		commandRanges.insert(commandRanges.end(), drawRanges.begin(), drawRanges.end());
+
+		//quantised meshes store positions inside their bounds, dequantise before world. view and
+		//projection are applied on the gpu from the per frame buffer
+		command.constants = (uint32_t)objectConstants.size();
+		StoreObjectConstants(objectConstants.emplace_back(), item.mesh->GetDequantiseMatrix() * world, item.mesh->GetVertexLayout());
+	}
+
+	//with 11.1 offsets the whole frame's constants go up in one map, each draw binds its block.
+	//without them every draw updates the one small buffer like before
+	bool useRing = false;
+	if (constantRing.IsSupported() && !objectConstants.empty()) {
+		uint8_t* blocks = (uint8_t*)constantRing.Begin((unsigned int)objectConstants.size(), sizeof(CBuffer_PerObject));
+		if (blocks) {
+			unsigned int stride = constantRing.GetBlockStride();
+			for (size_t i = 0; i < objectConstants.size(); i++) {
+				memcpy(blocks + i * stride, &objectConstants[i], sizeof(CBuffer_PerObject));
+			}
+			constantRing.End();
+			useRing = true;
+			frameStats.constantBufferMaps++;
+		}
 	}
 
-	//flip the back and front buffers around. display on screen
-	swapChain->Present(0, 0);
+	constantsZone.End();
+
+	//everything the draws read is on the gpu now. small frames record straight into the immediate
+	//context, bigger ones are split into chunks that worker threads record into deferred contexts,
+	//executed here in chunk order so the sorted draw order holds. with the pre-pass every chunk is
+	//recorded twice, depth only then shaded, and all the depth lists run before any of the shading
+	//so the whole scene's depth is there to test against
+	auto submitStart = std::chrono::steady_clock::now();
+	Profiler::Zone submitZone("Submit");
+	gpuProfiler.Begin("Draws");
+	depthPrepassed = depthPrepass && !drawCommands.empty();
+	DrawChunks::Partition(drawCommands.size(), drawChunkSize, drawChunks);
+	size_t chunkCount = drawChunks.size();
+	size_t listCount = depthPrepassed ? chunkCount * 2 : chunkCount;
+	bool recordDeferred = chunkCount > 1;
+	while (recordDeferred && deferredContexts.size() < listCount) {
+		//headless chunks are still split across threads, they just have no context to record into
+		ID3D11DeviceContext* deferred = nullptr;
+		if (dev && !CreateDeferredContext(&deferred)) {
+			LOG("Failed to create deferred context, recording on the immediate context");
+			recordDeferred = false;
+			break;
+		}
+		deferredContexts.emplace_back();
+		InitSubmitContext(deferredContexts.back(), deferred);
+	}
+
+	if (recordDeferred) {
+		//lists [0, chunkCount) are the pre-pass when there is one
+		DrawChunks::Record(recordPool, listCount, recordThreads, [&](size_t list) {
+			bool depthOnly = depthPrepassed && list < chunkCount;
+			PROFILE_ZONE(depthOnly ? "Record depth chunk" : "Record chunk");
+			const DrawChunks::Chunk& chunk = drawChunks[list % chunkCount];
+			SubmitContext& submit = deferredContexts[list];
+			BindFrameState(submit, instancesReady, depthOnly);
+			SubmitCommands(submit, chunk.first, chunk.count, instancesReady, useRing);
+			//false leaves the deferred context cleared for next frame, and the immediate one is
+			//cleared after each list anyway
+			if (submit.context)
+				FinishCommandList(submit);
+			submit.states.Reset();
+		});
+
+		auto executeLists = [&](size_t first, size_t count) {
+			for (size_t i = first; i < first + count; i++) {
+				SubmitContext& submit = deferredContexts[i];
+				if (submit.context && !ExecuteCommandList(submit)) {
+					LOG("Failed to record a command list, its draws are missing this frame");
+					continue;
+				}
+				recordedFrame.Append(submit.stream);
+				AddSubmitStats(submit.stats);
+				frameStats.commandLists++;
+			}
+		};
+		if (depthPrepassed) {
+			gpuProfiler.Begin("Depth prepass");
+			executeLists(0, chunkCount);
+			gpuProfiler.End();
+		}
+		gpuProfiler.Begin("Shading");
+		executeLists(listCount - chunkCount, chunkCount);
+		gpuProfiler.End();
+	}
+	else {
+		if (depthPrepassed) {
+			PROFILE_ZONE("Depth prepass");
+			gpuProfiler.Begin("Depth prepass");
+			BindFrameState(immediate, instancesReady, true);
+			SubmitCommands(immediate, 0, drawCommands.size(), instancesReady, useRing);
+			recordedFrame.Append(immediate.stream);
+			AddSubmitStats(immediate.stats);
+			gpuProfiler.End();
+		}
+		gpuProfiler.Begin("Shading");
+		BindFrameState(immediate, instancesReady);
+		SubmitCommands(immediate, 0, drawCommands.size(), instancesReady, useRing);
+		recordedFrame.Append(immediate.stream);
+		AddSubmitStats(immediate.stats);
+		gpuProfiler.End();
+	}
+	gpuProfiler.End();
+	submitZone.End();
+	frameStats.submitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - submitStart).count();
+	gpuProfiler.EndFrame();
+
+	if (captureHistory > 0)
+		CaptureFrame(view, projection, bg, perFrame.time, instancesReady);
+	else
+		capturedFrames.clear();
+	if (backend == RenderBackend::SOFTWARE)
+		DrawSoftware(view, projection, bg, perFrame.time, instancesReady);
+
+	//flip the back and front buffers around. display on screen. without vsync, tearing makes
+	//it show straight away instead of at the next compositor refresh
+	Profiler::Zone presentZone("Present");
+	if (swapChain)
+		Present();
+	presentZone.End();
+	frameWaited = false;
+	MeasureLatency();
+}
+
+void Renderer::CaptureFrame(FXMMATRIX view, CXMMATRIX projection, const float clearColour[4], float time, bool instancesReady) {
+	PROFILE_ZONE("Capture frame");
+	//start over if the history was resized, the ring only grows while it's filling up
+	if (capturedFrames.size() > captureHistory || (capturedFrames.size() < captureHistory && captureNext != capturedFrames.size())) {
+		capturedFrames.clear();
+		captureNext = 0;
+	}
+	if (captureNext == capturedFrames.size())
+		capturedFrames.emplace_back();
+	CapturedFrame& frame = capturedFrames[captureNext];
+	captureNext = (captureNext + 1) % captureHistory;
+	FillCapturedFrame(frame, view, projection, clearColour, time, instancesReady);
+}
+
+void Renderer::FillCapturedFrame(CapturedFrame& frame, FXMMATRIX view, CXMMATRIX projection,
+	const float clearColour[4], float time, bool instancesReady) {
+	//assign rather than copy so a full ring reuses its memory
+	XMStoreFloat4x4(&frame.view, view);
+	XMStoreFloat4x4(&frame.projection, projection);
+	XMStoreFloat4(&frame.cameraPosition, camera.transform.GetPosition());
+	frame.clearColour = XMFLOAT4(clearColour[0], clearColour[1], clearColour[2], clearColour[3]);
+	frame.time = time;
+	frame.objectConstants.assign(objectConstants.begin(), objectConstants.end());
+	if (instancesReady)
+		frame.instances.assign(instanceData.begin(), instanceData.end());
+	else
+		frame.instances.clear();
+	frame.stream.Clear();
+	frame.stream.Append(recordedFrame);
+
+	//only what the visible objects used, the stream can't have drawn with anything else.
+	//the data is shared with the pool and textures, so this is a reference each
+	captureHandles.clear();
+	captureTextures.clear();
+	for (const DrawItem& item : drawItems) {
+		captureHandles.push_back(item.mesh->GetGeometry());
+		captureTextures.push_back(item.texture ? item.texture : placeholderTexture);
+	}
+	std::sort(captureHandles.begin(), captureHandles.end());
+	captureHandles.erase(std::unique(captureHandles.begin(), captureHandles.end()), captureHandles.end());
+	std::sort(captureTextures.begin(), captureTextures.end());
+	captureTextures.erase(std::unique(captureTextures.begin(), captureTextures.end()), captureTextures.end());
+
+	frame.geometry.clear();
+	for (GeometryPool::Handle handle : captureHandles) {
+		std::shared_ptr<const GeometryData> kept = geometry.GetKeptData(handle);
+		if (kept)
+			frame.geometry.push_back(CapturedGeometry{ (uint32_t)geometry.GetArena(handle), geometry.GetBaseVertex(handle), geometry.GetFirstIndex(handle), std::move(kept) });
+	}
+	frame.textures.clear();
+	for (Texture* captured : captureTextures) {
+		std::shared_ptr<const TextureData> kept = captured->GetKeptData();
+		if (kept)
+			frame.textures.push_back(CapturedTexture{ captured->GetId(), std::move(kept) });
+	}
+}
+
+void Renderer::DrawSoftware(FXMMATRIX view, CXMMATRIX projection, const float clearColour[4], float time, bool instancesReady) {
+	PROFILE_ZONE("Software raster");
+	auto start = std::chrono::steady_clock::now();
+	if (softwareCapture.frames.empty())
+		softwareCapture.frames.emplace_back();
+	softwareCapture.width = GetWidth();
+	softwareCapture.height = GetHeight();
+	FillCapturedFrame(softwareCapture.frames[0], view, projection, clearColour, time, instancesReady);
+
+	//the pre-pass draws are skipped, the rasteriser's depth less test would reject the shading after them
+	softwareRasteriser.Resize(GetWidth(), GetHeight());
+	softwareDraws.clear();
+	softwareReplay.Replay(0, ReplayTarget::SOFTWARE, &softwareRasteriser, &recordPool, softwareDraws);
+	frameStats.softwareMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool Renderer::SaveCapture(const std::string& path) {
+	if (capturedFrames.empty()) {
+		LOG("Nothing captured, set captureHistory first");
+		return false;
+	}
+
+	//oldest first. a full ring's oldest is the one about to be overwritten
+	FrameCapture capture;
+	capture.width = GetWidth();
+	capture.height = GetHeight();
+	size_t first = capturedFrames.size() == captureHistory ? captureNext : 0;
+	for (size_t i = 0; i < capturedFrames.size(); i++) {
+		capture.frames.push_back(capturedFrames[(first + i) % capturedFrames.size()]);
+	}
+	return capture.Save(path);
 }
 
 void Renderer::Clean() {
 
-	if (cBuffer_PerObject) cBuffer_PerObject->Release();
-	if (iBuffer) iBuffer->Release();
-	if (vBuffer) vBuffer->Release();
-	if (depthBuffer) depthBuffer->Release();
-	if (backBuffer) backBuffer->Release();
-	if (swapChain) swapChain->Release();
-	if (dev) dev->Release();
-	if (devCon) devCon->Release();
+	delete placeholderTexture;
+	placeholderTexture = nullptr;
+	gpuProfiler.Release();
+	for (SubmitContext& submit : deferredContexts) {
+		ReleaseSubmitContext(submit);
+	}
+	deferredContexts.clear();
+	ReleaseSubmitContext(immediate);
+	geometry.Release();
+	constantRing.Release();
+	states.Release();
+	depthEqual = nullptr;
+	depthReadOnly = nullptr;
+	alphaBlend = nullptr;
+	ReleaseDevice();
 }
@@ -1,57 +1,413 @@
 #pragma once
-#include <d3d11.h>
 #include <vector>
+#include <chrono>
 
 #include "Transform.h"
 #include "Texture.h"
 #include "Camera.h"
+#include "VertexFormats.h"
+#include "Meshlet.h"
+#include "Frustum.h"
+#include "AssetLoader.h"
+#include "GeometryPool.h"
+#include "ConstantBufferRing.h"
+#include "ThreadPool.h"
+#include "DrawChunks.h"
+#include "GpuProfiler.h"
+#include "OcclusionBuffer.h"
+#include "CommandStream.h"
+#include "FrameCapture.h"
+#include "FrameReplay.h"
+#include "SoftwareRasteriser.h"
+#include "StateCache.h"
 
-struct IDXGISwapChain;
+struct IDXGISwapChain2;
 struct ID3D11Device;
 struct ID3D11DeviceContext;
+struct ID3D11DeviceContext1;
+struct ID3D11CommandList;
 struct ID3D11RenderTargetView;
 struct ID3D11DepthStencilView;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11InputLayout;
+struct ID3D11Buffer;
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
 
 class Window;
 class GameObject;
+class Mesh;
+struct Material;
+
+//what the renderer draws with. the headless ones run everything up to and including submission
+//the same way, for timing the cpu side of a frame without a gpu or a window
+enum class RenderBackend
+{
+	D3D11, //a window's swap chain
+	NULL_DEVICE, //binds and draws are dropped
+	RECORDING, //binds and draws go into a CommandStream instead
+	//recorded like RECORDING, then drawn on the cpu by a SoftwareRasteriser. keeps a cpu copy of
+	//every mesh and texture like keepCaptureData
+	SOFTWARE
+};
+
+//constant buffers by how often they change. CBuffer_PerObject is in FrameCapture.h since
+//captures keep a frame's worth of them
+struct CBuffer_PerFrame
+{
+	DirectX::XMMATRIX view;
+	DirectX::XMMATRIX projection;
+	DirectX::XMMATRIX viewProjection;
+	DirectX::XMFLOAT4 cameraPosition;
+	float time; //seconds since the renderer started
+	float padding[3];
+};
+
+struct CBuffer_PerMaterial
+{
+	DirectX::XMFLOAT4 colour;
+};
+
+//counters for the last RenderFrame, reset at the start of each frame
+struct FrameStats
+{
+	MeshletCullStats meshlets;
+	OcclusionStats occlusion; //its objectsOccluded are counted in objectsCulled too
+	size_t trianglesFullDetail = 0; //what the drawn objects would cost at lod 0
+	size_t trianglesAfterLod = 0;
+	size_t objectsDrawn = 0;
+	size_t drawCalls = 0;
+	size_t instancedDraws = 0; //draw calls that covered a group of objects sharing a mesh
+	size_t objectsTested = 0; //loaded objects checked against the view frustum
+	size_t objectsCulled = 0; //objects whose bounds were outside it
+	size_t geometryBinds = 0; //vertex/index buffer changes, one per geometry pool arena used
+	size_t constantBufferMaps = 0; //1 when the frame's object constants went up through the ring
+	size_t constantBufferUpdates = 0; //UpdateSubresource calls shading, only without 11.1 offsets
+	size_t stateChanges = 0; //texture, material, geometry, shader and blend binds actually made, over every pass and chunk
+	size_t stateBinds = 0; //blend, depth, rasterizer and sampler objects that went to a context
+	size_t stateBindsSkipped = 0; //ones that didn't because the context already had them bound
+	size_t stateObjects = 0; //distinct state objects in the renderer's StateCache
+	//the binds one pass over the drawn objects would make in the order they were registered, and
+	//in sorted order. counted the same way so they compare, unlike stateChanges
+	size_t stateChangesUnsorted = 0;
+	size_t stateChangesSorted = 0;
+	size_t commandLists = 0; //deferred contexts recorded on worker threads, 0 when drawn straight to the immediate one
+	size_t depthPrepassDraws = 0; //draw calls the depth pre-pass added, not counted in drawCalls
+	size_t depthPrepassConstantUpdates = 0; //and its UpdateSubresource calls, not counted in constantBufferUpdates
+	float occlusionMs = 0; //rasterising occluders and testing objects against them
+	float submitMs = 0; //recording the draws and, with command lists, executing them
+	float softwareMs = 0; //drawing the recorded frame on the cpu, SOFTWARE backend only
+	float inputToPresentMs = 0; //from Renderer::MarkInput to the Present call returning
+	//from MarkInput to the frame reaching the screen, a few frames behind. 0 when the swap
+	//chain can't report it (some windowed setups)
+	float inputToDisplayMs = 0;
+};
 
 class Renderer
 {
 private:
-	IDXGISwapChain* swapChain = nullptr; //pointer to swap chain reference
+	IDXGISwapChain2* swapChain = nullptr; //pointer to swap chain reference, flip model
 	ID3D11Device* dev = nullptr; //pointer to direct3d device interface
 	ID3D11DeviceContext* devCon = nullptr; //pointer to direct3d device context
 	ID3D11RenderTargetView* backBuffer = nullptr; //a buffer that can be used to render to
 	ID3D11DepthStencilView* depthBuffer = nullptr; //the pointer to our depth buffer
+	int backBufferWidth = 0; //window size the back and depth buffers were made for
+	int backBufferHeight = 0;
+
+	static const unsigned int swapChainBuffers = 3;
+	unsigned int maxFrameLatency = 1;
+	bool tearingSupported = false;
+	void* frameLatencyWaitable = nullptr; //signalled whenever the swap chain can take another frame
+	bool frameWaited = false; //already waited for the frame being built
+
+	//input to present latency. inputTime is when the frame's input was read, in Profiler::Now
+	//nanoseconds. when each present reached the screen is matched up by present count a few frames later
+	struct PresentInput
+	{
+		unsigned int presentCount = 0;
+		int64_t inputTime = 0;
+	};
+	static const unsigned int presentHistory = 8;
+	PresentInput presentInputTimes[presentHistory];
+	int64_t inputTime = 0;
+	int64_t qpcFrequency = 1;
+	float inputToDisplayMs = 0;
 
 	long InitD3D();
+	long InitBackBuffer(); //back buffer view, depth buffer and viewport for the current window size
+	unsigned int GetSwapChainFlags();
+	//recreates the back and depth buffers at the window's new size. false if either couldn't be,
+	//which leaves them null
+	bool Resize();
+	void MeasureLatency();
+	//inputToDisplayMs from the swap chain's frame statistics, left as it was without one
+	void MeasureDisplayLatency();
+	void ClearTargets(const float colour[4]);
+	void UpdatePerFrame(const CBuffer_PerFrame& perFrame);
+	void Present();
+	std::vector<uint32_t> readBackFrame;
+	//copies the current back buffer into readBackFrame through a staging texture, leaving it
+	//empty if that fails. waits for the gpu to finish the frame
+	void ReadBackBuffer();
+	//everything InitD3D, InitPipeline and InitGraphics made
+	void ReleaseDevice();
 
 	ID3D11VertexShader* pVS = nullptr;
+	ID3D11VertexShader* pVSInstanced = nullptr; //world matrices come from the instance buffer
+	ID3D11VertexShader* pVSDepth = nullptr; //depth pre-pass, positions only and no pixel shader
+	ID3D11VertexShader* pVSDepthInstanced = nullptr;
 	ID3D11PixelShader* pPS = nullptr;
-	ID3D11InputLayout* pIL = nullptr;
+	//[depth only][instanced][VertexLayout], one per vertex shader and the vertex formats it can read
+	ID3D11InputLayout* inputLayouts[2][2][3] = {};
 	ID3D11Buffer* vBuffer = nullptr; //vertex buffer
 	ID3D11Buffer* iBuffer = nullptr; //index buffer
-	ID3D11Buffer* cBuffer_PerObject = nullptr; //constant buffer
+	ID3D11Buffer* cBuffer_PerObject = nullptr; //world matrix, when the constant ring isn't supported
+	ID3D11Buffer* cBuffer_PerFrame = nullptr; //camera and time, shared by every draw
+	ID3D11Buffer* cBuffer_PerMaterial = nullptr; //colour, changes with the material
+	ID3D11Buffer* instanceBuffer = nullptr; //world matrix per instance, rewritten every frame
+	size_t instanceCapacity = 0;
+
+	bool UpdateInstanceBuffer();
 
 	long InitDepthBuffer();
 	long InitPipeline();
 	void InitGraphics();
 
-	Window& window;
+	Window* window = nullptr; //null when headless
+	RenderBackend backend = RenderBackend::D3D11;
+	int headlessWidth = 0; //stands in for the window size without one
+	int headlessHeight = 0;
+	GeometryPool geometry; //vertex and index buffers every mesh is stored in
+	StateCache states; //samplers, blends and the rest, shared by every texture and pass
+	AssetLoader assets; //after window, it needs us constructed enough to hand out our device
+	Texture* placeholderTexture = nullptr; //1x1 white, drawn with until the real texture arrives
+
+	FrameStats frameStats;
+	std::vector<DrawRange> drawRanges; //reused every object to avoid reallocating
+
+	//world space bounds of every loaded object, culled together before anything else happens
+	SphereList cullSpheres;
+	std::vector<GameObject*> cullObjects;
+	std::vector<uint8_t> cullVisible;
+	OcclusionBuffer occlusion;
+
+	//a visible object with its lod picked, waiting to be sorted
+	struct DrawItem
+	{
+		GameObject* object;
+		Mesh* mesh;
+		Material* material; //null for the default
+		Texture* texture; //the material's, or the renderer's when it has none
+		unsigned int lod;
+		bool transparent;
+	};
+	//what actually gets submitted, in sorted order. one object, or a run of matching ones drawn instanced
+	struct DrawCommand
+	{
+		uint32_t item; //first DrawItem it covers
+		unsigned int firstInstance;
+		unsigned int instanceCount; //0 for a plain single draw
+		uint32_t firstRange; //single draws only, into commandRanges
+		uint32_t rangeCount; //0 when meshlet culling removed everything
+		uint32_t constants; //single draws only, into objectConstants
+	};
+	std::vector<DrawItem> drawItems;
+	std::vector<uint64_t> sortKeys;
+	std::vector<uint32_t> sortOrder; //drawItems indices, sorted alongside the keys
+	std::vector<uint64_t> sortKeysScratch;
+	std::vector<uint32_t> sortOrderScratch;
+	std::vector<DrawCommand> drawCommands;
+	std::vector<DrawRange> commandRanges; //what survived meshlet culling, for every single draw
+	std::vector<CBuffer_PerObject> objectConstants; //per single draw
+	ConstantBufferRing constantRing;
+	std::vector<CBuffer_PerObject> instanceData;
+
+	//a context draws get recorded into, with what's bound on it right now so submission only
+	//changes state that differs. the immediate context has one, and each chunk of a split frame
+	//gets a deferred one, so recording threads never touch each other's
+	struct SubmitContext
+	{
+		ID3D11DeviceContext* context = nullptr;
+		ID3D11DeviceContext1* context1 = nullptr; //for constant ring offsets, null without 11.1
+		ID3D11CommandList* commandList = nullptr; //what a deferred context recorded this frame
+		//null context is a headless renderer, which only keeps the bindings below up to date.
+		//stream is what it bound and drew this pass when recording
+		CommandStream stream;
+
+		GeometryPool::Bindings geometry;
+		//state objects on the context itself, unlike the rest it lasts across passes and frames
+		//until the context is cleared
+		StateCache::Bindings states;
+		Texture* boundTexture = nullptr;
+		int boundShader = -1; //0 plain, 1 instanced
+		int boundLayer = -1; //0 opaque, 1 transparent
+		DirectX::XMFLOAT4 boundColour;
+		bool materialBound = false;
+		bool depthOnly = false; //recording the depth pre-pass, opaque draws with no pixel shader
+		bool countOnly = false; //never drawn or recorded, only there to count what an order of binds costs
+		FrameStats stats; //only the draw and bind counts, added to frameStats once recorded
+	};
+	SubmitContext immediate;
+	std::vector<SubmitContext> deferredContexts; //one per chunk, made as frames need more
+	std::vector<DrawChunks::Chunk> drawChunks;
+	ThreadPool recordPool; //only ever runs chunk recording, occlusion rasterising and software shading, each waits for it to be idle
+
+	//takes over the caller's reference to context
+	void InitSubmitContext(SubmitContext& submit, ID3D11DeviceContext* context);
+	void ReleaseSubmitContext(SubmitContext& submit);
+	//false if the device couldn't make one
+	bool CreateDeferredContext(ID3D11DeviceContext** context);
+	//into submit.commandList, left null if it failed
+	void FinishCommandList(SubmitContext& submit);
+	//runs and releases submit.commandList on the immediate context, false if there wasn't one
+	bool ExecuteCommandList(SubmitContext& submit);
+	//the device side of the Bind functions below, only called with a context. d3d11 calls
+	//live in RendererD3D11.cpp so this file and the headless build don't need its headers
+	void SetContextFrameState(SubmitContext& submit, bool instancesReady, bool depthOnly);
+	void SetContextTexture(SubmitContext& submit, Texture* texture);
+	void SetContextMaterial(SubmitContext& submit, const CBuffer_PerMaterial& perMaterial);
+	void SetContextShader(SubmitContext& submit, bool instanced);
+	void SetContextObject(SubmitContext& submit, uint32_t constants); //objectConstants[constants] into cBuffer_PerObject
+	//render targets, viewport, shaders and per frame buffers. deferred contexts start with nothing set.
+	//depthOnly sets up the depth pre-pass instead of shading
+	void BindFrameState(SubmitContext& submit, bool instancesReady, bool depthOnly = false);
+	void BindTexture(SubmitContext& submit, Texture* texture);
+	void BindMaterial(SubmitContext& submit, Material* material, Texture* materialTexture);
+	void BindShader(SubmitContext& submit, bool instanced);
+	void BindLayer(SubmitContext& submit, bool transparent);
+	//draw through the mesh on a real context, headless ones only bind and maybe record
+	void DrawMesh(SubmitContext& submit, Mesh* mesh, const DrawRange* ranges, size_t rangeCount);
+	void DrawMeshInstanced(SubmitContext& submit, Mesh* mesh, unsigned int lod, unsigned int instanceCount, unsigned int firstInstance);
+	bool IsRecording() { return backend == RenderBackend::RECORDING || backend == RenderBackend::SOFTWARE || captureHistory > 0; }
+	bool Records(const SubmitContext& submit) { return IsRecording() && !submit.countOnly; }
+	//records drawCommands[first, first + count) into the context
+	void SubmitCommands(SubmitContext& submit, size_t first, size_t count, bool instancesReady, bool useRing);
+	void AddSubmitStats(const FrameStats& stats);
+	//texture, material, shader, layer and geometry binds one shading pass over drawItems in this
+	//order would make, through the same Bind functions as SubmitCommands. single draws only, no
+	//pre-pass and no chunk rebinds, so two orders of the same items can be compared
+	size_t CountStateChanges(const std::vector<uint32_t>& order);
+	SubmitContext countSubmit;
+
+	GpuProfiler gpuProfiler;
+
+	//owned by states
+	ID3D11BlendState* alphaBlend = nullptr;
+	ID3D11DepthStencilState* depthReadOnly = nullptr; //transparent objects test depth but don't write it
+	ID3D11DepthStencilState* depthEqual = nullptr; //opaque shading after the pre-pass, only the nearest surface passes
+	bool depthPrepassed = false; //this frame's opaque depth was laid down by a pre-pass
+	CommandStream recordedFrame; //every pass's stream in the order they'd have run
+
+	//the last captureHistory frames, oldest at captureNext once it's full
+	std::vector<CapturedFrame> capturedFrames;
+	size_t captureNext = 0;
+	std::vector<GeometryPool::Handle> captureHandles; //this frame's distinct geometry
+	std::vector<Texture*> captureTextures;
+	void CaptureFrame(DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection, const float clearColour[4], float time, bool instancesReady);
+	//what CaptureFrame keeps of this frame, into frame
+	void FillCapturedFrame(CapturedFrame& frame, DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection,
+		const float clearColour[4], float time, bool instancesReady);
+
+	//the SOFTWARE backend captures each frame into softwareCapture's only frame and replays it
+	//onto the rasteriser, the same way agp_replay draws a saved capture
+	FrameCapture softwareCapture;
+	FrameReplay softwareReplay{ softwareCapture };
+	SoftwareRasteriser softwareRasteriser;
+	std::vector<ReplayDraw> softwareDraws;
+	void DrawSoftware(DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection, const float clearColour[4], float time, bool instancesReady);
 public:
 	ID3D11Device* GetDevice() { return dev; }
 	ID3D11DeviceContext* GetDeviceCon() { return devCon; }
+	ID3D11InputLayout* GetInputLayout(VertexLayout layout, bool instanced = false, bool positionsOnly = false);
 
+#ifndef HEADLESS_ONLY
 	Renderer(Window& inWindow);
+#endif
+	//no window, device or swap chain, the size stands in for the window's. assets still load and
+	//meshes still go into the geometry pool, but nothing reaches a gpu
+	Renderer(int width, int height, RenderBackend backend);
+	RenderBackend GetBackend() { return backend; }
+	int GetWidth();
+	int GetHeight();
+	//waits until the swap chain can take another frame. call before reading input so it's as fresh
+	//as possible when the frame is shown, RenderFrame calls it itself if it wasn't
+	void WaitForFrame();
+	//call once the frame's input has been read, latency in FrameStats is measured from here
+	void MarkInput();
 	void RenderFrame();
 	void Clean();
 
+	//cull meshlets against the camera, turn off to draw whole meshes for comparison
+	bool meshletCulling = true;
+	//draw opaque objects' depth first from positions alone, then shade them with an equal depth
+	//test so the pixel shader runs once per pixel however much they overlap. costs a second
+	//vertex pass, so it only pays off with a lot of overdraw. the gpu profiler times both passes
+	bool depthPrepass = false;
+	//rasterise objects marked as occluders on the cpu and skip anything hidden behind them.
+	//frames without any visible occluders don't pay for it
+	bool occlusionCulling = true;
+	//occlusion buffer width in pixels, its height follows the window's aspect
+	int occlusionWidth = 256;
+	const FrameStats& GetFrameStats() { return frameStats; }
+	//the last frame's binds and draws, empty unless the backend is RECORDING or SOFTWARE or captureHistory is on
+	const CommandStream& GetRecordedFrame() { return recordedFrame; }
+
+	//keep a cpu copy of every mesh and texture uploaded from now on, so captures can include
+	//them. as much memory again as they take on the gpu, so set it before loading anything
+	bool keepCaptureData = false;
+	//the last this many frames' camera, constants, binds and draws are kept for SaveCapture.
+	//0 records nothing
+	unsigned int captureHistory = 0;
+	//writes the kept frames and whatever they drew with to a file FrameReplay can play back.
+	//meshes and textures loaded without keepCaptureData are left out and their draws skipped
+	bool SaveCapture(const std::string& path);
+	AssetLoader& GetAssets() { return assets; }
+	GeometryPool& GetGeometry() { return geometry; }
+	StateCache& GetStates() { return states; }
+	//gpu time of the frame and its Uploads and Draws, with Draws split into Depth prepass and
+	//Shading. a few frames behind
+	GpuProfiler& GetGpuProfiler() { return gpuProfiler; }
+	//the last frame's image with the SOFTWARE backend, the window's size
+	SoftwareRasteriser& GetSoftwareRasteriser() { return softwareRasteriser; }
+	//sync to the display's refresh. off, frames are presented straight away and tear if the
+	//display doesn't have variable refresh
+	bool vsync = false;
+	//copy the next frame to the cpu just before it's presented, flip model leaves the back buffer
+	//undefined afterwards. stalls until the gpu has drawn it, for checks rather than every frame
+	bool readBackNextFrame = false;
+	//the last frame read back, RGBA8 and GetWidth pixels to a row. empty headless
+	const std::vector<uint32_t>& GetReadBackFrame() { return readBackFrame; }
+	//frames the cpu may get ahead of the display, lower is less input latency but less slack
+	void SetMaxFrameLatency(unsigned int frames);
+	unsigned int GetMaxFrameLatency() { return maxFrameLatency; }
+
+	//time each frame may spend uploading assets that finished loading
+	float uploadBudgetMs = 2.0f;
+
+	//lods are picked so the simplified surface is off by at most this many pixels, 0 keeps full detail
+	float lodErrorPixels = 1.0f;
+	//fraction either side of lodErrorPixels an object has to cross before it changes level
+	float lodHysteresis = 0.25f;
+
+	//objects sharing a mesh, texture and lod are drawn instanced once there are this many of them.
+	//smaller groups are drawn one at a time so they keep per object meshlet culling
+	unsigned int instancingMinObjects = 2;
+
+	//draw commands each worker thread records into a deferred context at a time. frames with
+	//more commands than this are split across threads, 0 always records on the immediate context
+	size_t drawChunkSize = 256;
+	//threads recording at once, counting the render thread. 0 uses every one the pool has
+	unsigned int recordThreads = 0;
+
 	//std::vector is a list!!! so we are storing a list of all our gameobjects
 	std::vector<GameObject*> gameObjects;
 	void RegisterGameObject(GameObject* e);
 	void RemoveGameObject(GameObject* e);
 
-	Texture* texture;
+	Texture* texture = nullptr; //for objects whose material doesn't have one
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
 
 	Camera camera;
 };
@@ -0,0 +1,625 @@
+#include "Renderer.h"
+#include "Profiler.h"
+#include "Debug.h"
+
+#ifndef HEADLESS_ONLY
+#include "Window.h"
+#include "ShaderLoading.h"
+
+#include <d3d11_1.h>
+#include <dxgi1_5.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+
+#include"DirectXMath.h"
+using namespace DirectX;
+
+//the renderer's d3d11 calls, Renderer.cpp has what's the same with or without a device. the
+//headless build has no d3d11 headers to include, so it gets the no device versions at the bottom
+
+#ifndef HEADLESS_ONLY
+
+//whole back buffer, from the size it was made at
+static D3D11_VIEWPORT MakeViewport(int width, int height) {
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = float(width);
+	viewport.Height = float(height);
+	viewport.MinDepth = 0;
+	viewport.MaxDepth = 1;
+	return viewport;
+}
+Renderer::Renderer(Window& inWindow)
+	: window(&inWindow), geometry(*this), assets(*this), recordPool(0, "Draw recording") {
+
+	if (InitD3D() != S_OK) {
+		LOG("Failed to initialise D3D renderer");
+		return;
+	}
+
+	if (InitPipeline() != S_OK) {
+		LOG("Failed to initialise pipeline");
+		return;
+	}
+
+	InitGraphics();
+}
+
+long Renderer::InitD3D(){
+	HRESULT hr;
+	//create the device and its immediate context on their own, the swap chain is made after from
+	//the same adapter's factory
+	hr = D3D11CreateDevice(NULL,				//default graphics adapter
+		D3D_DRIVER_TYPE_HARDWARE,				//use hardware acceleration, can also use software or WARP renderers
+		NULL,									//used for software driver types
+		D3D11_CREATE_DEVICE_DEBUG,				//flags can be OR'd together, we are enabling debug here
+		NULL,									//direct3d feature levels. NULL will use d2d11.0 or older
+		NULL,									//size of array passed to this ^^^
+		D3D11_SDK_VERSION,						//always set to D3D11_SDK_VERSION
+		&dev,
+		NULL,									//out param - will be set to chosen feature level
+		&devCon);								//pointer to immediate device context
+
+	if (FAILED(hr)) {
+		LOG("Failed to create a renderer");
+		return hr; //abort
+	}
+
+	//the swap chain has to come from the factory that made the device's adapter
+	IDXGIDevice* dxgiDevice = nullptr;
+	IDXGIAdapter* adapter = nullptr;
+	IDXGIFactory2* factory = nullptr;
+	hr = dev->QueryInterface(__uuidof(IDXGIDevice), (void**)&dxgiDevice);
+	if (SUCCEEDED(hr))
+		hr = dxgiDevice->GetAdapter(&adapter);
+	if (SUCCEEDED(hr))
+		hr = adapter->GetParent(__uuidof(IDXGIFactory2), (void**)&factory);
+	if (adapter) adapter->Release();
+	if (dxgiDevice) dxgiDevice->Release();
+	if (FAILED(hr)) {
+		LOG("Failed to get the DXGI factory");
+		return hr; //abort
+	}
+
+	//tearing lets presents without vsync show straight away, which variable refresh displays need
+	IDXGIFactory5* factory5 = nullptr;
+	if (SUCCEEDED(factory->QueryInterface(__uuidof(IDXGIFactory5), (void**)&factory5))) {
+		BOOL allowTearing = FALSE;
+		if (SUCCEEDED(factory5->CheckFeatureSupport(DXGI_FEATURE_PRESENT_ALLOW_TEARING, &allowTearing, sizeof(allowTearing))))
+			tearingSupported = allowTearing == TRUE;
+		factory5->Release();
+	}
+
+	//flip model, the compositor reads our back buffers directly instead of copying them out. the
+	//waitable object tells us when a buffer is free so frames don't pile up in a queue
+	DXGI_SWAP_CHAIN_DESC1 scd = {};
+	scd.Width = GetWidth();						//set the back buffer width
+	scd.Height = GetHeight();					//set the back buffer height
+	scd.Format = DXGI_FORMAT_R8G8B8A8_UNORM;			//32 bit colour
+	scd.SampleDesc.Count = 1;							//flip model can't be multisampled
+	scd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;	//intended swapchain use
+	scd.BufferCount = swapChainBuffers;
+	scd.Scaling = DXGI_SCALING_STRETCH;
+	scd.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+	scd.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+	scd.Flags = GetSwapChainFlags();
+
+	IDXGISwapChain1* swapChain1 = nullptr;
+	hr = factory->CreateSwapChainForHwnd(dev, window->GetHandle(), &scd, NULL, NULL, &swapChain1);
+	if (SUCCEEDED(hr))
+		factory->MakeWindowAssociation(window->GetHandle(), DXGI_MWA_NO_ALT_ENTER); //we stay windowed, exclusive fullscreen can't tear
+	factory->Release();
+	if (FAILED(hr)) {
+		LOG("Failed to create swap chain");
+		return hr; //abort
+	}
+	hr = swapChain1->QueryInterface(__uuidof(IDXGISwapChain2), (void**)&swapChain);
+	swapChain1->Release();
+	if (FAILED(hr)) {
+		LOG("Failed to get swap chain with frame latency control");
+		return hr; //abort
+	}
+
+	swapChain->SetMaximumFrameLatency(maxFrameLatency);
+	frameLatencyWaitable = swapChain->GetFrameLatencyWaitableObject();
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	qpcFrequency = frequency.QuadPart;
+
+	return InitBackBuffer();
+}
+
+unsigned int Renderer::GetSwapChainFlags() {
+	//ResizeBuffers needs the same flags the swap chain was made with
+	UINT flags = DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+	if (tearingSupported)
+		flags |= DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING;
+	return flags;
+}
+
+long Renderer::InitBackBuffer() {
+	HRESULT hr;
+	ID3D11Texture2D* backBufferTexture = nullptr; //get the address of the back buffer
+	hr = swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&backBufferTexture);
+	if (FAILED(hr)) {
+		LOG("Failed to get back buffer texture");
+		return hr; //abort
+	}
+
+	hr = dev->CreateRenderTargetView(backBufferTexture, NULL, &backBuffer);
+	backBufferTexture->Release();
+	if (FAILED(hr)) {
+		LOG("Failed to create back buffer view");
+		return hr; //abort
+	}
+
+	hr = InitDepthBuffer();
+	if (FAILED(hr)) {
+		LOG("Failed to create depth buffer");
+		return hr; //abort
+	}
+
+	backBufferWidth = GetWidth();
+	backBufferHeight = GetHeight();
+
+	//set the back buffer as the current render target
+	devCon->OMSetRenderTargets(1, &backBuffer, depthBuffer);
+	D3D11_VIEWPORT viewport = MakeViewport(backBufferWidth, backBufferHeight);
+	devCon->RSSetViewports(1, &viewport);
+	return S_OK;
+}
+
+bool Renderer::Resize() {
+	//everything holding the old buffers has to let go before ResizeBuffers. deferred contexts
+	//drop their targets when they finish recording, so only the immediate context still has them
+	devCon->OMSetRenderTargets(0, nullptr, nullptr);
+	if (backBuffer) backBuffer->Release();
+	if (depthBuffer) depthBuffer->Release();
+	backBuffer = nullptr;
+	depthBuffer = nullptr;
+	devCon->Flush();
+
+	HRESULT hr = swapChain->ResizeBuffers(0, GetWidth(), GetHeight(), DXGI_FORMAT_UNKNOWN, GetSwapChainFlags());
+	if (FAILED(hr)) {
+		LOG("Failed to resize swap chain");
+		return false;
+	}
+	if (FAILED(InitBackBuffer())) {
+		LOG("Failed to recreate back and depth buffers after resizing");
+		return false;
+	}
+	return true;
+}
+
+void Renderer::SetMaxFrameLatency(unsigned int frames) {
+	maxFrameLatency = std::max(frames, 1u);
+	if (swapChain)
+		swapChain->SetMaximumFrameLatency(maxFrameLatency);
+}
+
+void Renderer::WaitForFrame() {
+	if (frameWaited || !frameLatencyWaitable)
+		return;
+
+	//blocks until the swap chain has fewer than maxFrameLatency frames queued. capped at a
+	//second so a lost device can't hang us here forever
+	PROFILE_ZONE("Wait for frame");
+	WaitForSingleObjectEx((HANDLE)frameLatencyWaitable, 1000, TRUE);
+	frameWaited = true;
+}
+
+long Renderer::InitDepthBuffer() {
+	HRESULT hr;
+
+	//get swap chain settings and assign to scd
+	DXGI_SWAP_CHAIN_DESC scd = {};
+	swapChain->GetDesc(&scd);
+
+	//z buffer texture description
+	D3D11_TEXTURE2D_DESC tex2dDesc = { 0 };
+	tex2dDesc.Width = GetWidth();
+	tex2dDesc.Height = GetHeight();
+	tex2dDesc.ArraySize = 1;
+	tex2dDesc.MipLevels = 1;
+	tex2dDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+	tex2dDesc.SampleDesc.Count = scd.SampleDesc.Count; //same sample count as swap chin
+	tex2dDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	tex2dDesc.Usage = D3D11_USAGE_DEFAULT;
+
+	//z buffer texture
+	ID3D11Texture2D* zBufferTexture;
+	hr = dev->CreateTexture2D(&tex2dDesc, NULL, &zBufferTexture);
+	if (FAILED(hr)) {
+		LOG("Failed to create z buffer texture");
+		return E_FAIL;
+	}
+
+	//create the depth buffer view
+	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+	ZeroMemory(&dsvDesc, sizeof(D3D11_DEPTH_STENCIL_VIEW_DESC)); //< fill the struct with zeros
+	dsvDesc.Format = tex2dDesc.Format;
+	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	hr = dev->CreateDepthStencilView(zBufferTexture, &dsvDesc, &depthBuffer);
+	if (FAILED(hr)) {
+		LOG("Failed to create depth stencil view");
+		return E_FAIL;
+	}
+	zBufferTexture->Release(); //release zbuffer pointer - we still have depthbuffer, we are only releasing a pointer here
+
+	return S_OK;
+}
+
+long Renderer::InitPipeline() {
+	//every vertex shader gets an input layout for each vertex format meshes can be stored in
+	auto loadVertexShader = [&](const char* filename, ID3D11VertexShader** outVS, ID3D11InputLayout** outLayouts) {
+		ShaderLoading::LoadVertexShader(filename, dev, outVS, &outLayouts[(int)VertexLayout::FULL]);
+		ShaderLoading::LoadInputLayout(filename, dev, VertexLayout::COMPACT, &outLayouts[(int)VertexLayout::COMPACT]);
+		ShaderLoading::LoadInputLayout(filename, dev, VertexLayout::QUANTISED, &outLayouts[(int)VertexLayout::QUANTISED]);
+	};
+	loadVertexShader("Compiled Shaders/VertexShader.cso", &pVS, inputLayouts[0][0]);
+	loadVertexShader("Compiled Shaders/VertexShaderInstanced.cso", &pVSInstanced, inputLayouts[0][1]);
+	loadVertexShader("Compiled Shaders/VertexShaderDepth.cso", &pVSDepth, inputLayouts[1][0]);
+	loadVertexShader("Compiled Shaders/VertexShaderDepthInstanced.cso", &pVSDepthInstanced, inputLayouts[1][1]);
+	ShaderLoading::LoadPixelShader("Compiled Shaders/PixelShader.cso", dev, &pPS);
+
+	//set shader objects as active shaders in the pipeline
+	devCon->VSSetShader(pVS, 0, 0);
+	devCon->PSSetShader(pPS, 0, 0);
+
+	devCon->IASetInputLayout(inputLayouts[0][0][(int)VertexLayout::FULL]);
+
+	return S_OK;
+}
+
+void Renderer::InitGraphics() {
+	states.Init(dev);
+
+	//create the constant buffer
+	D3D11_BUFFER_DESC cbd = { 0 };
+	cbd.Usage = D3D11_USAGE_DEFAULT;
+	cbd.ByteWidth = sizeof(CBuffer_PerObject);
+	cbd.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	if (FAILED(dev->CreateBuffer(&cbd, NULL, &cBuffer_PerObject))) {
+		LOG("Failed to create constant buffer");
+		return;
+	}
+	//cBuffer_PerObject stays as the fallback when this isn't supported
+	constantRing.Init(dev, devCon);
+
+	cbd.ByteWidth = sizeof(CBuffer_PerFrame);
+	if (FAILED(dev->CreateBuffer(&cbd, NULL, &cBuffer_PerFrame))) {
+		LOG("Failed to create per frame constant buffer");
+		return;
+	}
+
+	cbd.ByteWidth = sizeof(CBuffer_PerMaterial);
+	if (FAILED(dev->CreateBuffer(&cbd, NULL, &cBuffer_PerMaterial))) {
+		LOG("Failed to create per material constant buffer");
+		return;
+	}
+
+	//standard alpha blending for transparent objects
+	D3D11_BLEND_DESC bd = { 0 };
+	bd.RenderTarget[0].BlendEnable = TRUE;
+	bd.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+	bd.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	bd.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	bd.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	bd.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	bd.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	bd.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	alphaBlend = states.GetBlend(bd);
+
+	//they still hide behind opaque objects but don't hide each other
+	D3D11_DEPTH_STENCIL_DESC dsd = { 0 };
+	dsd.DepthEnable = TRUE;
+	dsd.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+	dsd.DepthFunc = D3D11_COMPARISON_LESS;
+	depthReadOnly = states.GetDepthStencil(dsd);
+
+	//after the pre-pass the depth buffer already holds the nearest opaque surface, so shading
+	//only has to find it again, and doesn't need to write what's already there
+	dsd.DepthFunc = D3D11_COMPARISON_EQUAL;
+	depthEqual = states.GetDepthStencil(dsd);
+
+	//plain white stand in for textures still loading, so objects show up untextured instead of black
+	placeholderTexture = new Texture(*this);
+	TextureData white;
+	white.width = 1;
+	white.height = 1;
+	white.pixels = { 255, 255, 255, 255 };
+	placeholderTexture->Upload(white);
+
+	if (!gpuProfiler.Init(dev, devCon)) {
+		LOG("Failed to create gpu timing queries, gpu times won't be profiled");
+	}
+
+	devCon->AddRef(); //immediate keeps its own reference, released along with the deferred ones
+	InitSubmitContext(immediate, devCon);
+}
+
+void Renderer::InitSubmitContext(SubmitContext& submit, ID3D11DeviceContext* context) {
+	submit.context = context;
+	//the constant ring binds blocks by offset, which needs the 11.1 interface on every context
+	//it records into. Init already checked the device supports it
+	if (context && constantRing.IsSupported()) {
+		if (FAILED(context->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&submit.context1))) {
+			LOG("Failed to get 11.1 interface for a device context, its draws won't use the constant ring");
+			submit.context1 = nullptr;
+		}
+	}
+}
+
+void Renderer::ReleaseSubmitContext(SubmitContext& submit) {
+	if (submit.commandList) submit.commandList->Release();
+	if (submit.context1) submit.context1->Release();
+	if (submit.context) submit.context->Release();
+	submit.commandList = nullptr;
+	submit.context1 = nullptr;
+	submit.context = nullptr;
+}
+
+bool Renderer::UpdateInstanceBuffer() {
+	if (!dev)
+		return true; //headless, instanceData is all there is
+	if (instanceData.size() > instanceCapacity) {
+		if (instanceBuffer) instanceBuffer->Release();
+		instanceBuffer = nullptr;
+		instanceCapacity = std::max(instanceData.size(), instanceCapacity * 2);
+
+		D3D11_BUFFER_DESC ibd = { 0 };
+		ibd.Usage = D3D11_USAGE_DYNAMIC; //rewritten by the cpu every frame
+		ibd.ByteWidth = (unsigned int)(instanceCapacity * sizeof(CBuffer_PerObject));
+		ibd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		if (FAILED(dev->CreateBuffer(&ibd, NULL, &instanceBuffer))) {
+			LOG("Failed to create instance buffer");
+			instanceCapacity = 0;
+			return false;
+		}
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (FAILED(devCon->Map(instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped))) {
+		LOG("Failed to map instance buffer");
+		return false;
+	}
+	memcpy(mapped.pData, instanceData.data(), instanceData.size() * sizeof(CBuffer_PerObject));
+	devCon->Unmap(instanceBuffer, 0);
+	return true;
+}
+
+int Renderer::GetWidth() {
+	return window ? window->GetWidth() : headlessWidth;
+}
+
+int Renderer::GetHeight() {
+	return window ? window->GetHeight() : headlessHeight;
+}
+
+void Renderer::MeasureDisplayLatency() {
+	//when a present actually reached the screen only comes back a frame or two later, so keep
+	//the input time of the last few presents to match it up with
+	if (!swapChain)
+		return;
+	UINT presentCount = 0;
+	if (SUCCEEDED(swapChain->GetLastPresentCount(&presentCount))) {
+		presentInputTimes[presentCount % presentHistory] = PresentInput{ presentCount, inputTime };
+	}
+	DXGI_FRAME_STATISTICS statistics;
+	if (SUCCEEDED(swapChain->GetFrameStatistics(&statistics))) {
+		const PresentInput& shown = presentInputTimes[statistics.PresentCount % presentHistory];
+		//the sync time is in QueryPerformanceCounter ticks, so it's turned into how long ago it
+		//was and taken off how long ago the input was
+		LARGE_INTEGER now;
+		QueryPerformanceCounter(&now);
+		double sinceSyncMs = (now.QuadPart - statistics.SyncQPCTime.QuadPart) * 1000.0 / qpcFrequency;
+		double sinceInputMs = ((int64_t)Profiler::Now() - shown.inputTime) / 1e6;
+		if (shown.presentCount == statistics.PresentCount && sinceInputMs > sinceSyncMs)
+			inputToDisplayMs = (float)(sinceInputMs - sinceSyncMs);
+	}
+}
+
+void Renderer::ClearTargets(const float colour[4]) {
+	devCon->ClearRenderTargetView(backBuffer, colour);
+	devCon->ClearDepthStencilView(depthBuffer, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+}
+
+void Renderer::UpdatePerFrame(const CBuffer_PerFrame& perFrame) {
+	devCon->UpdateSubresource(cBuffer_PerFrame, NULL, NULL, &perFrame, NULL, NULL);
+}
+
+void Renderer::Present() {
+	if (readBackNextFrame) {
+		readBackNextFrame = false;
+		ReadBackBuffer();
+	}
+	//flip model without vsync, tearing makes it show straight away instead of at the next
+	//compositor refresh
+	UINT presentFlags = (!vsync && tearingSupported) ? DXGI_PRESENT_ALLOW_TEARING : 0;
+	swapChain->Present(vsync ? 1 : 0, presentFlags);
+}
+
+void Renderer::ReadBackBuffer() {
+	readBackFrame.clear();
+	ID3D11Texture2D* backBufferTexture = nullptr; //buffer 0 is always the one being drawn to
+	if (FAILED(swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), (LPVOID*)&backBufferTexture))) {
+		LOG("Failed to get back buffer texture to read back");
+		return;
+	}
+	D3D11_TEXTURE2D_DESC desc;
+	backBufferTexture->GetDesc(&desc);
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.BindFlags = 0;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	desc.MiscFlags = 0;
+	ID3D11Texture2D* staging = nullptr;
+	if (FAILED(dev->CreateTexture2D(&desc, NULL, &staging))) {
+		LOG("Failed to create back buffer staging texture");
+		backBufferTexture->Release();
+		return;
+	}
+	devCon->CopyResource(staging, backBufferTexture);
+	backBufferTexture->Release();
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (SUCCEEDED(devCon->Map(staging, 0, D3D11_MAP_READ, 0, &mapped))) {
+		//rows are padded out to RowPitch
+		readBackFrame.resize((size_t)desc.Width * desc.Height);
+		for (UINT y = 0; y < desc.Height; y++) {
+			memcpy(&readBackFrame[(size_t)y * desc.Width], (const char*)mapped.pData + (size_t)y * mapped.RowPitch, desc.Width * sizeof(uint32_t));
+		}
+		devCon->Unmap(staging, 0);
+	} else {
+		LOG("Failed to map back buffer staging texture");
+	}
+	staging->Release();
+}
+
+bool Renderer::CreateDeferredContext(ID3D11DeviceContext** context) {
+	return SUCCEEDED(dev->CreateDeferredContext(0, context));
+}
+
+void Renderer::FinishCommandList(SubmitContext& submit) {
+	//false leaves the deferred context cleared for next frame, and the immediate one is
+	//cleared after each list anyway
+	if (FAILED(submit.context->FinishCommandList(FALSE, &submit.commandList))) {
+		submit.commandList = nullptr;
+	}
+}
+
+bool Renderer::ExecuteCommandList(SubmitContext& submit) {
+	if (!submit.commandList)
+		return false;
+	devCon->ExecuteCommandList(submit.commandList, FALSE);
+	immediate.states.Reset();
+	submit.commandList->Release();
+	submit.commandList = nullptr;
+	return true;
+}
+
+void Renderer::SetContextFrameState(SubmitContext& submit, bool instancesReady, bool depthOnly) {
+	ID3D11DeviceContext* context = submit.context;
+	D3D11_VIEWPORT viewport = MakeViewport(backBufferWidth, backBufferHeight);
+	context->OMSetRenderTargets(1, &backBuffer, depthBuffer);
+	context->RSSetViewports(1, &viewport);
+	context->PSSetShader(depthOnly ? nullptr : pPS, 0, 0); //no pixel shader at all, depth is written straight from the rasteriser
+
+	//view and projection go up once for the whole frame, objects only send their own world
+	context->VSSetConstantBuffers(0, 1, &cBuffer_PerFrame);
+	context->PSSetConstantBuffers(1, 1, &cBuffer_PerMaterial);
+	context->VSSetConstantBuffers(2, 1, &cBuffer_PerObject); //the ring rebinds this slot per draw when it's in use
+
+	//every mesh is a triangle list, and the pool binds its buffers lazily from here on
+	context->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	if (instancesReady) {
+		UINT stride = sizeof(CBuffer_PerObject);
+		UINT offset = 0;
+		context->IASetVertexBuffers(1, 1, &instanceBuffer, &stride, &offset);
+	}
+}
+
+void Renderer::SetContextTexture(SubmitContext& submit, Texture* texture) {
+	auto t = texture->GetTexture();
+	submit.context->PSSetShaderResources(0, 1, &t);
+}
+
+void Renderer::SetContextMaterial(SubmitContext& submit, const CBuffer_PerMaterial& perMaterial) {
+	//fine from a deferred context too, the update plays back in order with its draws
+	submit.context->UpdateSubresource(cBuffer_PerMaterial, NULL, NULL, &perMaterial, NULL, NULL);
+}
+
+void Renderer::SetContextShader(SubmitContext& submit, bool instanced) {
+	if (submit.depthOnly)
+		submit.context->VSSetShader(instanced ? pVSDepthInstanced : pVSDepth, 0, 0);
+	else
+		submit.context->VSSetShader(instanced ? pVSInstanced : pVS, 0, 0);
+}
+
+void Renderer::SetContextObject(SubmitContext& submit, uint32_t constants) {
+	submit.context->UpdateSubresource(cBuffer_PerObject, NULL, NULL, &objectConstants[constants], NULL, NULL);
+}
+
+void Renderer::ReleaseDevice() {
+	if (instanceBuffer) instanceBuffer->Release();
+	if (cBuffer_PerMaterial) cBuffer_PerMaterial->Release();
+	if (cBuffer_PerFrame) cBuffer_PerFrame->Release();
+	if (cBuffer_PerObject) cBuffer_PerObject->Release();
+	for (auto& shaderLayouts : inputLayouts) {
+		for (auto& layouts : shaderLayouts) {
+			for (ID3D11InputLayout* layout : layouts) {
+				if (layout) layout->Release();
+			}
+		}
+	}
+	if (pVSDepthInstanced) pVSDepthInstanced->Release();
+	if (pVSDepth) pVSDepth->Release();
+	if (pVSInstanced) pVSInstanced->Release();
+	if (iBuffer) iBuffer->Release();
+	if (vBuffer) vBuffer->Release();
+	if (depthBuffer) depthBuffer->Release();
+	if (backBuffer) backBuffer->Release();
+	if (frameLatencyWaitable) CloseHandle((HANDLE)frameLatencyWaitable);
+	frameLatencyWaitable = nullptr;
+	if (swapChain) swapChain->Release();
+	if (dev) dev->Release();
+	if (devCon) devCon->Release();
+}
+
+#else
+
+//headless only, there's never a device, swap chain or window for any of this to touch
+
+int Renderer::GetWidth() {
+	return headlessWidth;
+}
+
+int Renderer::GetHeight() {
+	return headlessHeight;
+}
+
+void Renderer::SetMaxFrameLatency(unsigned int frames) {
+	maxFrameLatency = std::max(frames, 1u);
+}
+
+void Renderer::WaitForFrame() {}
+bool Renderer::Resize() { return true; }
+void Renderer::MeasureDisplayLatency() {}
+void Renderer::ClearTargets(const float[4]) {}
+void Renderer::UpdatePerFrame(const CBuffer_PerFrame&) {}
+void Renderer::Present() {
+	readBackNextFrame = false; //nothing to read, readBackFrame stays empty
+}
+void Renderer::ReadBackBuffer() {}
+void Renderer::ReleaseDevice() {}
+
+bool Renderer::UpdateInstanceBuffer() {
+	return true; //instanceData is all there is
+}
+
+void Renderer::InitSubmitContext(SubmitContext& submit, ID3D11DeviceContext* context) {
+	submit.context = context;
+}
+
+void Renderer::ReleaseSubmitContext(SubmitContext& submit) {
+	submit.commandList = nullptr;
+	submit.context1 = nullptr;
+	submit.context = nullptr;
+}
+
+bool Renderer::CreateDeferredContext(ID3D11DeviceContext** context) {
+	*context = nullptr;
+	return false;
+}
+
+void Renderer::FinishCommandList(SubmitContext&) {}
+bool Renderer::ExecuteCommandList(SubmitContext&) { return false; }
+void Renderer::SetContextFrameState(SubmitContext&, bool, bool) {}
+void Renderer::SetContextTexture(SubmitContext&, Texture*) {}
+void Renderer::SetContextMaterial(SubmitContext&, const CBuffer_PerMaterial&) {}
+void Renderer::SetContextShader(SubmitContext&, bool) {}
+void Renderer::SetContextObject(SubmitContext&, uint32_t) {}
+
+#endif
\ No newline at end of file
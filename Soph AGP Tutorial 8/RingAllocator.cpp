@@ -0,0 +1,32 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(unsigned int capacity)
+	: capacity(capacity - capacity % alignment) {
+
+}
+
+bool RingAllocator::Allocate(unsigned int size, Span& outSpan) {
+	size = Align(size);
+	if (size == 0 || size > capacity)
+		return false;
+
+	outSpan.discard = fresh;
+	if (head + size > capacity) {
+		//not enough left before the end, start again from the front of a renamed buffer
+		head = 0;
+		outSpan.discard = true;
+		wraps++;
+	}
+
+	outSpan.offset = head;
+	outSpan.size = size;
+	head += size;
+	fresh = false;
+	return true;
+}
+
+void RingAllocator::Reset(unsigned int newCapacity) {
+	capacity = newCapacity - newCapacity % alignment;
+	head = 0;
+	fresh = true;
+}
\ No newline at end of file
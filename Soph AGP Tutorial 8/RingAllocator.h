@@ -0,0 +1,38 @@
+#pragma once
+
+//hands out space in a buffer that gets refilled a piece at a time, wrapping back to the start
+//once it runs out. only bookkeeping, the ConstantBufferRing does the d3d side, so this can be
+//tried out without a gpu
+class RingAllocator
+{
+private:
+	unsigned int capacity = 0;
+	unsigned int head = 0; //where the next allocation starts
+	bool fresh = true; //nothing handed out since the last reset
+	unsigned int wraps = 0;
+
+public:
+	//constant buffer offsets have to be whole multiples of 16 constants, 256 bytes
+	static const unsigned int alignment = 256;
+	static unsigned int Align(unsigned int size) { return (size + alignment - 1) & ~(alignment - 1); }
+
+	struct Span
+	{
+		unsigned int offset = 0;
+		unsigned int size = 0;
+		//set when the ring went back to the start, so anything written earlier might still be
+		//read by the gpu. map with WRITE_DISCARD for these and WRITE_NO_OVERWRITE otherwise
+		bool discard = false;
+	};
+
+	RingAllocator(unsigned int capacity = 0);
+
+	//size is rounded up to the alignment. false when it wouldn't fit even in an empty ring
+	bool Allocate(unsigned int size, Span& outSpan);
+	//forgets everything handed out, the next allocation discards
+	void Reset(unsigned int newCapacity);
+
+	unsigned int GetCapacity() { return capacity; }
+	unsigned int GetHead() { return head; }
+	unsigned int GetWrapCount() { return wraps; }
+};
\ No newline at end of file
@@ -8,8 +8,32 @@
 
 namespace ShaderLoading {
 
+	//packed layouts store some elements in smaller formats, the shader still sees floats
+	DXGI_FORMAT PackedElementFormat(std::string semantic, VertexLayout layout, DXGI_FORMAT reflected) {
+		if (layout == VertexLayout::FULL)
+			return reflected;
+
+		if (semantic == "POSITION" && layout == VertexLayout::QUANTISED)
+			return DXGI_FORMAT_R16G16B16A16_SNORM;
+		if (semantic == "TEXCOORD")
+			return DXGI_FORMAT_R16G16_FLOAT;
+		if (semantic == "NORMAL")
+			return DXGI_FORMAT_R16G16_SNORM; //octahedral, two components
+		return reflected;
+	}
+
+	//elements named INSTANCE_something come from the instance buffer in slot 1, a step per instance
+	bool IsPerInstanceElement(std::string semantic) {
+		return semantic.rfind("INSTANCE_", 0) == 0;
+	}
+
+	//the geometry pool keeps positions in slot 0 and every other vertex element in slot 2
+	UINT VertexElementSlot(std::string semantic) {
+		return semantic == "POSITION" ? 0 : 2;
+	}
+
 	int ReflectVShaderInputLayout(std::vector<uint8_t>& vShaderBytecode,
-		ID3D11Device* dev, ID3D11InputLayout** outIL) {
+		ID3D11Device* dev, ID3D11InputLayout** outIL, VertexLayout layout = VertexLayout::FULL) {
 
 		HRESULT hr;
 
@@ -59,10 +83,20 @@ namespace ShaderLoading {
 				}
 			}
 
-			ied[i].InputSlot = 0;
+			ied[i].Format = PackedElementFormat(ied[i].SemanticName, layout, ied[i].Format);
+
+			//appended offsets are counted per slot, so instance elements pack from 0 in their own buffer
 			ied[i].AlignedByteOffset = D3D11_APPEND_ALIGNED_ELEMENT;
-			ied[i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-			ied[i].InstanceDataStepRate = 0;
+			if (IsPerInstanceElement(ied[i].SemanticName)) {
+				ied[i].InputSlot = 1;
+				ied[i].InputSlotClass = D3D11_INPUT_PER_INSTANCE_DATA;
+				ied[i].InstanceDataStepRate = 1;
+			}
+			else {
+				ied[i].InputSlot = VertexElementSlot(ied[i].SemanticName);
+				ied[i].InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
+				ied[i].InstanceDataStepRate = 0;
+			}
 		}
 
 		hr = dev->CreateInputLayout(ied, desc.InputParameters, vShaderBytecode.data(), vShaderBytecode.size(), outIL);
@@ -99,6 +133,19 @@ namespace ShaderLoading {
 		return S_OK;
 	}
 
+	long LoadInputLayout(std::string filename, ID3D11Device* dev,
+		VertexLayout layout, ID3D11InputLayout** outIL) {
+
+		auto shaderBytecode = DX::ReadData(std::wstring(filename.begin(), filename.end()).c_str());
+		HRESULT hr = ReflectVShaderInputLayout(shaderBytecode, dev, outIL, layout);
+		if (FAILED(hr)) {
+			LOG("Failed to reflect vertex shader" + filename + ".");
+			return hr;
+		}
+
+		return S_OK;
+	}
+
 	long LoadPixelShader(std::string filename, ID3D11Device* dev, 
 		ID3D11PixelShader** outPS) {
 
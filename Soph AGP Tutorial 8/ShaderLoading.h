@@ -2,6 +2,8 @@
 
 #include <string>
 
+#include "VertexFormats.h"
+
 struct ID3D11VertexShader;
 struct ID3D11PixelShader;
 struct ID3D11InputLayout;
@@ -10,6 +12,9 @@ struct ID3D11Device;
 namespace ShaderLoading {
 	long LoadVertexShader(std::string filename, ID3D11Device* dev, 
 		ID3D11VertexShader** outVS, ID3D11InputLayout** outIL);
+	//builds another input layout for the same shader, for meshes stored in a packed vertex layout
+	long LoadInputLayout(std::string filename, ID3D11Device* dev,
+		VertexLayout layout, ID3D11InputLayout** outIL);
 	long LoadPixelShader(std::string filename, ID3D11Device* dev, 
 		ID3D11PixelShader** outPS);
 }
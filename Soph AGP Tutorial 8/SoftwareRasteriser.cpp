@@ -0,0 +1,339 @@
+#include "SoftwareRasteriser.h"
+#include "ModelLoader.h"
+#include "Texture.h"
+#include "DrawChunks.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+static uint32_t PackColour(XMVECTOR colour) {
+	XMFLOAT4 c;
+	XMStoreFloat4(&c, XMVectorMultiplyAdd(XMVectorSaturate(colour), XMVectorReplicate(255.0f), XMVectorReplicate(0.5f)));
+	return (uint32_t)c.x | ((uint32_t)c.y << 8) | ((uint32_t)c.z << 16) | ((uint32_t)c.w << 24);
+}
+
+static XMVECTOR UnpackColour(uint32_t colour) {
+	return XMVectorScale(XMVectorSet((float)(colour & 0xFF), (float)((colour >> 8) & 0xFF),
+		(float)((colour >> 16) & 0xFF), (float)(colour >> 24)), 1.0f / 255.0f);
+}
+
+SoftwareRasteriser::SoftwareRasteriser(int width, int height) {
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+	Resize(width, height);
+}
+
+void SoftwareRasteriser::Resize(int newWidth, int newHeight) {
+	newWidth = std::max(newWidth, 1);
+	newHeight = std::max(newHeight, 1);
+	if (newWidth == width && newHeight == height)
+		return;
+
+	width = newWidth;
+	height = newHeight;
+	stride = (width + 3) & ~3;
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	colour.assign((size_t)stride * height, clearColour);
+	depth.assign((size_t)stride * height, 1.0f);
+	bins.resize((size_t)tilesX * tilesY);
+	tilePixels.resize(bins.size());
+}
+
+void SoftwareRasteriser::Begin(FXMMATRIX inViewProjection, XMFLOAT4 inClearColour) {
+	XMStoreFloat4x4(&viewProjection, inViewProjection);
+	clearColour = PackColour(XMLoadFloat4(&inClearColour));
+	std::fill(colour.begin(), colour.end(), clearColour);
+	std::fill(depth.begin(), depth.end(), 1.0f);
+	draws.clear();
+	triangles.clear();
+	for (auto& bin : bins) {
+		bin.clear();
+	}
+	stats = SoftwareRasteriserStats();
+}
+
+void SoftwareRasteriser::Draw(const VertexPosUVNorm* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+	FXMMATRIX world, const TextureData* texture, XMFLOAT4 drawColour, bool transparent) {
+	if (texture && (texture->width == 0 || texture->height == 0))
+		texture = nullptr; //failed to decode, the renderer draws these untextured too
+	uint32_t draw = (uint32_t)draws.size();
+	draws.push_back({ texture, drawColour, transparent });
+	stats.draws++;
+
+	//vertices are transformed the first time an index reaches them. the stamp marks which
+	//scratch entries are this draw's, so nothing has to be cleared between draws
+	XMMATRIX toClip = world * XMLoadFloat4x4(&viewProjection);
+	if (clipScratch.size() < vertexCount) {
+		clipScratch.resize(vertexCount);
+		clipStamps.resize(vertexCount, 0);
+	}
+	if (++clipStamp == 0) {
+		std::fill(clipStamps.begin(), clipStamps.end(), 0);
+		clipStamp = 1;
+	}
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		ClipVertex corners[3];
+		for (int c = 0; c < 3; c++) {
+			unsigned int v = indices[i + c];
+			if (clipStamps[v] != clipStamp) {
+				XMStoreFloat4(&clipScratch[v], XMVector3Transform(XMLoadFloat3(&vertices[v].pos), toClip));
+				clipStamps[v] = clipStamp;
+			}
+			corners[c] = { clipScratch[v], vertices[v].uv };
+		}
+		AddTriangle(corners[0], corners[1], corners[2], draw);
+		stats.trianglesSubmitted++;
+	}
+}
+
+void SoftwareRasteriser::AddTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, uint32_t draw) {
+	//all three outside the same plane, none of it can be on screen
+	auto allOutside = [&](auto outside) { return outside(v0.position) && outside(v1.position) && outside(v2.position); };
+	if (allOutside([](const XMFLOAT4& v) { return v.x < -v.w; }) || allOutside([](const XMFLOAT4& v) { return v.x > v.w; })
+		|| allOutside([](const XMFLOAT4& v) { return v.y < -v.w; }) || allOutside([](const XMFLOAT4& v) { return v.y > v.w; })
+		|| allOutside([](const XMFLOAT4& v) { return v.z < 0; }) || allOutside([](const XMFLOAT4& v) { return v.z > v.w; }))
+		return;
+
+	if (v0.position.z >= 0 && v1.position.z >= 0 && v2.position.z >= 0) {
+		ClipVertex clip[3] = { v0, v1, v2 };
+		SetupTriangle(clip, draw);
+		return;
+	}
+
+	//crosses the near plane, cut it off there before dividing by w. uvs are cut at the same
+	//point, clip space is still linear so that's exact
+	const ClipVertex* corners[3] = { &v0, &v1, &v2 };
+	ClipVertex polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++) {
+		const ClipVertex& a = *corners[i];
+		const ClipVertex& b = *corners[(i + 1) % 3];
+		if (a.position.z >= 0)
+			polygon[count++] = a;
+		if ((a.position.z >= 0) != (b.position.z >= 0)) {
+			float t = a.position.z / (a.position.z - b.position.z);
+			XMStoreFloat4(&polygon[count].position, XMVectorLerp(XMLoadFloat4(&a.position), XMLoadFloat4(&b.position), t));
+			XMStoreFloat2(&polygon[count].uv, XMVectorLerp(XMLoadFloat2(&a.uv), XMLoadFloat2(&b.uv), t));
+			count++;
+		}
+	}
+	for (int i = 1; i + 1 < count; i++) {
+		ClipVertex clip[3] = { polygon[0], polygon[i], polygon[i + 1] };
+		SetupTriangle(clip, draw);
+	}
+}
+
+void SoftwareRasteriser::SetupTriangle(const ClipVertex* clip, uint32_t draw) {
+	//pixels with y pointing down, pixel i's centre at i + 0.5
+	float x[3], y[3], values[4][3];
+	for (int i = 0; i < 3; i++) {
+		float invW = 1.0f / clip[i].position.w;
+		x[i] = (clip[i].position.x * invW * 0.5f + 0.5f) * width;
+		y[i] = (0.5f - clip[i].position.y * invW * 0.5f) * height;
+		values[0][i] = clip[i].position.z * invW;
+		values[1][i] = invW;
+		values[2][i] = clip[i].uv.x * invW;
+		values[3][i] = clip[i].uv.y * invW;
+	}
+
+	//d3d's default rasteriser state culls counter clockwise triangles, which come out negative here
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0))
+		return;
+
+	Triangle triangle;
+	float minX = std::min(x[0], std::min(x[1], x[2])), maxX = std::max(x[0], std::max(x[1], x[2]));
+	float minY = std::min(y[0], std::min(y[1], y[2])), maxY = std::max(y[0], std::max(y[1], y[2]));
+	triangle.minX = (int)std::max(std::ceil(minX - 0.5f), 0.0f);
+	triangle.maxX = (int)std::min(std::floor(maxX - 0.5f), (float)(width - 1));
+	triangle.minY = (int)std::max(std::ceil(minY - 0.5f), 0.0f);
+	triangle.maxY = (int)std::min(std::floor(maxY - 0.5f), (float)(height - 1));
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+		return; //too small to cover any pixel centre
+
+	//edge i runs from corner i to the next, positive on the inside. a pixel centre exactly on an
+	//edge belongs to the triangle only if it's a top or left edge, so triangles sharing an edge
+	//never both draw a pixel. with y down and clockwise winding those are the edges going up, or
+	//flat ones going right
+	for (int i = 0; i < 3; i++) {
+		int next = (i + 1) % 3;
+		triangle.edgeA[i] = y[i] - y[next];
+		triangle.edgeB[i] = x[next] - x[i];
+		triangle.edgeC[i] = -(triangle.edgeA[i] * x[i] + triangle.edgeB[i] * y[i]);
+		triangle.topLeft[i] = triangle.edgeA[i] > 0 || (triangle.edgeA[i] == 0 && triangle.edgeB[i] > 0);
+	}
+
+	//everything divided by w is linear across the screen
+	float dx1 = x[1] - x[0], dy1 = y[1] - y[0];
+	float dx2 = x[2] - x[0], dy2 = y[2] - y[0];
+	for (int p = 0; p < 4; p++) {
+		float d1 = values[p][1] - values[p][0], d2 = values[p][2] - values[p][0];
+		float a = (d1 * dy2 - d2 * dy1) / area;
+		float b = (dx1 * d2 - dx2 * d1) / area;
+		triangle.planes[p][0] = a;
+		triangle.planes[p][1] = b;
+		triangle.planes[p][2] = values[p][0] - a * x[0] - b * y[0];
+	}
+	triangle.draw = draw;
+
+	uint32_t index = (uint32_t)triangles.size();
+	triangles.push_back(triangle);
+	for (int tileY = triangle.minY / tileSize; tileY <= triangle.maxY / tileSize; tileY++) {
+		for (int tileX = triangle.minX / tileSize; tileX <= triangle.maxX / tileSize; tileX++) {
+			bins[(size_t)tileY * tilesX + tileX].push_back(index);
+			stats.binEntries++;
+		}
+	}
+	stats.trianglesRasterised++;
+}
+
+void SoftwareRasteriser::RasteriseTile(size_t tile) {
+	int tileX0 = (int)(tile % tilesX) * tileSize, tileY0 = (int)(tile / tilesX) * tileSize;
+	int tileX1 = std::min(tileX0 + tileSize, width) - 1, tileY1 = std::min(tileY0 + tileSize, height) - 1;
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR pixelOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	std::vector<std::pair<uint32_t, uint32_t>>& runs = tilePixels[tile];
+	uint32_t shaded = 0;
+
+	for (uint32_t index : bins[tile]) {
+		const Triangle& triangle = triangles[index];
+		//a bin is in submission order, so each draw's triangles are next to each other
+		if (!runs.empty() && runs.back().first != triangle.draw) {
+			runs.back().second = shaded;
+			shaded = 0;
+		}
+		if (runs.empty() || runs.back().first != triangle.draw)
+			runs.emplace_back(triangle.draw, 0);
+		const DrawState& draw = draws[triangle.draw];
+		const XMVECTOR drawColour = XMLoadFloat4(&draw.colour);
+		//tiles start on a multiple of 4, so blocks never cross into the next one
+		int startX = std::max(triangle.minX, tileX0) & ~3;
+		int endX = std::min(triangle.maxX, tileX1);
+		XMVECTOR columnLimit = XMVectorReplicate((float)endX + 1.0f); //centres past this are the next tile's
+
+		int endY = std::min(triangle.maxY, tileY1);
+		for (int y = std::max(triangle.minY, tileY0); y <= endY; y++) {
+			float centreY = y + 0.5f;
+			XMVECTOR edgeRow[3], planeRow[4];
+			for (int e = 0; e < 3; e++) {
+				edgeRow[e] = XMVectorReplicate(triangle.edgeB[e] * centreY + triangle.edgeC[e]);
+			}
+			for (int p = 0; p < 4; p++) {
+				planeRow[p] = XMVectorReplicate(triangle.planes[p][1] * centreY + triangle.planes[p][2]);
+			}
+
+			uint32_t* colourRow = colour.data() + (size_t)y * stride;
+			float* depthRow = depth.data() + (size_t)y * stride;
+			for (int x = startX; x <= endX; x += 4) {
+				//each block works from the row's start rather than stepping from the last, so a
+				//pixel comes out the same whichever tile or block it's drawn in
+				XMVECTOR blockX = XMVectorAdd(XMVectorReplicate((float)x), pixelOffsets);
+				XMVECTOR inside = XMVectorLess(blockX, columnLimit);
+				for (int e = 0; e < 3; e++) {
+					XMVECTOR edge = XMVectorMultiplyAdd(XMVectorReplicate(triangle.edgeA[e]), blockX, edgeRow[e]);
+					inside = XMVectorAndInt(inside, triangle.topLeft[e] ? XMVectorGreaterOrEqual(edge, zero) : XMVectorGreater(edge, zero));
+				}
+
+				XMVECTOR z = XMVectorMultiplyAdd(XMVectorReplicate(triangle.planes[0][0]), blockX, planeRow[0]);
+				XMFLOAT4* depthBlock = reinterpret_cast<XMFLOAT4*>(depthRow + x);
+				XMVECTOR oldDepth = XMLoadFloat4(depthBlock);
+				XMVECTOR pass = XMVectorAndInt(inside, XMVectorLess(z, oldDepth));
+				uint32_t lanes[4];
+				XMStoreInt4(lanes, pass);
+				if (!(lanes[0] | lanes[1] | lanes[2] | lanes[3]))
+					continue;
+				if (!draw.transparent)
+					XMStoreFloat4(depthBlock, XMVectorSelect(oldDepth, z, pass));
+
+				//u / w and v / w over 1 / w undoes the divide, giving uvs that are right in perspective
+				XMVECTOR invW = XMVectorMultiplyAdd(XMVectorReplicate(triangle.planes[1][0]), blockX, planeRow[1]);
+				XMFLOAT4 u, v;
+				XMStoreFloat4(&u, XMVectorDivide(XMVectorMultiplyAdd(XMVectorReplicate(triangle.planes[2][0]), blockX, planeRow[2]), invW));
+				XMStoreFloat4(&v, XMVectorDivide(XMVectorMultiplyAdd(XMVectorReplicate(triangle.planes[3][0]), blockX, planeRow[3]), invW));
+				const float us[4] = { u.x, u.y, u.z, u.w }, vs[4] = { v.x, v.y, v.z, v.w };
+
+				for (int i = 0; i < 4; i++) {
+					if (!lanes[i])
+						continue;
+					XMVECTOR pixel = drawColour;
+					if (draw.texture) {
+						//point sampling with wrap, the texel whose square the uv falls in
+						const TextureData& texture = *draw.texture;
+						unsigned int tx = std::min((unsigned int)((us[i] - std::floor(us[i])) * texture.width), texture.width - 1);
+						unsigned int ty = std::min((unsigned int)((vs[i] - std::floor(vs[i])) * texture.height), texture.height - 1);
+						uint32_t texel;
+						memcpy(&texel, &texture.pixels[((size_t)ty * texture.width + tx) * 4], sizeof(texel));
+						pixel = XMVectorMultiply(pixel, UnpackColour(texel));
+					}
+					if (draw.transparent) {
+						//the renderer's alpha blend: src alpha over inverse src alpha for colour, one
+						//over inverse src alpha for alpha
+						XMVECTOR alpha = XMVectorSplatW(pixel);
+						pixel = XMVectorMultiplyAdd(UnpackColour(colourRow[x + i]), XMVectorSubtract(XMVectorSplatOne(), alpha),
+							XMVectorMultiply(pixel, XMVectorSetW(alpha, 1.0f)));
+					}
+					colourRow[x + i] = PackColour(pixel);
+					shaded++;
+				}
+			}
+		}
+	}
+	if (!runs.empty())
+		runs.back().second = shaded;
+}
+
+void SoftwareRasteriser::Finish(ThreadPool& pool, unsigned int maxThreads) {
+	//tiles own separate pixels, so threads never write the same one
+	for (auto& runs : tilePixels) {
+		runs.clear();
+	}
+	if (!triangles.empty())
+		DrawChunks::Record(pool, bins.size(), maxThreads, [this](size_t tile) { RasteriseTile(tile); });
+	for (auto& runs : tilePixels) {
+		for (auto& run : runs) {
+			draws[run.first].pixelsShaded += run.second;
+			stats.pixelsShaded += run.second;
+		}
+	}
+
+	//shaded now, the next Finish starts from whatever is drawn after this
+	triangles.clear();
+	for (auto& bin : bins) {
+		bin.clear();
+	}
+}
+
+bool SoftwareRasteriser::WriteTga(const std::string& path) {
+	std::ofstream file{ path, std::ios::out | std::ios::binary | std::ios::trunc };
+	if (!file)
+		return false;
+
+	//uncompressed true colour, 8 bits of alpha, rows stored top first
+	uint8_t header[18] = {};
+	header[2] = 2;
+	header[12] = (uint8_t)(width & 0xFF);
+	header[13] = (uint8_t)(width >> 8);
+	header[14] = (uint8_t)(height & 0xFF);
+	header[15] = (uint8_t)(height >> 8);
+	header[16] = 32;
+	header[17] = 0x28;
+	file.write((const char*)header, sizeof(header));
+
+	std::vector<uint8_t> row((size_t)width * 4);
+	for (int y = 0; y < height; y++) {
+		const uint32_t* pixels = colour.data() + (size_t)y * stride;
+		for (int x = 0; x < width; x++) {
+			//tga wants bgra
+			row[x * 4 + 0] = (uint8_t)(pixels[x] >> 16);
+			row[x * 4 + 1] = (uint8_t)(pixels[x] >> 8);
+			row[x * 4 + 2] = (uint8_t)pixels[x];
+			row[x * 4 + 3] = (uint8_t)(pixels[x] >> 24);
+		}
+		file.write((const char*)row.data(), row.size());
+	}
+	return (bool)file;
+}
\ No newline at end of file
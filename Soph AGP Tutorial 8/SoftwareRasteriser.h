@@ -0,0 +1,115 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <DirectXMath.h>
+
+struct VertexPosUVNorm;
+struct TextureData;
+class ThreadPool;
+
+struct SoftwareRasteriserStats
+{
+	size_t draws = 0;
+	size_t trianglesSubmitted = 0;
+	size_t trianglesRasterised = 0; //what was left after near clipping, backface and off screen rejection
+	size_t binEntries = 0; //triangle and tile pairs, more than trianglesRasterised when they span tiles
+	size_t pixelsShaded = 0; //passed the depth test and were written
+};
+
+//draws meshes into a colour and depth image on the cpu, for checking rendering against golden
+//images and timing frames on machines without a gpu. it follows what the gpu does with the
+//renderer's shaders and states: clockwise triangles only, top left fill rule, depth less, and
+//colour = material colour * texture with point sampling and wrapping. it always samples the
+//top mip, so minified textures alias where the gpu would pick a smaller mip. no d3d in here
+class SoftwareRasteriser
+{
+public:
+	//pixels along each side of a tile. triangles are binned by which tiles they touch, and each
+	//tile is drawn by one thread, in the order its triangles were submitted
+	static const int tileSize = 32;
+
+private:
+	//per draw state the triangles point back at
+	struct DrawState
+	{
+		const TextureData* texture;
+		DirectX::XMFLOAT4 colour;
+		bool transparent;
+		size_t pixelsShaded = 0;
+	};
+
+	//a triangle after clipping and projection, as edge functions and attribute planes in pixels
+	struct Triangle
+	{
+		float edgeA[3], edgeB[3], edgeC[3]; //inside where a * x + b * y + c >= 0 (> 0 off top left edges)
+		bool topLeft[3];
+		//value = a * x + b * y + c for depth, 1 / w, u / w and v / w. the last three give
+		//perspective correct uvs
+		float planes[4][3];
+		int minX, maxX, minY, maxY; //pixels whose centres might be inside, clamped to the image
+		uint32_t draw;
+	};
+
+	int width = 0;
+	int height = 0;
+	int stride = 0; //pixels per row, width rounded up to a multiple of 4 so rows are whole blocks
+	int tilesX = 0;
+	int tilesY = 0;
+	std::vector<uint32_t> colour; //rgba8, red in the lowest byte, the renderer's back buffer format
+	std::vector<float> depth;
+	uint32_t clearColour = 0;
+
+	DirectX::XMFLOAT4X4 viewProjection;
+	std::vector<DrawState> draws;
+	std::vector<Triangle> triangles;
+	std::vector<std::vector<uint32_t>> bins; //triangles touching each tile, in submission order
+	//pixels each tile shaded as runs of (draw, pixels), summed into the draws and stats after
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> tilePixels;
+	std::vector<DirectX::XMFLOAT4> clipScratch; //a draw's vertices in clip space
+	std::vector<uint32_t> clipStamps; //clipScratch entries holding this draw's vertex when they match clipStamp
+	uint32_t clipStamp = 0;
+	SoftwareRasteriserStats stats;
+
+	struct ClipVertex
+	{
+		DirectX::XMFLOAT4 position;
+		DirectX::XMFLOAT2 uv;
+	};
+	void AddTriangle(const ClipVertex& v0, const ClipVertex& v1, const ClipVertex& v2, uint32_t draw);
+	void SetupTriangle(const ClipVertex* clip, uint32_t draw);
+	void RasteriseTile(size_t tile);
+
+public:
+	SoftwareRasteriser(int width = 800, int height = 600);
+
+	//does nothing when the size hasn't changed
+	void Resize(int width, int height);
+
+	//clears colour and depth and forgets the last frame's draws. colour is 0-1 rgba, like
+	//ClearRenderTargetView's
+	void Begin(DirectX::FXMMATRIX viewProjection, DirectX::XMFLOAT4 clearColour);
+	//clips, projects and bins the triangles, nothing is drawn until Finish. only the vertices
+	//the indices use are transformed, so drawing part of a mesh costs that part. the texture is read
+	//then, so it has to stay alive until Finish returns. null draws untextured. transparent
+	//draws blend over what's there and don't write depth, like the renderer's transparent pass
+	void Draw(const VertexPosUVNorm* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+		DirectX::FXMMATRIX world, const TextureData* texture, DirectX::XMFLOAT4 colour = { 1, 1, 1, 1 }, bool transparent = false);
+	//shades every tile on up to maxThreads threads counting the calling one (0 uses the whole
+	//pool). same rules for the pool as DrawChunks::Record, nothing else may be submitting to it.
+	//only shades what was drawn since the last Finish, so calling it after every Draw times
+	//each one's shading on its own
+	void Finish(ThreadPool& pool, unsigned int maxThreads);
+	//pixels the draw'th Draw since Begin wrote, counted by Finish
+	size_t GetDrawPixels(size_t draw) { return draw < draws.size() ? draws[draw].pixelsShaded : 0; }
+
+	const SoftwareRasteriserStats& GetStats() { return stats; }
+	int GetWidth() { return width; }
+	int GetHeight() { return height; }
+	int GetStride() { return stride; }
+	const uint32_t* GetColour() { return colour.data(); }
+	const float* GetDepth() { return depth.data(); }
+
+	//uncompressed 32 bit tga, for looking at or keeping as a golden image
+	bool WriteTga(const std::string& path);
+};
\ No newline at end of file
@@ -0,0 +1,202 @@
+#include "StateCache.h"
+
+#include <cstring>
+
+#include "Debug.h"
+
+#ifndef HEADLESS_ONLY
+//FNV-1a over the whole descriptor, they're at most a few hundred bytes
+static uint64_t HashBytes(const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+#endif
+
+void StateCache::Bindings::Reset() {
+	blend = nullptr;
+	depthStencil = nullptr;
+	stencilRef = 0;
+	rasterizer = nullptr;
+	for (ID3D11SamplerState*& sampler : psSamplers) {
+		sampler = nullptr;
+	}
+}
+
+StateCache::~StateCache() {
+	Release();
+}
+
+void StateCache::Init(ID3D11Device* device) {
+	dev = device;
+}
+
+#ifndef HEADLESS_ONLY
+
+template <typename Desc, typename State, typename Create>
+State* StateCache::Find(Table<Desc, State>& table, const Desc& key, const char* name, Create create) {
+	stats.requests++;
+	if (!dev)
+		return nullptr;
+
+	auto& bucket = table.buckets[HashBytes(&key, sizeof(Desc))];
+	for (auto& entry : bucket) {
+		if (memcmp(&entry.first, &key, sizeof(Desc)) == 0)
+			return entry.second;
+	}
+
+	State* state = nullptr;
+	if (FAILED(create(&state))) {
+		LOG(std::string("Failed to create ") + name + " state");
+		return nullptr;
+	}
+	bucket.emplace_back(key, state);
+	table.count++;
+	stats.created++;
+	return state;
+}
+
+//sampler and rasterizer descs are all 4 byte fields with no padding, so a copy compares as is
+ID3D11SamplerState* StateCache::GetSampler(const D3D11_SAMPLER_DESC& desc) {
+	D3D11_SAMPLER_DESC key;
+	memcpy(&key, &desc, sizeof(key));
+	ID3D11SamplerState* state = Find(samplers, key, "sampler", [&](ID3D11SamplerState** out) { return dev->CreateSamplerState(&key, out); });
+	stats.samplers = samplers.count;
+	return state;
+}
+
+ID3D11RasterizerState* StateCache::GetRasterizer(const D3D11_RASTERIZER_DESC& desc) {
+	D3D11_RASTERIZER_DESC key;
+	memcpy(&key, &desc, sizeof(key));
+	ID3D11RasterizerState* state = Find(rasterizers, key, "rasterizer", [&](ID3D11RasterizerState** out) { return dev->CreateRasterizerState(&key, out); });
+	stats.rasterizers = rasterizers.count;
+	return state;
+}
+
+//blend and depth stencil descs have byte sized masks followed by padding, which the caller's
+//copy could have left as anything. rebuilt field by field into zeroed keys
+ID3D11BlendState* StateCache::GetBlend(const D3D11_BLEND_DESC& desc) {
+	D3D11_BLEND_DESC key;
+	memset(&key, 0, sizeof(key));
+	key.AlphaToCoverageEnable = desc.AlphaToCoverageEnable;
+	key.IndependentBlendEnable = desc.IndependentBlendEnable;
+	for (int i = 0; i < 8; i++) {
+		const D3D11_RENDER_TARGET_BLEND_DESC& from = desc.RenderTarget[i];
+		D3D11_RENDER_TARGET_BLEND_DESC& to = key.RenderTarget[i];
+		to.BlendEnable = from.BlendEnable;
+		to.SrcBlend = from.SrcBlend;
+		to.DestBlend = from.DestBlend;
+		to.BlendOp = from.BlendOp;
+		to.SrcBlendAlpha = from.SrcBlendAlpha;
+		to.DestBlendAlpha = from.DestBlendAlpha;
+		to.BlendOpAlpha = from.BlendOpAlpha;
+		to.RenderTargetWriteMask = from.RenderTargetWriteMask;
+	}
+	ID3D11BlendState* state = Find(blends, key, "blend", [&](ID3D11BlendState** out) { return dev->CreateBlendState(&key, out); });
+	stats.blends = blends.count;
+	return state;
+}
+
+ID3D11DepthStencilState* StateCache::GetDepthStencil(const D3D11_DEPTH_STENCIL_DESC& desc) {
+	D3D11_DEPTH_STENCIL_DESC key;
+	memset(&key, 0, sizeof(key));
+	key.DepthEnable = desc.DepthEnable;
+	key.DepthWriteMask = desc.DepthWriteMask;
+	key.DepthFunc = desc.DepthFunc;
+	key.StencilEnable = desc.StencilEnable;
+	key.StencilReadMask = desc.StencilReadMask;
+	key.StencilWriteMask = desc.StencilWriteMask;
+	key.FrontFace = desc.FrontFace;
+	key.BackFace = desc.BackFace;
+	ID3D11DepthStencilState* state = Find(depthStencils, key, "depth stencil", [&](ID3D11DepthStencilState** out) { return dev->CreateDepthStencilState(&key, out); });
+	stats.depthStencils = depthStencils.count;
+	return state;
+}
+#endif
+
+void StateCache::SetBlend([[maybe_unused]] ID3D11DeviceContext* context, Bindings& bindings, ID3D11BlendState* state) {
+	if (bindings.blend == state) {
+		bindings.skipCount++;
+		return;
+	}
+#ifndef HEADLESS_ONLY
+	if (context)
+		context->OMSetBlendState(state, nullptr, 0xFFFFFFFF);
+#endif
+	bindings.blend = state;
+	bindings.bindCount++;
+}
+
+void StateCache::SetDepthStencil([[maybe_unused]] ID3D11DeviceContext* context, Bindings& bindings, ID3D11DepthStencilState* state, unsigned int stencilRef) {
+	if (bindings.depthStencil == state && bindings.stencilRef == stencilRef) {
+		bindings.skipCount++;
+		return;
+	}
+#ifndef HEADLESS_ONLY
+	if (context)
+		context->OMSetDepthStencilState(state, stencilRef);
+#endif
+	bindings.depthStencil = state;
+	bindings.stencilRef = stencilRef;
+	bindings.bindCount++;
+}
+
+void StateCache::SetRasterizer([[maybe_unused]] ID3D11DeviceContext* context, Bindings& bindings, ID3D11RasterizerState* state) {
+	if (bindings.rasterizer == state) {
+		bindings.skipCount++;
+		return;
+	}
+#ifndef HEADLESS_ONLY
+	if (context)
+		context->RSSetState(state);
+#endif
+	bindings.rasterizer = state;
+	bindings.bindCount++;
+}
+
+void StateCache::SetPSSampler([[maybe_unused]] ID3D11DeviceContext* context, Bindings& bindings, unsigned int slot, ID3D11SamplerState* state) {
+	//anything past what's tracked just always binds
+	if (slot < samplerSlots) {
+		if (bindings.psSamplers[slot] == state) {
+			bindings.skipCount++;
+			return;
+		}
+		bindings.psSamplers[slot] = state;
+	}
+#ifndef HEADLESS_ONLY
+	if (context)
+		context->PSSetSamplers(slot, 1, &state);
+#endif
+	bindings.bindCount++;
+}
+
+#ifndef HEADLESS_ONLY
+template <typename Desc, typename State>
+void StateCache::ReleaseTable(Table<Desc, State>& table) {
+	for (auto& bucket : table.buckets) {
+		for (auto& entry : bucket.second) {
+			entry.second->Release();
+		}
+	}
+	table.buckets.clear();
+	table.count = 0;
+}
+
+#endif
+
+void StateCache::Release() {
+#ifndef HEADLESS_ONLY
+	ReleaseTable(samplers);
+	ReleaseTable(rasterizers);
+	ReleaseTable(blends);
+	ReleaseTable(depthStencils);
+#endif
+	stats.samplers = 0;
+	stats.rasterizers = 0;
+	stats.blends = 0;
+	stats.depthStencils = 0;
+}
\ No newline at end of file
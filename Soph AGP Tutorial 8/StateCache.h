@@ -0,0 +1,110 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#ifndef HEADLESS_ONLY
+#include <d3d11.h>
+#else
+struct ID3D11Device;
+struct ID3D11DeviceContext;
+struct ID3D11SamplerState;
+struct ID3D11RasterizerState;
+struct ID3D11BlendState;
+struct ID3D11DepthStencilState;
+#endif
+
+struct StateCacheStats
+{
+	size_t samplers = 0;
+	size_t rasterizers = 0;
+	size_t blends = 0;
+	size_t depthStencils = 0;
+	size_t requests = 0; //every Get call
+	size_t created = 0; //requests that made a new object, the rest were handed one already made
+};
+
+//one d3d state object per distinct descriptor, shared by every texture and pass asking for it.
+//descriptors are hashed and compared byte for byte with their padding zeroed, so two only share
+//an object when every field matches. the cache holds the only reference, callers never release
+//what they get. render thread only, like the device calls it makes
+class StateCache
+{
+public:
+	static const unsigned int samplerSlots = 4; //pixel shader slots Bindings tracks, higher ones aren't used
+
+	//what one context has bound, so binding the same thing again can be skipped. starts out as
+	//a fresh context's defaults, Reset it whenever the context is cleared behind its back, like
+	//after FinishCommandList or ExecuteCommandList with their restore flags off
+	struct Bindings
+	{
+		ID3D11BlendState* blend = nullptr;
+		ID3D11DepthStencilState* depthStencil = nullptr;
+		unsigned int stencilRef = 0;
+		ID3D11RasterizerState* rasterizer = nullptr;
+		ID3D11SamplerState* psSamplers[samplerSlots] = {};
+		size_t bindCount = 0; //calls that went to the context
+		size_t skipCount = 0; //calls dropped because the state was already bound
+
+		//back to the defaults, keeping the counts
+		void Reset();
+	};
+
+private:
+	ID3D11Device* dev = nullptr;
+	StateCacheStats stats;
+
+	//headless only has no descriptors to make states from, just Bindings to track with
+#ifndef HEADLESS_ONLY
+	//descriptors by hash, collisions share a bucket and are told apart by comparing
+	template <typename Desc, typename State>
+	struct Table
+	{
+		std::unordered_map<uint64_t, std::vector<std::pair<Desc, State*>>> buckets;
+		size_t count = 0;
+	};
+
+	Table<D3D11_SAMPLER_DESC, ID3D11SamplerState> samplers;
+	Table<D3D11_RASTERIZER_DESC, ID3D11RasterizerState> rasterizers;
+	Table<D3D11_BLEND_DESC, ID3D11BlendState> blends;
+	Table<D3D11_DEPTH_STENCIL_DESC, ID3D11DepthStencilState> depthStencils;
+
+	//key has to be fully zeroed before its fields are filled in, create makes the object
+	template <typename Desc, typename State, typename Create>
+	State* Find(Table<Desc, State>& table, const Desc& key, const char* name, Create create);
+	template <typename Desc, typename State>
+	void ReleaseTable(Table<Desc, State>& table);
+#endif
+
+public:
+	StateCache() = default;
+	~StateCache();
+
+	void Init(ID3D11Device* dev);
+
+#ifndef HEADLESS_ONLY
+	//null without a device or if creating it failed, which is logged
+	ID3D11SamplerState* GetSampler(const D3D11_SAMPLER_DESC& desc);
+	ID3D11RasterizerState* GetRasterizer(const D3D11_RASTERIZER_DESC& desc);
+	ID3D11BlendState* GetBlend(const D3D11_BLEND_DESC& desc);
+	ID3D11DepthStencilState* GetDepthStencil(const D3D11_DEPTH_STENCIL_DESC& desc);
+#endif
+
+	//bind through bindings, only calling the context when the state differs. a null context
+	//still tracks, so headless renderers count binds the same as a real one. blends always use
+	//no blend factor and every sample
+	static void SetBlend(ID3D11DeviceContext* context, Bindings& bindings, ID3D11BlendState* state);
+	static void SetDepthStencil(ID3D11DeviceContext* context, Bindings& bindings, ID3D11DepthStencilState* state, unsigned int stencilRef = 0);
+	static void SetRasterizer(ID3D11DeviceContext* context, Bindings& bindings, ID3D11RasterizerState* state);
+	static void SetPSSampler(ID3D11DeviceContext* context, Bindings& bindings, unsigned int slot, ID3D11SamplerState* state);
+
+	//distinct objects alive right now
+	size_t GetCount() { return stats.samplers + stats.rasterizers + stats.blends + stats.depthStencils; }
+	StateCacheStats GetStats() { return stats; }
+
+	//releases every object, anything still holding one mustn't bind it again
+	void Release();
+
+	StateCache(const StateCache&) = delete;
+	StateCache& operator=(const StateCache&) = delete;
+};
\ No newline at end of file
@@ -0,0 +1,127 @@
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <climits>
+#include <filesystem>
+
+#include "Test.h"
+#include "DrawChunks.h"
+#include "ThreadPool.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#include "GameObject.h"
+#include "Benchmarks.h"
+
+//chunks have to run back to back from 0 to the end with nothing missed or doubled
+static bool Covers(const std::vector<DrawChunks::Chunk>& chunks, size_t commandCount) {
+	size_t next = 0;
+	for (const DrawChunks::Chunk& chunk : chunks) {
+		if (chunk.first != next || chunk.count == 0)
+			return false;
+		next += chunk.count;
+	}
+	return next == commandCount;
+}
+
+TEST(DrawChunks_Partition) {
+	std::vector<DrawChunks::Chunk> chunks;
+	DrawChunks::Partition(0, 64, chunks);
+	CHECK(chunks.empty());
+
+	DrawChunks::Partition(1000, 0, chunks);
+	CHECK(chunks.size() == 1 && Covers(chunks, 1000));
+	DrawChunks::Partition(50, 64, chunks);
+	CHECK(chunks.size() == 1 && Covers(chunks, 50));
+
+	DrawChunks::Partition(256, 64, chunks);
+	CHECK(chunks.size() == 4 && Covers(chunks, 256));
+	//20 left over is a quarter or more of 64, it gets its own chunk
+	DrawChunks::Partition(276, 64, chunks);
+	CHECK(chunks.size() == 5 && Covers(chunks, 276) && chunks.back().count == 20);
+	//10 isn't, it's folded into the last one
+	DrawChunks::Partition(266, 64, chunks);
+	CHECK(chunks.size() == 4 && Covers(chunks, 266) && chunks.back().count == 74);
+}
+
+TEST(DrawChunks_RecordRunsEveryChunkOnce) {
+	ThreadPool pool(3, "Test record");
+	for (unsigned int maxThreads : { 1u, 2u, 0u }) {
+		const size_t chunkCount = 37;
+		std::vector<std::atomic<int>> calls(chunkCount);
+		for (auto& count : calls) {
+			count = 0;
+		}
+		DrawChunks::Record(pool, chunkCount, maxThreads, [&](size_t chunk) { calls[chunk]++; });
+		bool once = true;
+		for (auto& count : calls) {
+			once = once && count == 1;
+		}
+		CHECK(once);
+	}
+	DrawChunks::Record(pool, 0, 0, [&](size_t) { CHECK(false); });
+}
+
+//the draws and object constants a frame recorded, in order, without the binds each chunk
+//repeats at its start
+static std::vector<CommandStream::Command> DrawsAndObjects(const CommandStream& stream) {
+	std::vector<CommandStream::Command> commands;
+	size_t offset = 0;
+	CommandStream::Command command;
+	while (stream.Read(offset, command)) {
+		if (command.op == StreamOp::DRAW || command.op == StreamOp::SET_OBJECT)
+			commands.push_back(command);
+	}
+	return commands;
+}
+
+static bool SameCommands(const std::vector<CommandStream::Command>& a, const std::vector<CommandStream::Command>& b) {
+	if (a.size() != b.size())
+		return false;
+	for (size_t i = 0; i < a.size(); i++) {
+		if (a[i].op != b[i].op || a[i].a != b[i].a || a[i].b != b[i].b || a[i].c != b[i].c)
+			return false;
+	}
+	return true;
+}
+
+//a frame split into chunks on several threads has to reach the gpu exactly as it would have
+//all in one, with and without the depth pre-pass
+TEST(DrawChunks_ChunkedFrameMatchesImmediate) {
+	std::error_code error;
+	std::string model = (std::filesystem::temp_directory_path(error) / "agp_test_sphere.obj").string();
+	CHECK(Benchmarks::WriteSphereObj(model, 8, 16));
+
+	Renderer renderer{ 800, 600, RenderBackend::RECORDING };
+	std::shared_ptr<Mesh> mesh = renderer.GetAssets().LoadMesh(model);
+	renderer.GetAssets().WaitAll();
+	CHECK(mesh->IsResident());
+	renderer.camera.transform.SetPosition({ 0, 0, -5 });
+	renderer.instancingMinObjects = UINT_MAX;
+	std::vector<std::unique_ptr<GameObject>> scene;
+	for (int i = 0; i < 1000; i++) {
+		scene.push_back(std::make_unique<GameObject>("Chunked", mesh));
+		scene.back()->transform.SetPosition({ (i % 40 - 20) * 1.5f, (i / 40 - 12) * 1.5f, 40, 1 });
+		renderer.RegisterGameObject(scene.back().get());
+	}
+
+	for (bool prepass : { false, true }) {
+		renderer.depthPrepass = prepass;
+		renderer.drawChunkSize = 0;
+		renderer.RenderFrame();
+		std::vector<CommandStream::Command> immediate = DrawsAndObjects(renderer.GetRecordedFrame());
+		CHECK(renderer.GetFrameStats().commandLists == 0);
+
+		renderer.drawChunkSize = 64;
+		renderer.recordThreads = 4;
+		renderer.RenderFrame();
+		std::vector<CommandStream::Command> chunked = DrawsAndObjects(renderer.GetRecordedFrame());
+		CHECK(renderer.GetFrameStats().commandLists > 1);
+		CHECK(!immediate.empty());
+		CHECK(SameCommands(immediate, chunked));
+	}
+
+	for (auto& obj : scene) {
+		renderer.RemoveGameObject(obj.get());
+	}
+	renderer.Clean();
+}
\ No newline at end of file
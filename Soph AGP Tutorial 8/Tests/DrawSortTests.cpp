@@ -0,0 +1,126 @@
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <filesystem>
+#include <DirectXMath.h>
+
+#include "Test.h"
+#include "DrawSort.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "GameObject.h"
+#include "Benchmarks.h"
+
+using namespace DirectX;
+
+//state first, then nearest first within the same state
+TEST(DrawSort_OpaqueGroupsByStateThenFrontToBack) {
+	uint64_t nearA = DrawSort::MakeKey(false, 0, 1, 5, 0, 0.1f);
+	uint64_t farA = DrawSort::MakeKey(false, 0, 1, 5, 0, 0.9f);
+	uint64_t nearB = DrawSort::MakeKey(false, 0, 2, 5, 0, 0.05f);
+	CHECK(nearA < farA);
+	CHECK(farA < nearB); //a different material beats being closer
+
+	//arena over material over mesh over lod
+	CHECK(DrawSort::MakeKey(false, 0, 9, 9, 9, 0.5f) < DrawSort::MakeKey(false, 1, 0, 0, 0, 0.5f));
+	CHECK(DrawSort::MakeKey(false, 0, 1, 9, 9, 0.5f) < DrawSort::MakeKey(false, 0, 2, 0, 0, 0.5f));
+	CHECK(DrawSort::MakeKey(false, 0, 1, 1, 9, 0.5f) < DrawSort::MakeKey(false, 0, 1, 2, 0, 0.5f));
+	CHECK(DrawSort::MakeKey(false, 0, 1, 1, 1, 0.5f) < DrawSort::MakeKey(false, 0, 1, 1, 2, 0.0f));
+
+	//depth outside the view clamps instead of spilling into the state bits
+	CHECK(DrawSort::MakeKey(false, 0, 1, 1, 1, -3.0f) == DrawSort::MakeKey(false, 0, 1, 1, 1, 0.0f));
+	CHECK(DrawSort::MakeKey(false, 0, 1, 1, 1, 7.0f) < DrawSort::MakeKey(false, 0, 1, 1, 2, 0.0f));
+}
+
+//after every opaque draw, farthest first whatever their state, and only grouped when depths tie
+TEST(DrawSort_TransparentBackToFrontAfterOpaque) {
+	uint64_t lastOpaque = DrawSort::MakeKey(false, 0xF, 0x3FFF, 0xFFFF, 0xF, 1.0f);
+	uint64_t far = DrawSort::MakeKey(true, 3, 7, 7, 0, 0.8f);
+	uint64_t near = DrawSort::MakeKey(true, 0, 1, 1, 0, 0.2f);
+	CHECK(lastOpaque < DrawSort::MakeKey(true, 0, 0, 0, 0, 0.0f));
+	CHECK(far < near);
+	CHECK(DrawSort::MakeKey(true, 0, 1, 1, 0, 0.5f) < DrawSort::MakeKey(true, 0, 2, 1, 0, 0.5f));
+}
+
+//the radix sort is stable, so with values starting in order it has to match std::sort on the pairs
+TEST(DrawSort_RadixSortMatchesStdSort) {
+	unsigned int seed = 99;
+	auto next = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	};
+
+	std::vector<uint64_t> keyScratch;
+	std::vector<uint32_t> valueScratch;
+	for (int round = 0; round < 3; round++) {
+		std::vector<uint64_t> keys;
+		std::vector<uint32_t> values;
+		for (uint32_t i = 0; i < 50000; i++) {
+			uint64_t key;
+			if (round == 0) //anything
+				key = ((uint64_t)next() << 40) ^ ((uint64_t)next() << 16) ^ next();
+			else if (round == 1) //lots of ties and high bytes that never change, so passes get skipped
+				key = DrawSort::MakeKey(next() % 8 == 0, next() % 2, next() % 5, next() % 20, next() % 3, (next() % 16) / 16.0f);
+			else //only a few distinct keys
+				key = next() % 4;
+			keys.push_back(key);
+			values.push_back(i);
+		}
+
+		std::vector<std::pair<uint64_t, uint32_t>> expected;
+		for (size_t i = 0; i < keys.size(); i++)
+			expected.push_back({ keys[i], values[i] });
+		std::sort(expected.begin(), expected.end());
+
+		DrawSort::RadixSort(keys, values, keyScratch, valueScratch);
+		size_t mismatches = 0;
+		for (size_t i = 0; i < keys.size(); i++)
+			mismatches += keys[i] != expected[i].first || values[i] != expected[i].second;
+		CHECK(mismatches == 0);
+	}
+
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> values;
+	DrawSort::RadixSort(keys, values, keyScratch, valueScratch);
+	CHECK(keys.empty() && values.empty());
+}
+
+//eight objects alternating between two colours. in registration order every draw changes the
+//material, sorted it changes once, and both counts come from the same bind tracking
+TEST(DrawSort_SortingSavesStateChanges) {
+	std::error_code error;
+	std::string model = (std::filesystem::temp_directory_path(error) / "agp_test_sphere.obj").string();
+	CHECK(Benchmarks::WriteSphereObj(model, 8, 16));
+
+	Renderer renderer{ 800, 600, RenderBackend::NULL_DEVICE };
+	std::shared_ptr<Mesh> mesh = renderer.GetAssets().LoadMesh(model);
+	renderer.GetAssets().WaitAll();
+	CHECK(mesh->IsResident());
+
+	std::shared_ptr<Material> red = std::make_shared<Material>();
+	red->colour = XMFLOAT4(1, 0, 0, 1);
+	std::shared_ptr<Material> blue = std::make_shared<Material>();
+	blue->colour = XMFLOAT4(0, 0, 1, 1);
+
+	std::vector<std::unique_ptr<GameObject>> objects;
+	for (int i = 0; i < 8; i++) {
+		objects.push_back(std::make_unique<GameObject>("Sphere", mesh));
+		objects.back()->material = i % 2 ? blue : red;
+		objects.back()->transform.SetPosition(XMVectorSet(i * 3.0f - 10.5f, 0, 30, 1));
+		renderer.RegisterGameObject(objects.back().get());
+	}
+	renderer.RenderFrame();
+
+	//layer, shader, texture and geometry once each, plus the colour changes
+	const FrameStats& stats = renderer.GetFrameStats();
+	CHECK(stats.objectsDrawn == 8);
+	CHECK(stats.stateChangesUnsorted == 4 + 8);
+	CHECK(stats.stateChangesSorted == 4 + 2);
+
+	for (auto& object : objects)
+		renderer.RemoveGameObject(object.get());
+	renderer.Clean();
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <filesystem>
+#include <DirectXMath.h>
+
+#include "Test.h"
+#include "Frustum.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#include "GameObject.h"
+#include "Benchmarks.h"
+
+using namespace DirectX;
+
+//the game's camera at the origin looking down +z, 60 degrees tall at 4:3, 0.1 to 100
+static Frustum CameraFrustum() {
+	return Frustum{ XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0))
+		* XMMatrixPerspectiveFovLH(XMConvertToRadians(60), 4.0f / 3.0f, 0.1f, 100.0f) };
+}
+
+TEST(Frustum_SpheresAgainstEachPlane) {
+	Frustum frustum = CameraFrustum();
+	CHECK(frustum.IntersectsSphere({ 0, 0, 10 }, 1));
+	CHECK(!frustum.IntersectsSphere({ 0, 0, -5 }, 1)); //behind
+	CHECK(!frustum.IntersectsSphere({ 0, 0, 110 }, 1)); //past far
+	CHECK(frustum.IntersectsSphere({ 0, 0, 100.5f }, 1)); //straddling far
+	CHECK(!frustum.IntersectsSphere({ 0, 20, 10 }, 1)); //above, the top edge is at y = 5.77
+	CHECK(frustum.IntersectsSphere({ 0, 6.5f, 10 }, 1)); //just over it but touching
+	CHECK(!frustum.IntersectsSphere({ -30, 0, 10 }, 1)); //left
+	CHECK(frustum.IntersectsSphere({ 0, 0, 0 }, 0.5f)); //around the eye, through the near plane
+}
+
+//100k spheres scattered around the camera, plus a few so the list doesn't end on a whole group
+//of four. the simd path has to agree with the one at a time test on every one of them
+TEST(Frustum_CullSpheresMatchesScalar) {
+	Frustum frustum = CameraFrustum();
+	const size_t count = 100003;
+	SphereList spheres;
+	unsigned int seed = 2024;
+	auto next = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+	for (size_t i = 0; i < count; i++) {
+		spheres.Add({ next() * 240 - 120, next() * 240 - 120, next() * 240 - 120 }, 0.1f + next() * 4);
+	}
+
+	std::vector<uint8_t> visible;
+	size_t visibleCount = frustum.CullSpheres(spheres, visible);
+	CHECK(visible.size() == count);
+
+	size_t expected = 0, mismatches = 0;
+	for (size_t i = 0; i < count; i++) {
+		bool inside = frustum.IntersectsSphere({ spheres.x[i], spheres.y[i], spheres.z[i] }, spheres.radius[i]);
+		expected += inside;
+		mismatches += (visible[i] != 0) != inside;
+	}
+	CHECK(mismatches == 0);
+	CHECK(visibleCount == expected);
+
+	//the frustum's about 4% of that box, so most are culled but plenty aren't
+	CHECK(visibleCount > count / 100);
+	CHECK(visibleCount < count / 10);
+}
+
+TEST(Frustum_CullSpheresEmptyAndShort) {
+	Frustum frustum = CameraFrustum();
+	SphereList spheres;
+	std::vector<uint8_t> visible{ 1, 1 };
+	CHECK(frustum.CullSpheres(spheres, visible) == 0);
+	CHECK(visible.empty());
+
+	spheres.Add({ 0, 0, 10 }, 1);
+	spheres.Add({ 0, 0, -10 }, 1);
+	spheres.Add({ 0, 0, 50 }, 1);
+	CHECK(frustum.CullSpheres(spheres, visible) == 2);
+	CHECK(visible.size() == 3 && visible[0] == 1 && visible[1] == 0 && visible[2] == 1);
+}
+
+//an object mirrored on an axis is just as big as it was, so it can't be culled for it. each is
+//stretched most along z, mirrored or not, and sits behind the camera where only that axis reaches
+//past the near plane
+TEST(Frustum_MirroredObjectsStayVisible) {
+	std::error_code error;
+	std::string model = (std::filesystem::temp_directory_path(error) / "agp_test_sphere.obj").string();
+	CHECK(Benchmarks::WriteSphereObj(model, 8, 16));
+
+	Renderer renderer{ 800, 600, RenderBackend::NULL_DEVICE };
+	std::shared_ptr<Mesh> mesh = renderer.GetAssets().LoadMesh(model);
+	renderer.GetAssets().WaitAll();
+	CHECK(mesh->IsResident());
+
+	const XMVECTOR scales[] = { XMVectorSet(1, 1, -3, 0), XMVectorSet(-1, 1.5f, -3, 0), XMVectorSet(-3, -3, -3, 0) };
+	for (XMVECTOR scale : scales) {
+		GameObject mirrored{ "Mirrored", mesh };
+		mirrored.transform.SetScale(scale);
+		//the camera's looking down +z from the origin
+		mirrored.transform.SetPosition(XMVectorSet(0, 0, -2.0f * mesh->GetBoundsRadius(), 1));
+		renderer.RegisterGameObject(&mirrored);
+		renderer.RenderFrame();
+		CHECK(renderer.GetFrameStats().objectsTested == 1);
+		CHECK(renderer.GetFrameStats().objectsCulled == 0);
+		renderer.RemoveGameObject(&mirrored);
+	}
+	renderer.Clean();
+}
\ No newline at end of file
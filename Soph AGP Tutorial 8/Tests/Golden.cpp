@@ -0,0 +1,100 @@
+#include "Golden.h"
+
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <cstdlib>
+#include <algorithm>
+
+namespace Golden {
+	static bool WriteTga(const std::string& path, int width, int height, const uint32_t* pixels, int stride) {
+		std::ofstream file{ path, std::ios::out | std::ios::binary | std::ios::trunc };
+		if (!file)
+			return false;
+
+		//same layout as SoftwareRasteriser::WriteTga, bgra with rows stored top first
+		uint8_t header[18] = {};
+		header[2] = 2;
+		header[12] = (uint8_t)(width & 0xFF);
+		header[13] = (uint8_t)(width >> 8);
+		header[14] = (uint8_t)(height & 0xFF);
+		header[15] = (uint8_t)(height >> 8);
+		header[16] = 32;
+		header[17] = 0x28;
+		file.write((const char*)header, sizeof(header));
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				uint32_t p = pixels[(size_t)y * stride + x];
+				uint8_t bgra[4] = { (uint8_t)(p >> 16), (uint8_t)(p >> 8), (uint8_t)p, (uint8_t)(p >> 24) };
+				file.write((const char*)bgra, 4);
+			}
+		}
+		return (bool)file;
+	}
+
+	//only reads back what WriteTga writes
+	static bool ReadTga(const std::string& path, int& width, int& height, std::vector<uint32_t>& pixels) {
+		std::ifstream file{ path, std::ios::in | std::ios::binary };
+		uint8_t header[18];
+		if (!file.read((char*)header, sizeof(header)) || header[2] != 2 || header[16] != 32 || header[17] != 0x28)
+			return false;
+		width = header[12] | (header[13] << 8);
+		height = header[14] | (header[15] << 8);
+		pixels.resize((size_t)width * height);
+		for (uint32_t& p : pixels) {
+			uint8_t bgra[4];
+			if (!file.read((char*)bgra, 4))
+				return false;
+			p = bgra[2] | (bgra[1] << 8) | (bgra[0] << 16) | ((uint32_t)bgra[3] << 24);
+		}
+		return true;
+	}
+
+	bool Matches(const std::string& name, int width, int height, const uint32_t* pixels, int stride,
+		int tolerance, float maxDiffering) {
+		std::string path = "Tests/Golden/" + name + ".tga";
+		const char* update = getenv("AGP_UPDATE_GOLDEN");
+		if (update && update[0] == '1') {
+			bool written = WriteTga(path, width, height, pixels, stride);
+			std::cout << (written ? "Updated " : "Failed to update ") << path << std::endl;
+			return written;
+		}
+
+		std::error_code error;
+		std::string actualPath = (std::filesystem::temp_directory_path(error) / (name + ".actual.tga")).string();
+		int goldenWidth = 0, goldenHeight = 0;
+		std::vector<uint32_t> golden;
+		if (!ReadTga(path, goldenWidth, goldenHeight, golden)) {
+			WriteTga(actualPath, width, height, pixels, stride);
+			std::cout << "Couldn't read " << path << ", wrote " << actualPath << ". AGP_UPDATE_GOLDEN=1 makes it" << std::endl;
+			return false;
+		}
+		if (goldenWidth != width || goldenHeight != height) {
+			WriteTga(actualPath, width, height, pixels, stride);
+			std::cout << path << " is " << goldenWidth << "x" << goldenHeight << ", drew " << width << "x" << height << std::endl;
+			return false;
+		}
+
+		size_t differing = 0;
+		int worst = 0;
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				uint32_t a = pixels[(size_t)y * stride + x], b = golden[(size_t)y * width + x];
+				int pixelWorst = 0;
+				for (int shift = 0; shift < 32; shift += 8) {
+					pixelWorst = std::max(pixelWorst, std::abs((int)((a >> shift) & 0xFF) - (int)((b >> shift) & 0xFF)));
+				}
+				worst = std::max(worst, pixelWorst);
+				differing += pixelWorst > tolerance;
+			}
+		}
+		if (differing > (size_t)(maxDiffering * width * height)) {
+			WriteTga(actualPath, width, height, pixels, stride);
+			std::cout << name << ": " << differing << " of " << width * height << " pixels differ from " << path
+				<< ", worst by " << worst << ". wrote " << actualPath << std::endl;
+			return false;
+		}
+		return true;
+	}
+}
\ No newline at end of file
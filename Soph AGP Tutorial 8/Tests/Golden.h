@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+//golden images for the rasteriser tests, kept as uncompressed 32 bit tga in Tests/Golden so
+//they open in anything. set AGP_UPDATE_GOLDEN=1 to rewrite them from what the tests draw now,
+//after checking the change is meant
+namespace Golden {
+	//pixels are rgba8 with red in the lowest byte, stride pixels to a row. a pixel differs when
+	//any channel is more than tolerance off, and the image matches while no more than
+	//maxDiffering of its pixels do, since edges can land either side of a pixel centre on
+	//another compiler. on a mismatch what was drawn goes to <temp>/<name>.actual.tga
+	bool Matches(const std::string& name, int width, int height, const uint32_t* pixels, int stride,
+		int tolerance = 2, float maxDiffering = 0.005f);
+}
\ No newline at end of file
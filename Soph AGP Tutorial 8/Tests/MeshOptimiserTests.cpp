@@ -0,0 +1,100 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+
+#include "Test.h"
+#include "MeshOptimiser.h"
+#include "ModelLoader.h"
+
+//a side x side grid of quads, two triangles each, with the triangles in a fixed shuffled order
+//so the cache starts out about as bad as a real export's
+static std::vector<unsigned int> ShuffledGrid(int side) {
+	std::vector<std::array<unsigned int, 3>> triangles;
+	for (int y = 0; y < side; y++) {
+		for (int x = 0; x < side; x++) {
+			unsigned int corner = y * (side + 1) + x;
+			triangles.push_back({ corner, corner + side + 1, corner + side + 2 });
+			triangles.push_back({ corner, corner + side + 2, corner + 1 });
+		}
+	}
+	unsigned int seed = 12345;
+	for (size_t i = triangles.size() - 1; i > 0; i--) {
+		seed = seed * 1664525u + 1013904223u;
+		std::swap(triangles[i], triangles[seed % (i + 1)]);
+	}
+
+	std::vector<unsigned int> indices;
+	for (auto& triangle : triangles) {
+		indices.insert(indices.end(), triangle.begin(), triangle.end());
+	}
+	return indices;
+}
+
+//each triangle rotated to start at its smallest index, then sorted, so two index buffers
+//drawing the same triangles in any order and winding start compare equal
+static std::vector<std::array<unsigned int, 3>> Triangles(const std::vector<unsigned int>& indices) {
+	std::vector<std::array<unsigned int, 3>> triangles;
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		std::array<unsigned int, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+TEST(MeshOptimiser_AnalyseCountsFifoMisses) {
+	//the first triangle misses on all three, the second only on its new corner
+	unsigned int indices[] = { 0, 1, 2, 2, 1, 3 };
+	MeshOptimiser::VertexCacheStats stats = MeshOptimiser::AnalyseVertexCache(indices, 6, 4);
+	CHECK_NEAR(stats.acmr, 2.0f, 1e-6);
+	CHECK_NEAR(stats.atvr, 1.0f, 1e-6);
+
+	//a cache of 2 has pushed 0 out by the time the third triangle comes back to it
+	unsigned int revisit[] = { 0, 1, 2, 3, 4, 5, 0, 1, 2 };
+	stats = MeshOptimiser::AnalyseVertexCache(revisit, 9, 6, 2);
+	CHECK_NEAR(stats.acmr, 3.0f, 1e-6);
+	CHECK_NEAR(stats.atvr, 1.5f, 1e-6);
+}
+
+TEST(MeshOptimiser_VertexCacheLowersAcmr) {
+	const int side = 32;
+	const size_t vertexCount = (side + 1) * (side + 1);
+	std::vector<unsigned int> indices = ShuffledGrid(side);
+	MeshOptimiser::VertexCacheStats before = MeshOptimiser::AnalyseVertexCache(indices.data(), indices.size(), vertexCount);
+
+	std::vector<unsigned int> optimised = indices;
+	MeshOptimiser::OptimiseVertexCache(optimised.data(), optimised.size(), vertexCount);
+	MeshOptimiser::VertexCacheStats after = MeshOptimiser::AnalyseVertexCache(optimised.data(), optimised.size(), vertexCount);
+
+	//shuffled, nearly every corner misses. a grid can get under 1 vertex per triangle with a
+	//16 entry cache, and every vertex has to be transformed at least once
+	CHECK(before.acmr > 2.0f);
+	CHECK(after.acmr < 0.8f);
+	CHECK(after.atvr >= 1.0f);
+	CHECK(after.atvr < 1.5f);
+	CHECK(Triangles(optimised) == Triangles(indices));
+}
+
+TEST(MeshOptimiser_VertexFetchIsFirstUseOrder) {
+	//vertex i at x = i, so where each one ended up can be read back from it
+	std::vector<VertexPosUVNorm> vertices(6);
+	for (size_t i = 0; i < vertices.size(); i++) {
+		vertices[i].pos = { (float)i, 0, 0 };
+	}
+	//vertex 1 is never used
+	std::vector<unsigned int> indices = { 5, 3, 0, 0, 3, 2, 4, 2, 3 };
+	std::vector<unsigned int> original = indices;
+
+	size_t count = MeshOptimiser::OptimiseVertexFetch(vertices.data(), vertices.size(), indices.data(), indices.size());
+	CHECK(count == 5);
+	for (size_t i = 0; i < indices.size(); i++) {
+		CHECK(vertices[indices[i]].pos.x == (float)original[i]);
+	}
+	//first use order means each index is at most one past the highest before it
+	unsigned int highest = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		CHECK(indices[i] <= highest + (i > 0));
+		highest = std::max(highest, indices[i]);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <DirectXMath.h>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "Meshlet.h"
+#include "Frustum.h"
+
+using namespace DirectX;
+
+//looking at target from eye, 60 degrees tall at 4:3
+static XMMATRIX ViewProjection(XMFLOAT3 eye, XMFLOAT3 target) {
+	XMVECTOR from = XMLoadFloat3(&eye);
+	return XMMatrixLookToLH(from, XMVectorSubtract(XMLoadFloat3(&target), from), XMVectorSet(0, 1, 0, 0))
+		* XMMatrixPerspectiveFovLH(XMConvertToRadians(60), 4.0f / 3.0f, 0.1f, 100.0f);
+}
+
+//whether a culled triangle really couldn't be seen, facing away or wholly outside one plane
+static bool TriangleHidden(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c, const Frustum& frustum, XMFLOAT3 eye) {
+	XMVECTOR pa = XMLoadFloat3(&a), pb = XMLoadFloat3(&b), pc = XMLoadFloat3(&c);
+	XMVECTOR n = XMVector3Cross(XMVectorSubtract(pb, pa), XMVectorSubtract(pc, pa));
+	if (XMVectorGetX(XMVector3Dot(n, XMVectorSubtract(pa, XMLoadFloat3(&eye)))) >= 0)
+		return true;
+
+	for (int i = 0; i < 6; i++) {
+		XMFLOAT4 stored = frustum.GetPlane(i);
+		XMVECTOR plane = XMLoadFloat4(&stored);
+		if (XMVectorGetX(XMPlaneDotCoord(plane, pa)) < 0 && XMVectorGetX(XMPlaneDotCoord(plane, pb)) < 0
+			&& XMVectorGetX(XMPlaneDotCoord(plane, pc)) < 0)
+			return true;
+	}
+	return false;
+}
+
+struct SphereMeshlets
+{
+	std::vector<VertexPosUVNorm> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<Meshlet> meshlets;
+
+	SphereMeshlets() {
+		std::vector<unsigned int> sourceIndices;
+		TestMeshes::UvSphere(32, 64, vertices, sourceIndices);
+		Meshlets::Build(vertices.data(), vertices.size(), sourceIndices.data(), sourceIndices.size(), indices, meshlets);
+	}
+};
+
+TEST(Meshlet_BuildKeepsTrianglesWithinLimits) {
+	SphereMeshlets sphere;
+	std::vector<VertexPosUVNorm> vertices;
+	std::vector<unsigned int> sourceIndices;
+	TestMeshes::UvSphere(32, 64, vertices, sourceIndices);
+
+	//same triangles, each still starting from the same corner, just reordered
+	auto triangles = [](const std::vector<unsigned int>& indices) {
+		std::vector<std::array<unsigned int, 3>> out;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+			out.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+		}
+		std::sort(out.begin(), out.end());
+		return out;
+	};
+	CHECK(triangles(sphere.indices) == triangles(sourceIndices));
+
+	//back to back over the whole buffer, each inside its limits and its bounding sphere
+	unsigned int nextIndex = 0;
+	for (const Meshlet& m : sphere.meshlets) {
+		CHECK(m.firstIndex == nextIndex);
+		CHECK(m.triangleCount > 0 && m.triangleCount <= Meshlets::maxTriangles);
+		CHECK(m.vertexCount > 0 && m.vertexCount <= Meshlets::maxVertices);
+		nextIndex = m.firstIndex + m.triangleCount * 3;
+		for (unsigned int i = m.firstIndex; i < nextIndex; i++) {
+			const XMFLOAT3& p = sphere.vertices[sphere.indices[i]].pos;
+			float dx = p.x - m.centre.x, dy = p.y - m.centre.y, dz = p.z - m.centre.z;
+			CHECK(sqrtf(dx * dx + dy * dy + dz * dz) <= m.radius * 1.0001f);
+		}
+	}
+	CHECK(nextIndex == sphere.indices.size());
+}
+
+//eight stops around the sphere at 4 units, a little above it, always looking at it. about 60%
+//of a unit sphere faces away from there. meshlets straddling the horizon can't be culled, so
+//the cones drop a bit under half of that, 26-33% of the sphere, and never a triangle that
+//could be seen
+TEST(Meshlet_CullOnCameraPath) {
+	SphereMeshlets sphere;
+	const size_t triangleCount = sphere.indices.size() / 3;
+	for (int stop = 0; stop < 8; stop++) {
+		float angle = XM_2PI * stop / 8;
+		XMFLOAT3 eye{ 4 * cosf(angle), 1.0f, 4 * sinf(angle) };
+		Frustum frustum{ ViewProjection(eye, { 0, 0, 0 }) };
+
+		std::vector<DrawRange> ranges;
+		MeshletCullStats stats;
+		Meshlets::Cull(sphere.meshlets, frustum, eye, ranges, stats);
+		CHECK(stats.meshletsTested == sphere.meshlets.size());
+		CHECK(stats.trianglesTested == triangleCount);
+		CHECK(stats.frustumCulled == 0); //the whole sphere's in view
+		CHECK(stats.trianglesCulled > triangleCount / 5);
+		CHECK(stats.trianglesCulled < triangleCount * 6 / 10);
+
+		std::vector<bool> drawn(triangleCount, false);
+		size_t drawnCount = 0;
+		for (const DrawRange& range : ranges) {
+			for (unsigned int i = range.firstIndex; i < range.firstIndex + range.indexCount; i += 3) {
+				drawn[i / 3] = true;
+				drawnCount++;
+			}
+		}
+		CHECK(drawnCount + stats.trianglesCulled == triangleCount);
+		for (size_t t = 0; t < triangleCount; t++) {
+			if (drawn[t])
+				continue;
+			const unsigned int* tri = &sphere.indices[t * 3];
+			CHECK(TriangleHidden(sphere.vertices[tri[0]].pos, sphere.vertices[tri[1]].pos, sphere.vertices[tri[2]].pos, frustum, eye));
+		}
+	}
+}
+
+TEST(Meshlet_CullBehindCameraAndWithoutCones) {
+	SphereMeshlets sphere;
+	XMFLOAT3 eye{ 0, 0, -4 };
+
+	//looking straight away, nothing's left
+	std::vector<DrawRange> ranges;
+	MeshletCullStats stats;
+	Meshlets::Cull(sphere.meshlets, Frustum{ ViewProjection(eye, { 0, 0, -8 }) }, eye, ranges, stats);
+	CHECK(stats.frustumCulled == sphere.meshlets.size());
+	CHECK(ranges.empty());
+
+	//cone culling off draws everything in view, as one range since they're back to back
+	stats = {};
+	Meshlets::Cull(sphere.meshlets, Frustum{ ViewProjection(eye, { 0, 0, 0 }) }, eye, ranges, stats, false);
+	CHECK(stats.backfaceCulled == 0);
+	CHECK(stats.trianglesCulled == 0);
+	CHECK(ranges.size() == 1 && ranges[0].indexCount == sphere.indices.size());
+}
\ No newline at end of file
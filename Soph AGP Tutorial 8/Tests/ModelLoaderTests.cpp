@@ -0,0 +1,137 @@
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <filesystem>
+#include <chrono>
+#include <iterator>
+#include <cstdint>
+
+#include "Test.h"
+#include "ModelLoader.h"
+
+//a file in the temp directory holding text, for the loader to read back
+static std::string WriteTemp(const std::string& name, const std::string& text) {
+	std::error_code error;
+	std::string path = (std::filesystem::temp_directory_path(error) / name).string();
+	std::ofstream{ path, std::ios::binary } << text;
+	return path;
+}
+
+static ModelLoadOptions Uncached(ModelLoadMode mode) {
+	ModelLoadOptions options;
+	options.mode = mode;
+	options.threadCount = 1;
+	options.useCache = false;
+	options.optimise = false;
+	return options;
+}
+
+static bool SameOutput(ModelLoader& a, ModelLoader& b) {
+	return a.GetVertexCount() == b.GetVertexCount() && a.GetIndexCount() == b.GetIndexCount()
+		&& memcmp(a.GetVertexData(), b.GetVertexData(), a.GetVertexBufferSize()) == 0
+		&& memcmp(a.GetIndexData(), b.GetIndexData(), a.GetIndexBufferSize()) == 0;
+}
+
+//two quads, each face written after the elements it uses. the negative file points at the
+//same elements counting back from the last one read, so both have to load the same
+static const char* absoluteObj =
+	"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+	"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 -1\n"
+	"f 1/1/1 2/2/1 3/3/1\nf 1/1/1 3/3/1 4/4/1\n"
+	"v 0 0 1\nv 1 0 1\nv 1 1 1\nvn 0 0 1\n"
+	"f 5/1/2 7/3/2 6/2/2\nf 5/1/2 4/4/2 7/3/2\n";
+static const char* negativeObj =
+	"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+	"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 -1\n"
+	"f -4/-4/-1 -3/-3/-1 -2/-2/-1\nf -4/-4/-1 -2/-2/-1 -1/-1/-1\n"
+	"v 0 0 1\nv 1 0 1\nv 1 1 1\nvn 0 0 1\n"
+	"f -3/-4/-1 -1/-2/-1 -2/-3/-1\nf -3/-4/-1 -4/-1/-1 -1/-2/-1\n";
+
+TEST(ModelLoader_NegativeIndicesMatchAbsolute) {
+	std::string absolutePath = WriteTemp("agp_test_absolute.obj", absoluteObj);
+	std::string negativePath = WriteTemp("agp_test_negative.obj", negativeObj);
+	for (ModelLoadMode mode : { ModelLoadMode::STREAM, ModelLoadMode::MAPPED }) {
+		ModelLoader absolute{ absolutePath, Uncached(mode) };
+		ModelLoader negative{ negativePath, Uncached(mode) };
+		CHECK(absolute.GetIndexCount() == 12);
+		CHECK(absolute.GetVertexCount() == 8);
+		CHECK(SameOutput(absolute, negative));
+	}
+}
+
+TEST(ModelLoader_NegativeIndexBeforeFirstFails) {
+	std::string path = WriteTemp("agp_test_negative_bad.obj", "v 0 0 0\nv 1 0 0\nv 1 1 0\nf -1 -2 -4\n");
+	for (ModelLoadMode mode : { ModelLoadMode::STREAM, ModelLoadMode::MAPPED }) {
+		ModelLoader loaded{ path, Uncached(mode) };
+		CHECK(loaded.GetIndexCount() == 0);
+	}
+}
+
+//the cached copy of a small model, cooked fresh
+static std::string CookedQuads(ModelLoadOptions& options) {
+	std::string path = WriteTemp("agp_test_cached.obj", absoluteObj);
+	std::error_code error;
+	std::filesystem::remove(path + ".meshbin", error);
+	options = Uncached(ModelLoadMode::MAPPED);
+	options.useCache = true;
+	ModelLoader cooking{ path, options };
+	return path;
+}
+
+static std::string ReadFile(const std::string& path) {
+	std::ifstream file{ path, std::ios::binary };
+	return std::string{ std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>() };
+}
+
+static void WriteFile(const std::string& path, const std::string& bytes) {
+	std::ofstream{ path, std::ios::binary | std::ios::trunc } << bytes;
+}
+
+//a touched but unchanged model hits the cache, and the cache takes its new time so only the
+//first load after touching it has to hash the model
+TEST(ModelLoader_TouchedSourceUpdatesCacheTime) {
+	ModelLoadOptions options;
+	std::string path = CookedQuads(options);
+	std::string cooked = ReadFile(path + ".meshbin");
+
+	std::error_code error;
+	std::filesystem::last_write_time(path, std::filesystem::last_write_time(path, error) + std::chrono::hours(1), error);
+	ModelLoader touched{ path, options };
+	CHECK(touched.IsFromCache());
+	std::string updated = ReadFile(path + ".meshbin");
+	CHECK(updated.size() == cooked.size());
+	CHECK(updated != cooked);
+
+	ModelLoader again{ path, options };
+	CHECK(again.IsFromCache());
+	CHECK(ReadFile(path + ".meshbin") == updated);
+}
+
+//offsets the header can't have written fall back to parsing the model instead of reading
+//outside the blob
+TEST(ModelLoader_CorruptCacheReparses) {
+	ModelLoadOptions options;
+	std::string path = CookedQuads(options);
+	ModelLoader parsed{ path, Uncached(ModelLoadMode::MAPPED) };
+	std::string cooked = ReadFile(path + ".meshbin");
+
+	//the header ends with the vertex and index offsets, 8 bytes each, then comes the path
+	size_t pathAt = cooked.find(ModelLoader::CanonicalPath(path));
+	CHECK(pathAt != std::string::npos && pathAt >= 16);
+	size_t offsetsAt = pathAt - 16;
+
+	const uint64_t badOffsets[] = { 0, ~(uint64_t)0 - 15, cooked.size() };
+	for (uint64_t bad : badOffsets) {
+		std::string corrupt = cooked;
+		memcpy(&corrupt[offsetsAt], &bad, sizeof(bad));
+		WriteFile(path + ".meshbin", corrupt);
+		ModelLoader loaded{ path, options };
+		CHECK(!loaded.IsFromCache());
+		CHECK(SameOutput(loaded, parsed));
+	}
+
+	WriteFile(path + ".meshbin", cooked.substr(0, cooked.size() - 4));
+	ModelLoader truncated{ path, options };
+	CHECK(!truncated.IsFromCache());
+	CHECK(SameOutput(truncated, parsed));
+}
\ No newline at end of file
@@ -0,0 +1,110 @@
+#include <vector>
+#include <algorithm>
+#include <DirectXMath.h>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "Golden.h"
+#include "OcclusionBuffer.h"
+#include "ThreadPool.h"
+
+using namespace DirectX;
+
+static const float nearZ = 0.1f;
+static const float farZ = 100.0f;
+
+//camera at the origin looking down +z with two spheres in view, the left one nearer and
+//partly in front of the right
+static void RasteriseScene(OcclusionBuffer& buffer, ThreadPool& pool, unsigned int maxThreads) {
+	std::vector<VertexPosUVNorm> vertices;
+	std::vector<unsigned int> indices;
+	TestMeshes::UvSphere(12, 24, vertices, indices);
+	OccluderMesh sphere;
+	for (const VertexPosUVNorm& v : vertices) {
+		sphere.vertices.push_back(v.pos);
+	}
+	sphere.indices.assign(indices.begin(), indices.end());
+
+	XMMATRIX viewProjection = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0))
+		* XMMatrixPerspectiveFovLH(XMConvertToRadians(60), (float)buffer.GetWidth() / buffer.GetHeight(), nearZ, farZ);
+	buffer.Begin(viewProjection);
+	buffer.AddOccluder(sphere, XMMatrixScaling(1.5f, 1.5f, 1.5f) * XMMatrixTranslation(-1.5f, 0, 6));
+	buffer.AddOccluder(sphere, XMMatrixScaling(2.5f, 2.5f, 2.5f) * XMMatrixTranslation(2, 0.5f, 10));
+	buffer.Rasterise(pool, maxThreads);
+}
+
+//depth back to distance along the view, then near white to black over 2 to 22 units. the far
+//plane's black
+static std::vector<uint32_t> DepthImage(OcclusionBuffer& buffer) {
+	std::vector<uint32_t> image;
+	const float* depth = buffer.GetDepth();
+	for (int i = 0; i < buffer.GetWidth() * buffer.GetHeight(); i++) {
+		float z = nearZ / (1 - depth[i] * (farZ - nearZ) / farZ);
+		uint32_t grey = (uint32_t)(255 * std::min(std::max(1 - (z - 2) / 20, 0.0f), 1.0f) + 0.5f);
+		image.push_back(grey | (grey << 8) | (grey << 16) | 0xFF000000);
+	}
+	return image;
+}
+
+TEST(OcclusionBuffer_DepthMatchesGolden) {
+	ThreadPool pool(3, "Test occlusion");
+	OcclusionBuffer buffer(128, 64);
+	RasteriseScene(buffer, pool, 0);
+	std::vector<uint32_t> image = DepthImage(buffer);
+	CHECK(Golden::Matches("occlusion_depth", buffer.GetWidth(), buffer.GetHeight(), image.data(), buffer.GetWidth()));
+	CHECK(buffer.GetStats().occluders == 2);
+	CHECK(buffer.GetStats().trianglesRasterised > 0);
+
+	//one thread draws exactly the same
+	OcclusionBuffer single(128, 64);
+	RasteriseScene(single, pool, 1);
+	CHECK(std::equal(buffer.GetDepth(), buffer.GetDepth() + 128 * 64, single.GetDepth()));
+}
+
+//every texel holds the farthest of the ones under it, so a test against a coarse level can
+//never see more occlusion than the full one has
+TEST(OcclusionBuffer_PyramidKeepsTheFarthest) {
+	ThreadPool pool(3, "Test occlusion");
+	OcclusionBuffer buffer(128, 64);
+	RasteriseScene(buffer, pool, 0);
+	CHECK(buffer.GetLevelCount() > 4);
+	for (size_t level = 1; level < buffer.GetLevelCount(); level++) {
+		int w = buffer.GetLevelWidth(level), h = buffer.GetLevelHeight(level);
+		int belowW = buffer.GetLevelWidth(level - 1), belowH = buffer.GetLevelHeight(level - 1);
+		const float* depth = buffer.GetDepth(level);
+		const float* below = buffer.GetDepth(level - 1);
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				float farthest = 0;
+				for (int by = y * 2; by < std::min(y * 2 + 2, belowH); by++) {
+					for (int bx = x * 2; bx < std::min(x * 2 + 2, belowW); bx++) {
+						farthest = std::max(farthest, below[by * belowW + bx]);
+					}
+				}
+				CHECK(depth[y * w + x] >= farthest);
+			}
+		}
+	}
+}
+
+TEST(OcclusionBuffer_BoxesBehindOccluders) {
+	ThreadPool pool(3, "Test occlusion");
+	OcclusionBuffer buffer(128, 64);
+	RasteriseScene(buffer, pool, 0);
+
+	CHECK(!buffer.IsVisible({ -1.8f, -0.3f, 9 }, { -1.2f, 0.3f, 9.6f })); //right behind the near sphere
+	CHECK(!buffer.IsVisible({ 1.5f, 0, 15 }, { 2.5f, 1, 16 })); //behind the far one
+	CHECK(buffer.IsVisible({ -1.8f, -0.3f, 3 }, { -1.2f, 0.3f, 3.6f })); //in front of the near one
+	CHECK(buffer.IsVisible({ -0.2f, 3, 8 }, { 0.2f, 3.4f, 8.4f })); //above both, nothing there
+	CHECK(buffer.IsVisible({ -1, -1, -1 }, { 1, 1, 1 })); //around the camera
+	CHECK(buffer.GetStats().objectsTested == 5);
+	CHECK(buffer.GetStats().objectsOccluded == 2);
+
+	SphereList spheres;
+	spheres.Add({ -1.5f, 0, 9.3f }, 0.3f);
+	spheres.Add({ -1.5f, 0, 3.3f }, 0.3f);
+	spheres.Add({ 0, 3.2f, 8.2f }, 0.2f);
+	std::vector<uint8_t> visible{ 1, 1, 0 };
+	CHECK(buffer.CullSpheres(spheres, visible) == 1);
+	CHECK(visible[0] == 0 && visible[1] == 1 && visible[2] == 0); //the last was already culled
+}
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <set>
+
+#include "Test.h"
+#include "Profiler.h"
+
+//every other test's zones go into the same rings, so each case looks for names only it uses
+static std::vector<Profiler::Event> Named(const char* name) {
+	std::vector<Profiler::Event> events, named;
+	Profiler::Collect(events);
+	for (const Profiler::Event& event : events) {
+		if (strcmp(event.name, name) == 0)
+			named.push_back(event);
+	}
+	return named;
+}
+
+TEST(Profiler_ZonesNestAndTime) {
+	uint64_t before = Profiler::Now();
+	{
+		PROFILE_ZONE("Profiler test outer");
+		PROFILE_ZONE("Profiler test inner");
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	uint64_t after = Profiler::Now();
+
+	std::vector<Profiler::Event> outer = Named("Profiler test outer");
+	std::vector<Profiler::Event> inner = Named("Profiler test inner");
+	CHECK(outer.size() == 1 && inner.size() == 1);
+	if (outer.size() != 1 || inner.size() != 1)
+		return;
+	CHECK(outer[0].startNs >= before && outer[0].endNs <= after);
+	CHECK(inner[0].startNs >= outer[0].startNs && inner[0].endNs <= outer[0].endNs);
+	CHECK(inner[0].endNs - inner[0].startNs >= 2000000);
+	CHECK(inner[0].depth == outer[0].depth + 1);
+	CHECK(inner[0].thread == outer[0].thread);
+}
+
+TEST(Profiler_EndEarlyAndDisabled) {
+	{
+		Profiler::Zone zone("Profiler test ended");
+		zone.End();
+		zone.End(); //does nothing the second time
+		PROFILE_ZONE("Profiler test after end");
+	}
+	std::vector<Profiler::Event> ended = Named("Profiler test ended");
+	std::vector<Profiler::Event> afterEnd = Named("Profiler test after end");
+	CHECK(ended.size() == 1);
+	CHECK(afterEnd.size() == 1);
+	if (ended.size() == 1 && afterEnd.size() == 1) {
+		CHECK(afterEnd[0].depth == ended[0].depth); //ending closed its level too
+		CHECK(afterEnd[0].startNs >= ended[0].endNs);
+	}
+
+	Profiler::SetEnabled(false);
+	{
+		PROFILE_ZONE("Profiler test disabled");
+	}
+	Profiler::RecordGpu("Profiler test disabled", 0, 1, 0);
+	Profiler::SetEnabled(true);
+	CHECK(Named("Profiler test disabled").empty());
+}
+
+//threads record side by side without locks, each onto its own track
+TEST(Profiler_ThreadsGetTheirOwnRings) {
+	const int threadCount = 4;
+	const int zonesPerThread = 1000;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++) {
+		threads.emplace_back([&]() {
+			for (int i = 0; i < zonesPerThread; i++) {
+				PROFILE_ZONE("Profiler test threaded");
+			}
+		});
+	}
+	for (std::thread& thread : threads) {
+		thread.join();
+	}
+
+	std::vector<Profiler::Event> events = Named("Profiler test threaded");
+	CHECK(events.size() == threadCount * zonesPerThread);
+	std::set<uint32_t> ids;
+	for (const Profiler::Event& event : events) {
+		ids.insert(event.thread);
+		CHECK(event.endNs >= event.startNs);
+	}
+	CHECK(ids.size() == threadCount);
+	CHECK(ids.count(Profiler::gpuThread) == 0);
+}
+
+//a ring that's gone round keeps its newest events, one ring's worth
+TEST(Profiler_FullRingKeepsTheNewest) {
+	const int zones = 40000;
+	std::thread([&]() {
+		for (int i = 0; i < zones; i++) {
+			PROFILE_ZONE("Profiler test wrap");
+		}
+		PROFILE_ZONE("Profiler test wrap last");
+	}).join();
+
+	std::vector<Profiler::Event> wrapped = Named("Profiler test wrap");
+	CHECK(!wrapped.empty());
+	CHECK(wrapped.size() < zones);
+	CHECK(Named("Profiler test wrap last").size() == 1);
+}
+
+TEST(Profiler_GpuEventsAndChromeTrace) {
+	uint64_t now = Profiler::Now();
+	Profiler::RecordGpu("Profiler test gpu", now, now + 5000, 1);
+	std::vector<Profiler::Event> gpu = Named("Profiler test gpu");
+	CHECK(gpu.size() == 1);
+	if (gpu.size() == 1) {
+		CHECK(gpu[0].thread == Profiler::gpuThread);
+		CHECK(gpu[0].depth == 1);
+		CHECK(gpu[0].endNs - gpu[0].startNs == 5000);
+	}
+
+	{
+		PROFILE_ZONE("Profiler test \"quoted\"");
+	}
+	std::error_code error;
+	std::string path = (std::filesystem::temp_directory_path(error) / "agp_test_profile.json").string();
+	CHECK(Profiler::ExportChromeTrace(path));
+	std::stringstream json;
+	json << std::ifstream{ path }.rdbuf();
+	std::string text = json.str();
+	CHECK(text.rfind("{\"traceEvents\":[", 0) == 0);
+	CHECK(text.find("\"name\":\"Profiler test gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":65535") != std::string::npos);
+	CHECK(text.find("Profiler test \\\"quoted\\\"") != std::string::npos);
+	CHECK(text.find("\n]}") != std::string::npos);
+	std::filesystem::remove(path, error);
+}
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include <vector>
+#include <map>
+#include <cstring>
+#include <iterator>
+
+#include "Test.h"
+#include "RangeAllocator.h"
+
+TEST(RangeAllocator_FreeingEveryOtherFragments) {
+	RangeAllocator ranges(1000);
+	unsigned int offsets[10];
+	for (unsigned int& offset : offsets) {
+		offset = ranges.Allocate(100);
+	}
+	CHECK(ranges.GetUsed() == 1000);
+	CHECK(ranges.Allocate(1) == RangeAllocator::invalid);
+
+	//half the space free but no two holes touching, so nothing over 100 fits
+	for (int i = 0; i < 10; i += 2) {
+		ranges.Free(offsets[i]);
+	}
+	CHECK(ranges.GetUsed() == 500);
+	CHECK(ranges.GetFreeRangeCount() == 5);
+	CHECK(ranges.GetLargestFree() == 100);
+	CHECK(ranges.Allocate(150) == RangeAllocator::invalid);
+
+	//freeing one in between joins it with both neighbours
+	ranges.Free(offsets[1]);
+	CHECK(ranges.GetFreeRangeCount() == 4);
+	CHECK(ranges.GetLargestFree() == 300);
+
+	//best fit takes an exact 100 hole and leaves the 300 whole
+	unsigned int exact = ranges.Allocate(100);
+	CHECK(exact != offsets[0] && exact != offsets[1] && exact != offsets[2]);
+	CHECK(ranges.GetLargestFree() == 300);
+	CHECK(ranges.Allocate(150) == offsets[0]);
+}
+
+TEST(RangeAllocator_CompactLeavesOneFreeRange) {
+	RangeAllocator ranges(1000);
+	std::vector<unsigned int> offsets;
+	for (unsigned int size = 10; size <= 120; size += 10) {
+		offsets.push_back(ranges.Allocate(size));
+	}
+	for (size_t i = 0; i < offsets.size(); i += 3) {
+		ranges.Free(offsets[i]);
+	}
+	CHECK(ranges.GetFreeRangeCount() > 1);
+
+	//every range filled with its own byte, copied the way GeometryPool copies them
+	std::vector<unsigned char> buffer(1000, 0);
+	std::map<unsigned int, unsigned char> fill;
+	unsigned char value = 1;
+	for (size_t i = 0; i < offsets.size(); i++) {
+		if (i % 3 == 0)
+			continue;
+		unsigned int size = (unsigned int)(i + 1) * 10;
+		memset(&buffer[offsets[i]], value, size);
+		fill[offsets[i]] = value++;
+	}
+
+	unsigned int used = ranges.GetUsed();
+	size_t allocations = ranges.GetAllocationCount();
+	std::vector<RangeAllocator::Move> moves = ranges.Compact();
+	unsigned int lastTo = 0;
+	for (const RangeAllocator::Move& move : moves) {
+		CHECK(move.to < move.from);
+		CHECK(move.to >= lastTo);
+		lastTo = move.to;
+		memmove(&buffer[move.to], &buffer[move.from], move.size);
+	}
+
+	CHECK(ranges.GetUsed() == used);
+	CHECK(ranges.GetAllocationCount() == allocations);
+	CHECK(ranges.GetFreeRangeCount() == 1);
+	CHECK(ranges.GetLargestFree() == 1000 - used);
+
+	//the ranges are in the same order as before, packed from 0
+	unsigned int cursor = 0;
+	for (auto& range : fill) {
+		size_t index = 0;
+		while (offsets[index] != range.first) index++;
+		unsigned int size = (unsigned int)(index + 1) * 10;
+		for (unsigned int i = cursor; i < cursor + size; i++) {
+			CHECK(buffer[i] == range.second);
+		}
+		cursor += size;
+	}
+	CHECK(cursor == used);
+}
+
+//random sizes in and out for a while, the way meshes come and go. nothing handed out overlaps,
+//and once it's all freed the space is whole again
+TEST(RangeAllocator_ChurnNeverOverlaps) {
+	const unsigned int capacity = 1 << 16;
+	RangeAllocator ranges(capacity);
+	std::vector<unsigned char> owner(capacity, 0);
+	std::map<unsigned int, unsigned int> live; //offset to size
+	unsigned int seed = 99;
+	auto next = [&]() { seed = seed * 1664525u + 1013904223u; return seed >> 8; };
+
+	size_t failures = 0;
+	for (int step = 0; step < 20000; step++) {
+		if (live.empty() || next() % 3 != 0) {
+			unsigned int size = 1 + next() % 1024;
+			unsigned int offset = ranges.Allocate(size);
+			if (offset == RangeAllocator::invalid) {
+				CHECK(ranges.GetLargestFree() < size);
+				failures++;
+				//out of room, free something instead
+				auto victim = live.begin();
+				std::advance(victim, next() % live.size());
+				memset(&owner[victim->first], 0, victim->second);
+				ranges.Free(victim->first);
+				live.erase(victim);
+				continue;
+			}
+			CHECK(offset + size <= capacity);
+			bool clear = true;
+			for (unsigned int i = offset; i < offset + size; i++) {
+				clear = clear && owner[i] == 0;
+			}
+			CHECK(clear);
+			memset(&owner[offset], 1, size);
+			live[offset] = size;
+		}
+		else {
+			auto victim = live.begin();
+			std::advance(victim, next() % live.size());
+			memset(&owner[victim->first], 0, victim->second);
+			ranges.Free(victim->first);
+			live.erase(victim);
+		}
+
+		unsigned int used = 0;
+		for (auto& range : live) {
+			used += range.second;
+		}
+		CHECK(ranges.GetUsed() == used);
+	}
+	CHECK(failures > 0); //it did run full and fragment
+
+	for (auto& range : live) {
+		ranges.Free(range.first);
+	}
+	CHECK(ranges.GetUsed() == 0);
+	CHECK(ranges.GetFreeRangeCount() == 1);
+	CHECK(ranges.GetLargestFree() == capacity);
+}
+
+TEST(RangeAllocator_GrowJoinsTheFreeEnd) {
+	RangeAllocator ranges(100);
+	unsigned int first = ranges.Allocate(60);
+	CHECK(first == 0);
+	ranges.Grow(200);
+	CHECK(ranges.GetCapacity() == 200);
+	CHECK(ranges.GetFreeRangeCount() == 1);
+	CHECK(ranges.GetLargestFree() == 140);
+	ranges.Grow(150); //never shrinks
+	CHECK(ranges.GetCapacity() == 200);
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "Test.h"
+#include "RingAllocator.h"
+
+TEST(RingAllocator_AlignsSizes) {
+	CHECK(RingAllocator::Align(1) == 256);
+	CHECK(RingAllocator::Align(256) == 256);
+	CHECK(RingAllocator::Align(257) == 512);
+
+	//capacity rounds down to whole blocks
+	RingAllocator ring(1000);
+	CHECK(ring.GetCapacity() == 768);
+
+	RingAllocator::Span span;
+	CHECK(!ring.Allocate(0, span));
+	CHECK(!ring.Allocate(769, span)); //1024 once aligned, can never fit
+}
+
+//the first span after a reset discards, then the rest append until one doesn't fit before the
+//end. that one starts back at 0 and discards again, and only that one
+TEST(RingAllocator_WrapsAndDiscards) {
+	RingAllocator ring(4 * 256);
+	RingAllocator::Span span;
+
+	CHECK(ring.Allocate(100, span));
+	CHECK(span.offset == 0 && span.size == 256 && span.discard);
+	CHECK(ring.Allocate(300, span));
+	CHECK(span.offset == 256 && span.size == 512 && !span.discard);
+	CHECK(ring.GetHead() == 768);
+	CHECK(ring.GetWrapCount() == 0);
+
+	//512 would run past 1024, so it wraps rather than splitting
+	CHECK(ring.Allocate(512, span));
+	CHECK(span.offset == 0 && span.size == 512 && span.discard);
+	CHECK(ring.GetWrapCount() == 1);
+	CHECK(ring.Allocate(256, span));
+	CHECK(span.offset == 512 && !span.discard);
+
+	//exactly filling the end doesn't wrap, the next one does
+	CHECK(ring.Allocate(256, span));
+	CHECK(span.offset == 768 && !span.discard);
+	CHECK(ring.GetHead() == 1024);
+	CHECK(ring.Allocate(1, span));
+	CHECK(span.offset == 0 && span.discard);
+	CHECK(ring.GetWrapCount() == 2);
+}
+
+TEST(RingAllocator_ResetStartsFresh) {
+	RingAllocator ring(1024);
+	RingAllocator::Span span;
+	ring.Allocate(512, span);
+	ring.Allocate(512, span);
+	ring.Allocate(512, span);
+	CHECK(ring.GetWrapCount() == 1);
+
+	//a bigger buffer, everything before is forgotten. wraps are a running total
+	ring.Reset(2048);
+	CHECK(ring.GetCapacity() == 2048);
+	CHECK(ring.GetHead() == 0);
+	CHECK(ring.Allocate(256, span));
+	CHECK(span.offset == 0 && span.discard);
+	CHECK(ring.Allocate(256, span));
+	CHECK(!span.discard);
+	CHECK(ring.GetWrapCount() == 1);
+}
+
+//a frame's worth of per object constants at a time, the way the ConstantBufferRing uses it. over
+//many frames every span stays inside the buffer and only spans at offset 0 discard
+TEST(RingAllocator_ManyFramesStayInBounds) {
+	RingAllocator ring(64 * 1024);
+	RingAllocator::Span span;
+	unsigned int lastEnd = 0;
+	for (int frame = 0; frame < 100; frame++) {
+		for (int object = 0; object < 37; object++) {
+			CHECK(ring.Allocate(64 + object * 8, span));
+			CHECK(span.offset % RingAllocator::alignment == 0);
+			CHECK(span.offset + span.size <= ring.GetCapacity());
+			CHECK(span.discard == (span.offset == 0));
+			CHECK(span.discard || span.offset == lastEnd);
+			lastEnd = span.offset + span.size;
+		}
+	}
+	CHECK(ring.GetWrapCount() > 10);
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <filesystem>
+#include <DirectXMath.h>
+
+#include "Test.h"
+#include "TestMeshes.h"
+#include "Golden.h"
+#include "SoftwareRasteriser.h"
+#include "ThreadPool.h"
+#include "Texture.h"
+#include "Renderer.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "GameObject.h"
+#include "Benchmarks.h"
+
+using namespace DirectX;
+
+//the game camera at (0, 0, -5) looking down +z at a 160x120 image
+static const int width = 160;
+static const int height = 120;
+
+static XMMATRIX ViewProjection() {
+	return XMMatrixLookToLH(XMVectorSet(0, 0, -5, 1), XMVectorSet(0, 0, 1, 0), XMVectorSet(0, 1, 0, 0))
+		* XMMatrixPerspectiveFovLH(XMConvertToRadians(60), (float)width / height, 0.1f, 100.0f);
+}
+
+//8x8 checks of orange and blue
+static TextureData Checker() {
+	TextureData texture;
+	texture.width = 8;
+	texture.height = 8;
+	for (unsigned int y = 0; y < texture.height; y++) {
+		for (unsigned int x = 0; x < texture.width; x++) {
+			bool odd = (x + y) & 1;
+			texture.pixels.insert(texture.pixels.end(), { (uint8_t)(odd ? 240 : 40), (uint8_t)(odd ? 140 : 90), (uint8_t)(odd ? 20 : 220), 255 });
+		}
+	}
+	return texture;
+}
+
+//a textured sphere on the left, a tinted untextured one on the right, and a see through blue
+//one in front of both where they meet. finishEach shades after every draw like agp_replay's
+//per-draw mode does
+static void DrawScene(SoftwareRasteriser& rasteriser, ThreadPool& pool, unsigned int maxThreads, bool finishEach) {
+	std::vector<VertexPosUVNorm> vertices;
+	std::vector<unsigned int> indices;
+	TestMeshes::UvSphere(16, 32, vertices, indices);
+	TextureData checker = Checker();
+
+	struct Object { XMFLOAT3 position; float scale; const TextureData* texture; XMFLOAT4 colour; bool transparent; };
+	const Object objects[] = {
+		{ { -1.2f, 0, 0 }, 1, &checker, { 1, 1, 1, 1 }, false },
+		{ { 1.2f, 0.3f, 0.5f }, 1, nullptr, { 1, 0.6f, 0.6f, 1 }, false },
+		{ { 0, -0.2f, -1.5f }, 0.6f, nullptr, { 0.2f, 0.4f, 1, 0.5f }, true },
+	};
+
+	rasteriser.Begin(ViewProjection(), { 0.0f, 0.4f, 0.3f, 1.0f });
+	for (const Object& object : objects) {
+		XMMATRIX world = XMMatrixScaling(object.scale, object.scale, object.scale) * XMMatrixTranslation(object.position.x, object.position.y, object.position.z);
+		rasteriser.Draw(vertices.data(), vertices.size(), indices.data(), indices.size(), world, object.texture, object.colour, object.transparent);
+		if (finishEach)
+			rasteriser.Finish(pool, maxThreads);
+	}
+	rasteriser.Finish(pool, maxThreads);
+}
+
+TEST(SoftwareRasteriser_SceneMatchesGolden) {
+	ThreadPool pool(3, "Test raster");
+	SoftwareRasteriser rasteriser(width, height);
+	DrawScene(rasteriser, pool, 0, false);
+	CHECK(Golden::Matches("software_scene", width, height, rasteriser.GetColour(), rasteriser.GetStride()));
+
+	const SoftwareRasteriserStats& stats = rasteriser.GetStats();
+	CHECK(stats.draws == 3);
+	CHECK(stats.trianglesSubmitted == 3 * 16 * 32 * 2);
+	//from 5 units away only about 40% of a sphere faces the camera, and the slivers at the poles
+	//have no area at all
+	CHECK(stats.trianglesRasterised > stats.trianglesSubmitted / 4);
+	CHECK(stats.trianglesRasterised < stats.trianglesSubmitted / 2);
+	CHECK(stats.pixelsShaded == rasteriser.GetDrawPixels(0) + rasteriser.GetDrawPixels(1) + rasteriser.GetDrawPixels(2));
+	CHECK(rasteriser.GetDrawPixels(2) > 0);
+}
+
+//tiles are shaded in parallel but each one in submission order, so the thread count and
+//finishing after every draw mustn't change a single pixel
+TEST(SoftwareRasteriser_SameImageOnAnyThreads) {
+	ThreadPool pool(3, "Test raster");
+	SoftwareRasteriser single(width, height), threaded(width, height), perDraw(width, height);
+	DrawScene(single, pool, 1, false);
+	DrawScene(threaded, pool, 0, false);
+	DrawScene(perDraw, pool, 0, true);
+
+	size_t threadedDiffer = 0, perDrawDiffer = 0;
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			size_t i = (size_t)y * single.GetStride() + x;
+			threadedDiffer += single.GetColour()[i] != threaded.GetColour()[i] || single.GetDepth()[i] != threaded.GetDepth()[i];
+			perDrawDiffer += single.GetColour()[i] != perDraw.GetColour()[i];
+		}
+	}
+	CHECK(threadedDiffer == 0);
+	CHECK(perDrawDiffer == 0);
+	CHECK(single.GetStats().pixelsShaded == perDraw.GetStats().pixelsShaded);
+}
+
+//the renderer's SOFTWARE backend draws what its own submission kept: a red sphere ahead is
+//drawn in its material's colour, one behind the camera is culled before it gets there, and the
+//depth pre-pass doesn't change a pixel
+TEST(SoftwareRasteriser_SoftwareBackendDrawsSubmittedFrame) {
+	std::error_code error;
+	std::string model = (std::filesystem::temp_directory_path(error) / "agp_test_sphere.obj").string();
+	CHECK(Benchmarks::WriteSphereObj(model, 8, 16));
+
+	Renderer renderer{ width, height, RenderBackend::SOFTWARE };
+	std::shared_ptr<Mesh> mesh = renderer.GetAssets().LoadMesh(model);
+	renderer.GetAssets().WaitAll();
+	CHECK(mesh->IsResident());
+
+	std::shared_ptr<Material> red = std::make_shared<Material>();
+	red->colour = XMFLOAT4(1, 0, 0, 1);
+	GameObject ahead{ "Ahead", mesh };
+	ahead.material = red;
+	ahead.transform.SetPosition(XMVectorSet(0, 0, 5, 1));
+	GameObject behind{ "Behind", mesh };
+	behind.transform.SetPosition(XMVectorSet(0, 0, -5, 1));
+	renderer.RegisterGameObject(&ahead);
+	renderer.RegisterGameObject(&behind);
+
+	renderer.RenderFrame();
+	SoftwareRasteriser& rasteriser = renderer.GetSoftwareRasteriser();
+	CHECK(rasteriser.GetWidth() == width && rasteriser.GetHeight() == height);
+	CHECK(renderer.GetFrameStats().objectsCulled == 1);
+	CHECK(rasteriser.GetStats().draws == 1);
+	CHECK(rasteriser.GetStats().pixelsShaded > 0);
+	const uint32_t* colour = rasteriser.GetColour();
+	CHECK(colour[(height / 2) * rasteriser.GetStride() + width / 2] == 0xFF0000FF);
+	CHECK(colour[0] != 0xFF0000FF);
+
+	std::vector<uint32_t> plain(colour, colour + (size_t)rasteriser.GetStride() * height);
+	renderer.depthPrepass = true;
+	renderer.RenderFrame();
+	CHECK(renderer.GetFrameStats().depthPrepassDraws > 0);
+	CHECK(std::equal(plain.begin(), plain.end(), rasteriser.GetColour()));
+
+	renderer.RemoveGameObject(&ahead);
+	renderer.RemoveGameObject(&behind);
+	renderer.Clean();
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cmath>
+
+//just enough of a test runner for the headless modules. each Tests/*Tests.cpp registers its
+//cases with TEST, named <Module>_<what it checks>, and agp_tests <Module> runs the ones starting
+//with that. a failed CHECK prints where and carries on with the rest of the case
+namespace Test {
+	struct Case
+	{
+		const char* name;
+		void (*run)();
+	};
+
+	std::vector<Case>& GetCases();
+	void Fail(const char* file, int line, const std::string& what);
+
+	struct Register
+	{
+		Register(const char* name, void (*run)()) { GetCases().push_back({ name, run }); }
+	};
+}
+
+#define TEST(name) \
+	static void name(); \
+	static Test::Register name##_register{ #name, name }; \
+	static void name()
+
+#define CHECK_NEAR(a, b, tolerance) \
+	do { if (!(std::fabs((double)(a) - (double)(b)) <= (tolerance))) Test::Fail(__FILE__, __LINE__, \
+		#a " = " + std::to_string((double)(a)) + ", expected " + std::to_string((double)(b))); } while (0)
+
+#define CHECK(condition) do { if (!(condition)) Test::Fail(__FILE__, __LINE__, #condition); } while (0)
\ No newline at end of file
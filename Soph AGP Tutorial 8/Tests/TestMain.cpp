@@ -0,0 +1,43 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+
+#include "Test.h"
+
+namespace Test {
+	static int failures = 0;
+
+	std::vector<Case>& GetCases() {
+		static std::vector<Case> cases; //filled in by static constructors, so made on first use
+		return cases;
+	}
+
+	void Fail(const char* file, int line, const std::string& what) {
+		std::cout << file << "(" << line << "): CHECK failed: " << what << std::endl;
+		failures++;
+	}
+}
+
+//agp_tests [prefix], runs every case, or the ones whose names start with prefix. ctest runs it
+//once per module from the project folder, like the other tools
+int main(int argc, char** argv) {
+	const char* prefix = argc > 1 ? argv[1] : "";
+	int run = 0;
+	int failed = 0;
+	for (const Test::Case& test : Test::GetCases()) {
+		if (strncmp(test.name, prefix, strlen(prefix)) != 0)
+			continue;
+		int failuresBefore = Test::failures;
+		test.run();
+		run++;
+		if (Test::failures != failuresBefore) {
+			std::cout << "FAILED " << test.name << std::endl;
+			failed++;
+		}
+	}
+
+	std::cout << run - failed << " of " << run << " passed" << std::endl;
+	if (run == 0)
+		std::cout << "No tests start with \"" << prefix << "\"" << std::endl;
+	return failed == 0 && run > 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <DirectXMath.h>
+
+#include "ModelLoader.h"
+
+//meshes built in memory for the tests, so none of them depend on Assets/
+namespace TestMeshes {
+	//radius 1 uv sphere around the origin, 2 * rings * segments triangles. wound so (b - a) x (c - a)
+	//points outwards, which is the front face to the renderer. the triangles touching the poles
+	//have two corners in the same place
+	inline void UvSphere(int rings, int segments, std::vector<VertexPosUVNorm>& vertices, std::vector<unsigned int>& indices) {
+		const float pi = 3.14159265f;
+		vertices.clear();
+		indices.clear();
+		for (int r = 0; r <= rings; r++) {
+			float theta = pi * r / rings;
+			for (int s = 0; s <= segments; s++) {
+				float phi = 2 * pi * s / segments;
+				DirectX::XMFLOAT3 p{ sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi) };
+				vertices.push_back({ p, { (float)s / segments, (float)r / rings }, p });
+			}
+		}
+
+		auto corner = [&](int r, int s) { return (unsigned int)(r * (segments + 1) + s); };
+		auto add = [&](unsigned int a, unsigned int b, unsigned int c) {
+			DirectX::XMVECTOR pa = DirectX::XMLoadFloat3(&vertices[a].pos);
+			DirectX::XMVECTOR n = DirectX::XMVector3Cross(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&vertices[b].pos), pa),
+				DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&vertices[c].pos), pa));
+			if (DirectX::XMVectorGetX(DirectX::XMVector3Dot(n, pa)) < 0)
+				std::swap(b, c);
+			indices.insert(indices.end(), { a, b, c });
+		};
+		for (int r = 0; r < rings; r++) {
+			for (int s = 0; s < segments; s++) {
+				add(corner(r, s), corner(r + 1, s), corner(r + 1, s + 1));
+				add(corner(r, s), corner(r + 1, s + 1), corner(r, s + 1));
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "Test.h"
+#include "VertexFormats.h"
+#include "ModelLoader.h"
+
+//vertices spread through an off centre box, with uvs across 0..1 and unit normals pointing
+//every which way. the same every run
+static std::vector<VertexPosUVNorm> ScatteredVertices(size_t count, DirectX::XMFLOAT3& boundsMin, DirectX::XMFLOAT3& boundsMax) {
+	unsigned int seed = 777;
+	auto next = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f; //0..1
+	};
+
+	std::vector<VertexPosUVNorm> vertices(count);
+	boundsMin = { 1e9f, 1e9f, 1e9f };
+	boundsMax = { -1e9f, -1e9f, -1e9f };
+	for (VertexPosUVNorm& v : vertices) {
+		v.pos = { -2 + next() * 5, -1 + next() * 5, next() * 10 };
+		v.uv = { next(), next() };
+		float z = next() * 2 - 1, angle = next() * 6.2831853f, r = sqrtf(1 - z * z);
+		v.norm = { r * cosf(angle), r * sinf(angle), z };
+		boundsMin = { std::min(boundsMin.x, v.pos.x), std::min(boundsMin.y, v.pos.y), std::min(boundsMin.z, v.pos.z) };
+		boundsMax = { std::max(boundsMax.x, v.pos.x), std::max(boundsMax.y, v.pos.y), std::max(boundsMax.z, v.pos.z) };
+	}
+	return vertices;
+}
+
+static VertexFormats::PackError PackAndMeasure(const std::vector<VertexPosUVNorm>& vertices, VertexLayout layout,
+	DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax) {
+	DirectX::XMFLOAT4X4 dequantise;
+	std::vector<uint8_t> packed = VertexFormats::Pack(vertices.data(), vertices.size(), layout, boundsMin, boundsMax, dequantise);
+	CHECK(packed.size() == vertices.size() * VertexFormats::GetStride(layout));
+	return VertexFormats::MeasureError(vertices.data(), vertices.size(), layout, packed, dequantise);
+}
+
+TEST(VertexFormats_Strides) {
+	CHECK(VertexFormats::GetStride(VertexLayout::FULL) == 32);
+	CHECK(VertexFormats::GetStride(VertexLayout::COMPACT) == 20);
+	CHECK(VertexFormats::GetStride(VertexLayout::QUANTISED) == 16);
+}
+
+TEST(VertexFormats_FullIsLossless) {
+	DirectX::XMFLOAT3 boundsMin, boundsMax;
+	std::vector<VertexPosUVNorm> vertices = ScatteredVertices(1000, boundsMin, boundsMax);
+	VertexFormats::PackError error = PackAndMeasure(vertices, VertexLayout::FULL, boundsMin, boundsMax);
+	CHECK(error.position == 0);
+	CHECK(error.uv == 0);
+	CHECK(error.normalDegrees == 0);
+}
+
+//half floats keep 11 bits, so a uv under 1 is within 2^-12 per component. 16 bit octahedral
+//normals are within a few thousandths of a degree, but MeasureError takes acos of a float dot
+//product, which can't tell anything under about 0.03 degrees from a couple of ulps off 1
+TEST(VertexFormats_CompactErrorBounds) {
+	DirectX::XMFLOAT3 boundsMin, boundsMax;
+	std::vector<VertexPosUVNorm> vertices = ScatteredVertices(1000, boundsMin, boundsMax);
+	VertexFormats::PackError error = PackAndMeasure(vertices, VertexLayout::COMPACT, boundsMin, boundsMax);
+	CHECK(error.position == 0);
+	CHECK(error.uv > 0);
+	CHECK(error.uv <= sqrtf(2.0f) / 4096);
+	CHECK(error.normalDegrees > 0);
+	CHECK(error.normalDegrees < 0.05f);
+}
+
+//positions are snapped to 32767 steps either side of the bounds' centre on each axis, so they
+//can be out by at most half a step on each
+TEST(VertexFormats_QuantisedErrorBounds) {
+	DirectX::XMFLOAT3 boundsMin, boundsMax;
+	std::vector<VertexPosUVNorm> vertices = ScatteredVertices(1000, boundsMin, boundsMax);
+	VertexFormats::PackError error = PackAndMeasure(vertices, VertexLayout::QUANTISED, boundsMin, boundsMax);
+
+	float halfX = (boundsMax.x - boundsMin.x) / 2, halfY = (boundsMax.y - boundsMin.y) / 2, halfZ = (boundsMax.z - boundsMin.z) / 2;
+	float halfStep = sqrtf(halfX * halfX + halfY * halfY + halfZ * halfZ) / 32767 / 2;
+	CHECK(error.position > 0);
+	CHECK(error.position <= halfStep * 1.01f);
+	CHECK(error.uv <= sqrtf(2.0f) / 4096);
+	CHECK(error.normalDegrees < 0.05f);
+}
+
+TEST(VertexFormats_OctahedralRoundTrip) {
+	const DirectX::XMFLOAT3 normals[] = { { 1, 0, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 }, { 0.6f, 0, -0.8f }, { -0.48f, 0.6f, -0.64f } };
+	for (const DirectX::XMFLOAT3& normal : normals) {
+		DirectX::XMFLOAT3 decoded = VertexFormats::DecodeOctahedral(VertexFormats::EncodeOctahedral(normal));
+		CHECK_NEAR(decoded.x, normal.x, 1e-5);
+		CHECK_NEAR(decoded.y, normal.y, 1e-5);
+		CHECK_NEAR(decoded.z, normal.z, 1e-5);
+	}
+}
+
+//what the vertex shader decodes: encoded, stored as R16G16_SNORM, read back the way the input
+//assembler reads it and unfolded. the angle comes from atan2 of the cross and dot products in
+//double, which unlike acos of the dot still resolves thousandths of a degree. 16 bits a
+//component keeps every normal within about 0.004 degrees
+TEST(VertexFormats_OctahedralSnormMaxAngularError) {
+	unsigned int seed = 4242;
+	auto next = [&]() {
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / 16777216.0f;
+	};
+
+	double worstDegrees = 0;
+	for (int i = 0; i < 100000; i++) {
+		float z = next() * 2 - 1, angle = next() * 6.2831853f, r = sqrtf(1 - z * z);
+		DirectX::XMFLOAT3 normal{ r * cosf(angle), r * sinf(angle), z };
+		DirectX::XMFLOAT2 encoded = VertexFormats::EncodeOctahedral(normal);
+		DirectX::PackedVector::XMSHORTN2 stored;
+		DirectX::PackedVector::XMStoreShortN2(&stored, DirectX::XMLoadFloat2(&encoded));
+		DirectX::XMStoreFloat2(&encoded, DirectX::PackedVector::XMLoadShortN2(&stored));
+		DirectX::XMFLOAT3 decoded = VertexFormats::DecodeOctahedral(encoded);
+
+		double cx = (double)normal.y * decoded.z - (double)normal.z * decoded.y;
+		double cy = (double)normal.z * decoded.x - (double)normal.x * decoded.z;
+		double cz = (double)normal.x * decoded.y - (double)normal.y * decoded.x;
+		double dot = (double)normal.x * decoded.x + (double)normal.y * decoded.y + (double)normal.z * decoded.z;
+		double degrees = atan2(sqrt(cx * cx + cy * cy + cz * cz), dot) * 180 / 3.14159265358979;
+		worstDegrees = std::max(worstDegrees, degrees);
+	}
+	CHECK(worstDegrees > 0);
+	CHECK(worstDegrees < 0.005);
+}
+
+TEST(VertexFormats_NarrowIndicesOnlyUnder65535) {
+	unsigned int indices[] = { 0, 1, 65534 };
+	std::vector<uint16_t> narrowed;
+	CHECK(VertexFormats::NarrowIndices(indices, 3, 65535, narrowed));
+	CHECK(narrowed.size() == 3 && narrowed[2] == 65534);
+	//65535 is the strip cut, a mesh needing it as a vertex stays 32 bit
+	CHECK(!VertexFormats::NarrowIndices(indices, 3, 65536, narrowed));
+}
\ No newline at end of file
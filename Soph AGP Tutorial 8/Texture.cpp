@@ -1,18 +1,28 @@
 #include "Texture.h"
 
-#include <WICTextureLoader.h>
+#ifndef HEADLESS_ONLY
 #include <d3d11.h>
+#endif
+#ifdef _WIN32
+#include <wincodec.h>
+#include <wrl/client.h>
+#endif
 
 #include "Renderer.h"
+#include "Profiler.h"
+#include "Debug.h"
 
-Texture::Texture(Renderer& renderer, std::string path) {
-	//get device and context from renderer
-	ID3D11Device* dev = renderer.GetDevice();
-	ID3D11DeviceContext* devCon = renderer.GetDeviceCon();
+#ifdef _WIN32
+using Microsoft::WRL::ComPtr;
+#endif
 
-	//get filepath as wide string then load texture from it
-	std::wstring filepath = std::wstring(path.begin(), path.end());
-	DirectX::CreateWICTextureFromFile(dev, devCon, filepath.c_str(), NULL, &texture);
+static unsigned int nextId = 1;
+
+Texture::Texture(Renderer& renderer)
+	: dev(renderer.GetDevice()), devCon(renderer.GetDeviceCon()), id(nextId++), keepData(renderer.keepCaptureData) {
+#ifndef HEADLESS_ONLY
+	if (!dev)
+		return; //headless, nothing to sample with
 
 	//create sampler description
 	D3D11_SAMPLER_DESC samplerDesc;
@@ -27,11 +37,120 @@ Texture::Texture(Renderer& renderer, std::string path) {
 	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
 	//LODs
 	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
-	//create sampler from desc
-	dev->CreateSamplerState(&samplerDesc, &sampler);
+	//every texture asks for this same one, the cache makes it once and they all share it
+	sampler = renderer.GetStates().GetSampler(samplerDesc);
+#endif
+}
+
+Texture::Texture(Renderer& renderer, std::string path)
+	: Texture(renderer) {
+
+	TextureData data;
+	if (Decode(path, data)) {
+		Upload(data);
+	}
+}
+
+bool Texture::Decode([[maybe_unused]] std::string path, [[maybe_unused]] TextureData& outData) {
+	PROFILE_ZONE("Texture::Decode");
+#ifdef _WIN32
+	//WIC is COM, every thread using it needs COM started. this is ref counted so
+	//it's fine if the thread already has it
+	HRESULT comResult = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+	bool decoded = false;
+	{
+		ComPtr<IWICImagingFactory> factory;
+		ComPtr<IWICBitmapDecoder> decoder;
+		ComPtr<IWICBitmapFrameDecode> frame;
+		ComPtr<IWICFormatConverter> converter;
+
+		//get filepath as wide string then decode the first frame from it
+		std::wstring filepath = std::wstring(path.begin(), path.end());
+		HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(factory.GetAddressOf()));
+		if (SUCCEEDED(hr))
+			hr = factory->CreateDecoderFromFilename(filepath.c_str(), nullptr, GENERIC_READ,
+				WICDecodeMetadataCacheOnDemand, decoder.GetAddressOf());
+		if (SUCCEEDED(hr))
+			hr = decoder->GetFrame(0, frame.GetAddressOf());
+		if (SUCCEEDED(hr))
+			hr = frame->GetSize(&outData.width, &outData.height);
+
+		//whatever the file's format, convert to the rgba8 we upload as
+		if (SUCCEEDED(hr))
+			hr = factory->CreateFormatConverter(converter.GetAddressOf());
+		if (SUCCEEDED(hr))
+			hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone,
+				nullptr, 0.0, WICBitmapPaletteTypeMedianCut);
+		if (SUCCEEDED(hr)) {
+			UINT rowPitch = outData.width * 4;
+			outData.pixels.resize((size_t)rowPitch * outData.height);
+			hr = converter->CopyPixels(nullptr, rowPitch, (UINT)outData.pixels.size(), outData.pixels.data());
+		}
+
+		if (FAILED(hr)) {
+			LOG("Failed to decode texture " + path);
+			outData = TextureData();
+		}
+		decoded = SUCCEEDED(hr);
+	}
+
+	if (SUCCEEDED(comResult))
+		CoUninitialize();
+	return decoded;
+#else
+	//WIC is all there is to decode with, elsewhere textures stay untextured
+	LOG("No image decoder on this platform, can't load " + path);
+	return false;
+#endif
+}
+
+void Texture::Upload(const TextureData& data) {
+	PROFILE_ZONE("Texture::Upload");
+	if (data.pixels.empty())
+		return;
+	if (keepData)
+		keptData = std::make_shared<TextureData>(data);
+#ifndef HEADLESS_ONLY
+	if (!dev)
+		return;
+
+	//mip levels 0 makes a full chain, the gpu fills the smaller ones in from the top level
+	D3D11_TEXTURE2D_DESC desc = { 0 };
+	desc.Width = data.width;
+	desc.Height = data.height;
+	desc.MipLevels = 0;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET; //render target is needed for GenerateMips
+	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+
+	ID3D11Texture2D* tex = nullptr;
+	if (FAILED(dev->CreateTexture2D(&desc, nullptr, &tex))) {
+		LOG("Failed to create texture");
+		return;
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = desc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = (UINT)-1;
+	HRESULT hr = dev->CreateShaderResourceView(tex, &srvDesc, &texture);
+	if (SUCCEEDED(hr)) {
+		devCon->UpdateSubresource(tex, 0, nullptr, data.pixels.data(), data.width * 4, 0);
+		devCon->GenerateMips(texture);
+	}
+	else {
+		LOG("Failed to create texture view");
+	}
+	tex->Release(); //the view holds its own reference
+#endif
 }
 
 Texture::~Texture() {
+#ifndef HEADLESS_ONLY
 	if (texture) texture->Release();
-	if (sampler) sampler->Release();
+#endif
 }
\ No newline at end of file
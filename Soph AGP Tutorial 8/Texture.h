@@ -1,21 +1,50 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
 
 class Renderer;
+struct ID3D11Device;
+struct ID3D11DeviceContext;
 struct ID3D11ShaderResourceView; //ref to our texture
-struct ID3D11SamplerState; //ref to the sampler we're using (point, bilinear, etc)
+struct ID3D11SamplerState; //ref to the sampler we're using (point, bilinear, etc), shared between textures
+
+//decoded image waiting to go to the gpu, Texture::Decode fills it in on any thread
+struct TextureData
+{
+	unsigned int width = 0;
+	unsigned int height = 0;
+	std::vector<uint8_t> pixels; //rgba, 8 bits per channel, rows packed tightly
+};
 
 class Texture
 {
 private:
+	ID3D11Device* dev;
+	ID3D11DeviceContext* devCon;
 	ID3D11ShaderResourceView* texture = nullptr;
-	ID3D11SamplerState* sampler = nullptr;
+	ID3D11SamplerState* sampler = nullptr; //the renderer's StateCache owns it
+	unsigned int id; //small number unique per texture, 0 is never used
+	bool keepData; //the renderer's keepCaptureData when this was made
+	std::shared_ptr<const TextureData> keptData;
 
 public:
 	ID3D11ShaderResourceView* GetTexture() { return texture; }
 	ID3D11SamplerState* GetSampler() { return sampler; }
+	bool IsResident() { return texture != nullptr; }
+	unsigned int GetId() { return id; }
+	//the image Upload was given, null unless the renderer was keeping capture data
+	std::shared_ptr<const TextureData> GetKeptData() { return keptData; }
 
 	Texture(Renderer& renderer, std::string path); //refs to our renderer and the texture's file path
+	//no image yet, the AssetLoader uploads one later
+	Texture(Renderer& renderer);
 	~Texture();
-};
 
+	//reads and decodes the file with WIC, doesn't touch d3d so it's safe on a loading thread
+	static bool Decode(std::string path, TextureData& outData);
+	//creates the texture with a full mip chain, render thread only. on a headless renderer only
+	//the capture copy is kept, the texture never becomes resident
+	void Upload(const TextureData& data);
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+ThreadPool::ThreadPool(unsigned int threadCount, std::string name)
+	: name(name) {
+	if (threadCount == 0) {
+		unsigned int cores = std::thread::hardware_concurrency();
+		threadCount = (cores > 1) ? cores - 1 : 1;
+	}
+
+	workers.reserve(threadCount);
+	for (unsigned int i = 0; i < threadCount; i++) {
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		stopping = true;
+	}
+	jobAdded.notify_all();
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+void ThreadPool::Submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAdded.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+	std::unique_lock<std::mutex> lock(jobsMutex);
+	jobFinished.wait(lock, [this]() { return jobs.empty() && busyWorkers == 0; });
+}
+
+size_t ThreadPool::DropQueued() {
+	std::deque<std::function<void()>> dropped;
+	{
+		std::lock_guard<std::mutex> lock(jobsMutex);
+		dropped.swap(jobs);
+	}
+	jobFinished.notify_all();
+	return dropped.size(); //destroyed out here, a job's captures could be anything
+}
+
+void ThreadPool::WorkerLoop() {
+	Profiler::SetThreadName(name);
+	while (true) {
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(jobsMutex);
+			jobAdded.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (jobs.empty())
+				return; //stopping and nothing left to do
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+			busyWorkers++;
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(jobsMutex);
+			busyWorkers--;
+		}
+		jobFinished.notify_all();
+	}
+}
\ No newline at end of file
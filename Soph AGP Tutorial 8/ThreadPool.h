@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string>
+
+//fixed set of worker threads pulling jobs off a shared queue, first in first out
+class ThreadPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> jobs;
+	std::mutex jobsMutex;
+	std::condition_variable jobAdded;
+	std::condition_variable jobFinished;
+	size_t busyWorkers = 0;
+	bool stopping = false;
+
+	std::string name;
+
+	void WorkerLoop();
+
+public:
+	//0 uses one thread per core, leaving one for the thread that created us. name labels the
+	//workers in profiler captures
+	ThreadPool(unsigned int threadCount = 0, std::string name = "Worker");
+	//finishes the jobs already queued before the workers exit
+	~ThreadPool();
+
+	void Submit(std::function<void()> job);
+	//blocks until the queue is empty and every worker is idle
+	void WaitIdle();
+	//throws away every job not started yet, ones already running still finish. returns how
+	//many were dropped
+	size_t DropQueued();
+
+	size_t GetThreadCount() { return workers.size(); }
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+};
\ No newline at end of file
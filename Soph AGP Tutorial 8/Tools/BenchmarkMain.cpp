@@ -0,0 +1,13 @@
+#include <string>
+
+#include "Benchmarks.h"
+
+//agp_benchmark <name> <args>, the game's -benchmark without a window or d3d11. run from the
+//project folder so Assets/ is where the benchmarks look for it
+int main(int argc, char** argv) {
+	std::string args;
+	for (int i = 1; i < argc; i++) {
+		args += std::string(argv[i]) + " ";
+	}
+	return Benchmarks::Run(args.empty() ? "frame" : args.c_str());
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <numeric>
+#include <algorithm>
+#include <cstring>
+
+#include "FrameCapture.h"
+#include "FrameReplay.h"
+#include "SoftwareRasteriser.h"
+#include "ThreadPool.h"
+
+//agp_replay <capture> [software|null] [per-draw]. plays back a file Renderer::SaveCapture wrote,
+//with no window or gpu, printing each frame's times and the slowest draws and writing every draw
+//to replay.csv. software draws the frames as well and writes the last one to replay.tga. per-draw
+//shades after every draw so each gets its own shading time, otherwise draws are compared by the
+//pixels they shaded
+int main(int argc, char** argv) {
+	const char* path = argc > 1 ? argv[1] : "capture.agpc";
+	bool software = !(argc > 2 && strcmp(argv[2], "null") == 0);
+	bool perDraw = argc > 3 && strcmp(argv[3], "per-draw") == 0;
+
+	FrameCapture capture;
+	if (!capture.Load(path)) {
+		std::cout << "Failed to load capture " << path << std::endl;
+		return 1;
+	}
+
+	ThreadPool pool(0, "Replay");
+	SoftwareRasteriser rasteriser(std::max(capture.width, 1), std::max(capture.height, 1));
+	FrameReplay replay(capture);
+	replay.finishEachDraw = perDraw;
+	std::vector<ReplayDraw> draws;
+	std::cout << path << " on " << (software ? "software" : "null") << (perDraw ? " shading per draw" : "")
+		<< ", " << capture.frames.size() << " frames" << std::endl;
+	std::cout << "frame, commands, draws, skipped, draw ms, finish ms, total ms" << std::endl;
+	for (size_t frame = 0; frame < capture.frames.size(); frame++) {
+		ReplayFrameStats stats = replay.Replay(frame, software ? ReplayTarget::SOFTWARE : ReplayTarget::NULL_DEVICE,
+			&rasteriser, &pool, draws);
+		std::cout << frame << ", " << stats.commands << ", " << stats.draws << ", " << stats.skippedDraws << ", "
+			<< stats.drawMs << ", " << stats.finishMs << ", " << stats.totalMs << std::endl;
+	}
+
+	//binning and shading together when each draw was shaded on its own. without that a draw's
+	//shading is only known as pixels, so binning time is all there is to rank by
+	std::vector<size_t> slowest(draws.size());
+	std::iota(slowest.begin(), slowest.end(), 0);
+	size_t shown = std::min<size_t>(slowest.size(), 10);
+	std::partial_sort(slowest.begin(), slowest.begin() + shown, slowest.end(),
+		[&](size_t a, size_t b) { return draws[a].ms + draws[a].shadeMs > draws[b].ms + draws[b].shadeMs; });
+	std::cout << "slowest draws: frame, command, ms, shade ms, indices, instances, triangles, pixels" << std::endl;
+	for (size_t i = 0; i < shown; i++) {
+		const ReplayDraw& draw = draws[slowest[i]];
+		std::cout << draw.frame << ", " << draw.command << ", " << draw.ms << ", " << draw.shadeMs << ", " << draw.indexCount << ", "
+			<< draw.instanceCount << ", " << draw.triangles << ", " << draw.pixels << std::endl;
+	}
+
+	std::ofstream csv{ "replay.csv", std::ios::trunc };
+	csv << "frame,command,instanced,depth only,transparent,skipped,texture,indices,instances,triangles,pixels,ms,shade ms\n";
+	for (const ReplayDraw& draw : draws) {
+		csv << draw.frame << "," << draw.command << "," << draw.instanced << "," << draw.depthOnly << ","
+			<< draw.transparent << "," << draw.skipped << "," << draw.texture << "," << draw.indexCount << ","
+			<< draw.instanceCount << "," << draw.triangles << "," << draw.pixels << "," << draw.ms << "," << draw.shadeMs << "\n";
+	}
+	std::cout << (csv ? "Wrote replay.csv" : "Failed to write replay.csv") << std::endl;
+	if (software)
+		std::cout << (rasteriser.WriteTga("replay.tga") ? "Wrote replay.tga" : "Failed to write replay.tga") << std::endl;
+	return 0;
+}
\ No newline at end of file
@@ -72,6 +72,10 @@ void Transform::Translate(DirectX::XMVECTOR translation) {
 	position = DirectX::XMVectorAdd(position, translation);
 }
 
+void Transform::SetScale(DirectX::XMVECTOR newScale) {
+	scale = newScale;
+}
+
 
 void Transform::Rotate(DirectX::XMVECTOR inRotation) {
 	rotation = DirectX::XMVectorAddAngles(rotation, inRotation);
@@ -24,6 +24,7 @@ public:
 
 	void SetPosition(DirectX::XMVECTOR newPosition);
 	void Translate(DirectX::XMVECTOR translation);
+	void SetScale(DirectX::XMVECTOR newScale);
 
 	void Rotate(DirectX::XMVECTOR inRotation);
 };
@@ -0,0 +1,194 @@
+#include "VertexFormats.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "ModelLoader.h"
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace VertexFormats {
+
+	size_t GetStride(VertexLayout layout) {
+		switch (layout) {
+		case VertexLayout::COMPACT:
+			return sizeof(VertexCompact);
+		case VertexLayout::QUANTISED:
+			return sizeof(VertexQuantised);
+		case VertexLayout::FULL:
+		default:
+			return sizeof(VertexPosUVNorm);
+		}
+	}
+
+	size_t GetPositionSize(VertexLayout layout) {
+		switch (layout) {
+		case VertexLayout::QUANTISED:
+			return sizeof(DirectX::PackedVector::XMSHORTN4);
+		case VertexLayout::COMPACT:
+		case VertexLayout::FULL:
+		default:
+			return sizeof(DirectX::XMFLOAT3);
+		}
+	}
+
+	static float SignNotZero(float v) {
+		return (v >= 0.0f) ? 1.0f : -1.0f;
+	}
+
+	XMFLOAT2 EncodeOctahedral(XMFLOAT3 n) {
+		//project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the top
+		float sum = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		if (sum == 0.0f)
+			return { 0.0f, 0.0f };
+
+		XMFLOAT2 e{ n.x / sum, n.y / sum };
+		if (n.z < 0.0f) {
+			e = { (1.0f - fabsf(e.y)) * SignNotZero(e.x), (1.0f - fabsf(e.x)) * SignNotZero(e.y) };
+		}
+		return e;
+	}
+
+	XMFLOAT3 DecodeOctahedral(XMFLOAT2 e) {
+		XMFLOAT3 n{ e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y) };
+		if (n.z < 0.0f) {
+			n.x = (1.0f - fabsf(e.y)) * SignNotZero(e.x);
+			n.y = (1.0f - fabsf(e.x)) * SignNotZero(e.y);
+		}
+		XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+		return n;
+	}
+
+	static XMSHORTN2 PackNormal(const XMFLOAT3& normal) {
+		XMFLOAT2 encoded = EncodeOctahedral(normal);
+		XMSHORTN2 packed;
+		XMStoreShortN2(&packed, XMLoadFloat2(&encoded));
+		return packed;
+	}
+
+	static XMHALF2 PackUV(const XMFLOAT2& uv) {
+		XMHALF2 packed;
+		XMStoreHalf2(&packed, XMLoadFloat2(&uv));
+		return packed;
+	}
+
+	std::vector<uint8_t> Pack(const VertexPosUVNorm* vertices, size_t vertexCount, VertexLayout layout,
+		XMFLOAT3 boundsMin, XMFLOAT3 boundsMax, XMFLOAT4X4& outDequantise) {
+
+		XMStoreFloat4x4(&outDequantise, XMMatrixIdentity());
+		std::vector<uint8_t> packed(vertexCount * GetStride(layout));
+
+		if (layout == VertexLayout::FULL) {
+			memcpy(packed.data(), vertices, packed.size());
+			return packed;
+		}
+
+		if (layout == VertexLayout::COMPACT) {
+			VertexCompact* out = (VertexCompact*)packed.data();
+			for (size_t i = 0; i < vertexCount; i++) {
+				out[i].pos = vertices[i].pos;
+				out[i].uv = PackUV(vertices[i].uv);
+				out[i].norm = PackNormal(vertices[i].norm);
+			}
+			return packed;
+		}
+
+		//positions are stored as -1..1 across the bounds, scale and offset bring them back
+		XMVECTOR bMin = XMLoadFloat3(&boundsMin);
+		XMVECTOR bMax = XMLoadFloat3(&boundsMax);
+		XMVECTOR centre = XMVectorScale(XMVectorAdd(bMin, bMax), 0.5f);
+		XMVECTOR extent = XMVectorScale(XMVectorSubtract(bMax, bMin), 0.5f);
+		//flat axes would divide by zero, any scale works for them
+		extent = XMVectorSelect(extent, XMVectorSplatOne(), XMVectorEqual(extent, XMVectorZero()));
+		XMVECTOR invExtent = XMVectorReciprocal(extent);
+
+		VertexQuantised* out = (VertexQuantised*)packed.data();
+		for (size_t i = 0; i < vertexCount; i++) {
+			XMVECTOR pos = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&vertices[i].pos), centre), invExtent);
+			XMStoreShortN4(&out[i].pos, XMVectorSetW(pos, 1.0f));
+			out[i].uv = PackUV(vertices[i].uv);
+			out[i].norm = PackNormal(vertices[i].norm);
+		}
+
+		XMMATRIX dequantise = XMMatrixScalingFromVector(extent) * XMMatrixTranslationFromVector(centre);
+		XMStoreFloat4x4(&outDequantise, dequantise);
+		return packed;
+	}
+
+	void Unpack(const uint8_t* packed, size_t vertexCount, VertexLayout layout, VertexPosUVNorm* outVertices) {
+		if (layout == VertexLayout::FULL) {
+			memcpy(outVertices, packed, vertexCount * sizeof(VertexPosUVNorm));
+			return;
+		}
+
+		for (size_t i = 0; i < vertexCount; i++) {
+			XMVECTOR pos, uv, norm;
+			if (layout == VertexLayout::COMPACT) {
+				const VertexCompact& v = ((const VertexCompact*)packed)[i];
+				pos = XMLoadFloat3(&v.pos);
+				uv = XMLoadHalf2(&v.uv);
+				norm = XMLoadShortN2(&v.norm);
+			}
+			else {
+				const VertexQuantised& v = ((const VertexQuantised*)packed)[i];
+				pos = XMLoadShortN4(&v.pos);
+				uv = XMLoadHalf2(&v.uv);
+				norm = XMLoadShortN2(&v.norm);
+			}
+
+			XMFLOAT2 encoded;
+			XMStoreFloat2(&encoded, norm);
+			XMStoreFloat3(&outVertices[i].pos, pos);
+			XMStoreFloat2(&outVertices[i].uv, uv);
+			outVertices[i].norm = DecodeOctahedral(encoded);
+		}
+	}
+
+	PackError MeasureError(const VertexPosUVNorm* vertices, size_t vertexCount, VertexLayout layout,
+		const std::vector<uint8_t>& packed, const XMFLOAT4X4& dequantise) {
+
+		PackError error;
+		if (layout == VertexLayout::FULL)
+			return error;
+
+		std::vector<VertexPosUVNorm> unpacked(vertexCount);
+		Unpack(packed.data(), vertexCount, layout, unpacked.data());
+		XMMATRIX dequantiseMatrix = XMLoadFloat4x4(&dequantise);
+		for (size_t i = 0; i < vertexCount; i++) {
+			XMVECTOR pos = XMLoadFloat3(&unpacked[i].pos);
+			if (layout == VertexLayout::QUANTISED)
+				pos = XMVector3TransformCoord(pos, dequantiseMatrix);
+			XMVECTOR uv = XMLoadFloat2(&unpacked[i].uv);
+			XMFLOAT3 decoded = unpacked[i].norm;
+
+			float posError = XMVectorGetX(XMVector3Length(XMVectorSubtract(pos, XMLoadFloat3(&vertices[i].pos))));
+			float uvError = XMVectorGetX(XMVector2Length(XMVectorSubtract(uv, XMLoadFloat2(&vertices[i].uv))));
+			error.position = std::max(error.position, posError);
+			error.uv = std::max(error.uv, uvError);
+
+			//only meaningful for real normals, formats without them leave zeros
+			XMVECTOR source = XMLoadFloat3(&vertices[i].norm);
+			if (XMVectorGetX(XMVector3LengthSq(source)) > 0.0f) {
+				float cosAngle = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&decoded), XMVector3Normalize(source)));
+				float degrees = XMConvertToDegrees(acosf(std::min(1.0f, std::max(-1.0f, cosAngle))));
+				error.normalDegrees = std::max(error.normalDegrees, degrees);
+			}
+		}
+		return error;
+	}
+
+	bool NarrowIndices(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+		std::vector<uint16_t>& outIndices) {
+
+		//0xffff is left alone, it's the strip cut value
+		if (vertexCount > 0xffff)
+			return false;
+
+		outIndices.resize(indexCount);
+		for (size_t i = 0; i < indexCount; i++)
+			outIndices[i] = (uint16_t)indices[i];
+		return true;
+	}
+}
\ No newline at end of file
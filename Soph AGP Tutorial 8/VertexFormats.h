@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+struct VertexPosUVNorm;
+
+//how a mesh's vertices are stored on the gpu. every layout keeps the same
+//pos, uv, norm element order so the shader's input signature doesn't change
+enum class VertexLayout
+{
+	FULL,		//VertexPosUVNorm, 32 bytes of floats
+	COMPACT,	//float positions, half uvs, octahedral normals. 20 bytes
+	QUANTISED	//16 bit positions inside the mesh bounds as well. 16 bytes
+};
+
+struct VertexCompact
+{
+	DirectX::XMFLOAT3 pos;
+	DirectX::PackedVector::XMHALF2 uv;
+	DirectX::PackedVector::XMSHORTN2 norm; //octahedral encoded
+};
+
+struct VertexQuantised
+{
+	DirectX::PackedVector::XMSHORTN4 pos; //-1..1 across the bounds, w unused
+	DirectX::PackedVector::XMHALF2 uv;
+	DirectX::PackedVector::XMSHORTN2 norm; //octahedral encoded
+};
+
+namespace VertexFormats {
+	//worst case differences between the packed data and the source vertices
+	struct PackError
+	{
+		float position = 0; //object space units
+		float uv = 0;
+		float normalDegrees = 0;
+	};
+
+	size_t GetStride(VertexLayout layout);
+	//bytes at the start of each vertex that are its position, the rest is uv and normal
+	size_t GetPositionSize(VertexLayout layout);
+
+	//packs vertices into the layout. outDequantise maps stored positions back to
+	//object space, it's identity for everything but QUANTISED
+	std::vector<uint8_t> Pack(const VertexPosUVNorm* vertices, size_t vertexCount, VertexLayout layout,
+		DirectX::XMFLOAT3 boundsMin, DirectX::XMFLOAT3 boundsMax, DirectX::XMFLOAT4X4& outDequantise);
+
+	//back to VertexPosUVNorm. QUANTISED positions stay in their -1..1 box, the dequantise matrix
+	//Pack gave moves them into object space
+	void Unpack(const uint8_t* packed, size_t vertexCount, VertexLayout layout, VertexPosUVNorm* outVertices);
+
+	//unpacks again and compares against the source, for checking the precision we give up
+	PackError MeasureError(const VertexPosUVNorm* vertices, size_t vertexCount, VertexLayout layout,
+		const std::vector<uint8_t>& packed, const DirectX::XMFLOAT4X4& dequantise);
+
+	DirectX::XMFLOAT2 EncodeOctahedral(DirectX::XMFLOAT3 normal);
+	DirectX::XMFLOAT3 DecodeOctahedral(DirectX::XMFLOAT2 encoded);
+
+	//copies indices into 16 bits, returns false if any of them don't fit
+	bool NarrowIndices(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+		std::vector<uint16_t>& outIndices);
+}
\ No newline at end of file
@@ -2,6 +2,9 @@ struct VIn
 {
     float3 position : POSITION;
     float2 uv : TEXCOORD;
+    //FULL has the normal itself. COMPACT and QUANTISED have an octahedral xy, R16G16_SNORM in
+    //their input layouts, which reads in with z 0
+    float3 normal : NORMAL;
 };
 
 struct VOut
@@ -9,18 +12,51 @@ struct VOut
     float4 position : SV_Position;
     float2 uv : TEXCOORD;
     float4 colour : COLOUR;
+    float3 normal : NORMAL; //world space, after what the pixel shader reads so far
 };
 
-cbuffer PerObjectCB
+//set once a frame, shared with the instanced shader
+cbuffer PerFrameCB : register(b0)
 {
-    matrix world;
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float4 cameraPosition;
+    float time;
 };
 
+//b1 is the pixel shader's per material buffer
+
+cbuffer PerObjectCB : register(b2)
+{
+    //affine, so the constant last column isn't sent. row_major to match XMStoreFloat3x4
+    row_major float3x4 world;
+    //inverse transpose of world's 3x3, stored the same way. takes object space normals to
+    //world space (unnormalised) whatever the scale. _m03 is 1 when NORMAL is octahedral
+    row_major float3x4 normalWorld;
+};
+
+//VertexFormats::DecodeOctahedral. the lower half of the sphere was folded over the diagonals
+//of the top, so points outside the inner diamond unfold back under it
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1 - abs(e.x) - abs(e.y));
+    if (n.z < 0)
+        n.xy = (1 - abs(e.yx)) * (e >= 0 ? 1 : -1);
+    return normalize(n);
+}
+
 VOut main( VIn input )
 {
     VOut output;
-    output.position = mul(world, float4(input.position, 1));
+    //precise, and the same maths as VertexShaderDepth.hlsl, so both passes land on exactly the
+    //same depth and the depth equal test after the pre-pass passes
+    precise float4 worldPosition = float4(mul(world, float4(input.position, 1)), 1);
+    precise float4 clipPosition = mul(viewProjection, worldPosition);
+    output.position = clipPosition;
     output.uv = input.uv;
     output.colour = float4(1, 1, 1, 1);
+    float3 normal = normalWorld._m03 != 0 ? DecodeOctahedral(input.normal.xy) : input.normal;
+    output.normal = normalize(mul(normalWorld, float4(normal, 0)));
 	return output;
 }
\ No newline at end of file
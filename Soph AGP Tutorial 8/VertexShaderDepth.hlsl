@@ -0,0 +1,30 @@
+//depth pre-pass. reads only the position stream and has no pixel shader, it just fills the
+//depth buffer so the shading pass runs its pixel shader once per pixel
+struct VIn
+{
+    float3 position : POSITION;
+};
+
+//same per frame and per object buffers as VertexShader.hlsl
+cbuffer PerFrameCB : register(b0)
+{
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float4 cameraPosition;
+    float time;
+};
+
+cbuffer PerObjectCB : register(b2)
+{
+    row_major float3x4 world;
+    row_major float3x4 normalWorld;
+};
+
+float4 main( VIn input ) : SV_Position
+{
+    //has to match VertexShader.hlsl to the bit, the shading pass tests depth for equality
+    precise float4 worldPosition = float4(mul(world, float4(input.position, 1)), 1);
+    precise float4 clipPosition = mul(viewProjection, worldPosition);
+    return clipPosition;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+//depth pre-pass for instanced draws, see VertexShaderDepth.hlsl
+struct VIn
+{
+    float3 position : POSITION;
+    //the first three rows of each instance, the normal matrix after them isn't needed
+    float4 world0 : INSTANCE_WORLD0;
+    float4 world1 : INSTANCE_WORLD1;
+    float4 world2 : INSTANCE_WORLD2;
+};
+
+cbuffer PerFrameCB : register(b0)
+{
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float4 cameraPosition;
+    float time;
+};
+
+float4 main( VIn input ) : SV_Position
+{
+    //has to match VertexShaderInstanced.hlsl to the bit
+    float3x4 world = float3x4(input.world0, input.world1, input.world2);
+    precise float4 worldPosition = float4(mul(world, float4(input.position, 1)), 1);
+    precise float4 clipPosition = mul(viewProjection, worldPosition);
+    return clipPosition;
+}
\ No newline at end of file
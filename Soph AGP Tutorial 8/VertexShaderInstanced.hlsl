@@ -0,0 +1,57 @@
+struct VIn
+{
+    float3 position : POSITION;
+    float2 uv : TEXCOORD;
+    float3 normal : NORMAL; //as in VertexShader.hlsl
+    //VertexShader.hlsl's per object world and normal matrices, a row per element. INSTANCE_
+    //semantics are read from the second vertex buffer once per instance instead of once per vertex
+    float4 world0 : INSTANCE_WORLD0;
+    float4 world1 : INSTANCE_WORLD1;
+    float4 world2 : INSTANCE_WORLD2;
+    float4 normalWorld0 : INSTANCE_NORMAL0;
+    float4 normalWorld1 : INSTANCE_NORMAL1;
+    float4 normalWorld2 : INSTANCE_NORMAL2;
+};
+
+struct VOut
+{
+    float4 position : SV_Position;
+    float2 uv : TEXCOORD;
+    float4 colour : COLOUR;
+    float3 normal : NORMAL;
+};
+
+//same per frame buffer as VertexShader.hlsl
+cbuffer PerFrameCB : register(b0)
+{
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float4 cameraPosition;
+    float time;
+};
+
+//same as VertexShader.hlsl
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1 - abs(e.x) - abs(e.y));
+    if (n.z < 0)
+        n.xy = (1 - abs(e.yx)) * (e >= 0 ? 1 : -1);
+    return normalize(n);
+}
+
+VOut main( VIn input )
+{
+    VOut output;
+    float3x4 world = float3x4(input.world0, input.world1, input.world2);
+    //precise to match VertexShaderDepthInstanced.hlsl exactly
+    precise float4 worldPosition = float4(mul(world, float4(input.position, 1)), 1);
+    precise float4 clipPosition = mul(viewProjection, worldPosition);
+    output.position = clipPosition;
+    output.uv = input.uv;
+    output.colour = float4(1, 1, 1, 1);
+    float3x4 normalWorld = float3x4(input.normalWorld0, input.normalWorld1, input.normalWorld2);
+    float3 normal = normalWorld._m03 != 0 ? DecodeOctahedral(input.normal.xy) : input.normal;
+    output.normal = normalize(mul(normalWorld, float4(normal, 0)));
+	return output;
+}
\ No newline at end of file
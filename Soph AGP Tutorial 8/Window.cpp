@@ -4,6 +4,15 @@
 
 LRESULT Window::WindowProc(HWND windowHandle, UINT message, WPARAM wParam, LPARAM lParam) {
 	switch (message) {
+	case WM_SIZE: { //window resized, maximised or minimised. the renderer resizes its buffers to match next frame
+		Window* window = (Window*)GetWindowLongPtr(windowHandle, GWLP_USERDATA);
+		if (window) {
+			window->width = LOWORD(lParam);
+			window->height = HIWORD(lParam);
+		}
+		return 0;
+	}
+
 	case WM_DESTROY: //if user closes window
 		PostQuitMessage(0); //send a quit message to the app
 		return 0;
@@ -84,8 +93,8 @@ Window::Window(int width, int height, HINSTANCE instanceHandle, int nCmdShow)
 	handle = CreateWindowEx(NULL,
 		L"Window Class 1", //name of our window class
 		windowName,
-		WS_OVERLAPPED | WS_MINIMIZEBOX | WS_SYSMENU, //window style with no resizing and maximising
-		//WS_OVERLAPPEDWINDOW,						 //alternative window style that allows resizing
+		WS_OVERLAPPEDWINDOW, //window style that allows resizing and maximising
+		//WS_OVERLAPPED | WS_MINIMIZEBOX | WS_SYSMENU, //alternative window style with no resizing and maximising
 		100, 100, //x and y positions of window
 		wr.right - wr.left, wr.bottom - wr.top, //width and heights of window
 		NULL, //no parent window, NULL
@@ -95,6 +104,7 @@ Window::Window(int width, int height, HINSTANCE instanceHandle, int nCmdShow)
 
 	//display the window on screen
 	if (Exists()) {
+		SetWindowLongPtr(handle, GWLP_USERDATA, (LONG_PTR)this); //so WindowProc can find us again
 		ShowWindow(handle, nCmdShow);
 	}
 	else {
@@ -1,14 +1,21 @@
 #include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
 #include "Window.h"
 #include "Renderer.h"
 #include "Mesh.h"
 #include "Texture.h"
+#include "Material.h"
 #include "GameObject.h"
 #include "BoxCollider.h"
+#include "Profiler.h"
+#include "Benchmarks.h"
 #include "Debug.h"
 
-const float walkSpeed = 0.001f;
-const float runSpeed = 0.003f;
+const float walkSpeed = 2.0f; //units per second
+const float runSpeed = 6.0f;
 
 //console debug stuff
 void OpenConsole() {
@@ -24,21 +31,64 @@ void OpenConsole() {
 	}
 }
 
+//for the command line modes, prints to the console we were started from or a new one when
+//there isn't one
+void AttachConsoleOrOpen() {
+	if (AttachConsole(ATTACH_PARENT_PROCESS)) {
+		FILE* fp = nullptr;
+		freopen_s(&fp, "CONOUT$", "w", stdout);
+		freopen_s(&fp, "CONOUT$", "w", stderr);
+	}
+	else {
+		OpenConsole();
+	}
+}
+
 //window main
 int WINAPI WinMain(_In_ HINSTANCE instanceH, _In_opt_ HINSTANCE prevInstanceH, _In_ LPSTR lpCmdLine, _In_ int  nCmdShow) {
+	//-benchmark <name> <args>, see Benchmarks.h. the ones timing the gpu get a window, the rest
+	//run headless the same as agp_benchmark
+	if (strncmp(lpCmdLine, "-benchmark", 10) == 0) {
+		AttachConsoleOrOpen();
+		if (!Benchmarks::WantsGpu(lpCmdLine + 10))
+			return Benchmarks::Run(lpCmdLine + 10);
+		Window window{ 800, 600, instanceH, nCmdShow };
+		Renderer renderer{ window };
+		int result = Benchmarks::Run(lpCmdLine + 10, &renderer);
+		renderer.Clean();
+		return result;
+	}
+
 	//initialise window with error check
 	Window window{ 800, 600, instanceH, nCmdShow };
 	Renderer renderer{ window };
+	//with -capture the last few frames are always recorded, so a slow one can be saved after
+	//the fact. it has to be on from the start, meshes only keep a cpu copy if they're uploaded
+	//while it is
+	bool capturing = strstr(lpCmdLine, "-capture") != nullptr;
+	if (capturing) {
+		renderer.keepCaptureData = true;
+		renderer.captureHistory = 4;
+	}
+	float averageFrameMs = 0;
+	bool spikeSaved = false;
 
-	//get models and textures
-	Mesh mesh_cube{ renderer, "Assets/Models/fish.obj" };
-	Mesh mesh_sphere{ renderer, "Assets/Models/sphere.obj" };
-	Texture tex_box{ renderer, "Assets/Textures/fish_texture.png" };
-	renderer.texture = &tex_box;
+	//get models and textures, these load in the background and pop in once they're uploaded
+	AssetLoader& assets = renderer.GetAssets();
+	std::shared_ptr<Mesh> mesh_cube = assets.LoadMesh("Assets/Models/fish.obj");
+	std::shared_ptr<Mesh> mesh_sphere = assets.LoadMesh("Assets/Models/sphere.obj");
+	std::shared_ptr<Texture> tex_box = assets.LoadTexture("Assets/Textures/fish_texture.png");
+	renderer.texture = tex_box.get();
 
 	//make gameobjects
-	GameObject obj1{ "Cube", &mesh_cube };
-	GameObject obj2{ "Sphere", &mesh_sphere };
+	GameObject obj1{ "Cube", mesh_cube };
+	GameObject obj2{ "Sphere", mesh_sphere };
+
+	//the sphere gets a tinted copy of the fish look
+	std::shared_ptr<Material> mat_tinted = std::make_shared<Material>();
+	mat_tinted->texture = tex_box;
+	mat_tinted->colour = { 1, 0.6f, 0.6f, 1 };
+	obj2.material = mat_tinted;
 
 	//set camera and gameobject positions
 	renderer.camera.transform.SetPosition({ 0, 0, -5 });
@@ -58,6 +108,9 @@ int WINAPI WinMain(_In_ HINSTANCE instanceH, _In_opt_ HINSTANCE prevInstanceH, _
 	//used to hold windows event messages
 	MSG msg;
 
+	Profiler::SetThreadName("Main");
+	auto lastFrame = std::chrono::steady_clock::now();
+
 	//main game loop
 	while (true) {
 		if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
@@ -68,8 +121,27 @@ int WINAPI WinMain(_In_ HINSTANCE instanceH, _In_opt_ HINSTANCE prevInstanceH, _
 			if (msg.message == WM_QUIT) break; //break out of the loop if get quit message
 		}
 		else {
-			//calculate delta time, i will do properly later
-			float deltaTime = 0.001f;
+			PROFILE_ZONE("Frame");
+
+			//seconds since the last frame, capped so a long stall (dragging the window, a breakpoint)
+			//doesn't throw everything across the scene
+			auto now = std::chrono::steady_clock::now();
+			float frameMs = std::chrono::duration<float, std::milli>(now - lastFrame).count();
+			float deltaTime = std::min(frameMs / 1000.0f, 0.1f);
+			lastFrame = now;
+
+			//the first frame that takes four times the recent average, once everything's loaded,
+			//saves the frames leading up to it for agp_replay
+			if (capturing && !spikeSaved && assets.GetPendingCount() == 0 && averageFrameMs > 0 && frameMs > averageFrameMs * 4) {
+				spikeSaved = renderer.SaveCapture("spike.agpc");
+				if (spikeSaved)
+					LOG("Frame took " + std::to_string(frameMs) + "ms, saved spike.agpc");
+			}
+			averageFrameMs = averageFrameMs > 0 ? averageFrameMs * 0.95f + frameMs * 0.05f : frameMs;
+
+			//wait for the swap chain before reading input rather than in Present, so the input is
+			//as fresh as it can be when the frame is shown
+			renderer.WaitForFrame();
 
 			//get keyboard input state
 			auto kbState = DirectX::Keyboard::Get().GetState();
@@ -79,6 +151,49 @@ int WINAPI WinMain(_In_ HINSTANCE instanceH, _In_opt_ HINSTANCE prevInstanceH, _
 				PostQuitMessage(0);
 			}
 
+			//writes the last few frames of cpu and gpu timings, open it in chrome://tracing
+			if (kbTracker.pressed.P) {
+				OpenConsole();
+				if (Profiler::ExportChromeTrace("profile.json"))
+					std::cout << "Wrote profile.json" << std::endl;
+				else
+					std::cout << "Failed to write profile.json" << std::endl;
+			}
+
+			//vsync on and off, prints the latency of the last frame shown so the two can be compared
+			if (kbTracker.pressed.V) {
+				renderer.vsync = !renderer.vsync;
+				OpenConsole();
+				const FrameStats& stats = renderer.GetFrameStats();
+				std::cout << "Vsync " << (renderer.vsync ? "on" : "off") << ", input to present " << stats.inputToPresentMs
+					<< "ms, input to display " << stats.inputToDisplayMs << "ms" << std::endl;
+			}
+
+			//depth pre-pass on and off, -benchmark prepass compares the two on a scene with lots of overdraw
+			if (kbTracker.pressed.Z) {
+				renderer.depthPrepass = !renderer.depthPrepass;
+				OpenConsole();
+				std::cout << "Depth pre-pass " << (renderer.depthPrepass ? "on" : "off") << std::endl;
+			}
+
+			//saves the last few frames, play them back with agp_replay capture.agpc
+			if (kbTracker.pressed.C) {
+				OpenConsole();
+				if (!capturing)
+					std::cout << "Not recording frames, start with -capture to save them" << std::endl;
+				else
+					std::cout << (renderer.SaveCapture("capture.agpc") ? "Wrote capture.agpc" : "Failed to write capture.agpc") << std::endl;
+			}
+
+			//occlusion culling on and off, -benchmark occlusion measures it on a scene that's mostly hidden
+			if (kbTracker.pressed.O) {
+				renderer.occlusionCulling = !renderer.occlusionCulling;
+				OpenConsole();
+				const FrameStats& stats = renderer.GetFrameStats();
+				std::cout << "Occlusion culling " << (renderer.occlusionCulling ? "on" : "off") << ", last frame occluded "
+					<< stats.occlusion.objectsOccluded << " of " << stats.occlusion.objectsTested << " objects" << std::endl;
+			}
+
 			if (kbTracker.pressed.LeftShift) {
 				moveSpeed = runSpeed;
 			}
@@ -89,22 +204,22 @@ int WINAPI WinMain(_In_ HINSTANCE instanceH, _In_opt_ HINSTANCE prevInstanceH, _
 
 			//keyboard camera movement
 			if (kbTracker.lastState.W) {
-				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetForward(), moveSpeed));
+				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetForward(), moveSpeed * deltaTime));
 			}
 			if (kbTracker.lastState.S) {
-				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetForward(), -moveSpeed));
+				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetForward(), -moveSpeed * deltaTime));
 			}
 			if (kbTracker.lastState.A) {
-				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetRight(), -moveSpeed));
+				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetRight(), -moveSpeed * deltaTime));
 			}
 			if (kbTracker.lastState.D) {
-				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetRight(), moveSpeed));
+				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetRight(), moveSpeed * deltaTime));
 			}
 			if (kbTracker.lastState.Q) {
-				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetUp(), moveSpeed));
+				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetUp(), moveSpeed * deltaTime));
 			}
 			if (kbTracker.lastState.E) {
-				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetUp(), -moveSpeed));
+				renderer.camera.transform.Translate(DirectX::XMVectorScale(renderer.camera.transform.GetUp(), -moveSpeed * deltaTime));
 			}
 
 			//get mouse input state
@@ -115,6 +230,7 @@ int WINAPI WinMain(_In_ HINSTANCE instanceH, _In_opt_ HINSTANCE prevInstanceH, _
 			if (msState.leftButton) {
 				renderer.camera.transform.SetPosition({ 0, 0, -5 });
 			}
+			renderer.MarkInput(); //latency in the frame stats is measured from here
 
 			//camera collision
 			if (BoxCollider::BoxCollision(renderer.camera.transform, obj1.transform)) { renderer.RemoveGameObject(&obj1); }